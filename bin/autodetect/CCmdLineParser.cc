@@ -43,7 +43,9 @@ bool CCmdLineParser::parse(int argc,
                            bool& isRestoreFileNamedPipe,
                            std::string& persistFileName,
                            bool& isPersistFileNamedPipe,
+                           std::string& captureFileName,
                            bool& isPersistInForeground,
+                           std::size_t& persistIncrementally,
                            std::size_t& maxAnomalyRecords,
                            bool& memoryUsage) {
     try {
@@ -88,7 +90,11 @@ bool CCmdLineParser::parse(int argc,
             ("persist", boost::program_options::value<std::string>(),
                     "Optional file to persist state to - not present means no state persistence")
             ("persistIsPipe", "Specified persist file is a named pipe")
+            ("captureInput", boost::program_options::value<std::string>(),
+                    "Optional file to capture the input and its arrival times to so it can be replayed")
             ("persistInForeground", "Persistence occurs in the foreground. Defaults to background persistence.")
+            ("persistIncrementally", boost::program_options::value<std::size_t>(),
+                    "Optional number of detectors to persist after each input record. Implies foreground persistence. Defaults to 0, which persists all detectors at once.")
             ("bucketPersistInterval", boost::program_options::value<std::size_t>(),
                     "Optional number of buckets after which to periodically persist model state.")
             ("maxAnomalyRecords", boost::program_options::value<std::size_t>(),
@@ -177,9 +183,15 @@ bool CCmdLineParser::parse(int argc,
         if (vm.count("persistIsPipe") > 0) {
             isPersistFileNamedPipe = true;
         }
+        if (vm.count("captureInput") > 0) {
+            captureFileName = vm["captureInput"].as<std::string>();
+        }
         if (vm.count("persistInForeground") > 0) {
             isPersistInForeground = true;
         }
+        if (vm.count("persistIncrementally") > 0) {
+            persistIncrementally = vm["persistIncrementally"].as<std::size_t>();
+        }
         if (vm.count("maxAnomalyRecords") > 0) {
             maxAnomalyRecords = vm["maxAnomalyRecords"].as<std::size_t>();
         }
@@ -55,7 +55,9 @@ public:
                       bool& isRestoreFileNamedPipe,
                       std::string& persistFileName,
                       bool& isPersistFileNamedPipe,
+                      std::string& captureFileName,
                       bool& isPersistInForeground,
+                      std::size_t& persistIncrementally,
                       std::size_t& maxAnomalyRecords,
                       bool& memoryUsage);
 
@@ -106,7 +106,9 @@ int main(int argc, char** argv) {
     bool isRestoreFileNamedPipe{false};
     std::string persistFileName;
     bool isPersistFileNamedPipe{false};
+    std::string captureFileName;
     bool isPersistInForeground{false};
+    std::size_t persistIncrementally{0};
     std::size_t maxAnomalyRecords{100};
     bool memoryUsage{false};
     if (ml::autodetect::CCmdLineParser::parse(
@@ -116,7 +118,8 @@ int main(int argc, char** argv) {
             namedPipeConnectTimeout, inputFileName, isInputFileNamedPipe,
             outputFileName, isOutputFileNamedPipe, restoreFileName,
             isRestoreFileNamedPipe, persistFileName, isPersistFileNamedPipe,
-            isPersistInForeground, maxAnomalyRecords, memoryUsage) == false) {
+            captureFileName, isPersistInForeground, persistIncrementally,
+            maxAnomalyRecords, memoryUsage) == false) {
         return EXIT_FAILURE;
     }
 
@@ -128,7 +131,8 @@ int main(int argc, char** argv) {
     ml::api::CIoManager ioMgr{
         cancellerThread,        inputFileName,         isInputFileNamedPipe,
         outputFileName,         isOutputFileNamedPipe, restoreFileName,
-        isRestoreFileNamedPipe, persistFileName,       isPersistFileNamedPipe};
+        isRestoreFileNamedPipe, persistFileName,       isPersistFileNamedPipe,
+        captureFileName};
 
     if (cancellerThread.start() == false) {
         // This log message will probably never been seen as it will go to the
@@ -232,6 +236,11 @@ int main(int argc, char** argv) {
         return EXIT_FAILURE;
     }
 
+    // Incremental snapshots are written on the main thread between records.
+    if (persistIncrementally > 0) {
+        isPersistInForeground = true;
+    }
+
     using TPersistenceManagerUPtr = std::unique_ptr<ml::api::CPersistenceManager>;
     const TPersistenceManagerUPtr persistenceManager{
         [persistInterval, isPersistInForeground, &persister,
@@ -271,6 +280,7 @@ int main(int argc, char** argv) {
                              jobConfig.dataDescription().timeField(),
                              timeFormat,
                              maxAnomalyRecords};
+    job.persistIncrementally(persistIncrementally);
 
     if (!quantilesStateFile.empty()) {
         if (job.initNormalizer(quantilesStateFile) == false) {
@@ -35,6 +35,7 @@ bool CCmdLineParser::parse(int argc,
                            bool& isRestoreFileNamedPipe,
                            std::string& persistFileName,
                            bool& isPersistFileNamedPipe,
+                           std::string& captureFileName,
                            bool& isPersistInForeground,
                            std::string& categorizationFieldName) {
     try {
@@ -69,6 +70,8 @@ bool CCmdLineParser::parse(int argc,
             ("persist", boost::program_options::value<std::string>(),
                     "Optional file to persist state to - not present means no state persistence")
             ("persistIsPipe", "Specified persist file is a named pipe")
+            ("captureInput", boost::program_options::value<std::string>(),
+                    "Optional file to capture the input and its arrival times to so it can be replayed")
             ("persistInterval", boost::program_options::value<core_t::TTime>(),
                     "Optional interval at which to periodically persist model state - if not specified then models will only be persisted at program exit")
             ("persistInForeground", "Persistence occurs in the foreground. Defaults to background persistence.")
@@ -138,6 +141,9 @@ bool CCmdLineParser::parse(int argc,
         if (vm.count("persistIsPipe") > 0) {
             isPersistFileNamedPipe = true;
         }
+        if (vm.count("captureInput") > 0) {
+            captureFileName = vm["captureInput"].as<std::string>();
+        }
         if (vm.count("persistInForeground") > 0) {
             isPersistInForeground = true;
         }
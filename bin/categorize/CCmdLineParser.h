@@ -46,6 +46,7 @@ public:
                       bool& isRestoreFileNamedPipe,
                       std::string& persistFileName,
                       bool& isPersistFileNamedPipe,
+                      std::string& captureFileName,
                       bool& isPersistInForeground,
                       std::string& categorizationFieldName);
 
@@ -82,6 +82,7 @@ int main(int argc, char** argv) {
     bool isRestoreFileNamedPipe{false};
     std::string persistFileName;
     bool isPersistFileNamedPipe{false};
+    std::string captureFileName;
     bool isPersistInForeground{false};
     std::string categorizationFieldName;
     if (ml::categorize::CCmdLineParser::parse(
@@ -89,7 +90,7 @@ int main(int argc, char** argv) {
             lengthEncodedInput, persistInterval, namedPipeConnectTimeout, inputFileName,
             isInputFileNamedPipe, outputFileName, isOutputFileNamedPipe, restoreFileName,
             isRestoreFileNamedPipe, persistFileName, isPersistFileNamedPipe,
-            isPersistInForeground, categorizationFieldName) == false) {
+            captureFileName, isPersistInForeground, categorizationFieldName) == false) {
         return EXIT_FAILURE;
     }
 
@@ -101,7 +102,8 @@ int main(int argc, char** argv) {
     ml::api::CIoManager ioMgr{
         cancellerThread,        inputFileName,         isInputFileNamedPipe,
         outputFileName,         isOutputFileNamedPipe, restoreFileName,
-        isRestoreFileNamedPipe, persistFileName,       isPersistFileNamedPipe};
+        isRestoreFileNamedPipe, persistFileName,       isPersistFileNamedPipe,
+        captureFileName};
 
     if (cancellerThread.start() == false) {
         // This log message will probably never been seen as it will go to the
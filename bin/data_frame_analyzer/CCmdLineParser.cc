@@ -32,7 +32,10 @@ bool CCmdLineParser::parse(int argc,
                            std::string& restoreFileName,
                            bool& isRestoreFileNamedPipe,
                            std::string& persistFileName,
-                           bool& isPersistFileNamedPipe) {
+                           bool& isPersistFileNamedPipe,
+                           std::string& captureFileName,
+                           bool& numaAware,
+                           bool& hugePages) {
     try {
         boost::program_options::options_description desc(DESCRIPTION);
         // clang-format off
@@ -62,6 +65,10 @@ bool CCmdLineParser::parse(int argc,
             ("persist", boost::program_options::value<std::string>(),
                     "File to persist state to - not present means no state persistence")
             ("persistIsPipe", "Specified persist file is a named pipe")
+            ("captureInput", boost::program_options::value<std::string>(),
+                    "Optional file to capture the input and its arrival times to so it can be replayed")
+            ("numaAware", "Pin worker threads and place data frame memory on NUMA nodes")
+            ("hugePages", "Request transparent huge pages for large data frame slices")
         ;
         // clang-format on
 
@@ -120,6 +127,15 @@ bool CCmdLineParser::parse(int argc,
         if (vm.count("persistIsPipe") > 0) {
             isPersistFileNamedPipe = true;
         }
+        if (vm.count("captureInput") > 0) {
+            captureFileName = vm["captureInput"].as<std::string>();
+        }
+        if (vm.count("numaAware") > 0) {
+            numaAware = true;
+        }
+        if (vm.count("hugePages") > 0) {
+            hugePages = true;
+        }
     } catch (std::exception& e) {
         std::cerr << "Error processing command line: " << e.what() << std::endl;
         return false;
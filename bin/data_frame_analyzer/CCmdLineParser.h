@@ -41,7 +41,10 @@ public:
                       std::string& restoreFileName,
                       bool& isRestoreFileNamedPipe,
                       std::string& persistFileName,
-                      bool& isPersistFileNamedPipe);
+                      bool& isPersistFileNamedPipe,
+                      std::string& captureFileName,
+                      bool& numaAware,
+                      bool& hugePages);
 
 private:
     static const std::string DESCRIPTION;
@@ -19,6 +19,7 @@
 #include <core/CJsonOutputStreamWrapper.h>
 #include <core/CLogger.h>
 #include <core/CNonInstantiatable.h>
+#include <core/CNumaPlacement.h>
 #include <core/CProcessPriority.h>
 #include <core/CProgramCounters.h>
 #include <core/CStringUtils.h>
@@ -98,11 +99,15 @@ int main(int argc, char** argv) {
     bool isRestoreFileNamedPipe{false};
     std::string persistFileName;
     bool isPersistFileNamedPipe{false};
+    std::string captureFileName;
+    bool numaAware{false};
+    bool hugePages{false};
     if (ml::data_frame_analyzer::CCmdLineParser::parse(
             argc, argv, configFile, memoryUsageEstimationOnly, logProperties,
             logPipe, lengthEncodedInput, namedPipeConnectTimeout, inputFileName,
             isInputFileNamedPipe, outputFileName, isOutputFileNamedPipe, restoreFileName,
-            isRestoreFileNamedPipe, persistFileName, isPersistFileNamedPipe) == false) {
+            isRestoreFileNamedPipe, persistFileName, isPersistFileNamedPipe,
+            captureFileName, numaAware, hugePages) == false) {
         return EXIT_FAILURE;
     }
 
@@ -119,7 +124,8 @@ int main(int argc, char** argv) {
     ml::api::CIoManager ioMgr{
         cancellerThread,        inputFileName,         isInputFileNamedPipe,
         outputFileName,         isOutputFileNamedPipe, restoreFileName,
-        isRestoreFileNamedPipe, persistFileName,       isPersistFileNamedPipe};
+        isRestoreFileNamedPipe, persistFileName,       isPersistFileNamedPipe,
+        captureFileName};
 
     if (cancellerThread.start() == false) {
         // This log message will probably never been seen as it will go to the
@@ -207,6 +213,9 @@ int main(int argc, char** argv) {
         return EXIT_SUCCESS;
     }
 
+    // This must be configured before the thread pool is started.
+    ml::core::CNumaPlacement::configure(numaAware, hugePages);
+
     if (analysisSpecification->numberThreads() > 1) {
         ml::core::startDefaultAsyncExecutor(analysisSpecification->numberThreads());
     }
@@ -0,0 +1,92 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include "CCmdLineParser.h"
+
+#include <ver/CBuildInfo.h>
+
+#include <boost/program_options.hpp>
+
+#include <iostream>
+
+namespace ml {
+namespace input_replay {
+
+const std::string CCmdLineParser::DESCRIPTION =
+    "Usage: input_replay --capture <file> [options]\n"
+    "Replays input captured by autodetect, categorize or data_frame_analyzer\n"
+    "using their --captureInput option. For example, to replay a capture to\n"
+    "autodetect at its original pace:\n"
+    "    input_replay --capture input.gz | autodetect --config job.json ...\n"
+    "Options:";
+
+bool CCmdLineParser::parse(int argc,
+                           const char* const* argv,
+                           std::string& logProperties,
+                           core_t::TTime& namedPipeConnectTimeout,
+                           std::string& captureFileName,
+                           std::string& outputFileName,
+                           bool& isOutputFileNamedPipe,
+                           bool& asFastAsPossible) {
+    try {
+        boost::program_options::options_description desc(DESCRIPTION);
+        // clang-format off
+        desc.add_options()
+            ("help", "Display this information and exit")
+            ("version", "Display version information and exit")
+            ("logProperties", boost::program_options::value<std::string>(),
+                    "Optional logger properties file")
+            ("namedPipeConnectTimeout", boost::program_options::value<core_t::TTime>(),
+                    "Optional timeout (in seconds) for connecting named pipes on startup - default is 300 seconds")
+            ("capture", boost::program_options::value<std::string>()->required(),
+                    "The capture file to replay")
+            ("output", boost::program_options::value<std::string>(),
+                    "Optional file to write the replayed input to - not present means write to STDOUT")
+            ("outputIsPipe", "Specified output file is a named pipe")
+            ("asFastAsPossible",
+                    "Write the input as fast as the reader accepts it - default is to reproduce the captured arrival times")
+        ;
+        // clang-format on
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+            boost::program_options::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help") > 0) {
+            std::cerr << desc << std::endl;
+            return false;
+        }
+        if (vm.count("version") > 0) {
+            std::cerr << ver::CBuildInfo::fullInfo() << std::endl;
+            return false;
+        }
+        boost::program_options::notify(vm);
+        if (vm.count("logProperties") > 0) {
+            logProperties = vm["logProperties"].as<std::string>();
+        }
+        if (vm.count("namedPipeConnectTimeout") > 0) {
+            namedPipeConnectTimeout = vm["namedPipeConnectTimeout"].as<core_t::TTime>();
+        }
+        if (vm.count("capture") > 0) {
+            captureFileName = vm["capture"].as<std::string>();
+        }
+        if (vm.count("output") > 0) {
+            outputFileName = vm["output"].as<std::string>();
+        }
+        if (vm.count("outputIsPipe") > 0) {
+            isOutputFileNamedPipe = true;
+        }
+        if (vm.count("asFastAsPossible") > 0) {
+            asFastAsPossible = true;
+        }
+    } catch (std::exception& e) {
+        std::cerr << "Error processing command line: " << e.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+}
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_input_replay_CCmdLineParser_h
+#define INCLUDED_ml_input_replay_CCmdLineParser_h
+
+#include <core/CoreTypes.h>
+
+#include <string>
+
+namespace ml {
+namespace input_replay {
+
+//! \brief
+//! Very simple command line parser.
+//!
+//! DESCRIPTION:\n
+//! Very simple command line parser.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! Put in a class rather than main to allow testing.
+//!
+class CCmdLineParser {
+public:
+    //! Parse the arguments and return options if appropriate.
+    static bool parse(int argc,
+                      const char* const* argv,
+                      std::string& logProperties,
+                      core_t::TTime& namedPipeConnectTimeout,
+                      std::string& captureFileName,
+                      std::string& outputFileName,
+                      bool& isOutputFileNamedPipe,
+                      bool& asFastAsPossible);
+
+private:
+    static const std::string DESCRIPTION;
+};
+}
+}
+
+#endif // INCLUDED_ml_input_replay_CCmdLineParser_h
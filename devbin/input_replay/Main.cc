@@ -0,0 +1,154 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+//! \brief
+//! Replays input captured by an ML process.
+//!
+//! DESCRIPTION:\n
+//! Feeds the input recorded by the --captureInput option of autodetect,
+//! categorize or data_frame_analyzer to a process, either reproducing the
+//! original arrival times or as fast as the process will read it. When
+//! the original pace is reproduced, any lag behind the capture means the
+//! process couldn't keep up. This pinpoints the input which caused a slow
+//! down. A timing report is written to STDERR when the replay finishes.
+//! The process's own options, such as autodetect's --memoryUsage, report
+//! the resources it used.
+//!
+#include <core/CBlockingCallCancellingTimer.h>
+#include <core/CCaptureReader.h>
+#include <core/CLogger.h>
+#include <core/CNamedPipeFactory.h>
+#include <core/CoreTypes.h>
+
+#include <ver/CBuildInfo.h>
+
+#include "CCmdLineParser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <stdlib.h>
+
+namespace {
+using TClock = std::chrono::steady_clock;
+
+double toSeconds(TClock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+}
+
+int main(int argc, char** argv) {
+    // Read command line options
+    std::string logProperties;
+    ml::core_t::TTime namedPipeConnectTimeout{
+        ml::core::CBlockingCallCancellingTimer::DEFAULT_TIMEOUT_SECONDS};
+    std::string captureFileName;
+    std::string outputFileName;
+    bool isOutputFileNamedPipe{false};
+    bool asFastAsPossible{false};
+    if (ml::input_replay::CCmdLineParser::parse(
+            argc, argv, logProperties, namedPipeConnectTimeout, captureFileName,
+            outputFileName, isOutputFileNamedPipe, asFastAsPossible) == false) {
+        return EXIT_FAILURE;
+    }
+
+    ml::core::CBlockingCallCancellingTimer cancellerThread{
+        ml::core::CThread::currentThreadId(), std::chrono::seconds{namedPipeConnectTimeout}};
+
+    if (cancellerThread.start() == false) {
+        LOG_FATAL(<< "Could not start blocking call canceller thread");
+        return EXIT_FAILURE;
+    }
+
+    const std::string logPipe;
+    if (ml::core::CLogger::instance().reconfigure(
+            logPipe, logProperties, cancellerThread.hasCancelledBlockingCall()) == false) {
+        LOG_FATAL(<< "Could not reconfigure logging");
+        cancellerThread.stop();
+        return EXIT_FAILURE;
+    }
+
+    LOG_DEBUG(<< ml::ver::CBuildInfo::fullInfo());
+
+    ml::core::CCaptureReader reader{captureFileName};
+    if (reader.isOpen() == false) {
+        cancellerThread.stop();
+        return EXIT_FAILURE;
+    }
+
+    ml::core::CNamedPipeFactory::TOStreamP outputStream;
+    if (isOutputFileNamedPipe) {
+        outputStream = ml::core::CNamedPipeFactory::openPipeStreamWrite(
+            outputFileName, cancellerThread.hasCancelledBlockingCall());
+    } else if (outputFileName.empty() == false) {
+        outputStream = std::make_shared<std::ofstream>(outputFileName, std::ios::binary);
+    }
+    cancellerThread.stop();
+    if (outputFileName.empty() == false && (outputStream == nullptr || outputStream->fail())) {
+        LOG_FATAL(<< "Failed to open output '" << outputFileName << "'");
+        return EXIT_FAILURE;
+    }
+    std::ios::sync_with_stdio(false);
+    std::ostream& output{outputStream != nullptr ? *outputStream : std::cout};
+
+    std::uint64_t chunks{0};
+    std::uint64_t bytes{0};
+    std::uint64_t lateChunks{0};
+    TClock::duration maxLag{0};
+    TClock::duration totalLag{0};
+    std::uint64_t recordedMicroseconds{0};
+
+    TClock::time_point start{TClock::now()};
+    std::uint64_t elapsedMicroseconds;
+    std::string data;
+    while (reader.next(elapsedMicroseconds, data)) {
+        if (asFastAsPossible == false) {
+            TClock::time_point due{start + std::chrono::microseconds{elapsedMicroseconds}};
+            TClock::time_point now{TClock::now()};
+            if (now < due) {
+                std::this_thread::sleep_until(due);
+            } else {
+                // The reader hasn't kept up with the original pace.
+                TClock::duration lag{now - due};
+                maxLag = std::max(maxLag, lag);
+                totalLag += lag;
+                lateChunks += lag > std::chrono::milliseconds{1} ? 1 : 0;
+            }
+        }
+        // Flush so the reader sees each chunk at the time it originally arrived.
+        output.write(data.data(), static_cast<std::streamsize>(data.size())).flush();
+        if (output.fail()) {
+            LOG_ERROR(<< "Failed writing chunk " << chunks << " - stopping replay");
+            break;
+        }
+        ++chunks;
+        bytes += data.size();
+        recordedMicroseconds = elapsedMicroseconds;
+    }
+    TClock::duration replayDuration{TClock::now() - start};
+    outputStream.reset();
+
+    double replaySeconds{toSeconds(replayDuration)};
+    std::cerr << "Replayed " << chunks << " chunks totalling " << bytes << " bytes\n"
+              << "Captured duration: " << static_cast<double>(recordedMicroseconds) / 1e6 << "s\n"
+              << "Replay duration: " << replaySeconds << "s\n"
+              << "Throughput: "
+              << (replaySeconds > 0.0 ? static_cast<double>(bytes) / replaySeconds / 1e6 : 0.0)
+              << "MB/s\n";
+    if (asFastAsPossible == false) {
+        std::cerr << "Chunks more than 1ms late: " << lateChunks << '\n'
+                  << "Maximum lag: " << toSeconds(maxLag) << "s\n"
+                  << "Mean lag: "
+                  << (chunks > 0 ? toSeconds(totalLag) / static_cast<double>(chunks) : 0.0)
+                  << "s\n";
+    }
+
+    return EXIT_SUCCESS;
+}
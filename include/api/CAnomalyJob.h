@@ -194,6 +194,17 @@ public:
     //! Is persistence needed?
     bool isPersistenceNeeded(const std::string& description) const override;
 
+    //! Write periodic foreground snapshots incrementally.
+    //!
+    //! Rather than blocking input processing until every detector has been
+    //! written, a snapshot is started at the time persistence is triggered
+    //! and at most \p numberDetectorsPerRecord detectors are written after
+    //! each subsequent record. A detector which hasn't yet been written is
+    //! written before it's next updated, so the snapshot is consistent with
+    //! the state at the time it was started without needing to copy it. Zero,
+    //! the default, writes all detectors at once.
+    void persistIncrementally(std::size_t numberDetectorsPerRecord);
+
     //! Log a list of the detectors and keys
     void description() const;
 
@@ -207,6 +218,10 @@ public:
     //! here.
     const SRestoredStateDetail& restoreStateStatus() const;
 
+private:
+    struct SIncrementalPersistState;
+    using TIncrementalPersistStateUPtr = std::unique_ptr<SIncrementalPersistState>;
+
 private:
     //! NULL pointer that we can take a long-lived const reference to
     static const TAnomalyDetectorPtr NULL_DETECTOR;
@@ -261,6 +276,23 @@ private:
     //! This function is called from the persistence manager when foreground persistence is triggered
     bool runForegroundPersist(core::CDataAdder& persister);
 
+    //! Start an incremental snapshot of the current state to \p persister.
+    //!
+    //! This writes everything except the detectors, which are subsequently
+    //! written by persistIncrementallyBeforeUpdate and continueIncrementalPersist.
+    bool startIncrementalPersist(core::CDataAdder& persister);
+
+    //! Write \p detector to the incremental snapshot in progress if it hasn't
+    //! been written yet. This must be called before \p detector is updated.
+    void persistIncrementallyBeforeUpdate(const model::CAnomalyDetector& detector);
+
+    //! Write up to \p numberDetectors detectors to the incremental snapshot
+    //! in progress and complete it if no detectors remain.
+    //!
+    //! \note This must be called with no limit before any operation which
+    //! can update all the detectors, such as outputting results.
+    bool continueIncrementalPersist(std::size_t numberDetectors);
+
     //! Persist the detectors to a stream.
     bool persistCopiedState(const std::string& description,
                             const std::string& snapshotId,
@@ -492,6 +524,13 @@ private:
     //! Flag indicating whether or not time has been advanced.
     bool m_TimeAdvanced{false};
 
+    //! The maximum number of detectors to write to an incremental snapshot
+    //! per record or zero if snapshots are written all at once.
+    std::size_t m_NumberDetectorsToPersistPerRecord{0};
+
+    //! The incremental snapshot in progress, if any.
+    TIncrementalPersistStateUPtr m_IncrementalPersistState;
+
     // Test case access
     friend struct CAnomalyJobTest::testParsePersistControlMessageArgs;
 };
@@ -15,8 +15,6 @@
 
 #include <api/ImportExport.h>
 
-#include <rapidjson/document.h>
-
 #include <atomic>
 #include <cstdint>
 #include <memory>
@@ -162,8 +160,8 @@ protected:
 
 private:
     void writeAnalysisStats(std::int64_t timestamp) override;
-    void writeTimingStats(rapidjson::Value& parentObject);
-    void writeParameters(rapidjson::Value& parentObject);
+    void writeTimingStats(TWriter& writer);
+    void writeParameters(TWriter& writer);
 
 private:
     maths::COutliers::SComputeParameters m_Parameters;
@@ -206,9 +204,9 @@ private:
 
 private:
     void writeAnalysisStats(std::int64_t timestamp) override;
-    void writeHyperparameters(rapidjson::Value& parentObject);
-    void writeValidationLoss(rapidjson::Value& parentObject);
-    void writeTimingStats(rapidjson::Value& parentObject);
+    void writeHyperparameters(TWriter& writer);
+    void writeValidationLoss(TWriter& writer);
+    void writeTimingStats(TWriter& writer);
     void reset();
 
 private:
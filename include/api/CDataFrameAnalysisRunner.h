@@ -109,6 +109,14 @@ public:
     //! \return The capacity of the data frame slice to use.
     virtual std::size_t dataFrameSliceCapacity() const = 0;
 
+    //! \return The number of rows to process in each batch or zero if the
+    //! analysis needs the whole data frame.
+    //!
+    //! \note If this is non-zero the analysis is run and its results written
+    //! for each batch of rows as they're received and the data frame is cleared
+    //! in between.
+    virtual std::size_t numberRowsPerBatch() const;
+
     //! Write the extra columns of \p row added by the analysis to \p writer.
     //!
     //! This should create a new object of the form:
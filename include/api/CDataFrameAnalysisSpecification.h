@@ -69,6 +69,8 @@ public:
     static const std::string MISSING_FIELD_VALUE;
     static const std::string CATEGORICAL_FIELD_NAMES;
     static const std::string DISK_USAGE_ALLOWED;
+    static const std::string FRAME_CACHE_DIRECTORY;
+    static const std::string FRAME_CACHE_KEY;
     static const std::string ANALYSIS;
     static const std::string NAME;
     static const std::string PARAMETERS;
@@ -88,6 +90,8 @@ public:
     //!   "results_field": <string>,
     //!   "categorical_fields": [<string>],
     //!   "disk_usage_allowed": <boolean>,
+    //!   "frame_cache_dir": <string>,
+    //!   "frame_cache_key": <string>,
     //!   "analysis": {
     //!     "name": <string>,
     //!     "parameters": <object>
@@ -103,6 +107,9 @@ public:
     //! \note temp_dir Is a directory which can be used to store the data frame
     //! out-of-core if we can't meet the memory constraint for the analysis without
     //! partitioning.
+    //! \note frame_cache_dir and frame_cache_key, if supplied, identify a cache
+    //! entry from which to restore the data frame, or to which to write it, so
+    //! repeated analyses of the same data needn't parse it again.
     //! \param persisterSupplier Shared pointer to the CDataAdder instance.
     CDataFrameAnalysisSpecification(const std::string& jsonSpecification,
                                     TPersisterSupplier persisterSupplier = noopPersisterSupplier,
@@ -154,6 +161,15 @@ public:
     //! fit in memory.
     bool diskUsageAllowed() const;
 
+    //! \return The string used to denote a missing field value.
+    const std::string& missingFieldValue() const;
+
+    //! \return The directory in which to cache the data frame if any.
+    const std::string& frameCacheDirectory() const;
+
+    //! \return The key which identifies the data frame in the cache if any.
+    const std::string& frameCacheKey() const;
+
     //! Make a data frame suitable for this analysis specification.
     //!
     //! This chooses the storage strategy based on the analysis constraints and
@@ -195,6 +211,8 @@ private:
     std::string m_MissingFieldValue;
     TStrVec m_CategoricalFieldNames;
     bool m_DiskUsageAllowed;
+    std::string m_FrameCacheDirectory;
+    std::string m_FrameCacheKey;
     // TODO Sparse table support
     // double m_TableLoadFactor = 0.0;
     TRunnerFactoryUPtrVec m_RunnerFactories;
@@ -22,6 +22,7 @@
 namespace ml {
 namespace core {
 class CDataFrame;
+class CDataFrameCache;
 class CJsonOutputStreamWrapper;
 class CTemporaryDirectory;
 }
@@ -69,7 +70,9 @@ public:
     const CDataFrameAnalysisRunner* runner() const;
 
 private:
+    using TUInt64Vec = std::vector<std::uint64_t>;
     using TDataFrameUPtr = std::unique_ptr<core::CDataFrame>;
+    using TDataFrameCacheUPtr = std::unique_ptr<core::CDataFrameCache>;
 
 private:
     static const std::ptrdiff_t FIELD_UNSET{-2};
@@ -82,7 +85,13 @@ private:
     bool isControlMessage(const TStrVec& fieldValues) const;
     bool handleControlMessage(const TStrVec& fieldValues);
     void captureFieldNames(const TStrVec& fieldNames);
+    void createDataFrameCache(const TStrVec& fieldNames);
+    void restoreDataFrameFromCache();
+    std::uint64_t rowHash(const TStrVec& fieldValues) const;
+    bool rowMatchesCache(std::uint64_t hash) const;
+    void restoreMatchedRowsFromCache();
     void addRowToDataFrame(const TStrVec& fieldValues);
+    void runBatch();
     void writeResultsOf(const CDataFrameAnalysisRunner& analysis,
                         core::CRapidJsonConcurrentLineWriter& writer) const;
     void writeInferenceModel(const CDataFrameAnalysisRunner& analysis,
@@ -100,7 +109,19 @@ private:
     TDataFrameAnalysisSpecificationUPtr m_AnalysisSpecification;
     TDataFrameUPtr m_DataFrame;
     TTemporaryDirectoryPtr m_DataFrameDirectory;
+    TDataFrameCacheUPtr m_DataFrameCache;
+    //! True if the data frame rows were restored from the cache.
+    bool m_RestoredDataFrameFromCache = false;
+    //! The hashes of the input from which each row was parsed. If the rows
+    //! were restored from the cache these are used to check the rows which
+    //! are supplied match the cached rows.
+    TUInt64Vec m_RowHashes;
+    std::size_t m_NumberRowsReceived = 0;
     TJsonOutputStreamWrapperUPtrSupplier m_ResultsStreamSupplier;
+    //! The results stream which is shared by all batches if the analysis
+    //! processes the rows in batches.
+    TJsonOutputStreamWrapperUPtr m_ResultsStream;
+    std::size_t m_NumberRowsInBatch = 0;
 };
 }
 }
@@ -25,6 +25,7 @@ public:
     static const std::string METHOD;
     static const std::string COMPUTE_FEATURE_INFLUENCE;
     static const std::string FEATURE_INFLUENCE_THRESHOLD;
+    static const std::string FEATURE_INFLUENCE_QUANTILE;
     static const std::string OUTLIER_FRACTION;
 
 public:
@@ -83,6 +84,10 @@ private:
     //! The minimum outlier score for which we'll write out feature influence.
     double m_FeatureInfluenceThreshold = 0.1;
 
+    //! If positive, only compute feature influence for points whose outlier
+    //! score is at least this quantile of all the outlier scores.
+    double m_FeatureInfluenceQuantile = 0.0;
+
     //! The fraction of true outliers amoung the points.
     double m_OutlierFraction = 0.05;
     //@}
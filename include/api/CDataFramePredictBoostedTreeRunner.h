@@ -0,0 +1,152 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#ifndef INCLUDED_ml_api_CDataFramePredictBoostedTreeRunner_h
+#define INCLUDED_ml_api_CDataFramePredictBoostedTreeRunner_h
+
+#include <api/CDataFrameAnalysisInstrumentation.h>
+#include <api/CDataFrameAnalysisRunner.h>
+#include <api/CDataFrameAnalysisSpecification.h>
+#include <api/CDataFrameTrainBoostedTreeClassifierRunner.h>
+#include <api/ImportExport.h>
+
+#include <boost/unordered_map.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ml {
+namespace maths {
+class CBoostedTree;
+}
+namespace api {
+class CDataFrameAnalysisConfigReader;
+class CDataFrameAnalysisParameters;
+
+//! \brief Predicts the rows of a core::CDataFrame using a trained boosted tree.
+//!
+//! DESCRIPTION:\n
+//! This restores the boosted tree and its category encoder from the state
+//! persisted at the end of training and only runs inference. The rows are
+//! processed in batches as they are received and the results of each batch
+//! are written before the next is read. Therefore, the data frame never has
+//! to hold more than one batch of rows.
+//!
+//! IMPLEMENTATION:\n
+//! The data frame assigns categories identifiers in the order it first sees
+//! them. This differs between the training data and each batch of rows to
+//! predict. The caller can supply the values of each categorical field in the
+//! order of their training identifiers and we remap the identifiers of each
+//! batch to match before predicting. Categories which weren't seen in training
+//! are treated as rare by the encoder.
+//!
+//! Classification results are written in the same way as by the classification
+//! runner, i.e. the predicted class is the one with the highest probability
+//! after adjusting by the classification weights computed during training.
+class API_EXPORT CDataFramePredictBoostedTreeRunner final : public CDataFrameAnalysisRunner {
+public:
+    static const std::string DEPENDENT_VARIABLE_NAME;
+    static const std::string PREDICTION_FIELD_NAME;
+    static const std::string NUM_TOP_FEATURE_IMPORTANCE_VALUES;
+    static const std::string CATEGORICAL_FIELD_VALUES;
+    static const std::string ROWS_PER_BATCH;
+
+    // Output
+    static const std::string FEATURE_NAME_FIELD_NAME;
+    static const std::string IMPORTANCE_FIELD_NAME;
+    static const std::string FEATURE_IMPORTANCE_FIELD_NAME;
+    static const std::string CLASSES_FIELD_NAME;
+    static const std::string CLASS_NAME_FIELD_NAME;
+
+public:
+    static const CDataFrameAnalysisConfigReader& parameterReader();
+
+    //! This is not intended to be called directly: use CDataFramePredictBoostedTreeRunnerFactory.
+    CDataFramePredictBoostedTreeRunner(const CDataFrameAnalysisSpecification& spec,
+                                       const CDataFrameAnalysisParameters& parameters);
+    ~CDataFramePredictBoostedTreeRunner() override;
+
+    //! \return The number of columns this adds to the data frame.
+    //!
+    //! \note This depends on the loss function and isn't known until the model
+    //! is restored when the data frame is resized.
+    std::size_t numberExtraColumns() const override;
+
+    //! \return The capacity of the data frame slice to use.
+    std::size_t dataFrameSliceCapacity() const override;
+
+    //! \return The number of rows to predict in each batch.
+    std::size_t numberRowsPerBatch() const override;
+
+    //! Write the prediction for \p row to \p writer.
+    void writeOneRow(const core::CDataFrame& frame,
+                     const TRowRef& row,
+                     core::CRapidJsonConcurrentLineWriter& writer) const override;
+
+    //! Validate if \p frame is suitable for running the analysis on.
+    bool validate(const core::CDataFrame& frame) const override;
+
+    //! \return Reference to the analysis state.
+    const CDataFrameAnalysisInstrumentation& instrumentation() const override;
+    //! \return Reference to the analysis state.
+    CDataFrameAnalysisInstrumentation& instrumentation() override;
+
+private:
+    using TSizeVec = std::vector<std::size_t>;
+    using EPredictionFieldType = CDataFrameTrainBoostedTreeClassifierRunner::EPredictionFieldType;
+    using TBoostedTreeUPtr = std::unique_ptr<maths::CBoostedTree>;
+    using TDataSearcherUPtr = CDataFrameAnalysisSpecification::TDataSearcherUPtr;
+    using TStrStrVecMap = std::map<std::string, TStrVec>;
+    using TStrSizeUMap = boost::unordered_map<std::string, std::size_t>;
+    using TStrSizeUMapVec = std::vector<TStrSizeUMap>;
+
+private:
+    void runImpl(core::CDataFrame& frame) override;
+    bool restoreBoostedTree(core::CDataFrame& frame,
+                            std::size_t dependentVariableColumn,
+                            TDataSearcherUPtr& restoreSearcher);
+    void mapCategoriesToTrainingIds(core::CDataFrame& frame) const;
+    std::size_t numberLossParameters() const;
+    std::size_t estimateBookkeepingMemoryUsage(std::size_t numberPartitions,
+                                               std::size_t totalNumberRows,
+                                               std::size_t partitionNumberRows,
+                                               std::size_t numberColumns) const override;
+
+private:
+    std::string m_DependentVariableFieldName;
+    std::string m_PredictionFieldName;
+    std::size_t m_NumberTopShapValues;
+    std::ptrdiff_t m_NumTopClasses;
+    EPredictionFieldType m_PredictionFieldType;
+    std::size_t m_NumberRowsPerBatch;
+    TStrStrVecMap m_CategoricalFieldValues;
+    //! The training identifiers of the categories of each column.
+    TStrSizeUMapVec m_TrainingCategoryIds;
+    TStrVec m_ClassValues;
+    TBoostedTreeUPtr m_BoostedTree;
+    CDataFrameTrainBoostedTreeInstrumentation m_Instrumentation;
+};
+
+//! \brief Makes a core::CDataFrame boosted tree prediction runner.
+class API_EXPORT CDataFramePredictBoostedTreeRunnerFactory final
+    : public CDataFrameAnalysisRunnerFactory {
+public:
+    static const std::string NAME;
+
+public:
+    const std::string& name() const override;
+
+private:
+    TRunnerUPtr makeImpl(const CDataFrameAnalysisSpecification& spec) const override;
+    TRunnerUPtr makeImpl(const CDataFrameAnalysisSpecification& spec,
+                         const rapidjson::Value& jsonParameters) const override;
+};
+}
+}
+
+#endif // INCLUDED_ml_api_CDataFramePredictBoostedTreeRunner_h
@@ -37,6 +37,7 @@ public:
 
 public:
     static const std::size_t MAX_NUMBER_CLASSES;
+    static const std::size_t MIN_NUMBER_CLASSES_FOR_DIAGONAL_CURVATURE;
     static const std::string NUM_CLASSES;
     static const std::string NUM_TOP_CLASSES;
     static const std::string PREDICTION_FIELD_TYPE;
@@ -47,6 +48,7 @@ public:
     static const std::string CLASSIFICATION_WEIGHTS;
     static const std::string CLASSIFICATION_WEIGHTS_CLASS;
     static const std::string CLASSIFICATION_WEIGHTS_WEIGHT;
+    static const std::string DIAGONAL_CURVATURE;
 
 public:
     static const CDataFrameAnalysisConfigReader& parameterReader();
@@ -71,6 +73,31 @@ public:
                      core::CRapidJsonConcurrentLineWriter& writer,
                      maths::CTreeShapFeatureImportance* featureImportance = nullptr) const;
 
+    //! Write the predicted class and its probability and score to \p writer.
+    //!
+    //! \note The predicted class is the one with the highest score.
+    static void writePredictedClass(const std::string& predictionFieldName,
+                                    EPredictionFieldType predictionFieldType,
+                                    const TStrVec& classValues,
+                                    const TDouble2Vec& probabilities,
+                                    const TDouble2Vec& scores,
+                                    core::CRapidJsonConcurrentLineWriter& writer);
+
+    //! Write the \p numberTopClasses classes with the highest scores to \p writer.
+    //!
+    //! \note A value of -1 for \p numberTopClasses means write all the classes.
+    static void writeTopClasses(std::ptrdiff_t numberTopClasses,
+                                EPredictionFieldType predictionFieldType,
+                                const TStrVec& classValues,
+                                const TDouble2Vec& probabilities,
+                                const TDouble2Vec& scores,
+                                core::CRapidJsonConcurrentLineWriter& writer);
+
+    //! Write \p categoryValue to \p writer with the type \p predictionFieldType.
+    static void writePredictedCategoryValue(EPredictionFieldType predictionFieldType,
+                                            const std::string& categoryValue,
+                                            core::CRapidJsonConcurrentLineWriter& writer);
+
     //! \return A serialisable definition of the trained classification model.
     TInferenceModelDefinitionUPtr
     inferenceModelDefinition(const TStrVec& fieldNames,
@@ -80,14 +107,11 @@ public:
     TOptionalInferenceModelMetadata inferenceModelMetadata() const override;
 
 private:
-    static TLossFunctionUPtr loss(std::size_t numberClasses);
+    static TLossFunctionUPtr loss(const CDataFrameAnalysisParameters& parameters);
 
     void validate(const core::CDataFrame& frame,
                   std::size_t dependentVariableColumn) const override;
 
-    void writePredictedCategoryValue(const std::string& categoryValue,
-                                     core::CRapidJsonConcurrentLineWriter& writer) const;
-
 private:
     std::ptrdiff_t m_NumTopClasses;
     EPredictionFieldType m_PredictionFieldType;
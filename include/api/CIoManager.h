@@ -11,11 +11,13 @@
 #include <api/ImportExport.h>
 
 #include <iosfwd>
+#include <memory>
 #include <string>
 
 namespace ml {
 namespace core {
 class CBlockingCallCancellerThread;
+class CCapturingIStream;
 }
 namespace api {
 
@@ -35,6 +37,10 @@ namespace api {
 //! Additionally, state persistence and restoration can be via
 //! named pipes.
 //!
+//! Optionally, all the input can be captured together with its arrival
+//! times so it can be replayed later, for example to reproduce a
+//! performance problem.
+//!
 //! This class:
 //! 1) Is the single point from which the appropriate C++ stream for
 //!    a given function can be retrieved.
@@ -49,7 +55,8 @@ class API_EXPORT CIoManager {
 public:
     //! Leave \p inputFileName/\p outputFileName empty to indicate
     //! STDIN/STDOUT.  Leave \p restoreFileName/\p persistFileName empty to
-    //! indicate no state restore or persist.
+    //! indicate no state restore or persist.  Leave \p captureFileName
+    //! empty to indicate the input shouldn't be captured.
     CIoManager(core::CBlockingCallCancellerThread& cancellerThread,
                const std::string& inputFileName,
                bool isInputFileNamedPipe,
@@ -58,7 +65,8 @@ public:
                const std::string& restoreFileName = std::string{},
                bool isRestoreFileNamedPipe = true,
                const std::string& persistFileName = std::string{},
-               bool isPersistFileNamedPipe = true);
+               bool isPersistFileNamedPipe = true,
+               const std::string& captureFileName = std::string{});
 
     //! No copying
     CIoManager(const CIoManager&) = delete;
@@ -101,6 +109,15 @@ private:
     //! std::cin is being used then this will be NULL.
     core::CNamedPipeFactory::TIStreamP m_InputStream;
 
+    //! Name of the file to capture the input to.  Empty implies don't
+    //! capture the input.
+    std::string m_CaptureFileName;
+
+    //! If the input is being captured then the stream which reads the
+    //! input and captures it.  This must be destroyed before the input
+    //! stream.
+    std::unique_ptr<core::CCapturingIStream> m_CapturingInputStream;
+
     //! Name of file/pipe to write output to.  Empty implies STDOUT.
     std::string m_OutputFileName;
 
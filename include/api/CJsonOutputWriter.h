@@ -272,6 +272,10 @@ private:
                      SBucketData& bucketData,
                      std::uint64_t bucketProcessingTime);
 
+    //! Stream the job ID and \p bucketTime fields common to every result
+    //! into the object being written.
+    void writeJobIdAndTimestamp(core_t::TTime bucketTime);
+
     //! Add the fields for a metric detector
     void addMetricFields(const CHierarchicalResultsWriter::TResults& results,
                          TDocumentWeakPtr weakDoc);
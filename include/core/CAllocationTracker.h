@@ -0,0 +1,103 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CAllocationTracker_h
+#define INCLUDED_ml_core_CAllocationTracker_h
+
+#include <core/CNonCopyable.h>
+#include <core/CNonInstantiatable.h>
+#include <core/ImportExport.h>
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace ml {
+namespace core {
+
+//! \brief Tracks the live heap bytes allocated by each subsystem.
+//!
+//! DESCRIPTION:\n
+//! Memory limits are enforced using estimates of the memory used by the
+//! various data structures. These can diverge from the memory actually
+//! allocated, for example because some containers aren't accounted. This
+//! provides the bytes which are actually allocated, attributed to the
+//! subsystem which allocated them, so the estimates can be validated.
+//!
+//! Allocations are attributed to the tag of the innermost CScopedTag on
+//! the allocating thread and are credited back to the same tag when they
+//! are freed, whichever thread frees them. Tasks run by CStaticThreadPool
+//! inherit the tag of the thread which scheduled them.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! This is a static class - it's not possible to construct an instance of it.
+//!
+//! Tracking is only available if the code is built with ML_ALLOCATION_TRACKING
+//! defined, in which case the global operators new and delete, including the
+//! over-aligned versions, are replaced with versions which store the size and
+//! tag of each allocation in a header before the returned memory. Otherwise
+//! the scoped tags still nest, but no bytes are recorded and enabled() returns
+//! false. The recorded bytes are those requested, i.e. they exclude allocator
+//! overheads. Replacing the allocation functions only affects every library
+//! on Linux, so elsewhere tracking requires ML_STATIC_BUILD to be defined to
+//! indicate everything is linked into a single executable.
+class CORE_EXPORT CAllocationTracker : private CNonInstantiatable {
+public:
+    //! The subsystems to which allocations can be attributed.
+    enum ETag {
+        E_Untagged = 0,
+        E_Gatherers,
+        E_Models,
+        E_Categorizer,
+        E_Results,
+        E_DataFrame
+    };
+
+    //! The number of distinct tags.
+    static constexpr std::size_t NUMBER_TAGS{E_DataFrame + 1};
+
+    using TSizeTagArray = std::array<std::size_t, NUMBER_TAGS>;
+
+    //! \brief Attributes allocations on the current thread to a tag for
+    //! the lifetime of the object.
+    class CORE_EXPORT CScopedTag : private CNonCopyable {
+    public:
+        explicit CScopedTag(ETag tag);
+        ~CScopedTag();
+
+    private:
+        ETag m_PreviousTag;
+    };
+
+public:
+    //! Check if allocations are being tracked.
+    static bool enabled();
+
+    //! Get the tag to which allocations on the current thread are attributed.
+    static ETag currentTag();
+
+    //! Get the live bytes allocated with \p tag.
+    static std::size_t liveBytes(ETag tag);
+
+    //! Get the live bytes allocated with each tag.
+    static TSizeTagArray liveBytesByTag();
+
+    //! Get the live bytes allocated with any tag.
+    static std::size_t totalLiveBytes();
+
+    //! Get a name for \p tag suitable for use as a JSON key.
+    static const std::string& print(ETag tag);
+
+    //! \name Allocation Hooks
+    //! These are called by the instrumented global allocation functions.
+    //@{
+    static void recordAllocation(ETag tag, std::size_t bytes);
+    static void recordDeallocation(ETag tag, std::size_t bytes);
+    //@}
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CAllocationTracker_h
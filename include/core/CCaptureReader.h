@@ -0,0 +1,57 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CCaptureReader_h
+#define INCLUDED_ml_core_CCaptureReader_h
+
+#include <core/ImportExport.h>
+
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace ml {
+namespace core {
+
+//! \brief
+//! Reads the chunks of input recorded by CCapturingIStream.
+//!
+//! DESCRIPTION:\n
+//! Each chunk is the data read by the captured process in one go together
+//! with the time it arrived relative to the start of the capture. See
+//! CCapturingIStream for the format.
+class CORE_EXPORT CCaptureReader {
+public:
+    explicit CCaptureReader(const std::string& captureFileName);
+    ~CCaptureReader();
+
+    CCaptureReader(const CCaptureReader&) = delete;
+    CCaptureReader& operator=(const CCaptureReader&) = delete;
+
+    //! Check if the file was opened and has the expected format.
+    bool isOpen() const;
+
+    //! Read the next chunk.
+    //!
+    //! \param[out] elapsedMicroseconds The time the chunk arrived in
+    //! microseconds since the capture started.
+    //! \param[out] data The chunk's data.
+    //! \return False if there are no more chunks or the capture is corrupt.
+    bool next(std::uint64_t& elapsedMicroseconds, std::string& data);
+
+private:
+    using TFilteredInput = boost::iostreams::filtering_stream<boost::iostreams::input>;
+
+private:
+    std::ifstream m_File;
+    TFilteredInput m_Input;
+    bool m_IsOpen{false};
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CCaptureReader_h
@@ -0,0 +1,75 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CCapturingIStream_h
+#define INCLUDED_ml_core_CCapturingIStream_h
+
+#include <core/ImportExport.h>
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+
+namespace ml {
+namespace core {
+
+//! \brief
+//! An input stream which records everything read from another stream.
+//!
+//! DESCRIPTION:\n
+//! Reading from this stream reads from the wrapped stream and also writes
+//! the data, together with the time at which it arrived, to a gzipped
+//! capture file. The capture can be read with CCaptureReader to feed the
+//! exact same input, at the same pace, to a process again. This is useful
+//! for reproducing performance problems which only occur with production
+//! input. For processes which receive control messages in band with their
+//! data these are captured too.
+//!
+//! The uncompressed capture starts with the line in FORMAT. This is followed
+//! by a chunk for each read of the wrapped stream comprising the elapsed time
+//! in microseconds since the stream was created as a std::uint64_t, the chunk
+//! length as a std::uint32_t and then the data, with integers in the native
+//! byte order.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! A read only waits for the wrapped stream to return some data. It never
+//! blocks waiting for a full buffer so the arrival time of each message is
+//! recorded accurately and interactive protocols, such as flush requests,
+//! work as they do without capture.
+//!
+//! If the capture file can't be written the data is still passed through
+//! and the problem is logged.
+class CORE_EXPORT CCapturingIStream : public std::istream {
+public:
+    //! The first line of a capture.
+    static const std::string FORMAT;
+
+public:
+    //! \param[in] source The stream to read. This must outlive this object.
+    //! \param[in] captureFileName The file to which to write the capture.
+    CCapturingIStream(std::istream& source, const std::string& captureFileName);
+    ~CCapturingIStream() override;
+
+    CCapturingIStream(const CCapturingIStream&) = delete;
+    CCapturingIStream& operator=(const CCapturingIStream&) = delete;
+
+    //! Check if the capture file is being written successfully.
+    bool isCapturing() const;
+
+    //! Get the number of bytes which have been captured.
+    std::uint64_t bytesCaptured() const;
+
+private:
+    class CCapturingStreamBuf;
+    using TCapturingStreamBufUPtr = std::unique_ptr<CCapturingStreamBuf>;
+
+private:
+    TCapturingStreamBufUPtr m_StreamBuf;
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CCapturingIStream_h
@@ -0,0 +1,509 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CConcurrentHashMap_h
+#define INCLUDED_ml_core_CConcurrentHashMap_h
+
+#include <core/CMemory.h>
+#include <core/CMemoryUsage.h>
+
+#include <boost/functional/hash.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace core {
+
+//! \brief A read-mostly concurrent hash map.
+//!
+//! DESCRIPTION:\n
+//! A hash map which supports lookups and inserts from any number of threads.
+//! It is designed for shared dictionaries, such as string stores, where almost
+//! all accesses find an existing key: lookups never take a lock and inserts
+//! of keys in different stripes don't contend with one another.
+//!
+//! Entries can only be erased with the functions whose names end NotThreadSafe.
+//! These must not be called concurrently with any other member function.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! This uses open addressing with linear probing over a table of atomic node
+//! pointers. Nodes are immutable once published and a slot only ever changes
+//! from null to a node outside the not thread safe functions, so lookups are
+//! optimistic: they probe the current table without synchronisation beyond
+//! acquire loads. A lookup which races with an insert of the same key may miss
+//! it, but any insert which completed before the lookup started is visible.
+//!
+//! Inserts take a shared lock on the table and an exclusive lock on the stripe
+//! of the key's hash. Equal keys have equal hashes so this stops duplicates,
+//! and inserts of different keys which race for the same slot are resolved by
+//! compare and swap. Growing the table takes the table lock exclusively. The
+//! old table is retained, since lookups may still be reading it, until the
+//! next not thread safe operation. The table at least doubles each time it
+//! grows so retained tables never use more memory than the current one.
+//!
+//! Heterogeneous lookup is supported by passing a hash and equality predicate
+//! for the lookup key type. The hash must agree with HASH for equal keys and
+//! the predicate is called as equal(key, storedKey).
+template<typename KEY, typename VALUE, typename HASH = boost::hash<KEY>, typename EQUAL = std::equal_to<KEY>>
+class CConcurrentHashMap {
+public:
+    using TKeyValuePr = std::pair<const KEY, VALUE>;
+    using TKeyValuePrCPtrBoolPr = std::pair<const TKeyValuePr*, bool>;
+
+    //! The number of stripes used to lock inserts.
+    static constexpr std::size_t NUMBER_STRIPES{16};
+
+public:
+    explicit CConcurrentHashMap(std::size_t capacity = 0,
+                                const HASH& hash = HASH{},
+                                const EQUAL& equal = EQUAL{})
+        : m_Hash{hash}, m_Equal{equal}, m_Locks{std::make_unique<SLocks>()} {
+        this->initialize(capacity);
+    }
+
+    ~CConcurrentHashMap() { this->deleteNodes(); }
+
+    CConcurrentHashMap(const CConcurrentHashMap&) = delete;
+    CConcurrentHashMap& operator=(const CConcurrentHashMap&) = delete;
+
+    //! \warning Not thread safe.
+    CConcurrentHashMap(CConcurrentHashMap&& other) noexcept
+        : m_Hash{std::move(other.m_Hash)}, m_Equal{std::move(other.m_Equal)},
+          m_Locks{std::move(other.m_Locks)}, m_Tables{std::move(other.m_Tables)},
+          m_Table{other.m_Table.load(std::memory_order_relaxed)},
+          m_Size{other.m_Size.load(std::memory_order_relaxed)} {
+        other.m_Table.store(nullptr, std::memory_order_relaxed);
+        other.m_Size.store(0, std::memory_order_relaxed);
+    }
+
+    //! \warning Not thread safe.
+    CConcurrentHashMap& operator=(CConcurrentHashMap&& other) noexcept {
+        if (this != &other) {
+            this->deleteNodes();
+            m_Hash = std::move(other.m_Hash);
+            m_Equal = std::move(other.m_Equal);
+            m_Locks = std::move(other.m_Locks);
+            m_Tables = std::move(other.m_Tables);
+            m_Table.store(other.m_Table.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+            m_Size.store(other.m_Size.load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+            other.m_Table.store(nullptr, std::memory_order_relaxed);
+            other.m_Size.store(0, std::memory_order_relaxed);
+        }
+        return *this;
+    }
+
+    //! Get the number of entries.
+    std::size_t size() const { return m_Size.load(std::memory_order_acquire); }
+
+    //! Check if there are no entries.
+    bool empty() const { return this->size() == 0; }
+
+    //! Get the number of slots in the current table.
+    std::size_t capacity() const {
+        const STable* table{m_Table.load(std::memory_order_acquire)};
+        return table == nullptr ? 0 : table->s_Capacity;
+    }
+
+    //! Find the entry for \p key.
+    //!
+    //! \return The entry or null if there isn't one. The entry is valid until
+    //! it is erased or the map is destroyed.
+    const TKeyValuePr* find(const KEY& key) const {
+        return this->find(key, m_Hash, m_Equal);
+    }
+
+    //! Find the entry for \p key using the hash \p hash and equality \p equal.
+    template<typename K, typename H, typename E>
+    const TKeyValuePr* find(const K& key, const H& hash, const E& equal) const {
+        std::size_t keyHash{hash(key)};
+        const SNode* node{this->findNode(m_Table.load(std::memory_order_acquire),
+                                         key, keyHash, equal)};
+        return node == nullptr ? nullptr : &node->s_KeyValue;
+    }
+
+    //! Insert \p value for \p key if there is no entry for \p key.
+    //!
+    //! \return The entry for \p key and true if it was inserted.
+    TKeyValuePrCPtrBoolPr insert(const KEY& key, VALUE value) {
+        return this->insert(key, m_Hash, m_Equal, [&] {
+            return TKeyValuePr{key, std::move(value)};
+        });
+    }
+
+    //! Insert the entry created by \p make if there is no entry for \p key.
+    //!
+    //! \p make is only called if \p key is absent and must return a TKeyValuePr
+    //! whose key is equal to \p key. It is called with the stripe lock held.
+    template<typename K, typename H, typename E, typename MAKE>
+    TKeyValuePrCPtrBoolPr insert(const K& key, const H& hash, const E& equal, const MAKE& make) {
+        std::size_t keyHash{hash(key)};
+
+        // The common case is that the key is present.
+        const SNode* existing{this->findNode(
+            m_Table.load(std::memory_order_acquire), key, keyHash, equal)};
+        if (existing != nullptr) {
+            return {&existing->s_KeyValue, false};
+        }
+
+        std::unique_ptr<SNode> node;
+        for (;;) {
+            const STable* full{nullptr};
+            {
+                std::shared_lock<std::shared_mutex> tableLock{m_Locks->s_TableMutex};
+                std::lock_guard<std::mutex> stripeLock{
+                    m_Locks->s_StripeMutexes[keyHash % NUMBER_STRIPES]};
+
+                STable* table{m_Table.load(std::memory_order_acquire)};
+                if (this->atLoadLimit(*table)) {
+                    full = table;
+                } else {
+                    for (std::size_t i = table->home(keyHash);; i = table->next(i)) {
+                        SNode* current{table->s_Slots[i].load(std::memory_order_acquire)};
+                        if (current == nullptr) {
+                            if (node == nullptr) {
+                                node = std::make_unique<SNode>(keyHash, make());
+                            }
+                            // Inserts of keys in other stripes can race for the slot.
+                            if (table->s_Slots[i].compare_exchange_strong(
+                                    current, node.get(), std::memory_order_acq_rel,
+                                    std::memory_order_acquire)) {
+                                m_Size.fetch_add(1, std::memory_order_acq_rel);
+                                return {&node.release()->s_KeyValue, true};
+                            }
+                        }
+                        if (current->s_Hash == keyHash &&
+                            equal(key, current->s_KeyValue.first)) {
+                            return {&current->s_KeyValue, false};
+                        }
+                    }
+                }
+            }
+            // Growing needs the table lock exclusively.
+            this->grow(full);
+        }
+    }
+
+    //! Ensure at least \p size entries can be stored without growing the table.
+    void reserve(std::size_t size) {
+        for (;;) {
+            STable* table{m_Table.load(std::memory_order_acquire)};
+            if (2 * size <= table->s_Capacity) {
+                return;
+            }
+            this->grow(table);
+        }
+    }
+
+    //! Call \p f for each entry.
+    //!
+    //! \note This sees the entries in the table when it is called and may miss
+    //! concurrent inserts. \p f must not modify the map.
+    template<typename F>
+    void forEach(const F& f) const {
+        std::shared_lock<std::shared_mutex> tableLock{m_Locks->s_TableMutex};
+        const STable* table{m_Table.load(std::memory_order_acquire)};
+        for (std::size_t i = 0; i < table->s_Capacity; ++i) {
+            const SNode* node{table->s_Slots[i].load(std::memory_order_acquire)};
+            if (node != nullptr) {
+                f(node->s_KeyValue);
+            }
+        }
+    }
+
+    //! Erase the entry for \p key using the hash \p hash and equality \p equal.
+    //!
+    //! \return True if an entry was erased.
+    //! \warning Not thread safe.
+    template<typename K, typename H, typename E>
+    bool eraseNotThreadSafe(const K& key, const H& hash, const E& equal) {
+        this->releaseRetiredTables();
+        std::size_t keyHash{hash(key)};
+        STable& table{*m_Table.load(std::memory_order_relaxed)};
+        for (std::size_t i = table.home(keyHash);; i = table.next(i)) {
+            SNode* node{table.s_Slots[i].load(std::memory_order_relaxed)};
+            if (node == nullptr) {
+                return false;
+            }
+            if (node->s_Hash == keyHash && equal(key, node->s_KeyValue.first)) {
+                delete node;
+                this->backwardShiftDelete(table, i);
+                m_Size.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+
+    //! Erase the entry for \p key.
+    //!
+    //! \warning Not thread safe.
+    bool eraseNotThreadSafe(const KEY& key) {
+        return this->eraseNotThreadSafe(key, m_Hash, m_Equal);
+    }
+
+    //! Erase all the entries for which \p pred returns true.
+    //!
+    //! \return The number of entries erased.
+    //! \warning Not thread safe.
+    template<typename PREDICATE>
+    std::size_t eraseIfNotThreadSafe(const PREDICATE& pred) {
+        this->releaseRetiredTables();
+        STable& table{*m_Table.load(std::memory_order_relaxed)};
+        std::size_t erased{0};
+        for (std::size_t i = 0; i < table.s_Capacity; ++i) {
+            SNode* node{table.s_Slots[i].load(std::memory_order_relaxed)};
+            if (node != nullptr && pred(node->s_KeyValue)) {
+                delete node;
+                table.s_Slots[i].store(nullptr, std::memory_order_relaxed);
+                ++erased;
+            }
+        }
+        if (erased > 0) {
+            // Reinsert the survivors so no probe sequence has a gap.
+            std::vector<SNode*> nodes;
+            nodes.reserve(m_Size.load(std::memory_order_relaxed) - erased);
+            for (std::size_t i = 0; i < table.s_Capacity; ++i) {
+                SNode* node{table.s_Slots[i].exchange(nullptr, std::memory_order_relaxed)};
+                if (node != nullptr) {
+                    nodes.push_back(node);
+                }
+            }
+            for (auto node : nodes) {
+                table.place(node);
+            }
+            m_Size.fetch_sub(erased, std::memory_order_relaxed);
+        }
+        return erased;
+    }
+
+    //! Remove all entries and free the table.
+    //!
+    //! \warning Not thread safe.
+    void clearNotThreadSafe() {
+        this->deleteNodes();
+        TTableUPtrVec empty;
+        m_Tables.swap(empty);
+        m_Size.store(0, std::memory_order_relaxed);
+        this->initialize(0);
+    }
+
+    //! Debug the memory used by this object.
+    void debugMemoryUsage(const CMemoryUsage::TMemoryUsagePtr& mem) const {
+        mem->setName("CConcurrentHashMap");
+        std::shared_lock<std::shared_mutex> tableLock{m_Locks->s_TableMutex};
+        mem->addItem("tables", this->tablesMemoryUsage());
+        mem->addItem("nodes", this->size() * sizeof(SNode));
+        if (this->entriesHaveDynamicSize()) {
+            const STable* table{m_Table.load(std::memory_order_acquire)};
+            for (std::size_t i = 0; i < table->s_Capacity; ++i) {
+                const SNode* node{table->s_Slots[i].load(std::memory_order_acquire)};
+                if (node != nullptr) {
+                    CMemoryDebug::dynamicSize("key", node->s_KeyValue.first, mem);
+                    CMemoryDebug::dynamicSize("value", node->s_KeyValue.second, mem);
+                }
+            }
+        }
+    }
+
+    //! Get the memory used by this object.
+    std::size_t memoryUsage() const {
+        std::shared_lock<std::shared_mutex> tableLock{m_Locks->s_TableMutex};
+        std::size_t mem{sizeof(SLocks) + this->tablesMemoryUsage() +
+                        this->size() * sizeof(SNode)};
+        if (this->entriesHaveDynamicSize()) {
+            const STable* table{m_Table.load(std::memory_order_acquire)};
+            for (std::size_t i = 0; i < table->s_Capacity; ++i) {
+                const SNode* node{table->s_Slots[i].load(std::memory_order_acquire)};
+                if (node != nullptr) {
+                    mem += CMemory::dynamicSize(node->s_KeyValue);
+                }
+            }
+        }
+        return mem;
+    }
+
+private:
+    //! \brief A published entry.
+    struct SNode {
+        SNode(std::size_t hash, TKeyValuePr keyValue)
+            : s_Hash{hash}, s_KeyValue{std::move(keyValue)} {}
+        std::size_t s_Hash;
+        TKeyValuePr s_KeyValue;
+    };
+
+    using TNodePtrAtomic = std::atomic<SNode*>;
+    using TNodePtrAtomicArrayUPtr = std::unique_ptr<TNodePtrAtomic[]>;
+
+    //! \brief A power of two sized table of node pointers.
+    struct STable {
+        explicit STable(std::size_t capacity)
+            : s_Capacity{capacity}, s_Shift{64}, s_Slots{new TNodePtrAtomic[capacity]} {
+            for (std::size_t i = 1; i < capacity; i *= 2) {
+                --s_Shift;
+            }
+            for (std::size_t i = 0; i < capacity; ++i) {
+                s_Slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        //! Fibonacci hashing so hashes which vary only in their high bits,
+        //! such as boost::hash of integers, are spread over the table.
+        std::size_t home(std::size_t hash) const {
+            return s_Shift == 64
+                       ? 0
+                       : static_cast<std::size_t>(
+                             (static_cast<std::uint64_t>(hash) * 0x9E3779B97F4A7C15ULL) >> s_Shift);
+        }
+
+        std::size_t next(std::size_t i) const { return (i + 1) & (s_Capacity - 1); }
+
+        //! Place \p node in the first free slot of its probe sequence.
+        //!
+        //! \warning Not thread safe.
+        void place(SNode* node) {
+            std::size_t i{this->home(node->s_Hash)};
+            while (s_Slots[i].load(std::memory_order_relaxed) != nullptr) {
+                i = this->next(i);
+            }
+            s_Slots[i].store(node, std::memory_order_relaxed);
+        }
+
+        std::size_t s_Capacity;
+        int s_Shift;
+        TNodePtrAtomicArrayUPtr s_Slots;
+    };
+
+    using TTableUPtr = std::unique_ptr<STable>;
+    using TTableUPtrVec = std::vector<TTableUPtr>;
+
+    //! \brief The locks, which are held by pointer so the map is movable.
+    struct SLocks {
+        std::shared_mutex s_TableMutex;
+        std::array<std::mutex, NUMBER_STRIPES> s_StripeMutexes;
+    };
+    using TLocksUPtr = std::unique_ptr<SLocks>;
+
+    //! The smallest table. This must be large enough that the table can't
+    //! fill if every stripe inserts at the load limit.
+    static constexpr std::size_t MINIMUM_CAPACITY{4 * NUMBER_STRIPES};
+
+private:
+    void initialize(std::size_t size) {
+        std::size_t capacity{MINIMUM_CAPACITY};
+        while (capacity < 2 * size) {
+            capacity *= 2;
+        }
+        m_Tables.push_back(std::make_unique<STable>(capacity));
+        m_Table.store(m_Tables.back().get(), std::memory_order_release);
+    }
+
+    template<typename K, typename E>
+    const SNode* findNode(const STable* table, const K& key, std::size_t keyHash, const E& equal) const {
+        for (std::size_t i = table->home(keyHash);; i = table->next(i)) {
+            const SNode* node{table->s_Slots[i].load(std::memory_order_acquire)};
+            if (node == nullptr) {
+                return nullptr;
+            }
+            if (node->s_Hash == keyHash && equal(key, node->s_KeyValue.first)) {
+                return node;
+            }
+        }
+    }
+
+    //! The table is grown when it's half full: lookups for absent keys probe
+    //! to the first empty slot so the load factor must stay modest.
+    bool atLoadLimit(const STable& table) const {
+        return 2 * (m_Size.load(std::memory_order_acquire) + 1) > table.s_Capacity;
+    }
+
+    //! Double the size of \p table unless another thread has already grown it.
+    void grow(const STable* table) {
+        std::unique_lock<std::shared_mutex> tableLock{m_Locks->s_TableMutex};
+        if (m_Table.load(std::memory_order_relaxed) != table) {
+            return;
+        }
+        auto grown = std::make_unique<STable>(2 * table->s_Capacity);
+        for (std::size_t i = 0; i < table->s_Capacity; ++i) {
+            SNode* node{table->s_Slots[i].load(std::memory_order_relaxed)};
+            if (node != nullptr) {
+                grown->place(node);
+            }
+        }
+        m_Table.store(grown.get(), std::memory_order_release);
+        m_Tables.push_back(std::move(grown));
+    }
+
+    //! Remove the entry in \p i closing the gap in any probe sequence.
+    void backwardShiftDelete(STable& table, std::size_t i) {
+        table.s_Slots[i].store(nullptr, std::memory_order_relaxed);
+        for (std::size_t j = table.next(i);; j = table.next(j)) {
+            SNode* node{table.s_Slots[j].load(std::memory_order_relaxed)};
+            if (node == nullptr) {
+                return;
+            }
+            // Move the node into the gap if its home doesn't lie cyclically
+            // in (i, j].
+            std::size_t home{table.home(node->s_Hash)};
+            bool homeInGap{i <= j ? (home > i && home <= j) : (home > i || home <= j)};
+            if (homeInGap == false) {
+                table.s_Slots[i].store(node, std::memory_order_relaxed);
+                table.s_Slots[j].store(nullptr, std::memory_order_relaxed);
+                i = j;
+            }
+        }
+    }
+
+    void releaseRetiredTables() {
+        if (m_Tables.size() > 1) {
+            m_Tables.erase(m_Tables.begin(), m_Tables.end() - 1);
+            m_Tables.shrink_to_fit();
+        }
+    }
+
+    void deleteNodes() {
+        STable* table{m_Table.load(std::memory_order_relaxed)};
+        if (table != nullptr) {
+            for (std::size_t i = 0; i < table->s_Capacity; ++i) {
+                delete table->s_Slots[i].exchange(nullptr, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::size_t tablesMemoryUsage() const {
+        std::size_t mem{m_Tables.capacity() * sizeof(TTableUPtr)};
+        for (const auto& table : m_Tables) {
+            mem += sizeof(STable) + table->s_Capacity * sizeof(TNodePtrAtomic);
+        }
+        return mem;
+    }
+
+    static bool entriesHaveDynamicSize() {
+        return (memory_detail::SDynamicSizeAlwaysZero<KEY>::value() &&
+                memory_detail::SDynamicSizeAlwaysZero<VALUE>::value()) == false;
+    }
+
+private:
+    HASH m_Hash;
+    EQUAL m_Equal;
+    TLocksUPtr m_Locks;
+    //! The current table is the last and the others are retained for readers.
+    TTableUPtrVec m_Tables;
+    std::atomic<STable*> m_Table{nullptr};
+    std::atomic<std::size_t> m_Size{0};
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CConcurrentHashMap_h
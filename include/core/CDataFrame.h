@@ -8,6 +8,7 @@
 #define INCLUDED_ml_core_CDataFrame_h
 
 #include <core/CAlignment.h>
+#include <core/CConcurrentHashMap.h>
 #include <core/CFloatStorage.h>
 #include <core/CPackedBitVector.h>
 #include <core/CVectorRange.h>
@@ -15,7 +16,6 @@
 #include <core/ImportExport.h>
 
 #include <boost/optional.hpp>
-#include <boost/unordered_map.hpp>
 
 #include <algorithm>
 #include <cstdint>
@@ -37,8 +37,13 @@ using TFloatVec = std::vector<CFloatStorage, CAlignedAllocator<CFloatStorage>>;
 using TFloatVecItr = TFloatVec::iterator;
 using TInt32Vec = std::vector<std::int32_t>;
 using TInt32VecCItr = TInt32Vec::const_iterator;
+using TSizeVecCItr = std::vector<std::size_t>::const_iterator;
 
 //! \brief A callback used to iterate over only the masked rows.
+//!
+//! DESCRIPTION:\n
+//! The rows to visit can either be the one bits of a mask or a sorted
+//! collection of row indices.
 class CORE_EXPORT CPopMaskedRow {
 public:
     CPopMaskedRow(std::size_t endSliceRows,
@@ -46,17 +51,27 @@ public:
                   const CPackedBitVector::COneBitIndexConstIterator& endMaskedRows)
         : m_EndSliceRows{endSliceRows}, m_MaskedRow{&maskedRow}, m_EndMaskedRows{&endMaskedRows} {
     }
+    CPopMaskedRow(std::size_t endSliceRows, TSizeVecCItr& indexedRow, const TSizeVecCItr& endIndexedRows)
+        : m_EndSliceRows{endSliceRows}, m_IndexedRow{&indexedRow}, m_EndIndexedRows{&endIndexedRows} {
+    }
 
     std::size_t operator()() const {
-        return ++(*m_MaskedRow) == *m_EndMaskedRows
+        if (m_MaskedRow != nullptr) {
+            return ++(*m_MaskedRow) == *m_EndMaskedRows
+                       ? m_EndSliceRows
+                       : std::min(**m_MaskedRow, m_EndSliceRows);
+        }
+        return ++(*m_IndexedRow) == *m_EndIndexedRows
                    ? m_EndSliceRows
-                   : std::min(**m_MaskedRow, m_EndSliceRows);
+                   : std::min(**m_IndexedRow, m_EndSliceRows);
     }
 
 private:
     std::size_t m_EndSliceRows;
-    CPackedBitVector::COneBitIndexConstIterator* m_MaskedRow;
-    const CPackedBitVector::COneBitIndexConstIterator* m_EndMaskedRows;
+    CPackedBitVector::COneBitIndexConstIterator* m_MaskedRow = nullptr;
+    const CPackedBitVector::COneBitIndexConstIterator* m_EndMaskedRows = nullptr;
+    TSizeVecCItr* m_IndexedRow = nullptr;
+    const TSizeVecCItr* m_EndIndexedRows = nullptr;
 };
 
 using TOptionalPopMaskedRow = boost::optional<CPopMaskedRow>;
@@ -222,10 +237,18 @@ private:
 //! Read from and writes to storage can optionally happen in a separate thread
 //! to the row reading and writing to deal with the case that these operations
 //! can by time consuming.
+//!
+//! If NUMA aware placement is configured (see CNumaPlacement) main memory slices
+//! are placed on the NUMA nodes in contiguous blocks and parallel reads take the
+//! slices placed on the node they are running on first. In this case the slices
+//! each reader visits depend on scheduling and aren't in row order.
 class CORE_EXPORT CDataFrame final {
 public:
     using TBoolVec = std::vector<bool>;
     using TSizeVec = std::vector<std::size_t>;
+    using TSizeVecCItr = TSizeVec::const_iterator;
+    using TSizeVecCItrPr = std::pair<TSizeVecCItr, TSizeVecCItr>;
+    using TSizeVecCItrPrVec = std::vector<TSizeVecCItrPr>;
     using TSizeVecSizePr = std::pair<TSizeVec, std::size_t>;
     using TStrVec = std::vector<std::string>;
     using TStrVecVec = std::vector<TStrVec>;
@@ -238,6 +261,7 @@ public:
     using TRowItr = data_frame_detail::CRowIterator;
     using TRowFunc = std::function<void(TRowItr, TRowItr)>;
     using TRowFuncVec = std::vector<TRowFunc>;
+    using TRowFuncVecVec = std::vector<TRowFuncVec>;
     using TRowFuncVecBoolPr = std::pair<TRowFuncVec, bool>;
     using TWriteFunc = std::function<void(TFloatVecItr, std::int32_t&)>;
     using TRowSlicePtr = std::shared_ptr<CDataFrameRowSlice>;
@@ -248,6 +272,10 @@ public:
         std::function<TRowSlicePtr(std::size_t, TFloatVec, TInt32Vec)>;
 
     //! Controls whether to read and write to storage asynchronously.
+    //!
+    //! Asynchronous sequential reads prefetch the next few slices and write
+    //! back modified slices on the default executor so storage I/O overlaps
+    //! applying the row functions.
     enum class EReadWriteToStorage { E_Async, E_Sync };
 
 public:
@@ -365,6 +393,32 @@ public:
                   TRowFuncVec& readers,
                   const CPackedBitVector* rowMask) const;
 
+    //! Overload which reads only the rows whose indices are in the range
+    //! [\p beginRowIndices, \p endRowIndices).
+    //!
+    //! The indices are divided into contiguous blocks of (nearly) equal size
+    //! and the i'th reader reads the rows of the i'th block. Each reader is run
+    //! on its own thread.
+    //!
+    //! \note This is intended for reading small subsets of the rows, for which
+    //! visiting them by index is much cheaper than scanning a mask of all rows.
+    //! \warning The indices must be sorted in increasing order.
+    bool readRows(TSizeVecCItr beginRowIndices,
+                  TSizeVecCItr endRowIndices,
+                  TRowFuncVec& readers) const;
+
+    //! Overload which reads the rows whose indices are in each of a collection
+    //! of ranges.
+    //!
+    //! This is equivalent to calling readRows with the i'th range and the i'th
+    //! collection of readers for each i, except that the blocks of all ranges
+    //! are read in a single parallel loop. Use this to read several disjoint
+    //! subsets of the rows concurrently: calling readRows from a function which
+    //! is already running in parallel reads sequentially.
+    //!
+    //! \warning The indices of each range must be sorted in increasing order.
+    bool readRows(const TSizeVecCItrPrVec& rowIndexRanges, TRowFuncVecVec& readers) const;
+
     //! Convenience overload for typed readers.
     //!
     //! The reason for this is to wrap up the code to extract the typed readers
@@ -492,6 +546,12 @@ public:
     //! Write which columns contain categorical data.
     void categoricalColumns(TBoolVec columnIsCategorical);
 
+    //! Write the string values of the categories for each column.
+    //!
+    //! \note This is intended for restoring rows whose categorical columns
+    //! are already encoded as identifiers into \p categoricalColumnValues.
+    void categoricalColumnValues(TStrVecVec categoricalColumnValues);
+
     //! This retrieves the asynchronous work from writing the rows to the store
     //! and updates the stored rows.
     //!
@@ -502,6 +562,12 @@ public:
     //! work and to join the thread used to store the slices.
     void finishWritingRows();
 
+    //! Remove all rows and the categorical column values read from them.
+    //!
+    //! The column names, types and the row capacity are unchanged so the data
+    //! frame can be reused to process the next batch of a stream of rows.
+    void clearRows();
+
     //! \return The column names if any.
     const TStrVec& columnNames() const;
 
@@ -530,11 +596,13 @@ public:
     }
 
 private:
-    using TStrSizeUMap = boost::unordered_map<std::string, std::size_t>;
-    using TStrSizeUMapVec = std::vector<TStrSizeUMap>;
+    using TStrSizeCMap = CConcurrentHashMap<std::string, std::size_t>;
+    using TStrSizeCMapVec = std::vector<TStrSizeCMap>;
     using TSizeSizePr = std::pair<std::size_t, std::size_t>;
     using TSizeDataFrameRowSlicePtrVecPr = std::pair<std::size_t, TRowSlicePtrVec>;
     using TOptionalPopMaskedRow = data_frame_detail::TOptionalPopMaskedRow;
+    using TRowSliceFunc = std::function<void(const TRowSlicePtr&)>;
+    using TRowSliceFuncVec = std::vector<TRowSliceFunc>;
 
     //! \brief Writes rows to the data frame.
     class CDataFrameRowSliceWriter final {
@@ -577,6 +645,14 @@ private:
                                   const CPackedBitVector* rowMask,
                                   bool commitResult) const;
 
+    void numaAwareParallelApplyToSlices(TRowSlicePtrVecCItr beginSlices,
+                                        TRowSlicePtrVecCItr endSlices,
+                                        TRowSliceFuncVec& funcs) const;
+
+    bool applyToIndexedRows(TRowFunc& func,
+                            TSizeVecCItr beginRowIndices,
+                            TSizeVecCItr endRowIndices) const;
+
     void applyToRowsOfOneSlice(TRowFunc& func,
                                std::size_t firstRowToRead,
                                std::size_t endRowsToRead,
@@ -586,6 +662,10 @@ private:
     TRowSlicePtrVecCItr beginSlices(std::size_t beginRows) const;
     TRowSlicePtrVecCItr endSlices(std::size_t endRows) const;
 
+    bool placeSlicesOnNumaNodes() const;
+    std::size_t beginNumaNodeSlices(std::size_t node) const;
+    void applyToSlicesOnTheirNumaNodes(const std::function<void(TRowSlicePtr&)>& func);
+
     template<typename ITR>
     bool maskedRowsInSlice(ITR& maskedRow,
                            ITR endMaskedRows,
@@ -619,7 +699,7 @@ private:
     TStrVecVec m_CategoricalColumnValues;
 
     //! A lookup for the integer value of categories.
-    TStrSizeUMapVec m_CategoricalColumnValueLookup;
+    TStrSizeCMapVec m_CategoricalColumnValueLookup;
 
     //! The string which indicates that a category is missing.
     std::string m_MissingString;
@@ -637,6 +717,9 @@ private:
     //! The stored slices.
     TRowSlicePtrVec m_Slices;
 
+    //! The NUMA node on which each slice was last placed.
+    TSizeVec m_SliceNumaNodes;
+
     //! The slice writer which is currently active.
     TRowSliceWriterPtr m_Writer;
 };
@@ -0,0 +1,84 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#ifndef INCLUDED_ml_core_CDataFrameCache_h
+#define INCLUDED_ml_core_CDataFrameCache_h
+
+#include <core/ImportExport.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace ml {
+namespace core {
+class CDataFrame;
+
+//! \brief A persistent cache of the rows read into a data frame.
+//!
+//! DESCRIPTION:\n
+//! Parsing the rows of a data frame, and in particular building the category
+//! dictionaries, is a significant fraction of the cost of analyses which are
+//! repeated on the same data. This stores the prepared rows, their document
+//! hashes, the column names and types and the category dictionaries in a file
+//! in a cache directory so a subsequent analysis can restore them directly.
+//! The caller also supplies a hash of the input from which each row was parsed
+//! so it can check whether the source data have changed since they were cached.
+//!
+//! IMPLEMENTATION:\n
+//! Entries are identified by a key supplied by the caller, which should be
+//! unique for the source data and the way they're parsed, and are stored in a
+//! versioned binary format. An entry is written to a uniquely named temporary
+//! file and renamed so concurrent readers and writers never see a partially
+//! written entry. Reading fails, and so the caller can fall back to parsing the
+//! data, if the format version or schema of the data frame don't match.
+class CORE_EXPORT CDataFrameCache {
+public:
+    using TUInt64Vec = std::vector<std::uint64_t>;
+
+public:
+    //! The version of the file format.
+    static const std::uint32_t VERSION;
+
+public:
+    CDataFrameCache(const std::string& directory, const std::string& key);
+
+    //! Get the name of the file holding the cache entry.
+    const std::string& fileName() const;
+
+    //! Check if the cache has an entry.
+    bool exists() const;
+
+    //! Write the rows of \p frame to the cache.
+    //!
+    //! \param[in] frame The data frame to cache.
+    //! \param[in] rowHashes The hashes of the input for each row of \p frame.
+    //! \note Only the columns which have been read into \p frame, i.e. up to
+    //! frame.numberColumns(), are stored.
+    bool write(const CDataFrame& frame, const TUInt64Vec& rowHashes) const;
+
+    //! Restore the cached rows into \p frame.
+    //!
+    //! \param[in,out] frame The data frame to populate. This must be empty and
+    //! have the same number of columns as the cached data frame. If it has
+    //! column names and types these must also match.
+    //! \param[out] rowHashes Filled in with the input hashes of the rows read.
+    //! \param[in] maximumNumberRows The maximum number of rows to restore. If
+    //! this is fewer than the number cached the category dictionaries are also
+    //! restricted to the categories of the rows restored.
+    //! \return False if the cached data frame can't be restored into \p frame.
+    bool read(CDataFrame& frame,
+              TUInt64Vec& rowHashes,
+              std::size_t maximumNumberRows = std::numeric_limits<std::size_t>::max()) const;
+
+private:
+    std::string m_FileName;
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CDataFrameCache_h
@@ -99,6 +99,8 @@ public:
     virtual CDataFrameRowSliceHandle read() = 0;
     //! Write the slice.
     virtual void write(const TFloatVec& rows, const TInt32Vec& docHashes) = 0;
+    //! Move any memory the slice holds to the NUMA node of the calling thread.
+    virtual void relocate() = 0;
     //! The static size of this object.
     virtual std::size_t staticSize() const = 0;
     //! The heap memory used by this object.
@@ -126,6 +128,7 @@ public:
     std::size_t indexOfLastRow(std::size_t rowCapacity) const override;
     CDataFrameRowSliceHandle read() override;
     void write(const TFloatVec& rows, const TInt32Vec& docHashes) override;
+    void relocate() override;
     std::size_t staticSize() const override;
     std::size_t memoryUsage() const override;
     std::uint64_t checksum() const override;
@@ -191,6 +194,7 @@ public:
     std::size_t indexOfLastRow(std::size_t rowCapacity) const override;
     CDataFrameRowSliceHandle read() override;
     void write(const TFloatVec& rows, const TInt32Vec& docHashes) override;
+    void relocate() override;
     std::size_t staticSize() const override;
     std::size_t memoryUsage() const override;
     std::uint64_t checksum() const override;
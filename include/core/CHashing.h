@@ -386,16 +386,20 @@ public:
         static bool dynamicSizeAlwaysZero() { return true; }
         using TStrCRef = std::reference_wrapper<const std::string>;
 
+        //! The default seed.
+        static constexpr std::size_t DEFAULT_SEED{0x5bd1e995};
+
     public:
-        CMurmurHash2String(std::size_t seed = 0x5bd1e995) : m_Seed(seed) {}
+        CMurmurHash2String(std::size_t seed = DEFAULT_SEED) : m_Seed(seed) {}
 
         std::size_t operator()(const std::string& key) const;
         std::size_t operator()(TStrCRef key) const {
             return this->operator()(key.get());
         }
+        //! \note Stored strings cache their hash for the default seed.
         std::size_t operator()(const CStoredStringPtr& key) const {
             if (key) {
-                return this->operator()(*key);
+                return m_Seed == DEFAULT_SEED ? key.hash() : this->operator()(*key);
             }
             return m_Seed;
         }
@@ -16,6 +16,9 @@
 #include <rapidjson/reader.h>
 
 #include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
 
 namespace ml {
 namespace core {
@@ -31,6 +34,12 @@ namespace core {
 //! Input is streaming rather than building up an in-memory JSON
 //! document.
 //!
+//! If the whole document is available in a contiguous buffer it can
+//! be parsed in-situ. In this case the names and values are decoded in
+//! place and are only copied if name() or value() are called. Also
+//! numbers are returned exactly as they appear in the document rather
+//! than being parsed and formatted again.
+//!
 //! Unlike the CRapidXmlStatePersistInserter, there is no possibility
 //! of including attributes on the root node (because JSON does not
 //! have attributes).  This may complicate code that needs to be 100%
@@ -40,6 +49,11 @@ class CORE_EXPORT CJsonStateRestoreTraverser : public CStateRestoreTraverser {
 public:
     CJsonStateRestoreTraverser(std::istream& inputStream);
 
+    //! Parse \p buffer in-situ.
+    //!
+    //! \warning Parsing modifies \p buffer, which must outlive the traverser.
+    CJsonStateRestoreTraverser(std::string& buffer);
+
     //! Navigate to the next element at the current level, or return false
     //! if there isn't one
     virtual bool next();
@@ -80,12 +94,12 @@ private:
     //! Accessors for alternating state variables
     size_t currentLevel() const;
     bool currentIsEndOfLevel() const;
-    const std::string& currentName() const;
-    const std::string& currentValue() const;
+    std::string_view currentName() const;
+    std::string_view currentValue() const;
     size_t nextLevel() const;
     bool nextIsEndOfLevel() const;
-    const std::string& nextName() const;
-    const std::string& nextValue() const;
+    std::string_view nextName() const;
+    std::string_view nextValue() const;
 
     //! Start off the parsing process
     bool start();
@@ -102,11 +116,15 @@ private:
     //! Skip the (JSON) array until it ends
     bool skipArray();
 
+private:
+    using TIStreamWrapperUPtr = std::unique_ptr<rapidjson::IStreamWrapper>;
+    using TInsituStringStreamUPtr = std::unique_ptr<rapidjson::InsituStringStream>;
+
 private:
     //! <a href="http://rapidjson.org/classrapidjson_1_1_handler.html">Handler</a>
     //! for events fired by rapidjson during parsing.
     struct SRapidJsonHandler final {
-        SRapidJsonHandler();
+        explicit SRapidJsonHandler(bool insitu);
 
         bool Null();
         bool Bool(bool b);
@@ -115,7 +133,7 @@ private:
         bool Int64(int64_t i);
         bool Uint64(uint64_t u);
         bool Double(double d);
-        bool RawNumber(const char*, rapidjson::SizeType, bool);
+        bool RawNumber(const char* str, rapidjson::SizeType length, bool);
         bool String(const char* str, rapidjson::SizeType length, bool);
         bool StartObject();
         bool Key(const char* str, rapidjson::SizeType length, bool);
@@ -136,15 +154,30 @@ private:
             E_TokenObjectStart = 9,
             E_TokenObjectEnd = 10,
             E_TokenArrayStart = 11,
-            E_TokenArrayEnd = 12
+            E_TokenArrayEnd = 12,
+            E_TokenNumber = 13
         };
 
+        //! Set the name or value \p view to \p str copying into \p buffer
+        //! unless parsing in-situ.
+        void assign(const char* str,
+                    rapidjson::SizeType length,
+                    std::string_view& view,
+                    std::string& buffer);
+
         ETokenType s_Type;
 
+        //! If true the names and values point into the parsed buffer.
+        bool s_Insitu;
+
         size_t s_Level[2];
         bool s_IsEndOfLevel[2];
-        std::string s_Name[2];
-        std::string s_Value[2];
+        std::string_view s_Name[2];
+        std::string_view s_Value[2];
+
+        //! Storage for the names and values if they're not parsed in-situ.
+        std::string s_NameBuffer[2];
+        std::string s_ValueBuffer[2];
 
         //! Setting m_NextIndex = (1 - m_NextIndex) advances the
         //! stored details.
@@ -154,7 +187,10 @@ private:
     };
 
     //! JSON reader istream wrapper
-    rapidjson::IStreamWrapper m_ReadStream;
+    TIStreamWrapperUPtr m_ReadStream;
+
+    //! JSON reader in-situ buffer stream
+    TInsituStringStreamUPtr m_InsituStream;
 
     //! JSON reader
     rapidjson::Reader m_Reader;
@@ -170,6 +206,12 @@ private:
 
     //! If the first token is an '[' then we are parsing an array of objects
     bool m_IsArrayOfObjects;
+
+    //! Copies of the current name and value if parsing in-situ.
+    mutable std::string m_NameCache;
+    mutable std::string m_ValueCache;
+    mutable const char* m_CachedNameData;
+    mutable const char* m_CachedValueData;
 };
 }
 }
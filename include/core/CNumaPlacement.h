@@ -0,0 +1,84 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CNumaPlacement_h
+#define INCLUDED_ml_core_CNumaPlacement_h
+
+#include <core/CNonInstantiatable.h>
+#include <core/ImportExport.h>
+
+#include <cstddef>
+#include <functional>
+
+namespace ml {
+namespace core {
+
+//! \brief Functions for placing threads and memory on NUMA nodes.
+//!
+//! DESCRIPTION:\n
+//! On multi-socket machines memory accesses which cross the interconnect
+//! between sockets are significantly slower than local ones. If NUMA aware
+//! placement is configured the workers of CStaticThreadPool are pinned to
+//! nodes in contiguous blocks and main memory data frames place their row
+//! slices on the node of the workers which will read them.
+//!
+//! Memory placement relies on the kernel's first touch policy, i.e. pages
+//! are allocated on the node of the thread which first writes them. So we
+//! place memory on a node by writing it from a thread bound to that node.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! This is a static class - it's not possible to construct an instance of it.
+//!
+//! Nodes are numbered 0 to numberNodes() - 1 and only nodes which have CPUs
+//! the process is allowed to run on are counted, so these indices needn't
+//! match the operating system's node identifiers. On platforms other than
+//! Linux there is always a single node and threads are never bound.
+class CORE_EXPORT CNumaPlacement : private CNonInstantiatable {
+public:
+    using TSizeFunc = std::function<void(std::size_t)>;
+
+public:
+    //! Configure placement.
+    //!
+    //! \param[in] numaAware If true pin thread pool workers and place data
+    //! frame memory on NUMA nodes.
+    //! \param[in] hugePages If true request transparent huge pages for large
+    //! data frame slices.
+    //! \note This is not thread safe. It should be called once before the
+    //! default async executor is started.
+    static void configure(bool numaAware, bool hugePages);
+
+    //! Check if NUMA aware placement is configured.
+    static bool numaAware();
+
+    //! Check if huge pages should be requested for large allocations.
+    static bool hugePages();
+
+    //! Get the number of NUMA nodes.
+    static std::size_t numberNodes();
+
+    //! Get the node of the CPU on which the calling thread is running.
+    static std::size_t currentNode();
+
+    //! Restrict the calling thread to the CPUs of \p node.
+    //!
+    //! \return True if the thread was bound.
+    static bool bindCurrentThreadToNode(std::size_t node);
+
+    //! Call \p f with each node index on a thread bound to that node.
+    //!
+    //! \note This blocks until all calls have returned.
+    static void runOnEachNode(const TSizeFunc& f);
+
+    //! Advise the kernel to back the whole huge pages in [\p memory, \p memory
+    //! + \p bytes) with huge pages.
+    //!
+    //! \note This should be called before the memory is first written.
+    static void adviseHugePages(void* memory, std::size_t bytes);
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CNumaPlacement_h
@@ -61,6 +61,18 @@ public:
     //! passed to \p doc Accept.
     void write(const rapidjson::Value& doc) { doc.Accept(*this); }
 
+    //! Write the members of the object \p obj without its enclosing braces.
+    //!
+    //! This allows extra fields to be streamed into an object stored as a
+    //! document without first adding them to the document.
+    //! \note The caller is responsible for calling StartObject and EndObject.
+    void writeMembers(const rapidjson::Value& obj) {
+        for (const auto& member : obj.GetObject()) {
+            this->Key(member.name.GetString(), member.name.GetStringLength());
+            member.value.Accept(*this);
+        }
+    }
+
 private:
     size_t m_ObjectCount = 0;
 };
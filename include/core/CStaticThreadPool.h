@@ -6,15 +6,19 @@
 #ifndef INCLUDED_ml_core_CStaticThreadPool_h
 #define INCLUDED_ml_core_CStaticThreadPool_h
 
+#include <core/CAllocationTracker.h>
 #include <core/CConcurrentQueue.h>
 #include <core/Concurrency.h>
 #include <core/ImportExport.h>
 
 #include <boost/optional.hpp>
 
+#include <array>
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -27,12 +31,22 @@ namespace core {
 //! This purposely has very limited interface and is intended to mainly support
 //! CThreadPoolExecutor which provides the mechanism by which we expose the thread
 //! pool to the rest of the code via calls core::async.
+//!
+//! Tasks are queued in one lane per priority, each of which has one queue per
+//! worker. Workers choose which lane to serve next according to the scheduling
+//! policy and sleep on a condition variable when every queue is empty.
+//!
+//! If NUMA aware placement is configured when the pool is created, workers
+//! are bound to NUMA nodes in contiguous blocks of ids (see CNumaPlacement).
 class CORE_EXPORT CStaticThreadPool {
 public:
     using TTask = std::function<void()>;
+    using EPriority = CExecutor::EPriority;
+    using EScheduling = CExecutor::EScheduling;
 
 public:
-    explicit CStaticThreadPool(std::size_t size);
+    explicit CStaticThreadPool(std::size_t size,
+                               EScheduling scheduling = CExecutor::E_StrictPriority);
 
     ~CStaticThreadPool();
 
@@ -41,7 +55,8 @@ public:
     CStaticThreadPool& operator=(const CStaticThreadPool&) = delete;
     CStaticThreadPool& operator=(CStaticThreadPool&&) = delete;
 
-    //! Schedule a Callable type to be executed by a thread in the pool.
+    //! Schedule a Callable type to be executed by a thread in the pool with
+    //! the priority of the calling thread.
     //!
     //! \note This forwards the task to the queue.
     //! \note This can block (if the task queues are full). This is intentional
@@ -50,17 +65,24 @@ public:
     //! thread scheduling tasks if the pool can't keep up.
     void schedule(TTask&& task);
 
+    //! Schedule a Callable type to be executed by a thread in the pool with
+    //! \p priority.
+    void schedule(TTask&& task, EPriority priority);
+
     //! Check if the thread pool has been marked as busy.
     bool busy() const;
 
     //! Check if the thread pool has been marked as busy.
     void busy(bool busy);
 
+    //! Get the number of tasks waiting to run with \p priority.
+    std::size_t queueDepth(EPriority priority) const;
+
 private:
     using TOptionalSize = boost::optional<std::size_t>;
     class CWrappedTask {
     public:
-        explicit CWrappedTask(TTask&& task, TOptionalSize threadId = boost::none);
+        CWrappedTask(TTask&& task, EPriority priority, TOptionalSize threadId = boost::none);
 
         bool executableOnThread(std::size_t id) const;
         void operator()();
@@ -68,25 +90,45 @@ private:
     private:
         TTask m_Task;
         TOptionalSize m_ThreadId;
+        //! The priority the task was scheduled with.
+        EPriority m_Priority;
+        //! The allocation tag of the thread which scheduled the task.
+        CAllocationTracker::ETag m_AllocationTag;
     };
     using TOptionalTask = boost::optional<CWrappedTask>;
     using TWrappedTaskQueue = CConcurrentQueue<CWrappedTask, 50>;
     using TWrappedTaskQueueVec = std::vector<TWrappedTaskQueue>;
     using TThreadVec = std::vector<std::thread>;
+    using TPriorityArray = std::array<EPriority, CExecutor::NUMBER_PRIORITIES>;
+    using TAtomicSizeArray = std::array<std::atomic_size_t, CExecutor::NUMBER_PRIORITIES>;
 
 private:
     void shutdown();
     void worker(std::size_t id);
+    TOptionalTask tryPop(std::size_t id, std::size_t& pops);
+    TPriorityArray priorityOrder(std::size_t pops) const;
+    void waitForTasks();
+    void notifyWorkers(bool all);
     void drainQueuesWithoutBlocking();
+    TWrappedTaskQueue& queue(EPriority priority, std::size_t id);
 
 private:
     // This doesn't have to be atomic because it is always only set to true,
     // always set straight before it is checked on each worker in the pool
     // and tearing can't happen for single byte writes.
     bool m_Done = false;
+    std::size_t m_Size;
+    EScheduling m_Scheduling;
     std::atomic_bool m_Busy;
     std::atomic<std::uint64_t> m_Cursor;
+    //! The queues of each lane, i.e. m_Size queues for each priority.
     TWrappedTaskQueueVec m_TaskQueues;
+    //! The number of tasks queued in each lane.
+    TAtomicSizeArray m_QueueDepths;
+    //! The number of workers waiting for a task.
+    std::atomic_size_t m_NumberSleeping;
+    std::mutex m_SleepMutex;
+    std::condition_variable m_SleepCondition;
     TThreadVec m_Pool;
 };
 }
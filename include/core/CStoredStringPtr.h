@@ -31,6 +31,11 @@ namespace core {
 //! The private constructors make it hard to accidentally construct
 //! stored string pointers that are not managed by a string store.
 //!
+//! Stored strings are used as keys in many hash containers so the hash
+//! of the string is computed once when it is stored and carried with the
+//! pointer. This is the same as CHashing::CMurmurHash2String with its
+//! default seed.
+//!
 class CORE_EXPORT CStoredStringPtr {
 public:
     //! NULL constructor.
@@ -53,6 +58,15 @@ public:
     //! Is there only one pointer for this stored string?
     bool isUnique() const noexcept;
 
+    //! Get the hash of the string.
+    std::size_t hash() const noexcept { return m_Hash; }
+
+    //! Check if the strings pointed to are equal.
+    //!
+    //! \note This short-circuits on pointer identity and compares hashes
+    //! before comparing the strings.
+    bool hasSameString(const CStoredStringPtr& other) const noexcept;
+
     //! Equality operator for NULL.
     bool operator==(std::nullptr_t rhs) const noexcept;
     bool operator!=(std::nullptr_t rhs) const noexcept;
@@ -93,6 +107,9 @@ private:
     //! The wrapped shared_ptr.
     TStrCPtr m_String;
 
+    //! The hash of the string.
+    std::size_t m_Hash;
+
     friend CORE_EXPORT std::size_t hash_value(const CStoredStringPtr&);
 };
 
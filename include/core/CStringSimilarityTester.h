@@ -191,9 +191,10 @@ public:
     //! Calculate the weighted edit distance between two sequences.  Each
     //! element of each sequence has an associated weight, such that some
     //! elements can be considered more expensive to add/remove/replace than
-    //! others.  Can be applied to any container that implements size() and
-    //! operator[]() where the elements are std::pairs<T, size_t>.  The
-    //! first element of each pair must implement operator==().
+    //! others.  Can be applied to any containers that implement size() and
+    //! operator[]() where the elements are std::pairs<T, U> and U converts
+    //! to size_t.  The first elements of the pairs in the two containers
+    //! must be comparable using operator==().
     //!
     //! Unfortunately, in the case of arbitrary weightings, the
     //! Berghel-Roach algorithm cannot be applied.  Ukkonen gives a
@@ -204,8 +205,9 @@ public:
     //!
     //! TODO - It may be possible to apply some of the lesser optimisations
     //! from section 2 of Ukkonen's paper to this algorithm.
-    template<typename PAIRCONTAINER>
-    size_t weightedEditDistance(const PAIRCONTAINER& first, const PAIRCONTAINER& second) const {
+    template<typename FIRST_PAIRCONTAINER, typename SECOND_PAIRCONTAINER>
+    size_t weightedEditDistance(const FIRST_PAIRCONTAINER& first,
+                                const SECOND_PAIRCONTAINER& second) const {
         // This is similar to the levenshteinDistanceSimple() method below,
         // but adding the concept of different costs for each element.  If
         // you are trying to understand this method, you should first make
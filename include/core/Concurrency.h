@@ -9,6 +9,7 @@
 
 #include <core/CLogger.h>
 #include <core/CLoopProgress.h>
+#include <core/CNonCopyable.h>
 #include <core/ImportExport.h>
 
 #include <algorithm>
@@ -68,14 +69,60 @@ auto bindRetrievableState(FUNCTION&& function, STATE&& state) {
 }
 
 //! \brief The base executor hierarchy.
+//!
+//! Tasks are scheduled into one of a number of priority lanes. The lane is
+//! the priority of the scheduling thread, see CScopedTaskPriority.
 class CExecutor {
+public:
+    //! The priority lanes into which tasks can be scheduled.
+    enum EPriority {
+        E_HighPriority = 0, //!< For latency sensitive tasks.
+        E_NormalPriority,   //!< The default.
+        E_LowPriority       //!< For bulk computation.
+    };
+
+    //! The number of distinct priorities.
+    static constexpr std::size_t NUMBER_PRIORITIES{E_LowPriority + 1};
+
+    //! The policies for choosing between lanes.
+    enum EScheduling {
+        //! Always run the highest priority task available except that lower
+        //! priority lanes are periodically served first to avoid starvation.
+        E_StrictPriority,
+        //! Serve the lanes in proportion to fixed weights.
+        E_WeightedPriority
+    };
+
 public:
     virtual ~CExecutor() = default;
     virtual void schedule(std::function<void()>&& f) = 0;
     virtual bool busy() const = 0;
     virtual void busy(bool value) = 0;
+    //! Get the number of tasks waiting to run with \p priority.
+    virtual std::size_t queueDepth(EPriority priority) const = 0;
 };
 
+//! \brief Sets the priority of the tasks the current thread schedules for
+//! the lifetime of the object.
+//!
+//! DESCRIPTION:\n
+//! Tasks run with the priority they were scheduled with so any tasks they
+//! schedule in turn inherit it. For example, wrapping a call to a function
+//! which uses parallel_for_each in this schedules all its tasks in the same
+//! lane.
+class CORE_EXPORT CScopedTaskPriority : private CNonCopyable {
+public:
+    explicit CScopedTaskPriority(CExecutor::EPriority priority);
+    ~CScopedTaskPriority();
+
+private:
+    CExecutor::EPriority m_PreviousPriority;
+};
+
+//! Get the priority of tasks scheduled on the current thread.
+CORE_EXPORT
+CExecutor::EPriority currentTaskPriority();
+
 //! Setup the global default executor for async.
 //!
 //! \note This is not thread safe as the intention is that it is invoked once,
@@ -83,7 +130,8 @@ public:
 //! \note If this is called with threads equal to zero it defaults to calling
 //! std::thread::hardware_concurrency to size the thread pool.
 CORE_EXPORT
-void startDefaultAsyncExecutor(std::size_t threadPoolSize = 0);
+void startDefaultAsyncExecutor(std::size_t threadPoolSize = 0,
+                               CExecutor::EScheduling scheduling = CExecutor::E_StrictPriority);
 
 //! Shutdown the thread pool and reset the executor to sequential in the same thread.
 //!
@@ -154,6 +202,14 @@ async(CExecutor& executor, FUNCTION&& f, ARGS&&... args) {
     return result;
 }
 
+//! An overload of async which schedules \p f with \p priority.
+template<typename FUNCTION, typename... ARGS>
+std::future<std::result_of_t<std::decay_t<FUNCTION>(std::decay_t<ARGS>...)>>
+async(CExecutor& executor, CExecutor::EPriority priority, FUNCTION&& f, ARGS&&... args) {
+    CScopedTaskPriority scopedPriority{priority};
+    return async(executor, std::forward<FUNCTION>(f), std::forward<ARGS>(args)...);
+}
+
 //! Wait for all \p futures to be available.
 template<typename T>
 void wait_for_all(const std::vector<std::future<T>>& futures) {
@@ -172,7 +228,7 @@ void wait_for_valid(const std::future<T>& future) {
 //! Wait for all valid \p futures to be available.
 template<typename T>
 void wait_for_all_valid(const std::vector<std::future<T>>& futures) {
-    std::for_each(futures.begin(), futures.end(), wait_for_valid);
+    std::for_each(futures.begin(), futures.end(), wait_for_valid<T>);
 }
 
 //! \brief Waits for a future to complete when the object is destroyed.
@@ -188,6 +244,22 @@ private:
     std::future<T>& m_Future;
 };
 
+//! \brief Waits for all valid futures in a collection to complete when the
+//! object is destroyed.
+template<typename T>
+class CWaitForAllValidWhenExitingScope {
+public:
+    CWaitForAllValidWhenExitingScope(std::vector<std::future<T>>& futures)
+        : m_Futures{futures} {}
+    ~CWaitForAllValidWhenExitingScope() { wait_for_all_valid(m_Futures); }
+    CWaitForAllValidWhenExitingScope(const CWaitForAllValidWhenExitingScope&) = delete;
+    CWaitForAllValidWhenExitingScope&
+    operator=(const CWaitForAllValidWhenExitingScope&) = delete;
+
+private:
+    std::vector<std::future<T>>& m_Futures;
+};
+
 //! Get the conjunction of all \p futures.
 CORE_EXPORT
 bool get_conjunction_of_all(std::vector<std::future<bool>>& futures);
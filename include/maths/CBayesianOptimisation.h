@@ -22,6 +22,11 @@
 #include <utility>
 #include <vector>
 
+namespace CBayesianOptimisationTest {
+struct testMinusExpectedImprovementForCandidates;
+struct testAnovaVersusPairwiseSums;
+}
+
 namespace ml {
 namespace maths {
 
@@ -152,10 +157,13 @@ private:
 private:
     void precondition();
     TVector function() const;
+    double functionMinimum() const;
     double meanErrorVariance() const;
     TMatrix dKerneld(const TVector& a, int k) const;
     TMatrix kernel(const TVector& a, double v) const;
     TVectorDoublePr kernelCovariates(const TVector& a, const TVector& x, double vx) const;
+    TMatrix kernelCovariates(const TVector& a, const TMatrix& x) const;
+    TVector minusExpectedImprovement(const TMatrix& x) const;
     double kernel(const TVector& a, const TVector& x, const TVector& y) const;
     double evaluate(const TVector& Kinvf, const TVector& input) const;
     double evaluate1D(const TVector& Kinvf, double input, int dimension) const;
@@ -164,6 +172,7 @@ private:
     double anovaMainEffect(const TVector& Kinvf, int dimension) const;
     TVector kinvf() const;
     TVector transformTo01(const TVector& x) const;
+    TMatrix pointsTo01() const;
     TVector scaledKernelParameters() const;
     void checkRestoredInvariants() const;
 
@@ -178,6 +187,9 @@ private:
     TDoubleVec m_ErrorVariances;
     TVector m_KernelParameters;
     TVector m_MinimumKernelCoordinateDistanceScale;
+
+    friend struct CBayesianOptimisationTest::testMinusExpectedImprovementForCandidates;
+    friend struct CBayesianOptimisationTest::testAnovaVersusPairwiseSums;
 };
 }
 }
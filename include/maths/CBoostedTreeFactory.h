@@ -120,6 +120,18 @@ public:
     CBoostedTreeFactory& numberTopShapValues(std::size_t numberTopShapValues);
     //! Set the flag to enable or disable early stopping.
     CBoostedTreeFactory& earlyStoppingEnabled(bool enable);
+    //! Set whether to run the hyperparameter line searches on a random sample
+    //! of the training rows if the data set is large.
+    CBoostedTreeFactory& downsampleLineSearches(bool enable);
+    //! Set the maximum number of leaves whose children we'll compute concurrently
+    //! growing each tree.
+    //!
+    //! \note Late in growing a tree the leaves are small and there is too little
+    //! work to split a single leaf efficiently on many threads. Splitting several
+    //! of the best leaves at once improves utilisation. The tree is deterministic
+    //! for a fixed value, but may differ from the one grown by splitting leaves
+    //! one at a time.
+    CBoostedTreeFactory& numberConcurrentLeafSplits(std::size_t number);
 
     //! Set pointer to the analysis instrumentation.
     CBoostedTreeFactory&
@@ -137,6 +149,13 @@ public:
     //! Restore a boosted tree object for a given data frame.
     //! \warning A tree object can only be restored once.
     TBoostedTreeUPtr restoreFor(core::CDataFrame& frame, std::size_t dependentVariable);
+    //! Restore a trained boosted tree object to predict the rows of \p frame.
+    //!
+    //! \note Unlike restoreFor this doesn't need the dependent variable values
+    //! and the returned object should only be used to predict.
+    //! \warning A tree object can only be restored once.
+    TBoostedTreeUPtr restoreForPrediction(core::CDataFrame& frame,
+                                          std::size_t dependentVariable);
 
 private:
     using TDoubleVec = std::vector<double>;
@@ -211,13 +230,22 @@ private:
     //!
     //! \return The interval to search during the main hyperparameter optimisation
     //! loop or null if this couldn't be found.
+    //! \note If \p sampleRows is false the line search always uses all the rows.
     TOptionalVector testLossLineSearch(core::CDataFrame& frame,
                                        const TApplyParameter& applyParameterStep,
                                        double intervalLeftEnd,
                                        double intervalRightEnd,
                                        double returnedIntervalLeftEndOffset,
                                        double returnedIntervalRightEndOffset,
-                                       const TAdjustTestLoss& adjustTestLoss = noopAdjustTestLoss) const;
+                                       const TAdjustTestLoss& adjustTestLoss = noopAdjustTestLoss,
+                                       bool sampleRows = true) const;
+
+    //! Sample the training and test rows to use for a line search.
+    //!
+    //! \return The fraction of the training rows which were sampled.
+    double lineSearchRowMasks(bool sampleRows,
+                              core::CPackedBitVector& trainingRowMask,
+                              core::CPackedBitVector& testingRowMask) const;
 
     //! Initialize the state for hyperparameter optimisation.
     void initializeHyperparameterOptimisation() const;
@@ -276,6 +304,7 @@ private:
     TOptionalDouble m_MinimumFrequencyToOneHotEncode;
     TOptionalSize m_BayesianOptimisationRestarts;
     bool m_StratifyRegressionCrossValidation = true;
+    bool m_DownsampleLineSearches = true;
     double m_InitialDownsampleRowsPerFeature = 200.0;
     double m_GainPerNode1stPercentile = 0.0;
     double m_GainPerNode50thPercentile = 0.0;
@@ -119,13 +119,17 @@ public:
     const TVector& classificationWeights() const;
 
     //! Get the number of columns training the model will add to the data frame.
-    static std::size_t numberExtraColumnsForTrain(std::size_t numberLossParameters) {
+    static std::size_t numberExtraColumnsForTrain(std::size_t numberLossParameters,
+                                                  bool diagonalCurvature) {
         // We store as follows:
         //   1. The predicted values for the dependent variable
         //   2. The gradient of the loss function
-        //   3. The upper triangle of the hessian of the loss function
+        //   3. The upper triangle (or diagonal) of the hessian of the loss function
         //   4. The example's weight
-        return numberLossParameters * (numberLossParameters + 5) / 2 + 1;
+        return 2 * numberLossParameters +
+               boosted_tree_detail::lossHessianStoredSize(numberLossParameters,
+                                                          diagonalCurvature) +
+               1;
     }
 
     //! Get the memory used by this object.
@@ -181,8 +185,10 @@ private:
     using TRegularizationOverride = CBoostedTreeRegularization<TOptionalDouble>;
     using TTreeShapFeatureImportanceUPtr = std::unique_ptr<CTreeShapFeatureImportance>;
     using TWorkspace = CBoostedTreeLeafNodeStatistics::CWorkspace;
+    using TWorkspaceVec = std::vector<TWorkspace>;
     using THyperparametersVec = std::vector<boosted_tree_detail::EHyperparameters>;
     using TDoubleVecVec = std::vector<TDoubleVec>;
+    using TSizeVecVec = std::vector<TSizeVec>;
 
     //! Tag progress through initialization.
     enum EInitializationStage {
@@ -245,11 +251,13 @@ private:
                                           const core::CPackedBitVector& trainingRowMask) const;
 
     //! Train one tree on the rows of \p frame in the mask \p trainingRowMask.
+    //!
+    //! \note Up to one leaf per element of \p workspaces is split concurrently.
     TNodeVec trainTree(core::CDataFrame& frame,
                        const core::CPackedBitVector& trainingRowMask,
                        const TImmutableRadixSetVec& candidateSplits,
                        const std::size_t maximumTreeSize,
-                       TWorkspace& workspace) const;
+                       TWorkspaceVec& workspaces) const;
 
     //! Compute the minimum mean test loss per fold for any round.
     double minimumTestLoss() const;
@@ -360,6 +368,7 @@ private:
     mutable CPRNG::CXorOShiro128Plus m_Rng;
     EInitializationStage m_InitializationStage = E_NotInitialized;
     std::size_t m_NumberThreads;
+    std::size_t m_NumberConcurrentLeafSplits = 1;
     std::size_t m_DependentVariable = std::numeric_limits<std::size_t>::max();
     TOptionalSize m_PaddedExtraColumns;
     TSizeVec m_ExtraColumns;
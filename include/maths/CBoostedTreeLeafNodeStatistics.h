@@ -8,6 +8,7 @@
 #define INCLUDED_ml_maths_CBoostedTreeLeafNodeStatistics_h
 
 #include <core/CAlignment.h>
+#include <core/CDataFrame.h>
 #include <core/CImmutableRadixSet.h>
 #include <core/CMemory.h>
 #include <core/CPackedBitVector.h>
@@ -29,13 +30,11 @@
 #include <cstdint>
 #include <functional>
 #include <limits>
+#include <memory>
 #include <numeric>
 #include <vector>
 
 namespace ml {
-namespace core {
-class CDataFrame;
-}
 namespace maths {
 class CBoostedTreeNode;
 class CDataFrameCategoryEncoder;
@@ -58,6 +57,8 @@ public:
     using TImmutableRadixSetVec = std::vector<TImmutableRadixSet>;
     using TPtr = std::shared_ptr<CBoostedTreeLeafNodeStatistics>;
     using TPtrPtrPr = std::pair<TPtr, TPtr>;
+    using TSizeVecCItrPr = core::CDataFrame::TSizeVecCItrPr;
+    using TRowFuncVec = core::CDataFrame::TRowFuncVec;
     using TMemoryMappedFloatVector = CMemoryMappedDenseVector<CFloatStorage, Eigen::Aligned16>;
     using TMemoryMappedDoubleVector = CMemoryMappedDenseVector<double, Eigen::Aligned16>;
     using TMemoryMappedDoubleMatrix = CMemoryMappedDenseMatrix<double, Eigen::Aligned16>;
@@ -72,8 +73,12 @@ public:
         static bool dynamicSizeAlwaysZero() { return true; }
 
     public:
-        CDerivatives(std::size_t numberLossParameters, double* storageGradients, double* storageCurvatures)
-            : m_Gradient{storageGradients, static_cast<int>(numberLossParameters)},
+        CDerivatives(std::size_t numberLossParameters,
+                     double* storageGradients,
+                     double* storageCurvatures,
+                     bool diagonalCurvature = false)
+            : m_DiagonalCurvature{diagonalCurvature},
+              m_Gradient{storageGradients, static_cast<int>(numberLossParameters)},
               m_Curvature{storageCurvatures, static_cast<int>(numberLossParameters),
                           static_cast<int>(numberLossParameters)} {}
 
@@ -97,7 +102,7 @@ public:
         //! Add \p count and \p derivatives to the accumulator.
         void add(std::size_t count, const TMemoryMappedFloatVector& derivatives) {
             m_Count += count;
-            this->upperTriangularFlatView() += derivatives;
+            this->compactFlatView() += derivatives;
         }
 
         //! Compute the accumulation of both collections of derivatives.
@@ -138,11 +143,24 @@ public:
         //! Remap the accumulated curvature to lower triangle row major format.
         void remapCurvature() {
             // For performance, we accumulate curvatures into the first n + n (n + 1) / 2
-            // elements of the array backing upperTriangularFlatView. However, the memory
-            // mapped matrix class expects them to be stored column major in the lower
-            // triangle of an n x n matrix. This copies them backwards to their correct
-            // positions.
-            TMemoryMappedDoubleVector derivatives{this->upperTriangularFlatView()};
+            // (or n + n if we only have the diagonal) elements of the array backing
+            // compactFlatView. However, the memory mapped matrix class expects them to
+            // be stored column major in the lower triangle of an n x n matrix. This
+            // copies them backwards to their correct positions.
+            TMemoryMappedDoubleVector derivatives{this->compactFlatView()};
+            if (m_DiagonalCurvature) {
+                // The off diagonal elements must be zero so we clear each element
+                // after we've copied it. Copying backwards means we never overwrite
+                // an element we've still to copy or one we've already copied.
+                for (std::ptrdiff_t i = m_Curvature.rows() - 1,
+                                    k = derivatives.rows() - 1;
+                     i >= 0; --i, --k) {
+                    double curvature{derivatives(k)};
+                    derivatives(k) = 0.0;
+                    m_Curvature(i, i) = curvature;
+                }
+                return;
+            }
             for (std::ptrdiff_t j = m_Curvature.cols() - 1, k = derivatives.rows() - 1;
                  j >= 0; --j) {
                 for (std::ptrdiff_t i = m_Curvature.rows() - 1; i >= j; --i, --k) {
@@ -159,10 +177,10 @@ public:
         }
 
     private:
-        TMemoryMappedDoubleVector upperTriangularFlatView() {
-            // Gradient + upper triangle of the Hessian.
+        TMemoryMappedDoubleVector compactFlatView() {
+            // Gradient + upper triangle (or diagonal) of the Hessian.
             auto n = m_Gradient.rows();
-            return {m_Gradient.data(), n * (n + 3) / 2};
+            return {m_Gradient.data(), m_DiagonalCurvature ? 2 * n : n * (n + 3) / 2};
         }
 
         TMemoryMappedDoubleVector flatView() {
@@ -174,6 +192,7 @@ public:
 
     private:
         std::size_t m_Count = 0;
+        bool m_DiagonalCurvature = false;
         TMemoryMappedDoubleVector m_Gradient;
         TMemoryMappedDoubleMatrix m_Curvature;
     };
@@ -191,8 +210,11 @@ public:
               m_PositiveDerivativesMax{-boosted_tree_detail::INF},
               m_PositiveDerivativesMin{boosted_tree_detail::INF},
               m_NegativeDerivativesMin{boosted_tree_detail::INF, boosted_tree_detail::INF} {}
-        CSplitsDerivatives(const TImmutableRadixSetVec& candidateSplits, std::size_t numberLossParameters)
+        CSplitsDerivatives(const TImmutableRadixSetVec& candidateSplits,
+                           std::size_t numberLossParameters,
+                           bool diagonalCurvature = false)
             : m_NumberLossParameters{numberLossParameters},
+              m_DiagonalCurvature{diagonalCurvature},
               m_PositiveDerivativesSum{TDerivatives2x1::Zero()},
               m_NegativeDerivativesSum{TDerivatives2x1::Zero()},
               m_PositiveDerivativesMax{-boosted_tree_detail::INF},
@@ -202,6 +224,7 @@ public:
         }
         CSplitsDerivatives(const CSplitsDerivatives& other)
             : m_NumberLossParameters{other.m_NumberLossParameters},
+              m_DiagonalCurvature{other.m_DiagonalCurvature},
               m_PositiveDerivativesSum{TDerivatives2x1::Zero()},
               m_NegativeDerivativesSum{TDerivatives2x1::Zero()},
               m_PositiveDerivativesMax{-boosted_tree_detail::INF},
@@ -217,8 +240,10 @@ public:
 
         //! Re-initialize recycling the allocated memory.
         void reinitialize(const TImmutableRadixSetVec& candidateSplits,
-                          std::size_t numberLossParameters) {
+                          std::size_t numberLossParameters,
+                          bool diagonalCurvature = false) {
             m_NumberLossParameters = numberLossParameters;
+            m_DiagonalCurvature = diagonalCurvature;
             for (auto& derivatives : m_Derivatives) {
                 derivatives.clear();
             }
@@ -230,6 +255,7 @@ public:
         //! Efficiently swap this and \p other.
         void swap(CSplitsDerivatives& other) {
             std::swap(m_NumberLossParameters, other.m_NumberLossParameters);
+            std::swap(m_DiagonalCurvature, other.m_DiagonalCurvature);
             m_Derivatives.swap(other.m_Derivatives);
             m_MissingDerivatives.swap(other.m_MissingDerivatives);
             m_Storage.swap(other.m_Storage);
@@ -370,6 +396,7 @@ public:
         //! Get a checksum of this object.
         std::uint64_t checksum(std::uint64_t seed = 0) const {
             seed = CChecksum::calculate(seed, m_NumberLossParameters);
+            seed = CChecksum::calculate(seed, m_DiagonalCurvature);
             seed = CChecksum::calculate(seed, m_Derivatives);
             seed = CChecksum::calculate(seed, m_MissingDerivatives);
             return seed;
@@ -379,6 +406,8 @@ public:
             return m_NumberLossParameters;
         }
 
+        bool diagonalCurvature() const { return m_DiagonalCurvature; }
+
         void addPositiveDerivatives(const TMemoryMappedFloatVector& derivatives) {
             m_PositiveDerivativesSum += derivatives;
             m_PositiveDerivativesMin = std::min(
@@ -463,10 +492,12 @@ public:
                 m_Derivatives[i].reserve(size);
                 for (std::size_t j = 0; j < size; ++j, storage += numberDerivatives) {
                     m_Derivatives[i].emplace_back(m_NumberLossParameters, storage,
-                                                  storage + numberGradients);
+                                                  storage + numberGradients,
+                                                  m_DiagonalCurvature);
                 }
                 m_MissingDerivatives.emplace_back(m_NumberLossParameters, storage,
-                                                  storage + numberGradients);
+                                                  storage + numberGradients,
+                                                  m_DiagonalCurvature);
             }
         }
 
@@ -486,6 +517,7 @@ public:
 
     private:
         std::size_t m_NumberLossParameters = 0;
+        bool m_DiagonalCurvature = false;
         TDerivativesVecVec m_Derivatives;
         TDerivativesVec m_MissingDerivatives;
         TAlignedDoubleVec m_Storage;
@@ -496,16 +528,24 @@ public:
         TDerivatives2x1 m_NegativeDerivativesMin;
     };
 
-    //! \brief The derivatives and row masks objects to use for computations.
+    //! \brief The derivatives and row indices objects to use for computations.
     //!
     //! DESCRIPTION:\n
     //! These are heavyweight objects and get passed in to minimise the number of
     //! times they need to be allocated. This has the added advantage of keeping
     //! the cache warm since the critical path is always working on the derivatives
     //! objects stored in this class.
+    //!
+    //! The rows of every leaf of the tree being grown are stored as a contiguous
+    //! range of a single array of row indices. Splitting a leaf stably partitions
+    //! its range into the rows of its left child followed by the rows of its right
+    //! child. As such, each leaf's indices are always sorted. Since the leaves'
+    //! ranges are disjoint, workspaces which share the row indices can be used
+    //! to split different leaves of the same tree concurrently.
     class MATHS_EXPORT CWorkspace {
     public:
-        using TPackedBitVectorVec = std::vector<core::CPackedBitVector>;
+        using TSizeVecPtr = std::shared_ptr<TSizeVec>;
+        using TSizeVecVec = std::vector<TSizeVec>;
         using TSplitsDerivativesVec = std::vector<CSplitsDerivatives>;
 
     public:
@@ -514,21 +554,23 @@ public:
         CWorkspace& operator=(const CWorkspace& other) = delete;
         CWorkspace& operator=(CWorkspace&&) = default;
 
-        //! Re-initialize the masks and derivatives.
+        //! Re-initialize the row indices and derivatives.
         void reinitialize(std::size_t numberThreads,
                           const TImmutableRadixSetVec& candidateSplits,
-                          std::size_t numberLossParameters) {
+                          std::size_t numberLossParameters,
+                          bool diagonalCurvature = false) {
             m_MinimumGain = 0.0;
-            m_Masks.resize(numberThreads);
+            m_RightChildBeginRowIndex = 0;
+            m_LeftChildRowIndices.resize(numberThreads);
+            m_RightChildRowIndices.resize(numberThreads);
             m_Derivatives.reserve(numberThreads);
-            for (auto& mask : m_Masks) {
-                mask.clear();
-            }
             for (auto& derivatives : m_Derivatives) {
-                derivatives.reinitialize(candidateSplits, numberLossParameters);
+                derivatives.reinitialize(candidateSplits, numberLossParameters,
+                                         diagonalCurvature);
             }
             for (std::size_t i = m_Derivatives.size(); i < numberThreads; ++i) {
-                m_Derivatives.emplace_back(candidateSplits, numberLossParameters);
+                m_Derivatives.emplace_back(candidateSplits, numberLossParameters,
+                                           diagonalCurvature);
             }
         }
 
@@ -546,10 +588,12 @@ public:
         //! Start working on a new leaf.
         void newLeaf(std::size_t numberThreads) {
             m_NumberThreads = numberThreads;
-            m_ReducedMasks = false;
             m_ReducedDerivatives = false;
         }
 
+        //! Get the number of threads working on the current leaf.
+        std::size_t numberThreads() const { return m_NumberThreads; }
+
         //! Get the reduction of the per thread aggregate derivatives.
         CSplitsDerivatives& reducedDerivatives() {
             if (m_ReducedDerivatives == false) {
@@ -562,37 +606,54 @@ public:
             return m_Derivatives[0];
         }
 
-        //! Get the reduction of the per thread masks.
-        const core::CPackedBitVector& reducedMask(std::size_t size) {
-            if (m_ReducedMasks == false) {
-                m_Masks[0].extend(false, size - m_Masks[0].size());
-                for (std::size_t i = 1; i < m_NumberThreads; ++i) {
-                    m_Masks[i].extend(false, size - m_Masks[i].size());
-                    m_Masks[0] |= m_Masks[i];
-                }
-                m_ReducedMasks = true;
-            }
-            return m_Masks[0];
+        //! Get the row indices of all leaves.
+        TSizeVec& rowIndices() { return *m_RowIndices; }
+
+        //! Get the row indices of all leaves.
+        const TSizeVec& rowIndices() const { return *m_RowIndices; }
+
+        //! Use the same row indices as \p other.
+        void shareRowIndices(const CWorkspace& other) {
+            m_RowIndices = other.m_RowIndices;
+        }
+
+        //! Get the per thread row indices of the left child of a split.
+        TSizeVecVec& leftChildRowIndices() { return m_LeftChildRowIndices; }
+
+        //! Get the per thread row indices of the right child of a split.
+        TSizeVecVec& rightChildRowIndices() { return m_RightChildRowIndices; }
+
+        //! Get the position in the row indices of the first row of the right
+        //! child of the last leaf to be partitioned.
+        std::size_t rightChildBeginRowIndex() const {
+            return m_RightChildBeginRowIndex;
         }
 
-        //! Get the workspace row masks.
-        TPackedBitVectorVec& masks() { return m_Masks; }
+        //! Set the position in the row indices of the first row of the right
+        //! child of the last leaf to be partitioned.
+        void rightChildBeginRowIndex(std::size_t index) {
+            m_RightChildBeginRowIndex = index;
+        }
 
         //! Get the workspace derivatives.
         TSplitsDerivativesVec& derivatives() { return m_Derivatives; }
 
         //! Get the memory used by this object.
         std::size_t memoryUsage() const {
-            return core::CMemory::dynamicSize(m_Masks) +
+            return core::CMemory::dynamicSize(m_RowIndices) +
+                   core::CMemory::dynamicSize(m_LeftChildRowIndices) +
+                   core::CMemory::dynamicSize(m_RightChildRowIndices) +
                    core::CMemory::dynamicSize(m_Derivatives);
         }
 
     private:
         std::size_t m_NumberThreads = 0;
         double m_MinimumGain = 0.0;
-        bool m_ReducedMasks = false;
         bool m_ReducedDerivatives = false;
-        TPackedBitVectorVec m_Masks;
+        std::size_t m_RightChildBeginRowIndex = 0;
+        TSizeVecPtr m_RowIndices = std::make_shared<TSizeVec>();
+        TSizeVecVec m_LeftChildRowIndices;
+        TSizeVecVec m_RightChildRowIndices;
         TSplitsDerivativesVec m_Derivatives;
     };
 
@@ -600,6 +661,7 @@ public:
     CBoostedTreeLeafNodeStatistics(std::size_t id,
                                    const TSizeVec& extraColumns,
                                    std::size_t numberLossParameters,
+                                   bool diagonalCurvature,
                                    std::size_t numberThreads,
                                    const core::CDataFrame& frame,
                                    const CDataFrameCategoryEncoder& encoder,
@@ -614,19 +676,15 @@ public:
     //! Only called by split but is public so it's accessible to std::make_shared.
     CBoostedTreeLeafNodeStatistics(std::size_t id,
                                    const CBoostedTreeLeafNodeStatistics& parent,
-                                   std::size_t numberThreads,
-                                   const core::CDataFrame& frame,
-                                   const CDataFrameCategoryEncoder& encoder,
                                    const TRegularization& regularization,
-                                   const TSizeVec& treeFeatureBag,
                                    const TSizeVec& nodeFeatureBag,
                                    bool isLeftChild,
-                                   const CBoostedTreeNode& split,
                                    CWorkspace& workspace);
 
     //! Only called by split but is public so it's accessible to std::make_shared.
     CBoostedTreeLeafNodeStatistics(std::size_t id,
                                    CBoostedTreeLeafNodeStatistics&& parent,
+                                   bool isLeftChild,
                                    const TRegularization& regularization,
                                    const TSizeVec& nodeFeatureBag,
                                    CWorkspace& workspace);
@@ -651,6 +709,40 @@ public:
                     const CBoostedTreeNode& split,
                     CWorkspace& workspace);
 
+    //! \name Split In Stages
+    //!
+    //! Splitting a leaf is equivalent to calling prepareSplit, running the
+    //! readers it returns on this leaf's rows, i.e. the rows with indices in
+    //! the range rowIndices, and then calling finishSplit. This allows us to
+    //! read the rows of several leaves we split concurrently with a single
+    //! parallel loop.
+    //@{
+    //! Get the readers which partition this leaf's rows between its children
+    //! and aggregate the loss derivatives for splitting it.
+    //!
+    //! \note If this returns no readers then we don't need to read any rows.
+    TRowFuncVec prepareSplit(std::size_t numberThreads,
+                             double gainThreshold,
+                             const CDataFrameCategoryEncoder& encoder,
+                             const TSizeVec& treeFeatureBag,
+                             const CBoostedTreeNode& split,
+                             CWorkspace& workspace) const;
+
+    //! Get the range of \p workspace row indices which belong to this leaf.
+    TSizeVecCItrPr rowIndices(const CWorkspace& workspace) const;
+
+    //! Compute the children's statistics once the readers returned by
+    //! prepareSplit have been run.
+    //!
+    //! \return Shared pointers to the left and right child node statistics.
+    TPtrPtrPr finishSplit(std::size_t leftChildId,
+                          std::size_t rightChildId,
+                          double gainThreshold,
+                          const TRegularization& regularization,
+                          const TSizeVec& nodeFeatureBag,
+                          CWorkspace& workspace);
+    //@}
+
     //! Order two leaves by decreasing gain in splitting them.
     bool operator<(const CBoostedTreeLeafNodeStatistics& rhs) const;
 
@@ -682,8 +774,8 @@ public:
     //! Get the node's identifier.
     std::size_t id() const;
 
-    //! Get the row mask for this leaf node.
-    core::CPackedBitVector& rowMask();
+    //! Get the number of rows in this leaf node.
+    std::size_t numberRows() const;
 
     //! Get the memory used by this object.
     std::size_t memoryUsage() const;
@@ -701,6 +793,10 @@ public:
 private:
     using TSizeVecCRef = std::reference_wrapper<const TSizeVec>;
 
+    //! The child whose rows we read to split a leaf. We compute the other from
+    //! the difference between the parent and this child if we need it.
+    enum EChildToRead { E_NoChild, E_LeftChild, E_RightChild };
+
     //! \brief Statistics relating to a split of the node.
     struct MATHS_EXPORT SSplitStatistics
         : private boost::less_than_comparable<SSplitStatistics> {
@@ -748,16 +844,9 @@ private:
                                          const core::CDataFrame& frame,
                                          const CDataFrameCategoryEncoder& encoder,
                                          const TSizeVec& featureBag,
-                                         const core::CPackedBitVector& rowMask,
                                          CWorkspace& workspace) const;
-    void computeRowMaskAndAggregateLossDerivatives(std::size_t numberThreads,
-                                                   const core::CDataFrame& frame,
-                                                   const CDataFrameCategoryEncoder& encoder,
-                                                   bool isLeftChild,
-                                                   const CBoostedTreeNode& split,
-                                                   const TSizeVec& featureBag,
-                                                   const core::CPackedBitVector& parentRowMask,
-                                                   CWorkspace& workspace) const;
+    EChildToRead childToRead(double gainThreshold) const;
+    void copyChildRowIndices(CWorkspace& workspace) const;
     void addRowDerivatives(const TSizeVec& featureBag,
                            const CEncodedDataFrameRowRef& row,
                            CSplitsDerivatives& splitsDerivatives) const;
@@ -772,8 +861,10 @@ private:
     std::size_t m_Depth;
     TSizeVecCRef m_ExtraColumns;
     std::size_t m_NumberLossParameters;
+    bool m_DiagonalCurvature;
     const TImmutableRadixSetVec& m_CandidateSplits;
-    core::CPackedBitVector m_RowMask;
+    std::size_t m_BeginRowIndex = 0;
+    std::size_t m_EndRowIndex = 0;
     CSplitsDerivatives m_Derivatives;
     SSplitStatistics m_BestSplit;
 };
@@ -384,6 +384,8 @@ public:
                            double weight = 1.0) const = 0;
     //! Returns true if the loss curvature is constant.
     virtual bool isCurvatureConstant() const = 0;
+    //! Returns true if curvature only writes the diagonal of the Hessian.
+    virtual bool isCurvatureDiagonal() const = 0;
 
     //! Transforms a prediction from the forest to the target space.
     virtual TDoubleVector transform(const TMemoryMappedFloatVector& prediction) const = 0;
@@ -435,6 +437,7 @@ public:
                    TWriter writer,
                    double weight = 1.0) const override;
     bool isCurvatureConstant() const override;
+    bool isCurvatureDiagonal() const override;
     //! \return \p prediction.
     TDoubleVector transform(const TMemoryMappedFloatVector& prediction) const override;
     CArgMinLoss minimizer(double lambda, const CPRNG::CXorOShiro128Plus& rng) const override;
@@ -477,6 +480,7 @@ public:
                    TWriter writer,
                    double weight = 1.0) const override;
     bool isCurvatureConstant() const override;
+    bool isCurvatureDiagonal() const override;
     //! \return (P(class 0), P(class 1)).
     TDoubleVector transform(const TMemoryMappedFloatVector& prediction) const override;
     CArgMinLoss minimizer(double lambda, const CPRNG::CXorOShiro128Plus& rng) const override;
@@ -499,13 +503,20 @@ private:
 //! where \f$a_i\f$ denotes the actual class of the i'th example, \f$p\f$ denotes
 //! the vector valued prediction and \f$\sigma(p)\f$ is the softmax function, i.e.
 //! \f$[\sigma(p)]_j = \frac{e^{p_i}}{\sum_k e^{p_k}}\f$.
+//!
+//! The Hessian of this loss is \f$diag(\sigma(p)) - \sigma(p)\sigma(p)^t\f$
+//! and storing its upper triangle for every training row dominates the memory
+//! used for training when there are many classes. Optionally, it can be
+//! approximated by its diagonal which drops the coupling between the classes
+//! when choosing splits, but reduces the storage from O(n^2) to O(n).
 class MATHS_EXPORT CMultinomialLogisticLoss final : public CLoss {
 public:
     static const std::string NAME;
 
 public:
     CMultinomialLogisticLoss(core::CStateRestoreTraverser& traverser);
-    CMultinomialLogisticLoss(std::size_t numberClasses);
+    explicit CMultinomialLogisticLoss(std::size_t numberClasses,
+                                      bool diagonalCurvature = false);
     ELossType type() const override;
     std::unique_ptr<CLoss> clone() const override;
     std::size_t numberParameters() const override;
@@ -521,6 +532,7 @@ public:
                    TWriter writer,
                    double weight = 1.0) const override;
     bool isCurvatureConstant() const override;
+    bool isCurvatureDiagonal() const override;
     //! \return (P(class 0), P(class 1), ..., P(class n)).
     TDoubleVector transform(const TMemoryMappedFloatVector& prediction) const override;
     CArgMinLoss minimizer(double lambda, const CPRNG::CXorOShiro128Plus& rng) const override;
@@ -533,6 +545,7 @@ private:
 
 private:
     std::size_t m_NumberClasses;
+    bool m_DiagonalCurvature = false;
 };
 
 //! \brief The MSLE loss function.
@@ -570,6 +583,7 @@ public:
                    TWriter writer,
                    double weight = 1.0) const override;
     bool isCurvatureConstant() const override;
+    bool isCurvatureDiagonal() const override;
     //! \return exp(\p prediction).
     TDoubleVector transform(const TMemoryMappedFloatVector& prediction) const override;
     CArgMinLoss minimizer(double lambda, const CPRNG::CXorOShiro128Plus& rng) const override;
@@ -628,6 +642,7 @@ public:
                    TWriter writer,
                    double weight = 1.0) const override;
     bool isCurvatureConstant() const override;
+    bool isCurvatureDiagonal() const override;
     //! \return \p prediction.
     TDoubleVector transform(const TMemoryMappedFloatVector& prediction) const override;
     CArgMinLoss minimizer(double lambda, const CPRNG::CXorOShiro128Plus& rng) const override;
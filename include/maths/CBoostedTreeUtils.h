@@ -66,11 +66,23 @@ inline std::size_t lossHessianUpperTriangleSize(std::size_t numberLossParameters
     return numberLossParameters * (numberLossParameters + 1) / 2;
 }
 
+//! Get the number of loss Hessian elements we store per row.
+//!
+//! If \p diagonalCurvature is true we only store the diagonal of the Hessian
+//! otherwise we store its upper triangle.
+inline std::size_t lossHessianStoredSize(std::size_t numberLossParameters,
+                                         bool diagonalCurvature) {
+    return diagonalCurvature ? numberLossParameters
+                             : lossHessianUpperTriangleSize(numberLossParameters);
+}
+
 //! Get the extra columns needed by training.
-inline TSizeAlignmentPrVec extraColumns(std::size_t numberLossParameters) {
+inline TSizeAlignmentPrVec extraColumns(std::size_t numberLossParameters,
+                                        bool diagonalCurvature) {
     return {{numberLossParameters, core::CAlignment::E_Unaligned},
             {numberLossParameters, core::CAlignment::E_Aligned16},
-            {numberLossParameters * numberLossParameters, core::CAlignment::E_Unaligned},
+            {lossHessianStoredSize(numberLossParameters, diagonalCurvature),
+             core::CAlignment::E_Unaligned},
             {1, core::CAlignment::E_Unaligned}};
 }
 
@@ -86,11 +98,13 @@ MATHS_EXPORT
 void zeroPrediction(const TRowRef& row, const TSizeVec& extraColumns, std::size_t numberLossParameters);
 
 //! Read all the loss derivatives from \p row into an aligned vector.
-inline TAlignedMemoryMappedFloatVector
-readLossDerivatives(const TRowRef& row, const TSizeVec& extraColumns, std::size_t numberLossParameters) {
+inline TAlignedMemoryMappedFloatVector readLossDerivatives(const TRowRef& row,
+                                                           const TSizeVec& extraColumns,
+                                                           std::size_t numberLossParameters,
+                                                           bool diagonalCurvature) {
     return {row.data() + extraColumns[E_Gradient],
             static_cast<int>(numberLossParameters +
-                             lossHessianUpperTriangleSize(numberLossParameters))};
+                             lossHessianStoredSize(numberLossParameters, diagonalCurvature))};
 }
 
 //! Zero the loss gradient of \p row.
@@ -106,17 +120,22 @@ void writeLossGradient(const TRowRef& row,
                        double actual,
                        double weight = 1.0);
 
-//! Read the loss flat column major Hessian from \p row.
+//! Read the loss flat column major Hessian, or its diagonal if \p diagonalCurvature
+//! is true, from \p row.
 inline TMemoryMappedFloatVector readLossCurvature(const TRowRef& row,
                                                   const TSizeVec& extraColumns,
-                                                  std::size_t numberLossParameters) {
+                                                  std::size_t numberLossParameters,
+                                                  bool diagonalCurvature) {
     return {row.data() + extraColumns[E_Curvature],
-            static_cast<int>(lossHessianUpperTriangleSize(numberLossParameters))};
+            static_cast<int>(lossHessianStoredSize(numberLossParameters, diagonalCurvature))};
 }
 
 //! Zero the loss Hessian of \p row.
 MATHS_EXPORT
-void zeroLossCurvature(const TRowRef& row, const TSizeVec& extraColumns, std::size_t numberLossParameters);
+void zeroLossCurvature(const TRowRef& row,
+                       const TSizeVec& extraColumns,
+                       std::size_t numberLossParameters,
+                       bool diagonalCurvature);
 
 //! Write the loss Hessian to \p row.
 MATHS_EXPORT
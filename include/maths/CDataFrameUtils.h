@@ -41,6 +41,11 @@ struct SRowTo<CMemoryMappedDenseVector<T, ALIGNMENT>> {
     dispatch(const core::CDataFrame::TRowRef& row) {
         return {row.data(), static_cast<long>(row.numberColumns())};
     }
+    static void dispatch(const core::CDataFrame::TRowRef& row,
+                         CMemoryMappedDenseVector<T, ALIGNMENT>& result) {
+        // Assignment reseats the mapped vector.
+        result = dispatch(row);
+    }
 };
 
 template<typename T>
@@ -53,6 +58,14 @@ struct SRowTo<CDenseVector<T>> {
         }
         return result;
     }
+    static void dispatch(const core::CDataFrame::TRowRef& row, CDenseVector<T>& result) {
+        // This only allocates if result doesn't have the right dimension.
+        std::size_t n{row.numberColumns()};
+        result.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            result(i) = row[i];
+        }
+    }
 };
 }
 
@@ -63,6 +76,7 @@ public:
     using TDoubleVecVec = std::vector<TDoubleVec>;
     using TSizeVec = std::vector<std::size_t>;
     using TFloatVec = std::vector<CFloatStorage>;
+    using TFloatVecVec = std::vector<TFloatVec>;
     using TSizeDoublePr = std::pair<std::size_t, double>;
     using TSizeDoublePrVec = std::vector<TSizeDoublePr>;
     using TSizeDoublePrVecVec = std::vector<TSizeDoublePrVec>;
@@ -97,11 +111,27 @@ public:
         virtual ~CColumnValue() = default;
         virtual double operator()(const TRowRef& row) const = 0;
         virtual double operator()(const TFloatVec& row) const = 0;
+        //! Write the values for a block of \p rows to \p values.
+        //!
+        //! \note This makes a single virtual call for the whole block.
+        virtual void operator()(const TFloatVecVec& rows, TDoubleVec& values) const = 0;
         virtual std::size_t hash() const = 0;
 
     protected:
         std::size_t column() const { return m_Column; }
 
+        //! Compute the values of the block \p rows using \p value.
+        //!
+        //! \note DERIVED should be final so the per row calls are statically
+        //! bound and can be inlined.
+        template<typename DERIVED>
+        static void blockValues(const DERIVED& value, const TFloatVecVec& rows, TDoubleVec& values) {
+            values.resize(rows.size());
+            for (std::size_t i = 0; i < rows.size(); ++i) {
+                values[i] = value(rows[i]);
+            }
+        }
+
     private:
         std::size_t m_Column;
     };
@@ -116,6 +146,9 @@ public:
         double operator()(const TFloatVec& row) const override {
             return row[this->column()];
         }
+        void operator()(const TFloatVecVec& rows, TDoubleVec& values) const override {
+            blockValues(*this, rows, values);
+        }
         std::size_t hash() const override { return 0; }
     };
 
@@ -137,6 +170,9 @@ public:
             }
             return static_cast<std::size_t>(row[this->column()]) == m_Category ? 1.0 : 0.0;
         }
+        void operator()(const TFloatVecVec& rows, TDoubleVec& values) const override {
+            blockValues(*this, rows, values);
+        }
         std::size_t hash() const override { return m_Category; }
 
     private:
@@ -163,6 +199,9 @@ public:
             std::size_t category{static_cast<std::size_t>(row[this->column()])};
             return (*m_Frequencies)[category];
         }
+        void operator()(const TFloatVecVec& rows, TDoubleVec& values) const override {
+            blockValues(*this, rows, values);
+        }
         std::size_t hash() const override { return 0; }
 
     private:
@@ -195,6 +234,9 @@ public:
             std::size_t category{static_cast<std::size_t>(row[this->column()])};
             return this->isRare(category) ? 0.0 : (*m_TargetMeanValues)[category];
         }
+        void operator()(const TFloatVecVec& rows, TDoubleVec& values) const override {
+            blockValues(*this, rows, values);
+        }
         std::size_t hash() const override { return 0; }
 
     private:
@@ -218,6 +260,15 @@ public:
         return data_frame_utils_detail::SRowTo<VECTOR>::dispatch(row);
     }
 
+    //! Convert a row of the data frame to a specified vector type in place.
+    //!
+    //! \note This avoids allocating if \p result already has the dimension of
+    //! \p row so can be used to convert many rows reusing the same vector.
+    template<typename VECTOR>
+    static void rowTo(const core::CDataFrame::TRowRef& row, VECTOR& result) {
+        data_frame_utils_detail::SRowTo<VECTOR>::dispatch(row, result);
+    }
+
     //! Subtract the mean and divide each column value by its standard deviation.
     //!
     //! \param[in] numberThreads The number of threads available.
@@ -276,11 +327,15 @@ public:
     //! where each class accounts for 1/\p numberBins of the data and the comprises
     //! the examples in each inter quantile range.
     //!
+    //! The rows are assigned to folds in two passes over \p frame which can both
+    //! be run in parallel. For a given \p rng the masks are the same whatever the
+    //! value of \p numberThreads.
+    //!
     //! \param[in] numberThreads The number of threads available.
     //! \param[in] frame The data frame for which to compute the row masks.
     //! \param[in] targetColumn The index of the column to predict.
     //! \param[in] rng The random number generator to use.
-    //! \param[in] numberFolds The number of folds to use.
+    //! \param[in] numberFolds The number of folds to use. This can be at most 256.
     //! \param[in] numberBuckets The number of buckets to use when stratifying by
     //! target quantiles for regression.
     //! \param[in] allTrainingRowsMask A mask of the candidate training rows.
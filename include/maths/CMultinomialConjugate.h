@@ -50,6 +50,86 @@ public:
     //! Lift the overloads of print into scope.
     using CPrior::print;
 
+    //! \brief Computes the two-sided probabilities of less likely categories.
+    //!
+    //! DESCRIPTION:\n
+    //! The categories are sorted by their expected probability once and the
+    //! probability of less likely categories is read off the prefix sums of
+    //! the sorted probabilities, averaged over samples from each category's
+    //! marginal prior. The averaging is the expensive part of the calculation
+    //! so it is only done for the categories which are queried.
+    //!
+    //! IMPLEMENTATION DECISIONS:\n
+    //! This is intended to be kept and updated as the prior changes. Updates
+    //! typically change the concentrations of only a few categories and decay
+    //! scales them all, which preserves their order. So update repairs the
+    //! existing order in linear time rather than sorting. It falls back to a
+    //! full sort if the categories changed or too many are out of order.
+    class MATHS_EXPORT CLessLikelyCategoriesCalculator {
+    public:
+        //! Bring the calculator up to date with \p prior.
+        void update(const CMultinomialConjugate& prior);
+
+        //! Get the number of categories.
+        std::size_t numberCategories() const;
+
+        //! Compute the bounds on the probability of less likely categories
+        //! than the category at \p index in the prior's categories.
+        void operator()(std::size_t index, double& lowerBound, double& upperBound) const;
+
+        //! Compute the bounds for every category.
+        void all(TDoubleVec& lowerBounds, TDoubleVec& upperBounds) const;
+
+        //! Get the memory used by this object.
+        void debugMemoryUsage(const core::CMemoryUsage::TMemoryUsagePtr& mem) const;
+
+        //! Get the memory used by this object.
+        std::size_t memoryUsage() const;
+
+    private:
+        //! \brief A category's expected probability, the probability of it
+        //! and all less likely categories and its index in the prior.
+        struct SCategory {
+            bool operator<(const SCategory& rhs) const {
+                return s_P < rhs.s_P ||
+                       (s_P == rhs.s_P && (s_Cumulative < rhs.s_Cumulative ||
+                                           (s_Cumulative == rhs.s_Cumulative &&
+                                            s_Index < rhs.s_Index)));
+            }
+            double s_P;
+            double s_Cumulative;
+            std::size_t s_Index;
+        };
+        using TCategoryVec = std::vector<SCategory>;
+
+        //! Beyond this fraction of displaced categories update just sorts.
+        static const double MAXIMUM_FRACTION_TO_REPAIR;
+
+    private:
+        //! Sort the categories by increasing probability.
+        void sort();
+
+        //! Restore the order of m_Ranked after the probabilities changed.
+        void repairOrder();
+
+        //! Average the probability over the marginal prior of \p index.
+        double probability(std::size_t index) const;
+
+    private:
+        //! The categories of the prior when last updated.
+        TDoubleVec m_Categories;
+        //! The concentrations of the prior when last updated.
+        TDoubleVec m_Concentrations;
+        //! The total concentration of the prior when last updated.
+        double m_TotalConcentration = 0.0;
+        //! The number of samples of the marginal priors to average over.
+        std::size_t m_NumberSamples = 1;
+        //! The mass of the categories which have not been observed.
+        double m_Pu = 0.0;
+        //! The categories sorted by increasing probability.
+        TCategoryVec m_Ranked;
+    };
+
 public:
     //! \name Life-Cycle
     //@{
@@ -320,6 +400,8 @@ public:
     //! \param[out] upperBounds If the model has not overflowed this is filled
     //! in with the probability of the set (subject to the measure \p calculation).
     //! Otherwise, it is filled in an upper bound.
+    //! \see CLessLikelyCategoriesCalculator to compute the two-sided values
+    //! repeatedly as the prior is updated.
     void probabilitiesOfLessLikelyCategories(maths_t::EProbabilityCalculation calculation,
                                              TDoubleVec& lowerBounds,
                                              TDoubleVec& upperBounds) const;
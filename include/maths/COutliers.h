@@ -74,6 +74,11 @@ public:
     //! Check whether to compute influences of features on the outlier scores.
     bool computeFeatureInfluence() const { return m_ComputeFeatureInfluence; }
 
+    //! Set whether to compute influences of features on the outlier scores.
+    virtual void computeFeatureInfluence(bool computeFeatureInfluence) {
+        m_ComputeFeatureInfluence = computeFeatureInfluence;
+    }
+
     //! The number of points.
     std::size_t n() const { return m_Lookup.size(); }
 
@@ -599,6 +604,16 @@ public:
                                                              methods[0]->progressRecorder()},
           m_Methods{std::move(methods)} {}
 
+    using CNearestNeighbourMethod<POINT, NEAREST_NEIGHBOURS>::computeFeatureInfluence;
+
+    void computeFeatureInfluence(bool computeFeatureInfluence) override {
+        this->CNearestNeighbourMethod<POINT, NEAREST_NEIGHBOURS>::computeFeatureInfluence(
+            computeFeatureInfluence);
+        for (auto& method : m_Methods) {
+            method->computeFeatureInfluence(computeFeatureInfluence);
+        }
+    }
+
     void recoverMemory() override {
         for (auto& model : m_Methods) {
             model->recoverMemory();
@@ -696,6 +711,10 @@ public:
         bool s_ComputeFeatureInfluence;
         //! The fraction of true outliers among the points.
         double s_OutlierFraction;
+        //! If positive, only compute the feature influence for points whose
+        //! outlier score is at least this quantile of all the points' scores.
+        //! These are computed in a second pass over the selected points.
+        double s_FeatureInfluenceQuantile;
     };
 
 public:
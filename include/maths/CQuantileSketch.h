@@ -40,12 +40,17 @@ namespace maths {
 //! a bias correction is applied when interpolating and cost caching is
 //! used to accelerate reduction.
 //!
+//! Batches of values can be added in bulk. These are radix sorted once and
+//! then merged with the knots in sorted subsets of around the sketch size,
+//! which avoids sorting the unsorted values on every reduction.
+//!
 //! Note this has none of the theoretical guarantees on maximum error
 //! which are available for the q-digest, so if you know the range of the
 //! variable up front, that is a safer choice for approximate quantile
 //! estimation.
 class MATHS_EXPORT CQuantileSketch : private boost::addable<CQuantileSketch> {
 public:
+    using TDoubleVec = std::vector<double>;
     using TFloatFloatPr = std::pair<CFloatStorage, CFloatStorage>;
     using TFloatFloatPrVec = std::vector<TFloatFloatPr>;
 
@@ -71,6 +76,12 @@ public:
     //! Add \p x to the sketch.
     void add(double x, double n = 1.0);
 
+    //! Add a batch of (value, count) pairs to the sketch.
+    //!
+    //! \note \p values is used as workspace and is cleared on return so
+    //! the caller can reuse it for the next batch.
+    void add(TFloatFloatPrVec& values);
+
     //! Age by scaling the counts.
     void age(double factor);
 
@@ -89,6 +100,12 @@ public:
     //! Get the quantile corresponding to \p percentage.
     bool quantile(double percentage, double& result) const;
 
+    //! Get the quantiles corresponding to each of \p percentages.
+    //!
+    //! \note This visits the knots once in total rather than once per
+    //! quantile so is preferred for computing many quantiles.
+    bool quantiles(const TDoubleVec& percentages, TDoubleVec& result) const;
+
     //! Get the knot values.
     const TFloatFloatPrVec& knots() const;
 
@@ -147,6 +164,18 @@ private:
                          double percentage,
                          double& result);
 
+    //! Compute quantiles on the supplied knots starting the search from the
+    //! \p i'th knot where \p partial is the total count of the knots before
+    //! it. These are updated so the search for any larger percentage can be
+    //! resumed from them.
+    static void quantile(EInterpolation interpolation,
+                         const TFloatFloatPrVec& knots,
+                         double count,
+                         double percentage,
+                         std::size_t& i,
+                         double& partial,
+                         double& result);
+
 private:
     //! The style of interpolation to use.
     EInterpolation m_Interpolation;
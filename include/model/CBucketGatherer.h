@@ -99,16 +99,15 @@ public:
             uint64_t seed = core::CHashing::hashCombine(
                 static_cast<uint64_t>(key.first.first),
                 static_cast<uint64_t>(key.first.second));
-            return core::CHashing::hashCombine(seed, s_Hasher(*key.second));
+            return core::CHashing::hashCombine(seed, static_cast<uint64_t>(key.second.hash()));
         }
-        core::CHashing::CMurmurHash2String s_Hasher;
     };
 
     //! \brief Checks two ((size_t, size_t), string*) pairs for equality.
     struct MODEL_EXPORT SSizeSizePrStoredStringPtrPrEqual {
         bool operator()(const TSizeSizePrStoredStringPtrPr& lhs,
                         const TSizeSizePrStoredStringPtrPr& rhs) const {
-            return lhs.first == rhs.first && *lhs.second == *rhs.second;
+            return lhs.first == rhs.first && lhs.second.hasSameString(rhs.second);
         }
     };
 
@@ -14,6 +14,7 @@
 #include <boost/container/flat_set.hpp>
 #include <boost/unordered_map.hpp>
 
+#include <cstdint>
 #include <string>
 
 namespace ml {
@@ -27,10 +28,12 @@ namespace model {
 //! Collects up to a configurable number of distinct examples per category
 //!
 //! IMPLEMENTATION DECISIONS:\n
-//! The examples are stored sorted in a boost flat_set. The flat_set was
-//! preferred due to the contiguous storage which in combination with the
-//! small number of expected examples should be more performant than a
-//! traditional set.
+//! Examples of the same category tend to share long prefixes. So each
+//! category's examples are stored sorted and front coded in a single string,
+//! i.e. each example only stores the suffix which differs from the previous
+//! example. There are a small number of examples per category so decoding
+//! them on demand is cheap, and they are only needed when they're output or
+//! persisted.
 //!
 class MODEL_EXPORT CCategoryExamplesCollector {
 public:
@@ -54,7 +57,10 @@ public:
     //! Returns the number of examples currently stored for a given category.
     std::size_t numberOfExamplesForCategory(CLocalCategoryId categoryId) const;
 
-    const TStrFSet& examples(CLocalCategoryId categoryId) const;
+    //! Get the examples for \p categoryId.
+    //!
+    //! \note These are decoded from the compact storage.
+    TStrFSet examples(CLocalCategoryId categoryId) const;
 
     //! Persist state by passing information to the supplied inserter
     void acceptPersistInserter(core::CStatePersistInserter& inserter) const;
@@ -72,11 +78,66 @@ public:
     std::size_t memoryUsage() const;
 
 private:
-    using TLocalCategoryIdStrFSetUMap = boost::unordered_map<CLocalCategoryId, TStrFSet>;
+    //! \brief The front coded examples of a single category.
+    //!
+    //! DESCRIPTION:\n
+    //! The examples are stored in ascending order in a single string. Each
+    //! is encoded as the length of the prefix it shares with the previous
+    //! example and the length of its remaining suffix, each in two bytes,
+    //! followed by the suffix.
+    class CCompactExamples {
+    public:
+        //! Get the number of examples.
+        std::size_t size() const;
+
+        //! Add \p example if it isn't already present.
+        //!
+        //! \return True if the example was added.
+        //! \note \p example must be no longer than MAX_EXAMPLE_LENGTH.
+        bool insert(const std::string& example);
+
+        //! Call \p f with each example in ascending order.
+        template<typename F>
+        void forEach(F f) const {
+            std::string example;
+            for (std::size_t pos = 0; pos < m_Encoded.size(); /**/) {
+                pos = decodeNext(pos, example);
+                f(example);
+            }
+        }
+
+        //! Debug the memory used by the examples.
+        void debugMemoryUsage(const core::CMemoryUsage::TMemoryUsagePtr& mem) const;
+
+        //! Get the memory used by the examples.
+        std::size_t memoryUsage() const;
+
+    private:
+        //! Decode the example starting at \p pos, which is encoded relative
+        //! to \p example, into \p example.
+        //!
+        //! \return The start of the next example.
+        std::size_t decodeNext(std::size_t pos, std::string& example) const;
+
+        //! Append \p example encoded relative to \p previous to \p encoded.
+        static void encode(const std::string& previous,
+                           const std::string& example,
+                           std::string& encoded);
+
+    private:
+        //! The front coded examples.
+        std::string m_Encoded;
+
+        //! The number of examples.
+        std::size_t m_Size = 0;
+    };
+
+    using TLocalCategoryIdCompactExamplesUMap =
+        boost::unordered_map<CLocalCategoryId, CCompactExamples>;
 
 private:
     void persistExamples(CLocalCategoryId categoryId,
-                         const TStrFSet& examples,
+                         const CCompactExamples& examples,
                          core::CStatePersistInserter& inserter) const;
     bool restoreExamples(core::CStateRestoreTraverser& traverser);
 
@@ -88,8 +149,8 @@ private:
     //! The max number of examples that will be collected per category
     std::size_t m_MaxExamples;
 
-    //! A map from categories to the set that contains the examples
-    TLocalCategoryIdStrFSetUMap m_ExamplesByCategory;
+    //! A map from categories to their examples
+    TLocalCategoryIdCompactExamplesUMap m_ExamplesByCategory;
 };
 }
 }
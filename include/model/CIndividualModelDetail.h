@@ -12,6 +12,8 @@
 #include <model/CProbabilityAndInfluenceCalculator.h>
 #include <model/CStringStore.h>
 
+#include <boost/unordered_set.hpp>
+
 namespace ml {
 namespace model {
 
@@ -12,6 +12,7 @@
 #include <core/CSmallVector.h>
 
 #include <maths/CModel.h>
+#include <maths/CMultinomialConjugate.h>
 #include <maths/CMultivariatePrior.h>
 #include <maths/COrderings.h>
 #include <maths/CPRNG.h>
@@ -33,7 +34,6 @@
 namespace ml {
 namespace maths {
 class CModel;
-class CMultinomialConjugate;
 }
 namespace model {
 class CSample;
@@ -106,17 +106,17 @@ public:
     struct MODEL_EXPORT SStoredStringPtrStoredStringPtrPrHash {
         std::size_t operator()(const TStoredStringPtrStoredStringPtrPr& target) const {
             return static_cast<std::size_t>(core::CHashing::hashCombine(
-                static_cast<uint64_t>(s_Hasher(*target.first)),
-                static_cast<uint64_t>(s_Hasher(*target.second))));
+                static_cast<uint64_t>(target.first.hash()),
+                static_cast<uint64_t>(target.second.hash())));
         }
-        core::CHashing::CMurmurHash2String s_Hasher;
     };
 
     //! \brief Compares two string pointer pairs.
     struct MODEL_EXPORT SStoredStringPtrStoredStringPtrPrEqual {
         std::size_t operator()(const TStoredStringPtrStoredStringPtrPr& lhs,
                                const TStoredStringPtrStoredStringPtrPr& rhs) const {
-            return *lhs.first == *rhs.first && *lhs.second == *rhs.second;
+            return lhs.first.hasSameString(rhs.first) &&
+                   lhs.second.hasSameString(rhs.second);
         }
     };
 
@@ -171,14 +171,22 @@ public:
     //!
     //! DESCRIPTION:\n
     //! This caches the probabilities for each category, in the multinomial
-    //! distribution, since they can't be computed independently and for
-    //! a large number of categories it is very wasteful to repeatedly
-    //! compute them all.
+    //! distribution, since for a large number of categories it is very
+    //! wasteful to repeatedly compute them.
+    //!
+    //! IMPLEMENTATION DECISIONS:\n
+    //! The probabilities are computed on demand for the categories which
+    //! are looked up. The calculator is kept between updates so it can
+    //! reuse the order of the categories from the last update.
     class MODEL_EXPORT CCategoryProbabilityCache {
     public:
         CCategoryProbabilityCache();
         CCategoryProbabilityCache(const maths::CMultinomialConjugate& prior);
 
+        //! Clear the cached probabilities and use \p prior to compute
+        //! them in future.
+        void update(const maths::CMultinomialConjugate& prior);
+
         //! Calculate the probability of less likely categories than
         //! \p attribute.
         bool lookup(std::size_t category, double& result) const;
@@ -189,9 +197,17 @@ public:
         //! Get the memory usage of the component
         std::size_t memoryUsage() const;
 
+    private:
+        using TLessLikelyCategoriesCalculator =
+            maths::CMultinomialConjugate::CLessLikelyCategoriesCalculator;
+
     private:
         //! The prior.
         const maths::CMultinomialConjugate* m_Prior;
+        //! True if the calculator must be updated from the prior.
+        mutable bool m_Stale;
+        //! Computes the probabilities.
+        mutable TLessLikelyCategoriesCalculator m_Calculator;
         //! The cached probabilities.
         mutable TDoubleVec m_Cache;
         //! The smallest possible category probability.
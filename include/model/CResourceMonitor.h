@@ -6,6 +6,7 @@
 #ifndef INCLUDED_ml_model_CResourceMonitor_h
 #define INCLUDED_ml_model_CResourceMonitor_h
 
+#include <core/CAllocationTracker.h>
 #include <core/CoreTypes.h>
 
 #include <maths/CBasicStatistics.h>
@@ -59,6 +60,9 @@ public:
         std::size_t s_BytesExceeded = 0;
         std::size_t s_BytesMemoryLimit = 0;
         SCategorizerStats s_OverallCategorizerStats;
+        //! The live bytes actually allocated by each subsystem. These are
+        //! only available if core::CAllocationTracker::enabled().
+        core::CAllocationTracker::TSizeTagArray s_AllocatedBytes{};
     };
 
 public:
@@ -213,6 +217,14 @@ private:
     //! Returns the sum of used memory plus any extra memory
     std::size_t totalMemory() const;
 
+    //! Returns the live bytes allocated by the subsystems whose memory is
+    //! monitored. This is zero unless core::CAllocationTracker::enabled().
+    std::size_t allocatedMemory() const;
+
+    //! Returns the memory to check against the limits. This is the larger of
+    //! the total memory and the allocated memory.
+    std::size_t memoryForLimits() const;
+
     //! Adjusts the amount of memory reported to take into
     //! account the current value of the byte limit margin and the effects
     //! of background persistence.
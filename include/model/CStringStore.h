@@ -6,6 +6,7 @@
 #ifndef INCLUDED_ml_model_CStringStore_h
 #define INCLUDED_ml_model_CStringStore_h
 
+#include <core/CConcurrentHashMap.h>
 #include <core/CFastMutex.h>
 #include <core/CMemory.h>
 #include <core/CNonCopyable.h>
@@ -13,11 +14,10 @@
 
 #include <model/ImportExport.h>
 
-#include <boost/unordered_set.hpp>
-
 #include <atomic>
 #include <functional>
 #include <string>
+#include <vector>
 
 namespace CResourceMonitorTest {
 class CTestFixture;
@@ -56,20 +56,24 @@ namespace model {
 //! A singleton class: there should only be one collection strings for
 //! person names/attributes, and a separate collection for influencer
 //! strings.
-//! Write access is locked for the benefit of future threading.
+//!
+//! The strings are held in a concurrent hash map so lookups of existing
+//! strings, which are by far the most common operation, don't lock and
+//! inserts only contend with inserts of strings in the same stripe. Each
+//! entry records the memory used by its string so the running total can
+//! be maintained as strings are added and pruned.
 //!
 class MODEL_EXPORT CStringStore : private core::CNonCopyable {
 public:
     struct MODEL_EXPORT SHashStoredStringPtr {
         std::size_t operator()(const core::CStoredStringPtr& key) const {
-            boost::hash<std::string> hasher;
-            return hasher(*key);
+            return key.hash();
         }
     };
     struct MODEL_EXPORT SStoredStringPtrEqual {
         bool operator()(const core::CStoredStringPtr& lhs,
                         const core::CStoredStringPtr& rhs) const {
-            return *lhs == *rhs;
+            return lhs.hasSameString(rhs);
         }
     };
 
@@ -105,8 +109,8 @@ public:
     std::size_t memoryUsage() const;
 
 private:
-    using TStoredStringPtrUSet =
-        boost::unordered_set<core::CStoredStringPtr, SHashStoredStringPtr, SStoredStringPtrEqual>;
+    using TStoredStringPtrSizeCMap =
+        core::CConcurrentHashMap<core::CStoredStringPtr, std::size_t, SHashStoredStringPtr, SStoredStringPtrEqual>;
     using TStrVec = std::vector<std::string>;
 
 private:
@@ -117,28 +121,20 @@ private:
     void clearEverythingTestOnly();
 
 private:
-    //! Fence for reading operations (in which case we "leak" a string
-    //! if we try to write at the same time). See get for details.
-    std::atomic_int m_Reading;
-
-    //! Fence for writing operations (in which case we "leak" a string
-    //! if we try to read at the same time). See get for details.
-    std::atomic_int m_Writing;
-
     //! The empty string is often used so we store it outside the set.
     core::CStoredStringPtr m_EmptyString;
 
-    //! Set to keep the person/attribute string pointers
-    TStoredStringPtrUSet m_Strings;
+    //! Map from the person/attribute string pointers to their memory usage.
+    TStoredStringPtrSizeCMap m_Strings;
 
     //! A list of the strings to remove.
     TStrVec m_Removed;
 
     //! Running count of memory usage by stored strings.  Avoids the need to
     //! recalculate repeatedly.
-    std::size_t m_StoredStringsMemUse;
+    std::atomic<std::size_t> m_StoredStringsMemUse;
 
-    //! Locking primitive
+    //! Guards the list of strings to remove.
     mutable core::CFastMutex m_Mutex;
 
     friend class CResourceMonitorTest::CTestFixture;
@@ -11,6 +11,7 @@
 #include <model/ImportExport.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <map>
 #include <string>
 #include <utility>
@@ -37,6 +38,13 @@ namespace model {
 //! that created this object knows the mappings between the
 //! token IDs and string tokens.
 //!
+//! Categories are long lived and there can be very many of them, so the
+//! token lists they retain use 32 bit token IDs and 16 bit weightings.
+//! This halves their size compared to the std::size_t pairs used for the
+//! transient token lists of the strings being categorized.  Weightings
+//! which don't fit in 16 bits are saturated.  Such a token can then never
+//! be common to another string, which is the conservative outcome.
+//!
 class MODEL_EXPORT CTokenListCategory {
 public:
     //! Used to associate tokens with weightings:
@@ -47,6 +55,14 @@ public:
     //! Used for storing token ID sequences
     using TSizeSizePrVec = std::vector<TSizeSizePr>;
 
+    //! Used to compactly associate retained tokens with weightings:
+    //! first -> token ID
+    //! second -> weighting
+    using TUInt32UInt16Pr = std::pair<std::uint32_t, std::uint16_t>;
+
+    //! Used for storing retained token ID sequences
+    using TUInt32UInt16PrVec = std::vector<TUInt32UInt16Pr>;
+
     //! Used for storing distinct token IDs mapped to weightings
     using TSizeSizeMap = std::map<std::size_t, std::size_t>;
 
@@ -72,9 +88,9 @@ public:
 
     //! Accessors
     const std::string& baseString() const;
-    const TSizeSizePrVec& baseTokenIds() const;
+    const TUInt32UInt16PrVec& baseTokenIds() const;
     std::size_t baseWeight() const;
-    const TSizeSizePrVec& commonUniqueTokenIds() const;
+    const TUInt32UInt16PrVec& commonUniqueTokenIds() const;
     std::size_t commonUniqueTokenWeight() const;
     std::size_t origUniqueTokenWeight() const;
     std::size_t maxStringLen() const;
@@ -130,11 +146,11 @@ public:
 
     //! Does the reverse search of this category match the reverse search that
     //! a category created from the supplied arguments would find?
-    template<typename PAIR_CONTAINER>
+    template<typename PAIR_CONTAINER, typename TOKEN_ID_CONTAINER>
     bool matchesSearchForCategory(std::size_t otherBaseWeight,
                                   std::size_t otherStringLen,
                                   const PAIR_CONTAINER& otherUniqueTokenIds,
-                                  const TSizeSizePrVec& otherBaseTokenIds) const {
+                                  const TOKEN_ID_CONTAINER& otherBaseTokenIds) const {
         return (m_BaseWeight == 0) == (otherBaseWeight == 0) &&
                this->maxMatchingStringLen() >= otherStringLen &&
                this->isMissingCommonTokenWeightZero(otherUniqueTokenIds) &&
@@ -143,7 +159,34 @@ public:
 
     //! Does the supplied token vector contain all our common tokens in the
     //! same order as our base token vector?
-    bool containsCommonInOrderTokensInOrder(const TSizeSizePrVec& tokenIds) const;
+    //! \param tokenIds A container of pairs where the first element is a
+    //!                 token ID.
+    template<typename TOKEN_ID_CONTAINER>
+    bool containsCommonInOrderTokensInOrder(const TOKEN_ID_CONTAINER& tokenIds) const {
+
+        auto testIter = tokenIds.begin();
+        for (std::size_t index = m_OrderedCommonTokenBeginIndex;
+             index < m_OrderedCommonTokenEndIndex; ++index) {
+            std::size_t baseTokenId{m_BaseTokenIds[index].first};
+
+            // Ignore tokens that are not in the common unique tokens
+            if (this->isTokenCommon(baseTokenId) == false) {
+                continue;
+            }
+
+            // Skip tokens in the test tokens until we find one that matches the
+            // base token.  If we reach the end of the test tokens whilst doing
+            // this, it means the test tokens don't contain the common ordered
+            // base tokens in the correct order.
+            do {
+                if (testIter == tokenIds.end()) {
+                    return false;
+                }
+            } while ((testIter++)->first != baseTokenId);
+        }
+
+        return true;
+    }
 
     //! \return Does the supplied token ID represent a common unique token?
     bool isTokenCommon(std::size_t tokenId) const;
@@ -192,7 +235,7 @@ private:
 private:
     //! The string and tokens we base this category on
     std::string m_BaseString;
-    TSizeSizePrVec m_BaseTokenIds;
+    TUInt32UInt16PrVec m_BaseTokenIds;
 
     //! Cache the total weight of the base tokens
     std::size_t m_BaseWeight = 0;
@@ -217,7 +260,7 @@ private:
 
     //! The unique token IDs that all strings classified to be this category
     //! contain.  This vector must always be sorted into ascending order.
-    TSizeSizePrVec m_CommonUniqueTokenIds;
+    TUInt32UInt16PrVec m_CommonUniqueTokenIds;
 
     //! Cache the weight of the common unique tokens
     std::size_t m_CommonUniqueTokenWeight = 0;
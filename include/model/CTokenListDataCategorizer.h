@@ -152,10 +152,10 @@ protected:
         totalWeight += idWithWeight.second;
     }
 
-    //! Compute similarity between two vectors
+    //! Compute similarity between a string's tokens and a category's tokens
     double similarity(const TSizeSizePrVec& left,
                       std::size_t leftWeight,
-                      const TSizeSizePrVec& right,
+                      const TUInt32UInt16PrVec& right,
                       std::size_t rightWeight) const override {
         double similarity(1.0);
 
@@ -174,7 +174,7 @@ private:
     //! Compare two vectors of tokens without doing any warping (this is an
     //! alternative to using the Levenshtein distance, which is a form of
     //! warping)
-    std::size_t compareNoWarp(const TSizeSizePrVec& left, const TSizeSizePrVec& right) const {
+    std::size_t compareNoWarp(const TSizeSizePrVec& left, const TUInt32UInt16PrVec& right) const {
         std::size_t minSize(std::min(left.size(), right.size()));
         std::size_t maxSize(std::max(left.size(), right.size()));
 
@@ -182,7 +182,8 @@ private:
 
         for (std::size_t index = 0; index < minSize; ++index) {
             if (left[index].first != right[index].first) {
-                diff += std::max(left[index].second, right[index].second);
+                diff += std::max(left[index].second,
+                                 static_cast<std::size_t>(right[index].second));
             }
         }
 
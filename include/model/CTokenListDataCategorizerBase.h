@@ -80,6 +80,9 @@ public:
     using TSizeSizePrVecItr = TSizeSizePrVec::iterator;
     using TSizeSizePrVecCItr = TSizeSizePrVec::const_iterator;
 
+    //! Used for the token ID sequences categories retain
+    using TUInt32UInt16PrVec = CTokenListCategory::TUInt32UInt16PrVec;
+
     //! Used for storing distinct token IDs
     using TSizeSizeMap = std::map<std::size_t, std::size_t>;
 
@@ -223,10 +226,10 @@ protected:
                                     TSizeSizeMap& tokenUniqueIds,
                                     std::size_t& totalWeight) = 0;
 
-    //! Compute similarity between two vectors
+    //! Compute similarity between a string's tokens and a category's tokens
     virtual double similarity(const TSizeSizePrVec& left,
                               std::size_t leftWeight,
-                              const TSizeSizePrVec& right,
+                              const TUInt32UInt16PrVec& right,
                               std::size_t rightWeight) const = 0;
 
     //! Add a match to an existing category
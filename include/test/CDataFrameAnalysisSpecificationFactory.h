@@ -56,6 +56,8 @@ public:
     CDataFrameAnalysisSpecificationFactory& memoryLimit(std::size_t memoryLimit);
     CDataFrameAnalysisSpecificationFactory& missingString(const std::string& missing);
     CDataFrameAnalysisSpecificationFactory& diskUsageAllowed(bool disk);
+    CDataFrameAnalysisSpecificationFactory& frameCache(const std::string& directory,
+                                                       const std::string& key);
 
     // Outliers
     CDataFrameAnalysisSpecificationFactory& outlierMethod(std::string method);
@@ -99,6 +101,7 @@ public:
     CDataFrameAnalysisSpecificationFactory& predictionFieldType(const std::string& type);
     CDataFrameAnalysisSpecificationFactory&
     classificationWeights(const TStrDoublePrVec& weights);
+    CDataFrameAnalysisSpecificationFactory& diagonalCurvature(bool diagonal);
 
     std::string outlierParams() const;
     TSpecificationUPtr outlierSpec() const;
@@ -111,8 +114,12 @@ public:
 private:
     using TOptionalSize = boost::optional<std::size_t>;
     using TOptionalDouble = boost::optional<double>;
+    using TOptionalBool = boost::optional<bool>;
     using TOptionalLossFunctionType = boost::optional<TLossFunctionType>;
 
+private:
+    std::string addFrameCache(std::string spec) const;
+
 private:
     // Shared
     TOptionalSize m_Rows;
@@ -120,6 +127,8 @@ private:
     TOptionalSize m_MemoryLimit;
     std::string m_MissingString;
     bool m_DiskUsageAllowed = true;
+    std::string m_FrameCacheDirectory;
+    std::string m_FrameCacheKey;
     // Outliers
     std::string m_Method;
     std::size_t m_NumberNeighbours = 0;
@@ -151,6 +160,7 @@ private:
     std::string m_PredictionFieldType;
     bool m_EarlyStoppingEnabled = true;
     TStrDoublePrVec m_ClassificationWeights;
+    TOptionalBool m_DiagonalCurvature;
 };
 }
 }
@@ -5,6 +5,7 @@
  */
 #include <api/CAnomalyJob.h>
 
+#include <core/CAllocationTracker.h>
 #include <core/CDataAdder.h>
 #include <core/CDataSearcher.h>
 #include <core/CFunctional.h>
@@ -46,6 +47,7 @@
 
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <boost/unordered_set.hpp>
 
 #include <fstream>
 #include <iostream>
@@ -125,6 +127,40 @@ const std::string CAnomalyJob::EMPTY_STRING;
 
 const CAnomalyJob::TAnomalyDetectorPtr CAnomalyJob::NULL_DETECTOR;
 
+//! \brief The state of an incremental snapshot which is in progress.
+struct CAnomalyJob::SIncrementalPersistState {
+    using TDetectorCPtrUSet = boost::unordered_set<const model::CAnomalyDetector*>;
+
+    SIncrementalPersistState(core::CDataAdder& persister,
+                             const model::CHierarchicalResultsAggregator& aggregator)
+        : s_Aggregator{aggregator}, s_Compressor{persister} {}
+
+    std::string s_Description;
+    std::string s_SnapshotId;
+    core_t::TTime s_SnapshotTimestamp{0};
+    core_t::TTime s_Time{0};
+    model::CResourceMonitor::SModelSizeStats s_ModelSizeStats;
+    //! The aggregator is small so we copy it rather than trying to track
+    //! when it changes.
+    model::CHierarchicalResultsAggregator s_Aggregator;
+    std::string s_NormalizerState;
+    core_t::TTime s_LatestRecordTime{0};
+    core_t::TTime s_LastResultsTime{0};
+    //! The detectors which existed when the snapshot was started in the
+    //! order they're written if they aren't updated first.
+    TAnomalyDetectorPtrVec s_Detectors;
+    //! The position in s_Detectors of the next detector to write.
+    std::size_t s_NextDetector{0};
+    //! The detectors which haven't been written yet.
+    TDetectorCPtrUSet s_Unwritten;
+    //! Clears the cached counters when the snapshot is complete.
+    core::CProgramCounters::CCacheManager s_CacheManager;
+    core::CStateCompressor s_Compressor;
+    core::CDataAdder::TOStreamP s_Stream;
+    //! The inserter must be destroyed before the stream is complete.
+    std::unique_ptr<core::CJsonStatePersistInserter> s_Inserter;
+};
+
 CAnomalyJob::CAnomalyJob(const std::string& jobId,
                          model::CLimits& limits,
                          CAnomalyJobConfig& jobConfig,
@@ -213,6 +249,7 @@ bool CAnomalyJob::handleRecord(const TStrStrUMap& dataRowFields, TOptionalTime t
             continue;
         }
 
+        this->persistIncrementallyBeforeUpdate(*detector);
         this->addRecord(detector, *time, dataRowFields);
     }
 
@@ -221,10 +258,14 @@ bool CAnomalyJob::handleRecord(const TStrStrUMap& dataRowFields, TOptionalTime t
     ++m_NumRecordsHandled;
     m_LatestRecordTime = std::max(m_LatestRecordTime, *time);
 
+    this->continueIncrementalPersist(m_NumberDetectorsToPersistPerRecord);
+
     return true;
 }
 
 void CAnomalyJob::finalise() {
+    this->continueIncrementalPersist(std::numeric_limits<std::size_t>::max());
+
     // Persist final state of normalizer iff an input record has been handled or time has been advanced.
     if (this->isPersistenceNeeded("quantiles state and model size stats")) {
         m_JsonOutputWriter.persistNormalizer(m_Normalizer, m_LastNormalizerPersistTime);
@@ -319,6 +360,13 @@ bool CAnomalyJob::handleControlMessage(const std::string& controlMessage) {
         return false;
     }
 
+    // Other than fillers and flushes, control messages can update all the
+    // detectors so any incremental snapshot must be completed first.
+    if (controlMessage[0] != ' ' && controlMessage[0] != CONTROL_FIELD_NAME_CHAR &&
+        controlMessage[0] != 'f') {
+        this->continueIncrementalPersist(std::numeric_limits<std::size_t>::max());
+    }
+
     switch (controlMessage[0]) {
     case ' ':
         // Spaces are just used to fill the buffers and force prior messages
@@ -513,6 +561,7 @@ void CAnomalyJob::outputBucketResultsUntil(core_t::TTime time) {
     for (core_t::TTime lastBucketEndTime = m_LastFinalisedBucketEndTime;
          lastBucketEndTime + bucketLength + latency <= time;
          lastBucketEndTime += bucketLength) {
+        this->continueIncrementalPersist(std::numeric_limits<std::size_t>::max());
         this->outputResults(lastBucketEndTime);
         m_Limits.resourceMonitor().decreaseMargin(bucketLength);
         m_Limits.resourceMonitor().sendMemoryUsageReportIfSignificantlyChanged(
@@ -637,6 +686,7 @@ void CAnomalyJob::doForecast(const std::string& controlMessage) {
 }
 
 void CAnomalyJob::outputResults(core_t::TTime bucketStartTime) {
+    core::CAllocationTracker::CScopedTag allocationTag{core::CAllocationTracker::E_Results};
     core::CStopWatch timer(true);
 
     core_t::TTime bucketLength = m_ModelConfig.bucketLength();
@@ -693,6 +743,7 @@ void CAnomalyJob::outputResults(core_t::TTime bucketStartTime) {
 }
 
 void CAnomalyJob::outputInterimResults(core_t::TTime bucketStartTime) {
+    core::CAllocationTracker::CScopedTag allocationTag{core::CAllocationTracker::E_Results};
     core::CStopWatch timer(true);
 
     core_t::TTime bucketLength = m_ModelConfig.bucketLength();
@@ -1085,6 +1136,8 @@ bool CAnomalyJob::doPersistStateInForeground(core::CDataAdder& persister,
                                              const std::string& description,
                                              const std::string& snapshotId,
                                              core_t::TTime snapshotTimestamp) {
+    this->continueIncrementalPersist(std::numeric_limits<std::size_t>::max());
+
     if (m_PersistenceManager != nullptr) {
         // This will not happen if finalise() was called before persisting state
         if (m_PersistenceManager->isBusy()) {
@@ -1120,6 +1173,8 @@ bool CAnomalyJob::backgroundPersistState() {
         return false;
     }
 
+    this->continueIncrementalPersist(std::numeric_limits<std::size_t>::max());
+
     // Pass arguments by value: this is what we want for
     // passing to a new thread.
     // Do NOT add std::ref wrappers around these arguments - they
@@ -1175,9 +1230,159 @@ bool CAnomalyJob::runForegroundPersist(core::CDataAdder& persister) {
     // Prune the models so that the persisted state is as neat as possible
     this->pruneAllModels();
 
+    if (m_NumberDetectorsToPersistPerRecord > 0) {
+        return this->startIncrementalPersist(persister);
+    }
+
     return this->persistStateInForeground(persister, "Periodic foreground persist at ");
 }
 
+bool CAnomalyJob::startIncrementalPersist(core::CDataAdder& persister) {
+    // Only one snapshot can be written to the data adder at a time.
+    this->continueIncrementalPersist(std::numeric_limits<std::size_t>::max());
+
+    if (m_LastFinalisedBucketEndTime == 0) {
+        LOG_INFO(<< "Will not persist detectors as no results have been output");
+        return true;
+    }
+
+    auto state = std::make_unique<SIncrementalPersistState>(persister, m_Aggregator);
+    state->s_SnapshotTimestamp = core::CTimeUtils::now();
+    state->s_SnapshotId = core::CStringUtils::typeToString(state->s_SnapshotTimestamp);
+    state->s_Description = "Periodic incremental persist at " +
+                           core::CTimeUtils::toIso8601(state->s_SnapshotTimestamp);
+    state->s_Time = m_LastFinalisedBucketEndTime;
+    state->s_ModelSizeStats = m_Limits.resourceMonitor().createMemoryUsageReport(
+        m_LastFinalisedBucketEndTime - m_ModelConfig.bucketLength());
+    m_Normalizer.toJson(m_LastResultsTime, "api", state->s_NormalizerState, true);
+    state->s_LatestRecordTime = m_LatestRecordTime;
+    state->s_LastResultsTime = m_LastResultsTime;
+
+    TKeyCRefAnomalyDetectorPtrPrVec detectors;
+    this->sortedDetectors(detectors);
+    state->s_Detectors.reserve(detectors.size());
+    for (const auto& detector : detectors) {
+        if (detector.second == nullptr) {
+            LOG_ERROR(<< "Unexpected NULL pointer for key '"
+                      << pairDebug(detector.first) << '\'');
+            continue;
+        }
+        state->s_Detectors.push_back(detector.second);
+        state->s_Unwritten.insert(detector.second.get());
+    }
+
+    // The counters are written with the simple count detector so must be
+    // captured now for them to be consistent with the rest of the snapshot.
+    core::CProgramCounters::cacheCounters();
+
+    try {
+        state->s_Stream = state->s_Compressor.addStreamed(
+            m_JobId + '_' + STATE_TYPE + '_' + state->s_SnapshotId);
+        if (state->s_Stream == nullptr) {
+            return true;
+        }
+        state->s_Inserter = std::make_unique<core::CJsonStatePersistInserter>(
+            *state->s_Stream);
+        state->s_Inserter->insertValue(TIME_TAG, state->s_Time);
+        state->s_Inserter->insertValue(VERSION_TAG, model::CAnomalyDetector::STATE_VERSION);
+        state->s_Inserter->insertLevel(
+            INTERIM_BUCKET_CORRECTOR_TAG,
+            std::bind(&model::CInterimBucketCorrector::acceptPersistInserter,
+                      &m_ModelConfig.interimBucketCorrector(), std::placeholders::_1));
+    } catch (std::exception& e) {
+        LOG_ERROR(<< "Failed to persist state! " << e.what());
+        return false;
+    }
+
+    LOG_DEBUG(<< "Started incremental persist of " << state->s_Detectors.size() << " detectors");
+    m_IncrementalPersistState = std::move(state);
+
+    return true;
+}
+
+void CAnomalyJob::persistIncrementallyBeforeUpdate(const model::CAnomalyDetector& detector) {
+    if (m_IncrementalPersistState == nullptr ||
+        m_IncrementalPersistState->s_Unwritten.erase(&detector) == 0) {
+        return;
+    }
+    try {
+        m_IncrementalPersistState->s_Inserter->insertLevel(
+            TOP_LEVEL_DETECTOR_TAG, std::bind(&CAnomalyJob::persistIndividualDetector,
+                                              std::cref(detector), std::placeholders::_1));
+        LOG_TRACE(<< "Persisted state for '" << detector.description() << "'");
+    } catch (std::exception& e) {
+        LOG_ERROR(<< "Failed to persist state! " << e.what());
+        m_IncrementalPersistState.reset();
+    }
+}
+
+bool CAnomalyJob::continueIncrementalPersist(std::size_t numberDetectors) {
+    if (m_IncrementalPersistState == nullptr) {
+        return true;
+    }
+
+    SIncrementalPersistState& state{*m_IncrementalPersistState};
+
+    try {
+        for (std::size_t i = 0; i < numberDetectors && state.s_Unwritten.size() > 0;
+             ++state.s_NextDetector) {
+            const model::CAnomalyDetector* detector{
+                state.s_Detectors[state.s_NextDetector].get()};
+            if (state.s_Unwritten.erase(detector) > 0) {
+                state.s_Inserter->insertLevel(
+                    TOP_LEVEL_DETECTOR_TAG,
+                    std::bind(&CAnomalyJob::persistIndividualDetector,
+                              std::cref(*detector), std::placeholders::_1));
+                LOG_TRACE(<< "Persisted state for '" << detector->description() << "'");
+                ++i;
+            }
+        }
+        if (state.s_Unwritten.size() > 0) {
+            return true;
+        }
+
+        state.s_Inserter->insertLevel(
+            RESULTS_AGGREGATOR_TAG,
+            std::bind(&model::CHierarchicalResultsAggregator::acceptPersistInserter,
+                      &state.s_Aggregator, std::placeholders::_1));
+        core::CPersistUtils::persist(LATEST_RECORD_TIME_TAG,
+                                     state.s_LatestRecordTime, *state.s_Inserter);
+        core::CPersistUtils::persist(LAST_RESULTS_TIME_TAG,
+                                     state.s_LastResultsTime, *state.s_Inserter);
+        state.s_Inserter.reset();
+
+        if (state.s_Compressor.streamComplete(state.s_Stream, true) == false ||
+            state.s_Stream->bad()) {
+            LOG_ERROR(<< "Failed to complete last persistence stream");
+            m_IncrementalPersistState.reset();
+            return false;
+        }
+
+        if (m_PersistCompleteFunc) {
+            CModelSnapshotJsonWriter::SModelSnapshotReport modelSnapshotReport{
+                MODEL_SNAPSHOT_MIN_VERSION, state.s_SnapshotTimestamp,
+                state.s_Description, state.s_SnapshotId,
+                state.s_Compressor.numCompressedDocs(), state.s_ModelSizeStats,
+                state.s_NormalizerState, state.s_LatestRecordTime,
+                // This needs to be the last final result time as it serves
+                // as the time after which all results are deleted when a
+                // model snapshot is reverted
+                state.s_Time - m_ModelConfig.bucketLength()};
+
+            m_PersistCompleteFunc(modelSnapshotReport);
+        }
+        LOG_DEBUG(<< "Completed incremental persist");
+    } catch (std::exception& e) {
+        LOG_ERROR(<< "Failed to persist state! " << e.what());
+        m_IncrementalPersistState.reset();
+        return false;
+    }
+
+    m_IncrementalPersistState.reset();
+
+    return true;
+}
+
 bool CAnomalyJob::runBackgroundPersist(TBackgroundPersistArgsPtr args,
                                        core::CDataAdder& persister) {
     if (!args) {
@@ -1573,6 +1778,8 @@ CAnomalyJob::detectorForKey(bool isRestoring,
 }
 
 void CAnomalyJob::pruneAllModels() {
+    this->continueIncrementalPersist(std::numeric_limits<std::size_t>::max());
+
     LOG_INFO(<< "Pruning all models");
 
     for (const auto& detector_ : m_Detectors) {
@@ -1586,6 +1793,10 @@ void CAnomalyJob::pruneAllModels() {
     }
 }
 
+void CAnomalyJob::persistIncrementally(std::size_t numberDetectorsPerRecord) {
+    m_NumberDetectorsToPersistPerRecord = numberDetectorsPerRecord;
+}
+
 CAnomalyJob::TAnomalyDetectorPtr
 CAnomalyJob::makeDetector(const model::CAnomalyDetectorModelConfig& modelConfig,
                           model::CLimits& limits,
@@ -5,6 +5,7 @@
  */
 #include <api/CDataFrameAnalysisInstrumentation.h>
 
+#include <core/CAllocationTracker.h>
 #include <core/CTimeUtils.h>
 #include <core/Constants.h>
 
@@ -37,6 +38,7 @@ const std::size_t MAXIMUM_FRACTIONAL_PROGRESS{std::size_t{1}
 const std::int64_t BYTES_IN_KB{static_cast<std::int64_t>(core::constants::BYTES_IN_KILOBYTES)};
 
 // clang-format off
+const std::string ALLOCATED_BYTES_TAG{"allocated_bytes"};
 const std::string CLASSIFICATION_STATS_TAG{"classification_stats"};
 const std::string HYPERPARAMETERS_TAG{"hyperparameters"};
 const std::string MEMORY_REESTIMATE_TAG{"memory_reestimate_bytes"};
@@ -259,6 +261,12 @@ void CDataFrameAnalysisInstrumentation::writeMemory(std::int64_t timestamp) {
             m_Writer->Key(MEMORY_REESTIMATE_TAG);
             m_Writer->Int64(m_MemoryReestimate.get());
         }
+        if (core::CAllocationTracker::enabled()) {
+            // Compare with the estimated peak usage.
+            m_Writer->Key(ALLOCATED_BYTES_TAG);
+            m_Writer->Uint64(core::CAllocationTracker::liveBytes(
+                core::CAllocationTracker::E_DataFrame));
+        }
         m_Writer->EndObject();
     }
 }
@@ -300,15 +308,10 @@ void CDataFrameOutliersInstrumentation::writeAnalysisStats(std::int64_t timestam
         writer->Key(TIMESTAMP_TAG);
         writer->Int64(timestamp);
 
-        rapidjson::Value parametersObject{writer->makeObject()};
-        this->writeParameters(parametersObject);
         writer->Key(PARAMETERS_TAG);
-        writer->write(parametersObject);
-
-        rapidjson::Value timingStatsObject{writer->makeObject()};
-        this->writeTimingStats(timingStatsObject);
+        this->writeParameters(*writer);
         writer->Key(TIMING_STATS_TAG);
-        writer->write(timingStatsObject);
+        this->writeTimingStats(*writer);
 
         writer->EndObject();
     }
@@ -329,40 +332,30 @@ void CDataFrameOutliersInstrumentation::featureInfluenceThreshold(double feature
     m_FeatureInfluenceThreshold = featureInfluenceThreshold;
 }
 
-void CDataFrameOutliersInstrumentation::writeTimingStats(rapidjson::Value& parentObject) {
-    auto* writer = this->writer();
-    if (writer != nullptr) {
-        writer->addMember(TIMING_ELAPSED_TIME_TAG,
-                          rapidjson::Value(m_ElapsedTime).Move(), parentObject);
-    }
-}
-
-void CDataFrameOutliersInstrumentation::writeParameters(rapidjson::Value& parentObject) {
-    auto* writer = this->writer();
-
-    if (writer != nullptr) {
-
-        writer->addMember(
-            CDataFrameOutliersRunner::N_NEIGHBORS,
-            rapidjson::Value(static_cast<std::uint64_t>(this->m_Parameters.s_NumberNeighbours))
-                .Move(),
-            parentObject);
-        writer->addMember(
-            CDataFrameOutliersRunner::COMPUTE_FEATURE_INFLUENCE,
-            rapidjson::Value(this->m_Parameters.s_ComputeFeatureInfluence).Move(),
-            parentObject);
-        writer->addMember(CDataFrameOutliersRunner::OUTLIER_FRACTION,
-                          rapidjson::Value(this->m_Parameters.s_OutlierFraction).Move(),
-                          parentObject);
-        writer->addMember(CDataFrameOutliersRunner::FEATURE_INFLUENCE_THRESHOLD,
-                          rapidjson::Value(this->m_FeatureInfluenceThreshold).Move(),
-                          parentObject);
-        writer->addMember(
-            CDataFrameOutliersRunner::STANDARDIZATION_ENABLED,
-            rapidjson::Value(this->m_Parameters.s_StandardizeColumns).Move(), parentObject);
-        writer->addMember(CDataFrameOutliersRunner::METHOD,
-                          maths::COutliers::print(this->m_Parameters.s_Method), parentObject);
-    }
+void CDataFrameOutliersInstrumentation::writeTimingStats(TWriter& writer) {
+    writer.StartObject();
+    writer.Key(TIMING_ELAPSED_TIME_TAG);
+    writer.Uint64(m_ElapsedTime);
+    writer.EndObject();
+}
+
+void CDataFrameOutliersInstrumentation::writeParameters(TWriter& writer) {
+    writer.StartObject();
+    writer.Key(CDataFrameOutliersRunner::N_NEIGHBORS);
+    writer.Uint64(static_cast<std::uint64_t>(this->m_Parameters.s_NumberNeighbours));
+    writer.Key(CDataFrameOutliersRunner::COMPUTE_FEATURE_INFLUENCE);
+    writer.Bool(this->m_Parameters.s_ComputeFeatureInfluence);
+    writer.Key(CDataFrameOutliersRunner::OUTLIER_FRACTION);
+    writer.Double(this->m_Parameters.s_OutlierFraction);
+    writer.Key(CDataFrameOutliersRunner::FEATURE_INFLUENCE_THRESHOLD);
+    writer.Double(this->m_FeatureInfluenceThreshold);
+    writer.Key(CDataFrameOutliersRunner::FEATURE_INFLUENCE_QUANTILE);
+    writer.Double(this->m_Parameters.s_FeatureInfluenceQuantile);
+    writer.Key(CDataFrameOutliersRunner::STANDARDIZATION_ENABLED);
+    writer.Bool(this->m_Parameters.s_StandardizeColumns);
+    writer.Key(CDataFrameOutliersRunner::METHOD);
+    writer.String(maths::COutliers::print(this->m_Parameters.s_Method));
+    writer.EndObject();
 }
 
 void CDataFrameTrainBoostedTreeInstrumentation::type(EStatsType type) {
@@ -409,20 +402,12 @@ void CDataFrameTrainBoostedTreeInstrumentation::writeAnalysisStats(std::int64_t
         writer->Key(ITERATION_TAG);
         writer->Uint64(m_Iteration);
 
-        rapidjson::Value hyperparametersObject{writer->makeObject()};
-        this->writeHyperparameters(hyperparametersObject);
         writer->Key(HYPERPARAMETERS_TAG);
-        writer->write(hyperparametersObject);
-
-        rapidjson::Value validationLossObject{writer->makeObject()};
-        this->writeValidationLoss(validationLossObject);
+        this->writeHyperparameters(*writer);
         writer->Key(VALIDATION_LOSS_TAG);
-        writer->write(validationLossObject);
-
-        rapidjson::Value timingStatsObject{writer->makeObject()};
-        this->writeTimingStats(timingStatsObject);
+        this->writeValidationLoss(*writer);
         writer->Key(TIMING_STATS_TAG);
-        writer->write(timingStatsObject);
+        this->writeTimingStats(*writer);
 
         writer->EndObject();
     }
@@ -434,114 +419,74 @@ void CDataFrameTrainBoostedTreeInstrumentation::reset() {
     m_LossValues.clear();
 }
 
-void CDataFrameTrainBoostedTreeInstrumentation::writeHyperparameters(rapidjson::Value& parentObject) {
-    auto* writer = this->writer();
-
-    if (writer != nullptr) {
-
-        writer->addMember(CDataFrameTrainBoostedTreeRunner::ETA,
-                          rapidjson::Value(this->m_Hyperparameters.s_Eta).Move(),
-                          parentObject);
-        if (m_Type == E_Classification) {
-            auto objective = this->m_Hyperparameters.s_ClassAssignmentObjective;
-            writer->addMember(
-                CDataFrameTrainBoostedTreeClassifierRunner::CLASS_ASSIGNMENT_OBJECTIVE,
-                CDataFrameTrainBoostedTreeClassifierRunner::CLASS_ASSIGNMENT_OBJECTIVE_VALUES[objective],
-                parentObject);
-        }
-        writer->addMember(
-            CDataFrameTrainBoostedTreeRunner::ALPHA,
-            rapidjson::Value(this->m_Hyperparameters.s_Regularization.s_DepthPenaltyMultiplier)
-                .Move(),
-            parentObject);
-        writer->addMember(
-            CDataFrameTrainBoostedTreeRunner::SOFT_TREE_DEPTH_LIMIT,
-            rapidjson::Value(this->m_Hyperparameters.s_Regularization.s_SoftTreeDepthLimit)
-                .Move(),
-            parentObject);
-        writer->addMember(
-            CDataFrameTrainBoostedTreeRunner::SOFT_TREE_DEPTH_TOLERANCE,
-            rapidjson::Value(this->m_Hyperparameters.s_Regularization.s_SoftTreeDepthTolerance)
-                .Move(),
-            parentObject);
-        writer->addMember(
-            CDataFrameTrainBoostedTreeRunner::GAMMA,
-            rapidjson::Value(this->m_Hyperparameters.s_Regularization.s_TreeSizePenaltyMultiplier)
-                .Move(),
-            parentObject);
-        writer->addMember(
-            CDataFrameTrainBoostedTreeRunner::LAMBDA,
-            rapidjson::Value(this->m_Hyperparameters.s_Regularization.s_LeafWeightPenaltyMultiplier)
-                .Move(),
-            parentObject);
-        writer->addMember(
-            CDataFrameTrainBoostedTreeRunner::DOWNSAMPLE_FACTOR,
-            rapidjson::Value(this->m_Hyperparameters.s_DownsampleFactor).Move(),
-            parentObject);
-        writer->addMember(
-            CDataFrameTrainBoostedTreeRunner::NUM_FOLDS,
-            rapidjson::Value(static_cast<std::uint64_t>(this->m_Hyperparameters.s_NumFolds))
-                .Move(),
-            parentObject);
-        writer->addMember(
-            CDataFrameTrainBoostedTreeRunner::MAX_TREES,
-            rapidjson::Value(static_cast<std::uint64_t>(this->m_Hyperparameters.s_MaxTrees))
-                .Move(),
-            parentObject);
-        writer->addMember(
-            CDataFrameTrainBoostedTreeRunner::FEATURE_BAG_FRACTION,
-            rapidjson::Value(this->m_Hyperparameters.s_FeatureBagFraction).Move(),
-            parentObject);
-        writer->addMember(
-            ETA_GROWTH_RATE_PER_TREE_TAG,
-            rapidjson::Value(this->m_Hyperparameters.s_EtaGrowthRatePerTree).Move(),
-            parentObject);
-        writer->addMember(
-            MAX_ATTEMPTS_TO_ADD_TREE_TAG,
-            rapidjson::Value(static_cast<std::uint64_t>(this->m_Hyperparameters.s_MaxAttemptsToAddTree))
-                .Move(),
-            parentObject);
-        writer->addMember(
-            NUM_SPLITS_PER_FEATURE_TAG,
-            rapidjson::Value(static_cast<std::uint64_t>(this->m_Hyperparameters.s_NumSplitsPerFeature))
-                .Move(),
-            parentObject);
-        writer->addMember(
-            CDataFrameTrainBoostedTreeRunner::MAX_OPTIMIZATION_ROUNDS_PER_HYPERPARAMETER,
-            rapidjson::Value(static_cast<std::uint64_t>(this->m_Hyperparameters.s_MaxOptimizationRoundsPerHyperparameter))
-                .Move(),
-            parentObject);
+void CDataFrameTrainBoostedTreeInstrumentation::writeHyperparameters(TWriter& writer) {
+    writer.StartObject();
+    writer.Key(CDataFrameTrainBoostedTreeRunner::ETA);
+    writer.Double(this->m_Hyperparameters.s_Eta);
+    if (m_Type == E_Classification) {
+        auto objective = this->m_Hyperparameters.s_ClassAssignmentObjective;
+        writer.Key(CDataFrameTrainBoostedTreeClassifierRunner::CLASS_ASSIGNMENT_OBJECTIVE);
+        writer.String(CDataFrameTrainBoostedTreeClassifierRunner::CLASS_ASSIGNMENT_OBJECTIVE_VALUES[objective]);
     }
-}
-void CDataFrameTrainBoostedTreeInstrumentation::writeValidationLoss(rapidjson::Value& parentObject) {
-    auto* writer = this->writer();
-    if (writer != nullptr) {
-        writer->addMember(VALIDATION_LOSS_TYPE_TAG, m_LossType, parentObject);
-        rapidjson::Value lossValuesArray{writer->makeArray()};
-        for (auto& element : m_LossValues) {
-            rapidjson::Value item{writer->makeObject()};
-            writer->addMember(
-                VALIDATION_FOLD_TAG,
-                rapidjson::Value(static_cast<std::uint64_t>(element.first)).Move(), item);
-            rapidjson::Value array{writer->makeArray(element.second.size())};
-            for (double lossValue : element.second) {
-                array.PushBack(rapidjson::Value(lossValue).Move(),
-                               writer->getRawAllocator());
-            }
-            writer->addMember(VALIDATION_LOSS_VALUES_TAG, array, item);
-            lossValuesArray.PushBack(item, writer->getRawAllocator());
+    writer.Key(CDataFrameTrainBoostedTreeRunner::ALPHA);
+    writer.Double(this->m_Hyperparameters.s_Regularization.s_DepthPenaltyMultiplier);
+    writer.Key(CDataFrameTrainBoostedTreeRunner::SOFT_TREE_DEPTH_LIMIT);
+    writer.Double(this->m_Hyperparameters.s_Regularization.s_SoftTreeDepthLimit);
+    writer.Key(CDataFrameTrainBoostedTreeRunner::SOFT_TREE_DEPTH_TOLERANCE);
+    writer.Double(this->m_Hyperparameters.s_Regularization.s_SoftTreeDepthTolerance);
+    writer.Key(CDataFrameTrainBoostedTreeRunner::GAMMA);
+    writer.Double(this->m_Hyperparameters.s_Regularization.s_TreeSizePenaltyMultiplier);
+    writer.Key(CDataFrameTrainBoostedTreeRunner::LAMBDA);
+    writer.Double(this->m_Hyperparameters.s_Regularization.s_LeafWeightPenaltyMultiplier);
+    writer.Key(CDataFrameTrainBoostedTreeRunner::DOWNSAMPLE_FACTOR);
+    writer.Double(this->m_Hyperparameters.s_DownsampleFactor);
+    writer.Key(CDataFrameTrainBoostedTreeRunner::NUM_FOLDS);
+    writer.Uint64(static_cast<std::uint64_t>(this->m_Hyperparameters.s_NumFolds));
+    writer.Key(CDataFrameTrainBoostedTreeRunner::MAX_TREES);
+    writer.Uint64(static_cast<std::uint64_t>(this->m_Hyperparameters.s_MaxTrees));
+    writer.Key(CDataFrameTrainBoostedTreeRunner::FEATURE_BAG_FRACTION);
+    writer.Double(this->m_Hyperparameters.s_FeatureBagFraction);
+    writer.Key(ETA_GROWTH_RATE_PER_TREE_TAG);
+    writer.Double(this->m_Hyperparameters.s_EtaGrowthRatePerTree);
+    writer.Key(MAX_ATTEMPTS_TO_ADD_TREE_TAG);
+    writer.Uint64(static_cast<std::uint64_t>(this->m_Hyperparameters.s_MaxAttemptsToAddTree));
+    writer.Key(NUM_SPLITS_PER_FEATURE_TAG);
+    writer.Uint64(static_cast<std::uint64_t>(this->m_Hyperparameters.s_NumSplitsPerFeature));
+    writer.Key(CDataFrameTrainBoostedTreeRunner::MAX_OPTIMIZATION_ROUNDS_PER_HYPERPARAMETER);
+    writer.Uint64(static_cast<std::uint64_t>(
+        this->m_Hyperparameters.s_MaxOptimizationRoundsPerHyperparameter));
+    writer.EndObject();
+}
+
+void CDataFrameTrainBoostedTreeInstrumentation::writeValidationLoss(TWriter& writer) {
+    writer.StartObject();
+    writer.Key(VALIDATION_LOSS_TYPE_TAG);
+    writer.String(m_LossType);
+    writer.Key(VALIDATION_FOLD_VALUES_TAG);
+    writer.StartArray();
+    for (const auto& element : m_LossValues) {
+        writer.StartObject();
+        writer.Key(VALIDATION_FOLD_TAG);
+        writer.Uint64(static_cast<std::uint64_t>(element.first));
+        writer.Key(VALIDATION_LOSS_VALUES_TAG);
+        writer.StartArray();
+        for (double lossValue : element.second) {
+            writer.Double(lossValue);
         }
-        writer->addMember(VALIDATION_FOLD_VALUES_TAG, lossValuesArray, parentObject);
+        writer.EndArray();
+        writer.EndObject();
     }
+    writer.EndArray();
+    writer.EndObject();
 }
-void CDataFrameTrainBoostedTreeInstrumentation::writeTimingStats(rapidjson::Value& parentObject) {
-    auto* writer = this->writer();
-    if (writer != nullptr) {
-        writer->addMember(TIMING_ELAPSED_TIME_TAG,
-                          rapidjson::Value(m_ElapsedTime).Move(), parentObject);
-        writer->addMember(TIMING_ITERATION_TIME_TAG,
-                          rapidjson::Value(m_IterationTime).Move(), parentObject);
-    }
+
+void CDataFrameTrainBoostedTreeInstrumentation::writeTimingStats(TWriter& writer) {
+    writer.StartObject();
+    writer.Key(TIMING_ELAPSED_TIME_TAG);
+    writer.Uint64(m_ElapsedTime);
+    writer.Key(TIMING_ITERATION_TIME_TAG);
+    writer.Uint64(m_IterationTime);
+    writer.EndObject();
 }
 
 CDataFrameAnalysisInstrumentation::CScopeSetOutputStream::CScopeSetOutputStream(
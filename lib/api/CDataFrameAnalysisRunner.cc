@@ -6,10 +6,12 @@
 
 #include <api/CDataFrameAnalysisRunner.h>
 
+#include <core/CAllocationTracker.h>
 #include <core/CDataFrame.h>
 #include <core/CJsonStatePersistInserter.h>
 #include <core/CLogger.h>
 #include <core/CStateCompressor.h>
+#include <core/Concurrency.h>
 #include <core/Constants.h>
 
 #include <api/CDataFrameAnalysisSpecification.h>
@@ -137,12 +139,21 @@ std::size_t CDataFrameAnalysisRunner::maximumNumberRowsPerPartition() const {
     return m_MaximumNumberRowsPerPartition;
 }
 
+std::size_t CDataFrameAnalysisRunner::numberRowsPerBatch() const {
+    return 0;
+}
+
 void CDataFrameAnalysisRunner::run(core::CDataFrame& frame) {
     if (m_Runner.joinable()) {
         LOG_INFO(<< "Already running analysis");
     } else {
         this->instrumentation().resetProgress();
         m_Runner = std::thread([&frame, this]() {
+            core::CAllocationTracker::CScopedTag allocationTag{
+                core::CAllocationTracker::E_DataFrame};
+            // The analysis is bulk computation so it shouldn't hold up any
+            // latency sensitive work scheduled on the default executor.
+            core::CScopedTaskPriority priority{core::CExecutor::E_LowPriority};
             this->runImpl(frame);
             this->instrumentation().setToFinished();
         });
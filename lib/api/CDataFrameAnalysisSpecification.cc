@@ -12,6 +12,7 @@
 
 #include <api/CDataFrameAnalysisConfigReader.h>
 #include <api/CDataFrameOutliersRunner.h>
+#include <api/CDataFramePredictBoostedTreeRunner.h>
 #include <api/CDataFrameTrainBoostedTreeClassifierRunner.h>
 #include <api/CDataFrameTrainBoostedTreeRegressionRunner.h>
 #include <api/CMemoryUsageEstimationResultJsonWriter.h>
@@ -39,6 +40,8 @@ const std::string CDataFrameAnalysisSpecification::RESULTS_FIELD{"results_field"
 const std::string CDataFrameAnalysisSpecification::MISSING_FIELD_VALUE{"missing_field_value"};
 const std::string CDataFrameAnalysisSpecification::CATEGORICAL_FIELD_NAMES{"categorical_fields"};
 const std::string CDataFrameAnalysisSpecification::DISK_USAGE_ALLOWED{"disk_usage_allowed"};
+const std::string CDataFrameAnalysisSpecification::FRAME_CACHE_DIRECTORY{"frame_cache_dir"};
+const std::string CDataFrameAnalysisSpecification::FRAME_CACHE_KEY{"frame_cache_key"};
 const std::string CDataFrameAnalysisSpecification::ANALYSIS{"analysis"};
 const std::string CDataFrameAnalysisSpecification::NAME{"name"};
 const std::string CDataFrameAnalysisSpecification::PARAMETERS{"parameters"};
@@ -54,6 +57,7 @@ TRunnerFactoryUPtrVec analysisFactories() {
         std::make_unique<CDataFrameTrainBoostedTreeRegressionRunnerFactory>());
     factories.push_back(
         std::make_unique<CDataFrameTrainBoostedTreeClassifierRunnerFactory>());
+    factories.push_back(std::make_unique<CDataFramePredictBoostedTreeRunnerFactory>());
     // Add new analysis types here.
     return factories;
 }
@@ -83,6 +87,10 @@ const CDataFrameAnalysisConfigReader CONFIG_READER{[] {
                            CDataFrameAnalysisConfigReader::E_OptionalParameter);
     theReader.addParameter(CDataFrameAnalysisSpecification::DISK_USAGE_ALLOWED,
                            CDataFrameAnalysisConfigReader::E_OptionalParameter);
+    theReader.addParameter(CDataFrameAnalysisSpecification::FRAME_CACHE_DIRECTORY,
+                           CDataFrameAnalysisConfigReader::E_OptionalParameter);
+    theReader.addParameter(CDataFrameAnalysisSpecification::FRAME_CACHE_KEY,
+                           CDataFrameAnalysisConfigReader::E_OptionalParameter);
     theReader.addParameter(CDataFrameAnalysisSpecification::ANALYSIS,
                            CDataFrameAnalysisConfigReader::E_RequiredParameter);
     return theReader;
@@ -139,6 +147,8 @@ CDataFrameAnalysisSpecification::CDataFrameAnalysisSpecification(
             core::CDataFrame::DEFAULT_MISSING_STRING);
         m_CategoricalFieldNames = parameters[CATEGORICAL_FIELD_NAMES].fallback(TStrVec{});
         m_DiskUsageAllowed = parameters[DISK_USAGE_ALLOWED].fallback(DEFAULT_DISK_USAGE_ALLOWED);
+        m_FrameCacheDirectory = parameters[FRAME_CACHE_DIRECTORY].fallback(std::string{});
+        m_FrameCacheKey = parameters[FRAME_CACHE_KEY].fallback(std::string{});
 
         double missing;
         if (m_MissingFieldValue != core::CDataFrame::DEFAULT_MISSING_STRING &&
@@ -150,6 +160,10 @@ CDataFrameAnalysisSpecification::CDataFrameAnalysisSpecification(
             HANDLE_FATAL(<< "Input error: temporary directory path should be explicitly set if disk"
                             " usage is allowed! Please report this problem.");
         }
+        if (m_FrameCacheKey.empty() != m_FrameCacheDirectory.empty()) {
+            HANDLE_FATAL(<< "Input error: '" << FRAME_CACHE_DIRECTORY << "' and '"
+                         << FRAME_CACHE_KEY << "' must both be set to cache the data frame.");
+        }
 
         auto jsonAnalysis = parameters[ANALYSIS].jsonObject();
         if (jsonAnalysis != nullptr) {
@@ -191,6 +205,18 @@ bool CDataFrameAnalysisSpecification::diskUsageAllowed() const {
     return m_DiskUsageAllowed;
 }
 
+const std::string& CDataFrameAnalysisSpecification::missingFieldValue() const {
+    return m_MissingFieldValue;
+}
+
+const std::string& CDataFrameAnalysisSpecification::frameCacheDirectory() const {
+    return m_FrameCacheDirectory;
+}
+
+const std::string& CDataFrameAnalysisSpecification::frameCacheKey() const {
+    return m_FrameCacheKey;
+}
+
 CDataFrameAnalysisSpecification::TDataFrameUPtrTemporaryDirectoryPtrPr
 CDataFrameAnalysisSpecification::makeDataFrame() {
     if (m_Runner == nullptr) {
@@ -225,7 +251,7 @@ bool CDataFrameAnalysisSpecification::validate(const core::CDataFrame& frame) co
     // budgeted for.
     if (frame.numberColumns() > this->numberColumns()) {
         HANDLE_FATAL(<< "Input error: expected '" << this->numberColumns()
-                     << "' columns but got '" << frame.numberRows() << "' columns"
+                     << "' columns but got '" << frame.numberColumns() << "' columns"
                      << ". Please report this problem.");
         return false;
     }
@@ -5,18 +5,23 @@
  */
 #include <api/CDataFrameAnalyzer.h>
 
+#include <core/CAllocationTracker.h>
 #include <core/CContainerPrinter.h>
 #include <core/CDataFrame.h>
+#include <core/CDataFrameCache.h>
 #include <core/CFloatStorage.h>
+#include <core/CHashing.h>
 #include <core/CJsonOutputStreamWrapper.h>
 #include <core/CLogger.h>
 #include <core/CStopWatch.h>
+#include <core/CStringUtils.h>
 
 #include <maths/CBasicStatistics.h>
 
 #include <api/CDataFrameAnalysisInstrumentation.h>
 #include <api/CDataFrameAnalysisSpecification.h>
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <string>
@@ -61,6 +66,8 @@ bool CDataFrameAnalyzer::usingControlMessages() const {
 
 bool CDataFrameAnalyzer::handleRecord(const TStrVec& fieldNames, const TStrVec& fieldValues) {
 
+    core::CAllocationTracker::CScopedTag allocationTag{core::CAllocationTracker::E_DataFrame};
+
     // Control messages are signified by a dot in the field name. This supports:
     //   - using the last field for a control message,
     //   - missing.
@@ -88,21 +95,42 @@ bool CDataFrameAnalyzer::handleRecord(const TStrVec& fieldNames, const TStrVec&
         return false;
     }
 
+    // We capture the field names before handling control messages because we
+    // may restore the data frame from the cache and receive no rows.
+    this->captureFieldNames(fieldNames);
+
     if (this->isControlMessage(fieldValues)) {
         return this->handleControlMessage(fieldValues);
     }
 
-    this->captureFieldNames(fieldNames);
     this->addRowToDataFrame(fieldValues);
 
     return true;
 }
 
 void CDataFrameAnalyzer::receivedAllRows() {
-    if (m_DataFrame != nullptr) {
-        m_DataFrame->finishWritingRows();
-        LOG_DEBUG(<< "Received " << m_DataFrame->numberRows() << " rows");
+    if (m_DataFrame == nullptr) {
+        return;
+    }
+    if (m_RestoredDataFrameFromCache) {
+        // The caller can either supply no rows or exactly the cached rows.
+        if (m_NumberRowsReceived == 0 || m_NumberRowsReceived == m_RowHashes.size()) {
+            m_RowHashes = TUInt64Vec{};
+            LOG_DEBUG(<< "Restored " << m_DataFrame->numberRows() << " rows from cache");
+            return;
+        }
+        LOG_INFO(<< "Received " << m_NumberRowsReceived << " rows but the cached data frame '"
+                 << m_DataFrameCache->fileName() << "' has " << m_RowHashes.size()
+                 << " rows: rebuilding it");
+        this->restoreMatchedRowsFromCache();
     }
+    m_DataFrame->finishWritingRows();
+    LOG_DEBUG(<< "Received " << m_DataFrame->numberRows() << " rows");
+    // This must happen before the analysis adds its columns to the data frame.
+    if (m_DataFrameCache != nullptr && m_DataFrame->numberRows() > 0) {
+        m_DataFrameCache->write(*m_DataFrame, m_RowHashes);
+    }
+    m_RowHashes = TUInt64Vec{};
 }
 
 void CDataFrameAnalyzer::run() {
@@ -111,6 +139,20 @@ void CDataFrameAnalyzer::run() {
         return;
     }
 
+    if (m_AnalysisSpecification->runner() != nullptr &&
+        m_AnalysisSpecification->runner()->numberRowsPerBatch() > 0) {
+        // The full batches have already been analysed as they were received so
+        // we only need to handle the remaining rows and close the results array.
+        if (m_NumberRowsInBatch > 0) {
+            this->runBatch();
+        }
+        if (m_ResultsStream == nullptr) {
+            m_ResultsStream = m_ResultsStreamSupplier();
+        }
+        m_ResultsStream.reset();
+        return;
+    }
+
     if (m_AnalysisSpecification->validate(*m_DataFrame) == false) {
         return;
     }
@@ -255,6 +297,92 @@ void CDataFrameAnalyzer::captureFieldNames(const TStrVec& fieldNames) {
         m_DataFrame->columnNames(columnNames);
         m_DataFrame->categoricalColumns(m_AnalysisSpecification->categoricalFieldNames());
         m_CapturedFieldNames = true;
+        this->createDataFrameCache(columnNames);
+        if (m_DataFrameCache != nullptr) {
+            this->restoreDataFrameFromCache();
+        }
+    }
+}
+
+void CDataFrameAnalyzer::createDataFrameCache(const TStrVec& columnNames) {
+    // Batched analyses never hold the full data frame so can't cache it.
+    if (m_AnalysisSpecification->frameCacheKey().empty() ||
+        m_AnalysisSpecification->runner()->numberRowsPerBatch() > 0) {
+        return;
+    }
+
+    // The entry must only be shared by analyses which parse the same input in
+    // the same way so the key includes everything which affects parsing. The
+    // analysis parameters don't so different analyses share the entry.
+    std::string key;
+    auto append = [&key](const std::string& value) {
+        key += value;
+        key += '\0';
+    };
+    append(m_AnalysisSpecification->frameCacheKey());
+    append(core::CStringUtils::typeToString(m_AnalysisSpecification->numberColumns()));
+    append(m_AnalysisSpecification->missingFieldValue());
+    append(core::CStringUtils::typeToString(m_DocHashFieldIndex != FIELD_MISSING));
+    for (const auto& name : columnNames) {
+        append(name);
+    }
+    TStrVec categoricalFieldNames{m_AnalysisSpecification->categoricalFieldNames()};
+    std::sort(categoricalFieldNames.begin(), categoricalFieldNames.end());
+    for (const auto& name : categoricalFieldNames) {
+        append(name);
+    }
+
+    m_DataFrameCache = std::make_unique<core::CDataFrameCache>(
+        m_AnalysisSpecification->frameCacheDirectory(), key);
+}
+
+void CDataFrameAnalyzer::restoreDataFrameFromCache() {
+    if (m_DataFrameCache->exists() == false) {
+        return;
+    }
+    if (m_DataFrameCache->read(*m_DataFrame, m_RowHashes) == false) {
+        LOG_INFO(<< "Failed to restore data frame from '"
+                 << m_DataFrameCache->fileName() << "': parsing rows");
+        m_DataFrame->clearRows();
+        m_RowHashes.clear();
+        return;
+    }
+    m_RestoredDataFrameFromCache = true;
+}
+
+std::uint64_t CDataFrameAnalyzer::rowHash(const TStrVec& fieldValues) const {
+    // This covers the values from which the row is parsed.
+    std::uint64_t result{0};
+    auto hash = [&](const std::string& value) {
+        result = core::CHashing::safeMurmurHash64(
+            value.data(), static_cast<int>(value.size()), result);
+    };
+    for (std::ptrdiff_t i = m_BeginDataFieldValues; i < m_EndDataFieldValues; ++i) {
+        hash(fieldValues[i]);
+    }
+    if (m_DocHashFieldIndex != FIELD_MISSING) {
+        hash(fieldValues[m_DocHashFieldIndex]);
+    }
+    return result;
+}
+
+bool CDataFrameAnalyzer::rowMatchesCache(std::uint64_t hash) const {
+    return m_NumberRowsReceived < m_RowHashes.size() &&
+           m_RowHashes[m_NumberRowsReceived] == hash;
+}
+
+void CDataFrameAnalyzer::restoreMatchedRowsFromCache() {
+    // The input has changed since the data frame was cached. Rather than
+    // parse all the rows again we restore those we've received which match
+    // the cache and parse the rest. The cache is rewritten when all the rows
+    // have been received.
+    m_RestoredDataFrameFromCache = false;
+    m_DataFrame->clearRows();
+    m_RowHashes.clear();
+    if (m_NumberRowsReceived > 0 &&
+        m_DataFrameCache->read(*m_DataFrame, m_RowHashes, m_NumberRowsReceived) == false) {
+        HANDLE_FATAL(<< "Internal error: failed to restore the first " << m_NumberRowsReceived
+                     << " rows from '" << m_DataFrameCache->fileName() << "'.");
     }
 }
 
@@ -262,11 +390,68 @@ void CDataFrameAnalyzer::addRowToDataFrame(const TStrVec& fieldValues) {
     if (m_DataFrame == nullptr) {
         return;
     }
+    std::uint64_t hash{m_DataFrameCache != nullptr ? this->rowHash(fieldValues) : 0};
+    if (m_RestoredDataFrameFromCache) {
+        if (this->rowMatchesCache(hash)) {
+            // The rows only need to be checked against the cached rows.
+            ++m_NumberRowsReceived;
+            return;
+        }
+        LOG_INFO(<< "Row " << m_NumberRowsReceived << " doesn't match the cached data frame '"
+                 << m_DataFrameCache->fileName() << "': rebuilding it");
+        this->restoreMatchedRowsFromCache();
+    }
+    ++m_NumberRowsReceived;
+    if (m_DataFrameCache != nullptr) {
+        m_RowHashes.push_back(hash);
+    }
     auto columnValues = core::make_range(fieldValues, m_BeginDataFieldValues,
                                          m_EndDataFieldValues);
     m_DataFrame->parseAndWriteRow(columnValues, m_DocHashFieldIndex != FIELD_MISSING
                                                     ? &fieldValues[m_DocHashFieldIndex]
                                                     : nullptr);
+
+    auto analysisRunner = m_AnalysisSpecification->runner();
+    if (analysisRunner != nullptr && analysisRunner->numberRowsPerBatch() > 0 &&
+        ++m_NumberRowsInBatch == analysisRunner->numberRowsPerBatch()) {
+        this->runBatch();
+    }
+}
+
+void CDataFrameAnalyzer::runBatch() {
+
+    m_DataFrame->finishWritingRows();
+    m_NumberRowsInBatch = 0;
+    LOG_TRACE(<< "Running analysis on batch of " << m_DataFrame->numberRows() << " rows...");
+
+    // The analysis adds its columns to the data frame when it runs the first
+    // batch, which creates the results stream, and these are reused for later
+    // batches. So only the first batch has just the input columns to validate.
+    if (m_ResultsStream != nullptr || m_AnalysisSpecification->validate(*m_DataFrame)) {
+        auto analysisRunner = m_AnalysisSpecification->runner();
+
+        // All batches write to the same stream so the results are all wrapped
+        // in a single array.
+        if (m_ResultsStream == nullptr) {
+            m_ResultsStream = m_ResultsStreamSupplier();
+        }
+
+        auto& instrumentation = analysisRunner->instrumentation();
+        CDataFrameAnalysisInstrumentation::CScopeSetOutputStream setStream{
+            instrumentation, *m_ResultsStream};
+
+        analysisRunner->run(*m_DataFrame);
+
+        core::CRapidJsonConcurrentLineWriter outputWriter{*m_ResultsStream};
+
+        CDataFrameAnalysisInstrumentation::monitor(instrumentation, outputWriter);
+
+        analysisRunner->waitToFinish();
+        this->writeResultsOf(*analysisRunner, outputWriter);
+    }
+
+    // We don't need the rows once their results have been written.
+    m_DataFrame->clearRows();
 }
 
 void CDataFrameAnalyzer::writeInferenceModel(const CDataFrameAnalysisRunner& analysis,
@@ -43,6 +43,8 @@ const CDataFrameAnalysisConfigReader& parameterReader() {
                                CDataFrameAnalysisConfigReader::E_OptionalParameter);
         theReader.addParameter(CDataFrameOutliersRunner::FEATURE_INFLUENCE_THRESHOLD,
                                CDataFrameAnalysisConfigReader::E_OptionalParameter);
+        theReader.addParameter(CDataFrameOutliersRunner::FEATURE_INFLUENCE_QUANTILE,
+                               CDataFrameAnalysisConfigReader::E_OptionalParameter);
         theReader.addParameter(CDataFrameOutliersRunner::OUTLIER_FRACTION,
                                CDataFrameAnalysisConfigReader::E_OptionalParameter);
         return theReader;
@@ -66,8 +68,14 @@ CDataFrameOutliersRunner::CDataFrameOutliersRunner(const CDataFrameAnalysisSpeci
     m_Method = parameters[METHOD].fallback(maths::COutliers::E_Ensemble);
     m_ComputeFeatureInfluence = parameters[COMPUTE_FEATURE_INFLUENCE].fallback(true);
     m_FeatureInfluenceThreshold = parameters[FEATURE_INFLUENCE_THRESHOLD].fallback(0.1);
+    m_FeatureInfluenceQuantile = parameters[FEATURE_INFLUENCE_QUANTILE].fallback(0.0);
     m_OutlierFraction = parameters[OUTLIER_FRACTION].fallback(0.05);
 
+    if (m_FeatureInfluenceQuantile < 0.0 || m_FeatureInfluenceQuantile >= 1.0) {
+        HANDLE_FATAL(<< "Input error: bad value " << m_FeatureInfluenceQuantile
+                     << " for '" << FEATURE_INFLUENCE_QUANTILE << "'. It must be in [0, 1).");
+    }
+
     m_Instrumentation.featureInfluenceThreshold(m_FeatureInfluenceThreshold);
 }
 
@@ -143,7 +151,8 @@ void CDataFrameOutliersRunner::runImpl(core::CDataFrame& frame) {
                                                 static_cast<maths::COutliers::EMethod>(m_Method),
                                                 m_NumberNeighbours,
                                                 m_ComputeFeatureInfluence,
-                                                m_OutlierFraction};
+                                                m_OutlierFraction,
+                                                m_FeatureInfluenceQuantile};
     maths::COutliers::compute(params, frame, m_Instrumentation);
 }
 
@@ -158,7 +167,8 @@ CDataFrameOutliersRunner::estimateBookkeepingMemoryUsage(std::size_t numberParti
                                                 static_cast<maths::COutliers::EMethod>(m_Method),
                                                 m_NumberNeighbours,
                                                 m_ComputeFeatureInfluence,
-                                                m_OutlierFraction};
+                                                m_OutlierFraction,
+                                                m_FeatureInfluenceQuantile};
     return maths::COutliers::estimateMemoryUsedByCompute(
         params, totalNumberRows, partitionNumberRows, numberColumns);
 }
@@ -168,6 +178,7 @@ const std::string CDataFrameOutliersRunner::N_NEIGHBORS{"n_neighbors"};
 const std::string CDataFrameOutliersRunner::METHOD{"method"};
 const std::string CDataFrameOutliersRunner::COMPUTE_FEATURE_INFLUENCE{"compute_feature_influence"};
 const std::string CDataFrameOutliersRunner::FEATURE_INFLUENCE_THRESHOLD{"feature_influence_threshold"};
+const std::string CDataFrameOutliersRunner::FEATURE_INFLUENCE_QUANTILE{"feature_influence_quantile"};
 const std::string CDataFrameOutliersRunner::OUTLIER_FRACTION{"outlier_fraction"};
 
 const std::string& CDataFrameOutliersRunnerFactory::name() const {
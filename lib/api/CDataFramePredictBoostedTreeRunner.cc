@@ -0,0 +1,450 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include <api/CDataFramePredictBoostedTreeRunner.h>
+
+#include <core/CContainerPrinter.h>
+#include <core/CDataFrame.h>
+#include <core/CLogger.h>
+#include <core/CMemory.h>
+#include <core/CRapidJsonConcurrentLineWriter.h>
+#include <core/CStateDecompressor.h>
+#include <core/CStringUtils.h>
+
+#include <maths/CBoostedTree.h>
+#include <maths/CBoostedTreeFactory.h>
+#include <maths/CBoostedTreeUtils.h>
+#include <maths/CDataFrameUtils.h>
+#include <maths/CTreeShapFeatureImportance.h>
+
+#include <api/CDataFrameAnalysisConfigReader.h>
+
+#include <rapidjson/document.h>
+
+#include <algorithm>
+
+namespace ml {
+namespace api {
+namespace {
+using TClassifierRunner = CDataFrameTrainBoostedTreeClassifierRunner;
+
+const std::size_t DEFAULT_NUMBER_ROWS_PER_BATCH{10000};
+}
+
+const CDataFrameAnalysisConfigReader& CDataFramePredictBoostedTreeRunner::parameterReader() {
+    static const CDataFrameAnalysisConfigReader PARAMETER_READER{[] {
+        CDataFrameAnalysisConfigReader theReader;
+        theReader.addParameter(DEPENDENT_VARIABLE_NAME,
+                               CDataFrameAnalysisConfigReader::E_RequiredParameter);
+        theReader.addParameter(PREDICTION_FIELD_NAME,
+                               CDataFrameAnalysisConfigReader::E_OptionalParameter);
+        theReader.addParameter(NUM_TOP_FEATURE_IMPORTANCE_VALUES,
+                               CDataFrameAnalysisConfigReader::E_OptionalParameter);
+        theReader.addParameter(TClassifierRunner::NUM_TOP_CLASSES,
+                               CDataFrameAnalysisConfigReader::E_OptionalParameter);
+        theReader.addParameter(
+            TClassifierRunner::PREDICTION_FIELD_TYPE,
+            CDataFrameAnalysisConfigReader::E_OptionalParameter,
+            {{"string", int{TClassifierRunner::E_PredictionFieldTypeString}},
+             {"int", int{TClassifierRunner::E_PredictionFieldTypeInt}},
+             {"bool", int{TClassifierRunner::E_PredictionFieldTypeBool}}});
+        theReader.addParameter(CATEGORICAL_FIELD_VALUES,
+                               CDataFrameAnalysisConfigReader::E_OptionalParameter);
+        theReader.addParameter(ROWS_PER_BATCH,
+                               CDataFrameAnalysisConfigReader::E_OptionalParameter);
+        return theReader;
+    }()};
+    return PARAMETER_READER;
+}
+
+CDataFramePredictBoostedTreeRunner::CDataFramePredictBoostedTreeRunner(
+    const CDataFrameAnalysisSpecification& spec,
+    const CDataFrameAnalysisParameters& parameters)
+    : CDataFrameAnalysisRunner{spec}, m_Instrumentation{spec.jobId(), spec.memoryLimit()} {
+
+    m_DependentVariableFieldName = parameters[DEPENDENT_VARIABLE_NAME].as<std::string>();
+    m_PredictionFieldName = parameters[PREDICTION_FIELD_NAME].fallback(
+        m_DependentVariableFieldName + "_prediction");
+    m_NumberTopShapValues =
+        parameters[NUM_TOP_FEATURE_IMPORTANCE_VALUES].fallback(std::size_t{0});
+    m_NumTopClasses =
+        parameters[TClassifierRunner::NUM_TOP_CLASSES].fallback(std::ptrdiff_t{0});
+    m_PredictionFieldType = parameters[TClassifierRunner::PREDICTION_FIELD_TYPE].fallback(
+        TClassifierRunner::E_PredictionFieldTypeString);
+    m_NumberRowsPerBatch = parameters[ROWS_PER_BATCH].fallback(DEFAULT_NUMBER_ROWS_PER_BATCH);
+
+    if (m_NumberRowsPerBatch == 0) {
+        HANDLE_FATAL(<< "Input error: '" << ROWS_PER_BATCH << "' should be positive.");
+    }
+
+    const rapidjson::Value* categoricalFieldValues{
+        parameters[CATEGORICAL_FIELD_VALUES].jsonObject()};
+    if (categoricalFieldValues != nullptr) {
+        if (categoricalFieldValues->IsObject() == false) {
+            HANDLE_FATAL(<< "Input error: '" << CATEGORICAL_FIELD_VALUES
+                         << "' should be an object mapping each categorical field"
+                         << " to its values in the order of their training ids.");
+            return;
+        }
+        for (const auto& field : categoricalFieldValues->GetObject()) {
+            TStrVec& values{m_CategoricalFieldValues[field.name.GetString()]};
+            if (field.value.IsArray() == false) {
+                HANDLE_FATAL(<< "Input error: expected an array of values for '"
+                             << field.name.GetString() << "' in '"
+                             << CATEGORICAL_FIELD_VALUES << "'.");
+                return;
+            }
+            values.reserve(field.value.Size());
+            for (const auto& value : field.value.GetArray()) {
+                if (value.IsString() == false) {
+                    HANDLE_FATAL(<< "Input error: expected string values for '"
+                                 << field.name.GetString() << "' in '"
+                                 << CATEGORICAL_FIELD_VALUES << "'.");
+                    return;
+                }
+                values.emplace_back(value.GetString());
+            }
+        }
+    }
+}
+
+CDataFramePredictBoostedTreeRunner::~CDataFramePredictBoostedTreeRunner() = default;
+
+std::size_t CDataFramePredictBoostedTreeRunner::numberExtraColumns() const {
+    return 0;
+}
+
+std::size_t CDataFramePredictBoostedTreeRunner::dataFrameSliceCapacity() const {
+    std::size_t sliceCapacity{core::dataFrameDefaultSliceCapacity(this->spec().numberColumns())};
+    std::size_t numberThreads{this->spec().numberThreads()};
+    if (numberThreads > 1) {
+        // Use at least one slice per thread because we parallelize work over slices.
+        sliceCapacity = std::min(sliceCapacity, (m_NumberRowsPerBatch + numberThreads - 1) /
+                                                    numberThreads);
+    }
+    return std::max(sliceCapacity, std::size_t{128});
+}
+
+std::size_t CDataFramePredictBoostedTreeRunner::numberRowsPerBatch() const {
+    return m_NumberRowsPerBatch;
+}
+
+bool CDataFramePredictBoostedTreeRunner::validate(const core::CDataFrame& frame) const {
+    if (frame.numberColumns() <= 1) {
+        HANDLE_FATAL(<< "Input error: analysis need at least one regressor.");
+        return false;
+    }
+    return true;
+}
+
+void CDataFramePredictBoostedTreeRunner::writeOneRow(const core::CDataFrame&,
+                                                     const TRowRef& row,
+                                                     core::CRapidJsonConcurrentLineWriter& writer) const {
+
+    if (m_BoostedTree == nullptr) {
+        HANDLE_FATAL(<< "Internal error: boosted tree missing. Please report this problem.");
+        return;
+    }
+
+    writer.StartObject();
+    if (m_ClassValues.empty()) {
+        writer.Key(m_PredictionFieldName);
+        writer.Double(m_BoostedTree->readPrediction(row)[0]);
+    } else {
+        auto probabilities = m_BoostedTree->readPrediction(row);
+        auto scores = m_BoostedTree->readAndAdjustPrediction(row);
+        TClassifierRunner::writePredictedClass(m_PredictionFieldName, m_PredictionFieldType,
+                                               m_ClassValues, probabilities, scores, writer);
+        if (m_NumTopClasses != 0) {
+            TClassifierRunner::writeTopClasses(m_NumTopClasses, m_PredictionFieldType,
+                                               m_ClassValues, probabilities, scores, writer);
+        }
+    }
+
+    auto featureImportance = m_BoostedTree->shap();
+    if (featureImportance != nullptr) {
+        featureImportance->shap(
+            row, [&writer, this](const maths::CTreeShapFeatureImportance::TSizeVec& indices,
+                                 const TStrVec& featureNames,
+                                 const maths::CTreeShapFeatureImportance::TVectorVec& shap) {
+                writer.Key(FEATURE_IMPORTANCE_FIELD_NAME);
+                writer.StartArray();
+                for (auto i : indices) {
+                    if (shap[i].norm() != 0.0) {
+                        writer.StartObject();
+                        writer.Key(FEATURE_NAME_FIELD_NAME);
+                        writer.String(featureNames[i]);
+                        if (m_ClassValues.empty()) {
+                            writer.Key(IMPORTANCE_FIELD_NAME);
+                            writer.Double(shap[i](0));
+                        } else {
+                            // For binary classification we have the importance
+                            // for the second class which is minus the importance
+                            // for the first.
+                            std::size_t numberClasses{
+                                shap[i].size() == 1
+                                    ? m_ClassValues.size()
+                                    : std::min(m_ClassValues.size(),
+                                               static_cast<std::size_t>(shap[i].size()))};
+                            writer.Key(CLASSES_FIELD_NAME);
+                            writer.StartArray();
+                            for (std::size_t j = 0; j < numberClasses; ++j) {
+                                writer.StartObject();
+                                writer.Key(CLASS_NAME_FIELD_NAME);
+                                TClassifierRunner::writePredictedCategoryValue(
+                                    m_PredictionFieldType, m_ClassValues[j], writer);
+                                writer.Key(IMPORTANCE_FIELD_NAME);
+                                if (shap[i].size() == 1) {
+                                    writer.Double(j == 1 ? shap[i](0) : -shap[i](0));
+                                } else {
+                                    writer.Double(shap[i](static_cast<int>(j)));
+                                }
+                                writer.EndObject();
+                            }
+                            writer.EndArray();
+                        }
+                        writer.EndObject();
+                    }
+                }
+                writer.EndArray();
+            });
+    }
+    writer.EndObject();
+}
+
+const CDataFrameAnalysisInstrumentation&
+CDataFramePredictBoostedTreeRunner::instrumentation() const {
+    return m_Instrumentation;
+}
+
+CDataFrameAnalysisInstrumentation& CDataFramePredictBoostedTreeRunner::instrumentation() {
+    return m_Instrumentation;
+}
+
+void CDataFramePredictBoostedTreeRunner::runImpl(core::CDataFrame& frame) {
+
+    // The model is restored for the first batch and the data frame is reused
+    // for subsequent batches so it is already sized for the predictions.
+
+    if (m_BoostedTree == nullptr) {
+        auto dependentVariablePos = std::find(frame.columnNames().begin(),
+                                              frame.columnNames().end(),
+                                              m_DependentVariableFieldName);
+        if (dependentVariablePos == frame.columnNames().end()) {
+            HANDLE_FATAL(<< "Input error: supplied variable to predict '"
+                         << m_DependentVariableFieldName << "' is missing from "
+                         << core::CContainerPrinter::print(frame.columnNames()));
+            return;
+        }
+        std::size_t dependentVariableColumn(dependentVariablePos -
+                                            frame.columnNames().begin());
+
+        m_TrainingCategoryIds.resize(frame.numberColumns());
+        for (std::size_t i = 0; i < frame.numberColumns(); ++i) {
+            if (frame.columnIsCategorical()[i] == false) {
+                continue;
+            }
+            auto values = m_CategoricalFieldValues.find(frame.columnNames()[i]);
+            if (values == m_CategoricalFieldValues.end()) {
+                if (i != dependentVariableColumn) {
+                    HANDLE_FATAL(<< "Input error: missing training values for categorical field '"
+                                 << frame.columnNames()[i] << "' in '"
+                                 << CATEGORICAL_FIELD_VALUES << "'.");
+                    return;
+                }
+                continue;
+            }
+            for (std::size_t id = 0; id < values->second.size(); ++id) {
+                m_TrainingCategoryIds[i].emplace(values->second[id], id);
+            }
+            if (i == dependentVariableColumn) {
+                m_ClassValues = values->second;
+            }
+        }
+
+        // The category encoding is used to restore the SHAP calculator so the
+        // categories must be mapped first.
+        this->mapCategoriesToTrainingIds(frame);
+
+        auto restoreSearcher = this->spec().restoreSearcher();
+        if (restoreSearcher == nullptr ||
+            this->restoreBoostedTree(frame, dependentVariableColumn, restoreSearcher) == false) {
+            HANDLE_FATAL(<< "Input error: failed to restore the trained model.");
+            return;
+        }
+
+        if (frame.columnIsCategorical()[dependentVariableColumn]) {
+            // We fall back to using the class identifiers as their names if the
+            // training values weren't supplied.
+            std::size_t numberLossParameters(
+                m_BoostedTree->trainedModel()[0][0].value().size());
+            std::size_t numberClasses{numberLossParameters == 1 ? 2 : numberLossParameters};
+            for (std::size_t id = m_ClassValues.size(); id < numberClasses; ++id) {
+                m_ClassValues.push_back(core::CStringUtils::typeToString(id));
+            }
+        }
+    } else {
+        this->mapCategoriesToTrainingIds(frame);
+    }
+
+    m_BoostedTree->predict();
+}
+
+bool CDataFramePredictBoostedTreeRunner::restoreBoostedTree(core::CDataFrame& frame,
+                                                            std::size_t dependentVariableColumn,
+                                                            TDataSearcherUPtr& restoreSearcher) {
+    // Restore from compressed JSON.
+    try {
+        core::CStateDecompressor decompressor(*restoreSearcher);
+        core::CDataSearcher::TIStreamP inputStream{decompressor.search(1, 1)}; // search arguments are ignored
+        if (inputStream == nullptr) {
+            LOG_ERROR(<< "Unable to connect to data store");
+            return false;
+        }
+
+        if (inputStream->bad()) {
+            LOG_ERROR(<< "State restoration search returned bad stream");
+            return false;
+        }
+
+        if (inputStream->fail()) {
+            LOG_ERROR(<< "State restoration search returned failed stream");
+            return false;
+        }
+        m_BoostedTree = maths::CBoostedTreeFactory::constructFromString(*inputStream)
+                            .analysisInstrumentation(m_Instrumentation)
+                            .numberTopShapValues(m_NumberTopShapValues)
+                            .restoreForPrediction(frame, dependentVariableColumn);
+    } catch (std::exception& e) {
+        LOG_ERROR(<< "Failed to restore state! " << e.what());
+        return false;
+    }
+    return m_BoostedTree != nullptr;
+}
+
+void CDataFramePredictBoostedTreeRunner::mapCategoriesToTrainingIds(core::CDataFrame& frame) const {
+
+    using TDoubleVec = std::vector<double>;
+    using TDoubleVecVec = std::vector<TDoubleVec>;
+    using TRowItr = core::CDataFrame::TRowItr;
+
+    // Categories not seen in training are given an id the encoder will never
+    // have seen.
+    const double unseen{static_cast<double>(core::CDataFrame::MAX_CATEGORICAL_CARDINALITY)};
+
+    TSizeVec categoricalColumns;
+    TDoubleVecVec trainingIds(frame.numberColumns());
+    for (std::size_t i = 0; i < m_TrainingCategoryIds.size(); ++i) {
+        if (m_TrainingCategoryIds[i].empty()) {
+            continue;
+        }
+        const TStrVec& values{frame.categoricalColumnValues()[i]};
+        trainingIds[i].resize(values.size(), unseen);
+        for (std::size_t id = 0; id < values.size(); ++id) {
+            auto trainingId = m_TrainingCategoryIds[i].find(values[id]);
+            if (trainingId != m_TrainingCategoryIds[i].end()) {
+                trainingIds[i][id] = static_cast<double>(trainingId->second);
+            }
+        }
+        categoricalColumns.push_back(i);
+    }
+
+    if (categoricalColumns.empty()) {
+        return;
+    }
+
+    frame.writeColumns(this->spec().numberThreads(), [&](TRowItr beginRows, TRowItr endRows) {
+        for (auto row = beginRows; row != endRows; ++row) {
+            for (auto i : categoricalColumns) {
+                double id{(*row)[i]};
+                if (maths::CDataFrameUtils::isMissing(id) == false) {
+                    auto index = static_cast<std::size_t>(id);
+                    row->writeColumn(i, index < trainingIds[i].size()
+                                            ? trainingIds[i][index]
+                                            : unseen);
+                }
+            }
+        }
+    });
+}
+
+std::size_t CDataFramePredictBoostedTreeRunner::numberLossParameters() const {
+    const TStrVec& categoricalFieldNames{this->spec().categoricalFieldNames()};
+    if (std::find(categoricalFieldNames.begin(), categoricalFieldNames.end(),
+                  m_DependentVariableFieldName) == categoricalFieldNames.end()) {
+        return 1;
+    }
+    auto classValues = m_CategoricalFieldValues.find(m_DependentVariableFieldName);
+    std::size_t numberClasses{classValues != m_CategoricalFieldValues.end()
+                                  ? classValues->second.size()
+                                  : TClassifierRunner::MAX_NUMBER_CLASSES};
+    return numberClasses == 2 ? 1 : numberClasses;
+}
+
+std::size_t CDataFramePredictBoostedTreeRunner::estimateBookkeepingMemoryUsage(
+    std::size_t /*numberPartitions*/,
+    std::size_t totalNumberRows,
+    std::size_t /*partitionNumberRows*/,
+    std::size_t numberColumns) const {
+
+    // The model size isn't known until its state is restored. This accounts for
+    // the columns the model adds to each batch of rows, the maps from category
+    // values to their training identifiers and the SHAP values of each row being
+    // written.
+
+    std::size_t numberRows{std::min(totalNumberRows, m_NumberRowsPerBatch)};
+    std::size_t numberLossParameters{this->numberLossParameters()};
+    std::size_t numberExtraColumns{0};
+    for (const auto& columns : maths::boosted_tree_detail::extraColumns(
+             numberLossParameters, false /*worst case*/)) {
+        numberExtraColumns += columns.first;
+    }
+    std::size_t extraColumnsMemoryUsage{numberRows * numberExtraColumns *
+                                        sizeof(maths::CFloatStorage)};
+    std::size_t categoryIdsMemoryUsage{2 * core::CMemory::dynamicSize(m_CategoricalFieldValues)};
+    std::size_t shapMemoryUsage{
+        m_NumberTopShapValues > 0
+            ? this->spec().numberThreads() * numberColumns * numberLossParameters * sizeof(double)
+            : 0};
+    return extraColumnsMemoryUsage + categoryIdsMemoryUsage + shapMemoryUsage;
+}
+
+// clang-format off
+const std::string CDataFramePredictBoostedTreeRunner::DEPENDENT_VARIABLE_NAME{"dependent_variable"};
+const std::string CDataFramePredictBoostedTreeRunner::PREDICTION_FIELD_NAME{"prediction_field_name"};
+const std::string CDataFramePredictBoostedTreeRunner::NUM_TOP_FEATURE_IMPORTANCE_VALUES{"num_top_feature_importance_values"};
+const std::string CDataFramePredictBoostedTreeRunner::CATEGORICAL_FIELD_VALUES{"categorical_field_values"};
+const std::string CDataFramePredictBoostedTreeRunner::ROWS_PER_BATCH{"rows_per_batch"};
+const std::string CDataFramePredictBoostedTreeRunner::FEATURE_NAME_FIELD_NAME{"feature_name"};
+const std::string CDataFramePredictBoostedTreeRunner::IMPORTANCE_FIELD_NAME{"importance"};
+const std::string CDataFramePredictBoostedTreeRunner::FEATURE_IMPORTANCE_FIELD_NAME{"feature_importance"};
+const std::string CDataFramePredictBoostedTreeRunner::CLASSES_FIELD_NAME{"classes"};
+const std::string CDataFramePredictBoostedTreeRunner::CLASS_NAME_FIELD_NAME{"class_name"};
+// clang-format on
+
+const std::string& CDataFramePredictBoostedTreeRunnerFactory::name() const {
+    return NAME;
+}
+
+CDataFramePredictBoostedTreeRunnerFactory::TRunnerUPtr
+CDataFramePredictBoostedTreeRunnerFactory::makeImpl(const CDataFrameAnalysisSpecification&) const {
+    HANDLE_FATAL(<< "Input error: boosted tree prediction has a non-optional parameter '"
+                 << CDataFramePredictBoostedTreeRunner::DEPENDENT_VARIABLE_NAME << "'.");
+    return nullptr;
+}
+
+CDataFramePredictBoostedTreeRunnerFactory::TRunnerUPtr
+CDataFramePredictBoostedTreeRunnerFactory::makeImpl(const CDataFrameAnalysisSpecification& spec,
+                                                    const rapidjson::Value& jsonParameters) const {
+    const CDataFrameAnalysisConfigReader& parameterReader{
+        CDataFramePredictBoostedTreeRunner::parameterReader()};
+    auto parameters = parameterReader.read(jsonParameters);
+    return std::make_unique<CDataFramePredictBoostedTreeRunner>(spec, parameters);
+}
+
+const std::string CDataFramePredictBoostedTreeRunnerFactory::NAME{"boosted_tree_prediction"};
+}
+}
@@ -74,6 +74,8 @@ CDataFrameTrainBoostedTreeClassifierRunner::parameterReader() {
              {CLASS_ASSIGNMENT_OBJECTIVE_VALUES[custom], custom}});
         theReader.addParameter(CLASSIFICATION_WEIGHTS,
                                CDataFrameAnalysisConfigReader::E_OptionalParameter);
+        theReader.addParameter(DIAGONAL_CURVATURE,
+                               CDataFrameAnalysisConfigReader::E_OptionalParameter);
         return theReader;
     }()};
     return PARAMETER_READER;
@@ -83,7 +85,7 @@ CDataFrameTrainBoostedTreeClassifierRunner::CDataFrameTrainBoostedTreeClassifier
     const CDataFrameAnalysisSpecification& spec,
     const CDataFrameAnalysisParameters& parameters)
     : CDataFrameTrainBoostedTreeRunner{
-          spec, parameters, loss(parameters[NUM_CLASSES].as<std::size_t>())} {
+          spec, parameters, loss(parameters)} {
 
     std::size_t numberClasses{parameters[NUM_CLASSES].as<std::size_t>()};
     auto classAssignmentObjective = parameters[CLASS_ASSIGNMENT_OBJECTIVE].fallback(
@@ -149,45 +151,17 @@ void CDataFrameTrainBoostedTreeClassifierRunner::writeOneRow(
     auto scores = readClassScores(row);
 
     double actualClassId{row[columnHoldingDependentVariable]};
-    std::size_t predictedClassId(std::max_element(scores.begin(), scores.end()) -
-                                 scores.begin());
 
     const TStrVec& classValues{frame.categoricalColumnValues()[columnHoldingDependentVariable]};
     writer.StartObject();
-    writer.Key(this->predictionFieldName());
-    writePredictedCategoryValue(classValues[predictedClassId], writer);
-    writer.Key(PREDICTION_PROBABILITY_FIELD_NAME);
-    writer.Double(probabilities[predictedClassId]);
-    writer.Key(PREDICTION_SCORE_FIELD_NAME);
-    writer.Double(scores[predictedClassId]);
+    writePredictedClass(this->predictionFieldName(), m_PredictionFieldType,
+                        classValues, probabilities, scores, writer);
     writer.Key(IS_TRAINING_FIELD_NAME);
     writer.Bool(maths::CDataFrameUtils::isMissing(actualClassId) == false);
 
     if (m_NumTopClasses != 0) {
-        TSizeVec classIds(scores.size());
-        std::iota(classIds.begin(), classIds.end(), 0);
-        std::sort(classIds.begin(), classIds.end(),
-                  [&scores](std::size_t lhs, std::size_t rhs) {
-                      return scores[lhs] > scores[rhs];
-                  });
-        // -1 is a special value meaning "output all the classes"
-        classIds.resize(m_NumTopClasses == -1
-                            ? classIds.size()
-                            : std::min(classIds.size(),
-                                       static_cast<std::size_t>(m_NumTopClasses)));
-        writer.Key(TOP_CLASSES_FIELD_NAME);
-        writer.StartArray();
-        for (std::size_t i : classIds) {
-            writer.StartObject();
-            writer.Key(CLASS_NAME_FIELD_NAME);
-            writePredictedCategoryValue(classValues[i], writer);
-            writer.Key(CLASS_PROBABILITY_FIELD_NAME);
-            writer.Double(probabilities[i]);
-            writer.Key(CLASS_SCORE_FIELD_NAME);
-            writer.Double(scores[i]);
-            writer.EndObject();
-        }
-        writer.EndArray();
+        writeTopClasses(m_NumTopClasses, m_PredictionFieldType, classValues,
+                        probabilities, scores, writer);
     }
 
     if (featureImportance != nullptr) {
@@ -197,7 +171,7 @@ void CDataFrameTrainBoostedTreeClassifierRunner::writeOneRow(
         m_InferenceModelMetadata.predictionFieldTypeResolverWriter(
             [this](const std::string& categoryValue,
                    core::CRapidJsonConcurrentLineWriter& writer_) {
-                this->writePredictedCategoryValue(categoryValue, writer_);
+                writePredictedCategoryValue(m_PredictionFieldType, categoryValue, writer_);
             });
         featureImportance->shap(
             row, [&](const maths::CTreeShapFeatureImportance::TSizeVec& indices,
@@ -217,7 +191,8 @@ void CDataFrameTrainBoostedTreeClassifierRunner::writeOneRow(
                             for (int j = 0; j < numberClasses; ++j) {
                                 writer.StartObject();
                                 writer.Key(CLASS_NAME_FIELD_NAME);
-                                writePredictedCategoryValue(classValues[j], writer);
+                                writePredictedCategoryValue(m_PredictionFieldType,
+                                                            classValues[j], writer);
                                 writer.Key(IMPORTANCE_FIELD_NAME);
                                 if (j == 1) {
                                     writer.Double(shap[i](0));
@@ -234,7 +209,8 @@ void CDataFrameTrainBoostedTreeClassifierRunner::writeOneRow(
                             for (int j = 0; j < shap[i].size() && j < numberClasses; ++j) {
                                 writer.StartObject();
                                 writer.Key(CLASS_NAME_FIELD_NAME);
-                                writePredictedCategoryValue(classValues[j], writer);
+                                writePredictedCategoryValue(m_PredictionFieldType,
+                                                            classValues[j], writer);
                                 writer.Key(IMPORTANCE_FIELD_NAME);
                                 writer.Double(shap[i](j));
                                 writer.EndObject();
@@ -257,12 +233,65 @@ void CDataFrameTrainBoostedTreeClassifierRunner::writeOneRow(
     writer.EndObject();
 }
 
+void CDataFrameTrainBoostedTreeClassifierRunner::writePredictedClass(
+    const std::string& predictionFieldName,
+    EPredictionFieldType predictionFieldType,
+    const TStrVec& classValues,
+    const TDouble2Vec& probabilities,
+    const TDouble2Vec& scores,
+    core::CRapidJsonConcurrentLineWriter& writer) {
+
+    std::size_t predictedClassId(std::max_element(scores.begin(), scores.end()) -
+                                 scores.begin());
+
+    writer.Key(predictionFieldName);
+    writePredictedCategoryValue(predictionFieldType, classValues[predictedClassId], writer);
+    writer.Key(PREDICTION_PROBABILITY_FIELD_NAME);
+    writer.Double(probabilities[predictedClassId]);
+    writer.Key(PREDICTION_SCORE_FIELD_NAME);
+    writer.Double(scores[predictedClassId]);
+}
+
+void CDataFrameTrainBoostedTreeClassifierRunner::writeTopClasses(
+    std::ptrdiff_t numberTopClasses,
+    EPredictionFieldType predictionFieldType,
+    const TStrVec& classValues,
+    const TDouble2Vec& probabilities,
+    const TDouble2Vec& scores,
+    core::CRapidJsonConcurrentLineWriter& writer) {
+
+    TSizeVec classIds(scores.size());
+    std::iota(classIds.begin(), classIds.end(), 0);
+    std::sort(classIds.begin(), classIds.end(), [&scores](std::size_t lhs, std::size_t rhs) {
+        return scores[lhs] > scores[rhs];
+    });
+    // -1 is a special value meaning "output all the classes"
+    classIds.resize(numberTopClasses == -1
+                        ? classIds.size()
+                        : std::min(classIds.size(),
+                                   static_cast<std::size_t>(numberTopClasses)));
+    writer.Key(TOP_CLASSES_FIELD_NAME);
+    writer.StartArray();
+    for (std::size_t i : classIds) {
+        writer.StartObject();
+        writer.Key(CLASS_NAME_FIELD_NAME);
+        writePredictedCategoryValue(predictionFieldType, classValues[i], writer);
+        writer.Key(CLASS_PROBABILITY_FIELD_NAME);
+        writer.Double(probabilities[i]);
+        writer.Key(CLASS_SCORE_FIELD_NAME);
+        writer.Double(scores[i]);
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
 void CDataFrameTrainBoostedTreeClassifierRunner::writePredictedCategoryValue(
+    EPredictionFieldType predictionFieldType,
     const std::string& categoryValue,
-    core::CRapidJsonConcurrentLineWriter& writer) const {
+    core::CRapidJsonConcurrentLineWriter& writer) {
 
     double doubleValue;
-    switch (m_PredictionFieldType) {
+    switch (predictionFieldType) {
     case E_PredictionFieldTypeString:
         writer.String(categoryValue);
         break;
@@ -284,11 +313,18 @@ void CDataFrameTrainBoostedTreeClassifierRunner::writePredictedCategoryValue(
 }
 
 CDataFrameTrainBoostedTreeClassifierRunner::TLossFunctionUPtr
-CDataFrameTrainBoostedTreeClassifierRunner::loss(std::size_t numberClasses) {
+CDataFrameTrainBoostedTreeClassifierRunner::loss(const CDataFrameAnalysisParameters& parameters) {
     using namespace maths::boosted_tree;
-    return numberClasses == 2
-               ? TLossFunctionUPtr{std::make_unique<CBinomialLogisticLoss>()}
-               : TLossFunctionUPtr{std::make_unique<CMultinomialLogisticLoss>(numberClasses)};
+    std::size_t numberClasses{parameters[NUM_CLASSES].as<std::size_t>()};
+    if (numberClasses == 2) {
+        return std::make_unique<CBinomialLogisticLoss>();
+    }
+    // The full Hessian needs n(n+1)/2 extra columns per row versus n for its
+    // diagonal. Unless the user chooses, we only approximate the curvature for
+    // many classes where the memory saving is significant.
+    bool diagonalCurvature{parameters[DIAGONAL_CURVATURE].fallback(
+        numberClasses >= MIN_NUMBER_CLASSES_FOR_DIAGONAL_CURVATURE)};
+    return std::make_unique<CMultinomialLogisticLoss>(numberClasses, diagonalCurvature);
 }
 
 void CDataFrameTrainBoostedTreeClassifierRunner::validate(const core::CDataFrame& frame,
@@ -335,6 +371,7 @@ CDataFrameTrainBoostedTreeClassifierRunner::inferenceModelMetadata() const {
 // The MAX_NUMBER_CLASSES must match the value used in the Java code. See the
 // MAX_DEPENDENT_VARIABLE_CARDINALITY in the x-pack classification code.
 const std::size_t CDataFrameTrainBoostedTreeClassifierRunner::MAX_NUMBER_CLASSES{30};
+const std::size_t CDataFrameTrainBoostedTreeClassifierRunner::MIN_NUMBER_CLASSES_FOR_DIAGONAL_CURVATURE{10};
 const std::string CDataFrameTrainBoostedTreeClassifierRunner::NUM_CLASSES{"num_classes"};
 const std::string CDataFrameTrainBoostedTreeClassifierRunner::NUM_TOP_CLASSES{"num_top_classes"};
 const std::string CDataFrameTrainBoostedTreeClassifierRunner::PREDICTION_FIELD_TYPE{"prediction_field_type"};
@@ -345,6 +382,7 @@ CDataFrameTrainBoostedTreeClassifierRunner::CLASS_ASSIGNMENT_OBJECTIVE_VALUES{
 const std::string CDataFrameTrainBoostedTreeClassifierRunner::CLASSIFICATION_WEIGHTS{"classification_weights"};
 const std::string CDataFrameTrainBoostedTreeClassifierRunner::CLASSIFICATION_WEIGHTS_CLASS{"class"};
 const std::string CDataFrameTrainBoostedTreeClassifierRunner::CLASSIFICATION_WEIGHTS_WEIGHT{"weight"};
+const std::string CDataFrameTrainBoostedTreeClassifierRunner::DIAGONAL_CURVATURE{"diagonal_curvature"};
 // clang-format on
 
 const std::string& CDataFrameTrainBoostedTreeClassifierRunnerFactory::name() const {
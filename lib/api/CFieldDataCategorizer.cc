@@ -5,6 +5,7 @@
  */
 #include <api/CFieldDataCategorizer.h>
 
+#include <core/CAllocationTracker.h>
 #include <core/CDataAdder.h>
 #include <core/CDataSearcher.h>
 #include <core/CJsonStatePersistInserter.h>
@@ -102,7 +103,11 @@ bool CFieldDataCategorizer::handleRecord(const TStrStrUMap& dataRowFields, TOpti
         time = this->parseTime(dataRowFields);
     }
 
-    CGlobalCategoryId globalCategoryId{this->computeAndUpdateCategory(dataRowFields, time)};
+    CGlobalCategoryId globalCategoryId;
+    {
+        core::CAllocationTracker::CScopedTag allocationTag{core::CAllocationTracker::E_Categorizer};
+        globalCategoryId = this->computeAndUpdateCategory(dataRowFields, time);
+    }
     if (globalCategoryId.isHardFailure() == false) {
         if (m_OutputFieldCategory != nullptr) {
             *m_OutputFieldCategory =
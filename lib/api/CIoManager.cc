@@ -6,6 +6,7 @@
 #include <api/CIoManager.h>
 
 #include <core/CBlockingCallCancellerThread.h>
+#include <core/CCapturingIStream.h>
 #include <core/CLogger.h>
 
 #include <atomic>
@@ -69,9 +70,11 @@ CIoManager::CIoManager(core::CBlockingCallCancellerThread& cancellerThread,
                        const std::string& restoreFileName,
                        bool isRestoreFileNamedPipe,
                        const std::string& persistFileName,
-                       bool isPersistFileNamedPipe)
+                       bool isPersistFileNamedPipe,
+                       const std::string& captureFileName)
     : m_CancellerThread{cancellerThread}, m_IoInitialised{false}, m_InputFileName{inputFileName},
       m_IsInputFileNamedPipe{isInputFileNamedPipe && !inputFileName.empty()},
+      m_CaptureFileName{captureFileName},
       m_OutputFileName{outputFileName}, m_IsOutputFileNamedPipe{isOutputFileNamedPipe &&
                                                                 !outputFileName.empty()},
       m_RestoreFileName{restoreFileName},
@@ -105,10 +108,19 @@ bool CIoManager::initIo() {
                                    m_CancellerThread, m_RestoreStream) &&
                       setUpOStream(m_PersistFileName, m_IsPersistFileNamedPipe,
                                    m_CancellerThread, m_PersistStream);
+    if (m_IoInitialised && m_CaptureFileName.empty() == false) {
+        LOG_INFO(<< "Capturing input to '" << m_CaptureFileName << "'");
+        m_CapturingInputStream = std::make_unique<core::CCapturingIStream>(
+            m_InputStream != nullptr ? *m_InputStream : std::cin, m_CaptureFileName);
+    }
     return m_IoInitialised;
 }
 
 std::istream& CIoManager::inputStream() {
+    if (m_CapturingInputStream != nullptr) {
+        return *m_CapturingInputStream;
+    }
+
     if (m_InputStream != nullptr) {
         return *m_InputStream;
     }
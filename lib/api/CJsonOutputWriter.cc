@@ -379,15 +379,18 @@ void CJsonOutputWriter::writeBucket(bool isInterim,
                 continue;
             }
 
-            m_Writer.addIntFieldToObj(DETECTOR_INDEX, detectorIndex, *docPtr);
-            m_Writer.addIntFieldToObj(BUCKET_SPAN, bucketData.s_BucketSpan, *docPtr);
-            m_Writer.addStringFieldCopyToObj(JOB_ID, m_JobId, *docPtr);
-            m_Writer.addTimeFieldToObj(TIMESTAMP, bucketTime, *docPtr);
-
+            m_Writer.StartObject();
+            m_Writer.writeMembers(*docPtr);
+            m_Writer.Key(DETECTOR_INDEX);
+            m_Writer.Int(detectorIndex);
+            m_Writer.Key(BUCKET_SPAN);
+            m_Writer.Int64(bucketData.s_BucketSpan);
+            this->writeJobIdAndTimestamp(bucketTime);
             if (isInterim) {
-                m_Writer.addBoolFieldToObj(IS_INTERIM, isInterim, *docPtr);
+                m_Writer.Key(IS_INTERIM);
+                m_Writer.Bool(isInterim);
             }
-            m_Writer.write(*docPtr);
+            m_Writer.EndObject();
         }
         m_Writer.EndArray();
         m_Writer.EndObject();
@@ -408,13 +411,16 @@ void CJsonOutputWriter::writeBucket(bool isInterim,
                 continue;
             }
 
-            m_Writer.addStringFieldCopyToObj(JOB_ID, m_JobId, *docPtr);
-            m_Writer.addTimeFieldToObj(TIMESTAMP, bucketTime, *docPtr);
+            m_Writer.StartObject();
+            m_Writer.writeMembers(*docPtr);
+            this->writeJobIdAndTimestamp(bucketTime);
             if (isInterim) {
-                m_Writer.addBoolFieldToObj(IS_INTERIM, isInterim, *docPtr);
+                m_Writer.Key(IS_INTERIM);
+                m_Writer.Bool(isInterim);
             }
-            m_Writer.addIntFieldToObj(BUCKET_SPAN, bucketData.s_BucketSpan, *docPtr);
-            m_Writer.write(*docPtr);
+            m_Writer.Key(BUCKET_SPAN);
+            m_Writer.Int64(bucketData.s_BucketSpan);
+            m_Writer.EndObject();
         }
         m_Writer.EndArray();
         m_Writer.EndObject();
@@ -458,13 +464,16 @@ void CJsonOutputWriter::writeBucket(bool isInterim,
                 continue;
             }
 
-            m_Writer.addStringFieldCopyToObj(JOB_ID, m_JobId, *docPtr);
-            m_Writer.addTimeFieldToObj(TIMESTAMP, bucketTime, *docPtr);
-            m_Writer.addIntFieldToObj(BUCKET_SPAN, bucketData.s_BucketSpan, *docPtr);
+            m_Writer.StartObject();
+            m_Writer.writeMembers(*docPtr);
+            this->writeJobIdAndTimestamp(bucketTime);
+            m_Writer.Key(BUCKET_SPAN);
+            m_Writer.Int64(bucketData.s_BucketSpan);
             if (isInterim) {
-                m_Writer.addBoolFieldToObj(IS_INTERIM, isInterim, *docPtr);
+                m_Writer.Key(IS_INTERIM);
+                m_Writer.Bool(isInterim);
             }
-            m_Writer.write(*docPtr);
+            m_Writer.EndObject();
         }
         m_Writer.EndArray();
     }
@@ -485,6 +494,16 @@ void CJsonOutputWriter::writeBucket(bool isInterim,
     m_Writer.EndObject();
 }
 
+void CJsonOutputWriter::writeJobIdAndTimestamp(core_t::TTime bucketTime) {
+    // Empty job IDs are omitted, as they are for fields added to documents.
+    if (m_JobId.empty() == false) {
+        m_Writer.Key(JOB_ID);
+        m_Writer.String(m_JobId);
+    }
+    m_Writer.Key(TIMESTAMP);
+    m_Writer.Time(bucketTime);
+}
+
 void CJsonOutputWriter::addMetricFields(const CHierarchicalResultsWriter::TResults& results,
                                         TDocumentWeakPtr weakDoc) {
     TDocumentPtr docPtr = weakDoc.lock();
@@ -6,6 +6,7 @@
 
 #include <api/CModelSizeStatsJsonWriter.h>
 
+#include <core/CAllocationTracker.h>
 #include <core/CTimeUtils.h>
 
 #include <model/SCategorizerStats.h>
@@ -27,6 +28,7 @@ const std::string TOTAL_PARTITION_FIELD_COUNT{"total_partition_field_count"};
 const std::string BUCKET_ALLOCATION_FAILURES_COUNT{"bucket_allocation_failures_count"};
 const std::string MEMORY_STATUS{"memory_status"};
 const std::string ASSIGNMENT_MEMORY_BASIS{"assignment_memory_basis"};
+const std::string ALLOCATED_BYTES{"allocated_bytes"};
 const std::string CATEGORIZED_DOC_COUNT{"categorized_doc_count"};
 const std::string TOTAL_CATEGORY_COUNT{"total_category_count"};
 const std::string FREQUENT_CATEGORY_COUNT{"frequent_category_count"};
@@ -79,6 +81,17 @@ void CModelSizeStatsJsonWriter::write(const std::string& jobId,
         writer.String(model_t::print(results.s_AssignmentMemoryBasis));
     }
 
+    if (core::CAllocationTracker::enabled()) {
+        writer.Key(ALLOCATED_BYTES);
+        writer.StartObject();
+        for (std::size_t i = 0; i < results.s_AllocatedBytes.size(); ++i) {
+            writer.Key(core::CAllocationTracker::print(
+                static_cast<core::CAllocationTracker::ETag>(i)));
+            writer.Uint64(results.s_AllocatedBytes[i]);
+        }
+        writer.EndObject();
+    }
+
     CModelSizeStatsJsonWriter::writeCommonFields(
         jobId, results.s_OverallCategorizerStats, results.s_BucketStartTime, writer);
 
@@ -18,9 +18,11 @@
 #include <test/BoostTestCloseAbsolute.h>
 #include <test/CDataFrameAnalysisSpecificationFactory.h>
 #include <test/CRandomNumbers.h>
+#include <test/CTestTmpDir.h>
 
 #include <rapidjson/prettywriter.h>
 
+#include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
 #include <memory>
@@ -38,6 +40,7 @@ using namespace ml;
 
 namespace {
 using TStrVec = std::vector<std::string>;
+using TStrVecVec = std::vector<TStrVec>;
 using TRowItr = core::CDataFrame::TRowItr;
 
 void addOutlierTestData(TStrVec fieldNames,
@@ -105,6 +108,60 @@ void addOutlierTestData(TStrVec fieldNames,
         }
     });
 }
+
+TStrVecVec makeOutlierTestRows(std::size_t numberRows) {
+    test::CRandomNumbers rng;
+    TDoubleVec values;
+    rng.generateNormalSamples(0.0, 4.0, 5 * numberRows, values);
+    TStrVecVec rows(numberRows, TStrVec(7));
+    for (std::size_t i = 0; i < numberRows; ++i) {
+        for (std::size_t j = 0; j < 5; ++j) {
+            rows[i][j] = core::CStringUtils::typeToStringPrecise(
+                values[5 * i + j], core::CIEEE754::E_DoublePrecision);
+        }
+        rows[i][5] = core::CStringUtils::typeToString(i + 1);
+    }
+    return rows;
+}
+
+TDoubleVec runOutlierDetection(const TStrVecVec& rows, const std::string& frameCacheDirectory) {
+
+    std::stringstream output;
+    auto outputWriterFactory = [&output]() {
+        return std::make_unique<core::CJsonOutputStreamWrapper>(output);
+    };
+
+    test::CDataFrameAnalysisSpecificationFactory specFactory;
+    if (frameCacheDirectory.empty() == false) {
+        specFactory.frameCache(frameCacheDirectory, "test-index");
+    }
+    api::CDataFrameAnalyzer analyzer{specFactory.rows(150).outlierSpec(), outputWriterFactory};
+
+    TStrVec fieldNames{"c1", "c2", "c3", "c4", "c5", ".", "."};
+    for (const auto& row : rows) {
+        analyzer.handleRecord(fieldNames, row);
+    }
+    analyzer.handleRecord(fieldNames, {"", "", "", "", "", "", "$"});
+
+    rapidjson::Document results;
+    rapidjson::ParseResult ok(results.Parse(output.str()));
+    BOOST_TEST_REQUIRE(static_cast<bool>(ok) == true);
+
+    TDoubleVec scores;
+    for (const auto& result : results.GetArray()) {
+        if (result.HasMember("row_results")) {
+            scores.push_back(
+                result["row_results"]["results"]["ml"]["outlier_score"].GetDouble());
+        }
+    }
+    return scores;
+}
+
+std::size_t numberFiles(const std::string& directory) {
+    return static_cast<std::size_t>(
+        std::distance(boost::filesystem::directory_iterator{directory},
+                      boost::filesystem::directory_iterator{}));
+}
 }
 
 BOOST_AUTO_TEST_CASE(testWithoutControlMessages) {
@@ -602,6 +659,62 @@ BOOST_AUTO_TEST_CASE(testRoundTripDocHashes) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(testFrameCache) {
+
+    // Test the analyzer reuses the cached data frame if the input matches and
+    // otherwise rebuilds it. In all cases the results should match running
+    // without a cache.
+
+    std::string directory{test::CTestTmpDir::tmpDir() + "/frame_cache"};
+    boost::filesystem::remove_all(directory);
+    boost::filesystem::create_directories(directory);
+
+    TStrVecVec rows{makeOutlierTestRows(100)};
+    TDoubleVec expectedScores{runOutlierDetection(rows, "")};
+
+    LOG_DEBUG(<< "Write cache");
+    BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedScores),
+                        core::CContainerPrinter::print(runOutlierDetection(rows, directory)));
+    BOOST_REQUIRE_EQUAL(1, numberFiles(directory));
+
+    LOG_DEBUG(<< "Reuse cache");
+    BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedScores),
+                        core::CContainerPrinter::print(runOutlierDetection({}, directory)));
+    BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedScores),
+                        core::CContainerPrinter::print(runOutlierDetection(rows, directory)));
+
+    LOG_DEBUG(<< "Changed row");
+    rows[50][2] = "1.5";
+    expectedScores = runOutlierDetection(rows, "");
+    BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedScores),
+                        core::CContainerPrinter::print(runOutlierDetection(rows, directory)));
+    // The cache should have been rebuilt with the changed row.
+    BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedScores),
+                        core::CContainerPrinter::print(runOutlierDetection({}, directory)));
+
+    LOG_DEBUG(<< "Fewer rows");
+    rows.resize(60);
+    expectedScores = runOutlierDetection(rows, "");
+    BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedScores),
+                        core::CContainerPrinter::print(runOutlierDetection(rows, directory)));
+    BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedScores),
+                        core::CContainerPrinter::print(runOutlierDetection({}, directory)));
+
+    LOG_DEBUG(<< "More rows");
+    TStrVecVec extraRows{makeOutlierTestRows(120)};
+    rows.insert(rows.end(), extraRows.begin() + 60, extraRows.end());
+    expectedScores = runOutlierDetection(rows, "");
+    BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedScores),
+                        core::CContainerPrinter::print(runOutlierDetection(rows, directory)));
+    BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedScores),
+                        core::CContainerPrinter::print(runOutlierDetection({}, directory)));
+
+    // We should never leave temporary files behind.
+    BOOST_REQUIRE_EQUAL(1, numberFiles(directory));
+
+    boost::filesystem::remove_all(directory);
+}
+
 BOOST_AUTO_TEST_CASE(testProgress) {
 
     // Test we get 100% progress reported for all stages of the analysis.
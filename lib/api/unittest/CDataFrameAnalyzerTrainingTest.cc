@@ -19,7 +19,10 @@
 #include <maths/CDataFrameUtils.h>
 #include <maths/CTools.h>
 
+#include <api/CDataFrameAnalysisSpecification.h>
+#include <api/CDataFrameAnalysisSpecificationJsonWriter.h>
 #include <api/CDataFrameAnalyzer.h>
+#include <api/CDataFramePredictBoostedTreeRunner.h>
 #include <api/CDataFrameTrainBoostedTreeRegressionRunner.h>
 #include <api/CSingleStreamDataAdder.h>
 #include <api/ElasticsearchStateIndex.h>
@@ -28,6 +31,7 @@
 #include <test/CDataFrameAnalysisSpecificationFactory.h>
 #include <test/CDataFrameAnalyzerTrainingFactory.h>
 #include <test/CRandomNumbers.h>
+#include <test/CTestTmpDir.h>
 
 #include <rapidjson/prettywriter.h>
 
@@ -608,6 +612,179 @@ BOOST_AUTO_TEST_CASE(testRunBoostedTreeRegressionTrainingWithStateRecovery) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(testRunBoostedTreePrediction) {
+
+    // Test predicting in batches with the model restored from the final training
+    // state reproduces the predictions made at the end of training.
+
+    std::stringstream output;
+    auto outputWriterFactory = [&output]() {
+        return std::make_unique<core::CJsonOutputStreamWrapper>(output);
+    };
+
+    auto persistenceStream = std::make_shared<std::ostringstream>();
+    TPersisterSupplier persisterSupplier{[&persistenceStream]() {
+        return std::make_unique<api::CSingleStreamDataAdder>(persistenceStream);
+    }};
+
+    auto readPredictions = [&output] {
+        rapidjson::Document results;
+        rapidjson::ParseResult ok(results.Parse(output.str()));
+        BOOST_TEST_REQUIRE(static_cast<bool>(ok) == true);
+        TDoubleVec predictions;
+        for (const auto& result : results.GetArray()) {
+            if (result.HasMember("row_results")) {
+                predictions.push_back(
+                    result["row_results"]["results"]["ml"]["target_prediction"].GetDouble());
+            }
+        }
+        return predictions;
+    };
+
+    TStrVec fieldNames{"f1", "f2", "f3", "f4", "target", ".", "."};
+    TStrVec fieldValues{"", "", "", "", "", "0", ""};
+    api::CDataFrameAnalyzer analyzer{
+        test::CDataFrameAnalysisSpecificationFactory{}
+            .predictionMaximumNumberTrees(10)
+            .predictionPersisterSupplier(&persisterSupplier)
+            .predictionSpec(test::CDataFrameAnalysisSpecificationFactory::regression(), "target"),
+        outputWriterFactory};
+    test::CDataFrameAnalyzerTrainingFactory::addPredictionTestData(
+        TLossFunctionType::E_MseRegression, fieldNames, fieldValues, analyzer);
+    analyzer.handleRecord(fieldNames, {"", "", "", "", "", "", "$"});
+
+    TDoubleVec expectedPredictions{readPredictions()};
+
+    TStrVec persistedStates{
+        splitOnNull(std::stringstream{std::move(persistenceStream->str())})};
+    std::string finalState{persistedStates.back()};
+    TRestoreSearcherSupplier restorerSupplier{[&finalState]() {
+        return std::make_unique<CTestDataSearcher>(finalState);
+    }};
+
+    output.str("");
+    output.clear();
+
+    std::string spec{api::CDataFrameAnalysisSpecificationJsonWriter::jsonString(
+        "testJob", 100, 5, 7000000, 1, "", {}, true, test::CTestTmpDir::tmpDir(),
+        "ml", api::CDataFramePredictBoostedTreeRunnerFactory::NAME,
+        "{\"dependent_variable\": \"target\", \"rows_per_batch\": 30}")};
+    api::CDataFrameAnalyzer predictor{std::make_unique<api::CDataFrameAnalysisSpecification>(
+                                          spec, persisterSupplier, restorerSupplier),
+                                      outputWriterFactory};
+    test::CDataFrameAnalyzerTrainingFactory::addPredictionTestData(
+        TLossFunctionType::E_MseRegression, fieldNames, fieldValues, predictor);
+    predictor.handleRecord(fieldNames, {"", "", "", "", "", "", "$"});
+
+    TDoubleVec actualPredictions{readPredictions()};
+
+    BOOST_REQUIRE_EQUAL(expectedPredictions.size(), actualPredictions.size());
+    for (std::size_t i = 0; i < expectedPredictions.size(); ++i) {
+        BOOST_REQUIRE_CLOSE_ABSOLUTE(expectedPredictions[i], actualPredictions[i],
+                                     1e-6 * std::fabs(expectedPredictions[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testRunBoostedTreeClassifierPrediction) {
+
+    // Test predicting in batches with the classifier restored from the final
+    // training state writes the same results as are written at the end of training.
+
+    std::stringstream output;
+    auto outputWriterFactory = [&output]() {
+        return std::make_unique<core::CJsonOutputStreamWrapper>(output);
+    };
+
+    auto persistenceStream = std::make_shared<std::ostringstream>();
+    TPersisterSupplier persisterSupplier{[&persistenceStream]() {
+        return std::make_unique<api::CSingleStreamDataAdder>(persistenceStream);
+    }};
+
+    auto readResults = [&output] {
+        rapidjson::Document results;
+        rapidjson::ParseResult ok(results.Parse(output.str()));
+        BOOST_TEST_REQUIRE(static_cast<bool>(ok) == true);
+        rapidjson::Document rowResults;
+        rowResults.SetArray();
+        for (auto& result : results.GetArray()) {
+            if (result.HasMember("row_results")) {
+                rowResults.PushBack(rapidjson::Value{result["row_results"]["results"]["ml"],
+                                                     rowResults.GetAllocator()},
+                                    rowResults.GetAllocator());
+            }
+        }
+        return rowResults;
+    };
+
+    TStrVec fieldNames{"f1", "f2", "f3", "f4", "target", ".", "."};
+    TStrVec fieldValues{"", "", "", "", "", "0", ""};
+    api::CDataFrameAnalyzer analyzer{
+        test::CDataFrameAnalysisSpecificationFactory{}
+            .predictionMaximumNumberTrees(10)
+            .predictionCategoricalFieldNames({"target"})
+            .numberTopClasses(2)
+            .predictionPersisterSupplier(&persisterSupplier)
+            .predictionSpec(test::CDataFrameAnalysisSpecificationFactory::classification(), "target"),
+        outputWriterFactory};
+    test::CDataFrameAnalyzerTrainingFactory::addPredictionTestData(
+        TLossFunctionType::E_BinaryClassification, fieldNames, fieldValues, analyzer);
+    analyzer.handleRecord(fieldNames, {"", "", "", "", "", "", "$"});
+
+    rapidjson::Document expectedResults{readResults()};
+
+    // The predictor needs the classes in the order of their training ids.
+    const TStrVec& classes{analyzer.dataFrame().categoricalColumnValues()[4]};
+    BOOST_REQUIRE_EQUAL(2, classes.size());
+
+    TStrVec persistedStates{
+        splitOnNull(std::stringstream{std::move(persistenceStream->str())})};
+    std::string finalState{persistedStates.back()};
+    TRestoreSearcherSupplier restorerSupplier{[&finalState]() {
+        return std::make_unique<CTestDataSearcher>(finalState);
+    }};
+
+    output.str("");
+    output.clear();
+
+    std::string spec{api::CDataFrameAnalysisSpecificationJsonWriter::jsonString(
+        "testJob", 100, 5, 7000000, 1, "", {"target"}, true,
+        test::CTestTmpDir::tmpDir(), "ml", api::CDataFramePredictBoostedTreeRunnerFactory::NAME,
+        "{\"dependent_variable\": \"target\", \"rows_per_batch\": 30, "
+        "\"num_top_classes\": 2, \"categorical_field_values\": {\"target\": [\"" +
+            classes[0] + "\", \"" + classes[1] + "\"]}}")};
+    api::CDataFrameAnalyzer predictor{std::make_unique<api::CDataFrameAnalysisSpecification>(
+                                          spec, persisterSupplier, restorerSupplier),
+                                      outputWriterFactory};
+    test::CDataFrameAnalyzerTrainingFactory::addPredictionTestData(
+        TLossFunctionType::E_BinaryClassification, fieldNames, fieldValues, predictor);
+    predictor.handleRecord(fieldNames, {"", "", "", "", "", "", "$"});
+
+    rapidjson::Document actualResults{readResults()};
+
+    BOOST_REQUIRE_EQUAL(expectedResults.Size(), actualResults.Size());
+    for (rapidjson::SizeType i = 0; i < expectedResults.Size(); ++i) {
+        const auto& expected = expectedResults[i];
+        const auto& actual = actualResults[i];
+        BOOST_REQUIRE_EQUAL(expected["target_prediction"].GetString(),
+                            actual["target_prediction"].GetString());
+        BOOST_REQUIRE_CLOSE(expected["prediction_probability"].GetDouble(),
+                            actual["prediction_probability"].GetDouble(), 1e-4);
+        BOOST_REQUIRE_CLOSE(expected["prediction_score"].GetDouble(),
+                            actual["prediction_score"].GetDouble(), 1e-4);
+        const auto& expectedTopClasses = expected["top_classes"];
+        const auto& actualTopClasses = actual["top_classes"];
+        BOOST_REQUIRE_EQUAL(expectedTopClasses.Size(), actualTopClasses.Size());
+        for (rapidjson::SizeType j = 0; j < expectedTopClasses.Size(); ++j) {
+            BOOST_REQUIRE_EQUAL(expectedTopClasses[j]["class_name"].GetString(),
+                                actualTopClasses[j]["class_name"].GetString());
+            BOOST_REQUIRE_CLOSE(expectedTopClasses[j]["class_probability"].GetDouble(),
+                                actualTopClasses[j]["class_probability"].GetDouble(), 1e-4);
+            BOOST_REQUIRE_CLOSE(expectedTopClasses[j]["class_score"].GetDouble(),
+                                actualTopClasses[j]["class_score"].GetDouble(), 1e-4);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(testRunBoostedTreeClassifierTraining) {
 
     // Test the results the analyzer produces match running classification directly.
@@ -5,19 +5,25 @@
  */
 
 #include <core/CDataFrame.h>
+#include <core/CFloatStorage.h>
+#include <core/CJsonOutputStreamWrapper.h>
 #include <core/CRegex.h>
 #include <core/CSmallVector.h>
+#include <core/Constants.h>
 
 #include <maths/CTools.h>
 
 #include <api/CDataFrameAnalysisConfigReader.h>
 #include <api/CDataFrameTrainBoostedTreeClassifierRunner.h>
+#include <api/CMemoryUsageEstimationResultJsonWriter.h>
 
 #include <test/CDataFrameAnalysisSpecificationFactory.h>
 #include <test/CRandomNumbers.h>
 
+#include <boost/optional.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -51,6 +57,77 @@ BOOST_AUTO_TEST_CASE(testPredictionFieldNameClash) {
     BOOST_TEST_REQUIRE(regex.matches(errors[0]));
 }
 
+BOOST_AUTO_TEST_CASE(testDiagonalCurvature) {
+
+    // Check the choice of multiclass curvature storage is reflected in the number
+    // of columns we add to the data frame and the memory usage estimate.
+
+    using TOptionalBool = boost::optional<bool>;
+
+    std::size_t numberRows{100000};
+    std::size_t numberColumns{10};
+
+    auto makeSpec = [&](std::size_t numberClasses, TOptionalBool diagonal) {
+        test::CDataFrameAnalysisSpecificationFactory specFactory;
+        specFactory.rows(numberRows)
+            .columns(numberColumns)
+            .memoryLimit(10000000000)
+            .predictionCategoricalFieldNames({"target"})
+            .numberClasses(numberClasses);
+        if (diagonal) {
+            specFactory.diagonalCurvature(*diagonal);
+        }
+        return specFactory.predictionSpec(
+            test::CDataFrameAnalysisSpecificationFactory::classification(), "target");
+    };
+    auto expectedMemoryWithoutDisk = [](const api::CDataFrameAnalysisSpecification& spec) {
+        std::ostringstream sstream;
+        {
+            core::CJsonOutputStreamWrapper wrappedOutStream(sstream);
+            api::CMemoryUsageEstimationResultJsonWriter writer(wrappedOutStream);
+            spec.estimateMemoryUsage(writer);
+        }
+        rapidjson::Document arrayDoc;
+        arrayDoc.Parse<rapidjson::kParseDefaultFlags>(sstream.str().c_str());
+        BOOST_TEST_REQUIRE(arrayDoc.IsArray());
+        std::string estimate{arrayDoc[0]["expected_memory_without_disk"].GetString()};
+        return std::stoi(estimate.substr(0, estimate.size() - 2));
+    };
+
+    std::size_t numberClasses{5};
+    std::size_t fullColumns{2 * numberClasses + numberClasses * (numberClasses + 1) / 2 + 1};
+    std::size_t diagonalColumns{3 * numberClasses + 1};
+
+    auto defaultSpec = makeSpec(numberClasses, TOptionalBool{});
+    auto fullSpec = makeSpec(numberClasses, false);
+    auto diagonalSpec = makeSpec(numberClasses, true);
+
+    BOOST_REQUIRE_EQUAL(fullColumns, defaultSpec->runner()->numberExtraColumns());
+    BOOST_REQUIRE_EQUAL(fullColumns, fullSpec->runner()->numberExtraColumns());
+    BOOST_REQUIRE_EQUAL(diagonalColumns, diagonalSpec->runner()->numberExtraColumns());
+
+    int fullMemory{expectedMemoryWithoutDisk(*fullSpec)};
+    int diagonalMemory{expectedMemoryWithoutDisk(*diagonalSpec)};
+    LOG_DEBUG(<< "full memory = " << fullMemory << "mb, diagonal memory = " << diagonalMemory
+              << "mb");
+
+    // We save at least the curvature columns we no longer store.
+    std::size_t savedColumns{fullColumns - diagonalColumns};
+    BOOST_TEST_REQUIRE(static_cast<std::size_t>(fullMemory - diagonalMemory) >=
+                       savedColumns * numberRows * sizeof(core::CFloatStorage) /
+                           core::constants::BYTES_IN_MEGABYTES);
+
+    // For many classes we default to the diagonal approximation.
+    numberClasses =
+        api::CDataFrameTrainBoostedTreeClassifierRunner::MIN_NUMBER_CLASSES_FOR_DIAGONAL_CURVATURE;
+    fullColumns = 2 * numberClasses + numberClasses * (numberClasses + 1) / 2 + 1;
+    diagonalColumns = 3 * numberClasses + 1;
+    defaultSpec = makeSpec(numberClasses, TOptionalBool{});
+    fullSpec = makeSpec(numberClasses, false);
+    BOOST_REQUIRE_EQUAL(diagonalColumns, defaultSpec->runner()->numberExtraColumns());
+    BOOST_REQUIRE_EQUAL(fullColumns, fullSpec->runner()->numberExtraColumns());
+}
+
 namespace {
 template<typename T>
 void testWriteOneRow(const std::string& dependentVariableField,
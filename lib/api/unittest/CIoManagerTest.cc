@@ -5,6 +5,7 @@
  */
 
 #include <core/CBlockingCallCancellingTimer.h>
+#include <core/CCaptureReader.h>
 #include <core/CThread.h>
 
 #include <api/CIoManager.h>
@@ -30,6 +31,7 @@ const std::size_t TEST_SIZE{10000};
 const char TEST_CHAR{'a'};
 const char* const GOOD_INPUT_FILE_NAME{"testfiles/good_input_file"};
 const char* const GOOD_OUTPUT_FILE_NAME{"testfiles/good_output_file"};
+const char* const CAPTURE_FILE_NAME{"testfiles/capture.gz"};
 #ifdef Windows
 const char* const GOOD_INPUT_PIPE_NAME{"\\\\.\\pipe\\good_input_pipe"};
 const char* const GOOD_OUTPUT_PIPE_NAME{"\\\\.\\pipe\\good_output_pipe"};
@@ -125,6 +127,44 @@ BOOST_AUTO_TEST_CASE(testFileIoGood) {
     BOOST_REQUIRE_EQUAL(0, std::remove(GOOD_OUTPUT_FILE_NAME));
 }
 
+BOOST_AUTO_TEST_CASE(testFileIoCaptured) {
+    std::remove(GOOD_OUTPUT_FILE_NAME);
+    std::remove(CAPTURE_FILE_NAME);
+
+    std::ofstream strm{GOOD_INPUT_FILE_NAME};
+    strm << std::string(TEST_SIZE, TEST_CHAR);
+    strm.close();
+
+    std::string processedData;
+    {
+        ml::core::CBlockingCallCancellingTimer cancellerThread{
+            ml::core::CThread::currentThreadId()};
+        ml::api::CIoManager ioMgr{cancellerThread, GOOD_INPUT_FILE_NAME, false,
+                                  GOOD_OUTPUT_FILE_NAME, false, "", true, "",
+                                  true, CAPTURE_FILE_NAME};
+        BOOST_TEST_REQUIRE(ioMgr.initIo());
+        std::getline(ioMgr.inputStream(), processedData);
+    }
+    BOOST_REQUIRE_EQUAL(std::string(TEST_SIZE, TEST_CHAR), processedData);
+
+    // The capture should reproduce the input exactly.
+    std::string capturedData;
+    {
+        ml::core::CCaptureReader reader{CAPTURE_FILE_NAME};
+        BOOST_TEST_REQUIRE(reader.isOpen());
+        std::uint64_t elapsed;
+        std::string chunk;
+        while (reader.next(elapsed, chunk)) {
+            capturedData += chunk;
+        }
+    }
+    BOOST_REQUIRE_EQUAL(processedData, capturedData);
+
+    BOOST_REQUIRE_EQUAL(0, std::remove(GOOD_INPUT_FILE_NAME));
+    BOOST_REQUIRE_EQUAL(0, std::remove(GOOD_OUTPUT_FILE_NAME));
+    BOOST_REQUIRE_EQUAL(0, std::remove(CAPTURE_FILE_NAME));
+}
+
 BOOST_AUTO_TEST_CASE(testFileIoBad) {
     testCommon(BAD_INPUT_FILE_NAME, false, BAD_OUTPUT_FILE_NAME, false, false);
 }
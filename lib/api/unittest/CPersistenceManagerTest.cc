@@ -390,6 +390,116 @@ protected:
             BOOST_TEST_REQUIRE(state.find(expectedId) != std::string::npos);
         }
     }
+
+    void foregroundIncrementalComp(const std::string& configFileName) {
+        // Start by creating a job with non-trivial state
+
+        static const ml::core_t::TTime BUCKET_SIZE{3600};
+        static const std::string JOB_ID{"job"};
+
+        std::string inputFilename{"testfiles/big_ascending.txt"};
+
+        // Open the input and output files
+        std::ifstream inputStrm{inputFilename};
+        BOOST_TEST_REQUIRE(inputStrm.is_open());
+
+        std::ofstream outputStrm{ml::core::COsFileFuncs::NULL_FILENAME};
+        BOOST_TEST_REQUIRE(outputStrm.is_open());
+
+        ml::model::CLimits limits;
+        ml::api::CAnomalyJobConfig jobConfig;
+        BOOST_TEST_REQUIRE(jobConfig.initFromFile(configFileName));
+
+        ml::model::CAnomalyDetectorModelConfig modelConfig{
+            ml::model::CAnomalyDetectorModelConfig::defaultConfig(BUCKET_SIZE)};
+
+        std::ostringstream* incrementalStream{nullptr};
+        ml::api::CSingleStreamDataAdder::TOStreamP incrementalStreamPtr{
+            incrementalStream = new std::ostringstream()};
+        ml::api::CSingleStreamDataAdder incrementalDataAdder{incrementalStreamPtr};
+
+        std::ostringstream* foregroundStream{nullptr};
+        ml::api::CSingleStreamDataAdder::TOStreamP foregroundStreamPtr{
+            foregroundStream = new std::ostringstream()};
+        ml::api::CSingleStreamDataAdder foregroundDataAdder{foregroundStreamPtr};
+
+        // The 30000 second persist interval is set large enough that the timer
+        // will not trigger during the test - we bypass the timer in this test
+        // and kick off the persistence chain explicitly
+        ml::api::CPersistenceManager persistenceManager{30000, true, incrementalDataAdder};
+
+        ml::core_t::TTime snapshotTimestamp;
+        std::string description;
+        std::string snapshotId;
+        std::size_t numDocs{0};
+
+        std::string foregroundSnapshotId;
+        std::string incrementalSnapshotId;
+
+        {
+            ml::core::CJsonOutputStreamWrapper wrappedOutputStream{outputStrm};
+
+            CTestAnomalyJob job{JOB_ID,
+                                limits,
+                                jobConfig,
+                                modelConfig,
+                                wrappedOutputStream,
+                                std::bind(&reportPersistComplete, std::placeholders::_1,
+                                          std::ref(snapshotTimestamp), std::ref(description),
+                                          std::ref(snapshotId), std::ref(numDocs)),
+                                &persistenceManager,
+                                -1,
+                                "time",
+                                "%d/%b/%Y:%T %z"};
+
+            ml::api::CDataProcessor* firstProcessor{&job};
+
+            ml::api::CNdJsonInputParser parser{
+                {CTestFieldDataCategorizer::MLCATEGORY_NAME}, inputStrm};
+
+            BOOST_TEST_REQUIRE(parser.readStreamIntoMaps(
+                [firstProcessor](const ml::api::CDataProcessor::TStrStrUMap& dataRowFields) {
+                    return firstProcessor->handleRecord(
+                        dataRowFields, ml::api::CDataProcessor::TOptionalTime{});
+                }));
+
+            // Ensure the model size stats are up to date
+            job.finalise();
+
+            BOOST_TEST_REQUIRE(job.persistStateInForeground(
+                foregroundDataAdder, "Foreground persist at "));
+            foregroundSnapshotId = snapshotId;
+
+            // Writing one detector per record means the snapshot shouldn't be
+            // complete until something forces the remaining detectors out.
+            snapshotId.clear();
+            job.persistIncrementally(1);
+            BOOST_TEST_REQUIRE(firstProcessor->periodicPersistStateInForeground());
+            persistenceManager.startPersist();
+            BOOST_TEST_REQUIRE(snapshotId.empty());
+
+            job.finalise();
+            BOOST_TEST_REQUIRE(snapshotId.empty() == false);
+            incrementalSnapshotId = snapshotId;
+        }
+
+        std::string incrementalState{incrementalStream->str()};
+        std::string foregroundState{foregroundStream->str()};
+
+        // The snapshot ID can be different between the two persists, so replace the
+        // first occurrence of it (which is in the bulk metadata)
+        BOOST_REQUIRE_EQUAL(1, ml::core::CStringUtils::replaceFirst(
+                                   incrementalSnapshotId, "snap", incrementalState));
+        BOOST_REQUIRE_EQUAL(1, ml::core::CStringUtils::replaceFirst(
+                                   foregroundSnapshotId, "snap", foregroundState));
+
+        // Replace the zero byte separators to avoid '\0's in the output if the
+        // test fails
+        std::replace(incrementalState.begin(), incrementalState.end(), '\0', ',');
+        std::replace(foregroundState.begin(), foregroundState.end(), '\0', ',');
+
+        BOOST_REQUIRE_EQUAL(foregroundState, incrementalState);
+    }
 };
 
 BOOST_FIXTURE_TEST_CASE(testDetectorPersistByWithGivenSnapshotDescriptors, CTestFixture) {
@@ -413,6 +523,10 @@ BOOST_FIXTURE_TEST_CASE(testDetectorBackgroundPersistStaticsConsistency, CTestFi
     this->foregroundBackgroundCompAnomalyDetectionAfterStaticsUpdate("testfiles/new_mlfields_over.json");
 }
 
+BOOST_FIXTURE_TEST_CASE(testDetectorPersistIncrementally, CTestFixture) {
+    this->foregroundIncrementalComp("testfiles/new_mlfields_partition.json");
+}
+
 BOOST_FIXTURE_TEST_CASE(testBackgroundPersistCategorizationConsistency, CTestFixture) {
 
     static const std::string JOB_ID{"job"};
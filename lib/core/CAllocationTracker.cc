@@ -0,0 +1,243 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CAllocationTracker.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace ml {
+namespace core {
+namespace {
+// These must be usable before static initialisation has run so they're both
+// zero initialised.
+std::atomic<std::int64_t> LIVE_BYTES[CAllocationTracker::NUMBER_TAGS];
+thread_local CAllocationTracker::ETag CURRENT_TAG;
+
+const std::string TAG_NAMES[]{"untagged",    "gatherers", "models",
+                              "categorizer", "results",   "data_frame"};
+}
+
+CAllocationTracker::CScopedTag::CScopedTag(ETag tag)
+    : m_PreviousTag{CURRENT_TAG} {
+    CURRENT_TAG = tag;
+}
+
+CAllocationTracker::CScopedTag::~CScopedTag() {
+    CURRENT_TAG = m_PreviousTag;
+}
+
+bool CAllocationTracker::enabled() {
+#ifdef ML_ALLOCATION_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+CAllocationTracker::ETag CAllocationTracker::currentTag() {
+    return CURRENT_TAG;
+}
+
+std::size_t CAllocationTracker::liveBytes(ETag tag) {
+    // This can only be negative if memory is freed with a different family
+    // of functions than it was allocated with, but don't report garbage.
+    std::int64_t bytes{LIVE_BYTES[tag].load(std::memory_order_relaxed)};
+    return bytes > 0 ? static_cast<std::size_t>(bytes) : 0;
+}
+
+CAllocationTracker::TSizeTagArray CAllocationTracker::liveBytesByTag() {
+    TSizeTagArray result;
+    for (std::size_t i = 0; i < NUMBER_TAGS; ++i) {
+        result[i] = liveBytes(static_cast<ETag>(i));
+    }
+    return result;
+}
+
+std::size_t CAllocationTracker::totalLiveBytes() {
+    std::size_t result{0};
+    for (std::size_t i = 0; i < NUMBER_TAGS; ++i) {
+        result += liveBytes(static_cast<ETag>(i));
+    }
+    return result;
+}
+
+const std::string& CAllocationTracker::print(ETag tag) {
+    return TAG_NAMES[tag];
+}
+
+void CAllocationTracker::recordAllocation(ETag tag, std::size_t bytes) {
+    LIVE_BYTES[tag].fetch_add(static_cast<std::int64_t>(bytes), std::memory_order_relaxed);
+}
+
+void CAllocationTracker::recordDeallocation(ETag tag, std::size_t bytes) {
+    LIVE_BYTES[tag].fetch_sub(static_cast<std::int64_t>(bytes), std::memory_order_relaxed);
+}
+}
+}
+
+#ifdef ML_ALLOCATION_TRACKING
+
+// Replacing the global allocation functions from a shared library only affects
+// the whole process on Linux. On other platforms code in other libraries would
+// use the default allocation functions, so we'd misattribute or even corrupt
+// memory freed across library boundaries, unless everything is linked into one
+// executable.
+#if !defined(Linux) && !defined(ML_STATIC_BUILD)
+#error "ML_ALLOCATION_TRACKING is only supported on Linux or if ML_STATIC_BUILD is defined"
+#endif
+
+namespace {
+using ml::core::CAllocationTracker;
+
+//! \brief The header stored immediately before each tracked allocation.
+//!
+//! \note The size is a multiple of the fundamental alignment so the memory
+//! following a header at the start of a block is suitably aligned.
+struct alignas(alignof(std::max_align_t)) SAllocationHeader {
+    void* s_Block;
+    std::size_t s_Bytes;
+    CAllocationTracker::ETag s_Tag;
+};
+
+void* allocate(std::size_t bytes, std::size_t alignment) noexcept {
+    // Over-aligned memory is offset in a larger block. We use malloc for all
+    // allocations, rather than an aligned allocation function, so that every
+    // block can be freed in the same way.
+    std::size_t padding{alignment > alignof(SAllocationHeader) ? alignment - 1 : 0};
+    void* block{std::malloc(sizeof(SAllocationHeader) + padding + bytes)};
+    if (block == nullptr) {
+        return nullptr;
+    }
+    auto start = reinterpret_cast<std::uintptr_t>(block) + sizeof(SAllocationHeader);
+    if (padding > 0) {
+        start = ((start + padding) / alignment) * alignment;
+    }
+    auto* header = reinterpret_cast<SAllocationHeader*>(start) - 1;
+    header->s_Block = block;
+    header->s_Bytes = bytes;
+    header->s_Tag = CAllocationTracker::currentTag();
+    CAllocationTracker::recordAllocation(header->s_Tag, bytes);
+    return header + 1;
+}
+
+void* allocateOrThrow(std::size_t bytes, std::size_t alignment = alignof(SAllocationHeader)) {
+    for (;;) {
+        void* result{allocate(bytes, alignment)};
+        if (result != nullptr) {
+            return result;
+        }
+        std::new_handler handler{std::get_new_handler()};
+        if (handler == nullptr) {
+            throw std::bad_alloc{};
+        }
+        handler();
+    }
+}
+
+void* allocateOrNull(std::size_t bytes,
+                     std::size_t alignment = alignof(SAllocationHeader)) noexcept {
+    try {
+        return allocateOrThrow(bytes, alignment);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void deallocate(void* memory) noexcept {
+    if (memory == nullptr) {
+        return;
+    }
+    auto* header = static_cast<SAllocationHeader*>(memory) - 1;
+    CAllocationTracker::recordDeallocation(header->s_Tag, header->s_Bytes);
+    std::free(header->s_Block);
+}
+}
+
+void* operator new(std::size_t bytes) {
+    return allocateOrThrow(bytes);
+}
+
+void* operator new[](std::size_t bytes) {
+    return allocateOrThrow(bytes);
+}
+
+void* operator new(std::size_t bytes, const std::nothrow_t&) noexcept {
+    return allocateOrNull(bytes);
+}
+
+void* operator new[](std::size_t bytes, const std::nothrow_t&) noexcept {
+    return allocateOrNull(bytes);
+}
+
+void* operator new(std::size_t bytes, std::align_val_t alignment) {
+    return allocateOrThrow(bytes, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t bytes, std::align_val_t alignment) {
+    return allocateOrThrow(bytes, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateOrNull(bytes, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t bytes,
+                     std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+    return allocateOrNull(bytes, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+    deallocate(memory);
+}
+
+#endif
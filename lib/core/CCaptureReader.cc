@@ -0,0 +1,74 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CCaptureReader.h>
+
+#include <core/CCapturingIStream.h>
+#include <core/CLogger.h>
+
+#include <boost/iostreams/filter/gzip.hpp>
+
+namespace ml {
+namespace core {
+
+CCaptureReader::CCaptureReader(const std::string& captureFileName)
+    : m_File{captureFileName, std::ios::binary} {
+    if (m_File.is_open() == false) {
+        LOG_ERROR(<< "Failed to open capture file '" << captureFileName << "'");
+        return;
+    }
+    m_Input.push(boost::iostreams::gzip_decompressor());
+    m_Input.push(m_File);
+
+    std::string format(CCapturingIStream::FORMAT.size(), '\0');
+    try {
+        m_Input.read(&format[0], static_cast<std::streamsize>(format.size()));
+    } catch (const std::exception& e) {
+        LOG_ERROR(<< "Failed to read capture file '" << captureFileName
+                  << "': " << e.what());
+        return;
+    }
+    if (format != CCapturingIStream::FORMAT) {
+        LOG_ERROR(<< "'" << captureFileName << "' is not a capture file");
+        return;
+    }
+    m_IsOpen = true;
+}
+
+CCaptureReader::~CCaptureReader() = default;
+
+bool CCaptureReader::isOpen() const {
+    return m_IsOpen;
+}
+
+bool CCaptureReader::next(std::uint64_t& elapsedMicroseconds, std::string& data) {
+    if (m_IsOpen == false) {
+        return false;
+    }
+    try {
+        std::uint32_t length{0};
+        if (m_Input.read(reinterpret_cast<char*>(&elapsedMicroseconds),
+                         sizeof(elapsedMicroseconds))
+                .read(reinterpret_cast<char*>(&length), sizeof(length))
+                .fail()) {
+            // The capture is truncated if the captured process was killed
+            // so a partial header is just the end of the data.
+            return false;
+        }
+        data.resize(length);
+        if (m_Input.read(&data[0], static_cast<std::streamsize>(length)).fail()) {
+            LOG_WARN(<< "Capture truncated in chunk of length " << length);
+            data.resize(static_cast<std::size_t>(m_Input.gcount()));
+            return data.empty() == false;
+        }
+    } catch (const std::exception& e) {
+        // This is typically because the gzip trailer is missing.
+        LOG_WARN(<< "Failed reading capture: " << e.what());
+        return false;
+    }
+    return true;
+}
+}
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CCapturingIStream.h>
+
+#include <core/CLogger.h>
+
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <streambuf>
+#include <vector>
+
+namespace ml {
+namespace core {
+
+const std::string CCapturingIStream::FORMAT{"ml_input_capture_1\n"};
+
+//! \brief Reads from the source stream buffer and writes what it reads
+//! to the capture.
+class CCapturingIStream::CCapturingStreamBuf : public std::streambuf {
+public:
+    CCapturingStreamBuf(std::streambuf* source, const std::string& captureFileName)
+        : m_Source{source}, m_Buffer(BUFFER_SIZE),
+          m_CaptureFile{captureFileName, std::ios::binary | std::ios::trunc},
+          m_Start{std::chrono::steady_clock::now()} {
+        this->setg(m_Buffer.data(), m_Buffer.data(), m_Buffer.data());
+        if (m_CaptureFile.is_open() == false) {
+            LOG_ERROR(<< "Failed to open capture file '" << captureFileName << "'");
+            return;
+        }
+        m_Capture.push(boost::iostreams::gzip_compressor());
+        m_Capture.push(m_CaptureFile);
+        m_Capture.write(FORMAT.data(), static_cast<std::streamsize>(FORMAT.size()));
+    }
+
+    ~CCapturingStreamBuf() override {
+        try {
+            // This flushes and closes the gzip stream.
+            m_Capture.reset();
+        } catch (const std::exception& e) {
+            LOG_ERROR(<< "Failed to complete capture: " << e.what());
+        }
+    }
+
+    bool isCapturing() const { return m_Capture.empty() == false && m_Capture.good(); }
+
+    std::uint64_t bytesCaptured() const { return m_BytesCaptured; }
+
+protected:
+    int_type underflow() override {
+        if (this->gptr() < this->egptr()) {
+            return traits_type::to_int_type(*this->gptr());
+        }
+        if (m_Source == nullptr) {
+            return traits_type::eof();
+        }
+
+        // Wait for at least one character then take only what the source
+        // has buffered so we never block waiting for more input.
+        if (traits_type::eq_int_type(m_Source->sgetc(), traits_type::eof())) {
+            return traits_type::eof();
+        }
+        std::streamsize available{std::max(m_Source->in_avail(), std::streamsize{1})};
+        std::streamsize n{m_Source->sgetn(
+            m_Buffer.data(),
+            std::min(available, static_cast<std::streamsize>(m_Buffer.size())))};
+        if (n <= 0) {
+            return traits_type::eof();
+        }
+
+        this->capture(m_Buffer.data(), n);
+        this->setg(m_Buffer.data(), m_Buffer.data(), m_Buffer.data() + n);
+
+        return traits_type::to_int_type(*this->gptr());
+    }
+
+private:
+    static const std::size_t BUFFER_SIZE{65536};
+
+private:
+    void capture(const char* data, std::streamsize n) {
+        if (this->isCapturing() == false) {
+            return;
+        }
+        std::uint64_t elapsed{static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - m_Start)
+                .count())};
+        std::uint32_t length{static_cast<std::uint32_t>(n)};
+        m_Capture.write(reinterpret_cast<const char*>(&elapsed), sizeof(elapsed));
+        m_Capture.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        m_Capture.write(data, n);
+        if (m_Capture.good() == false) {
+            LOG_ERROR(<< "Failed writing capture after " << m_BytesCaptured
+                      << " bytes - input will no longer be captured");
+            return;
+        }
+        m_BytesCaptured += length;
+    }
+
+private:
+    using TFilteredOutput = boost::iostreams::filtering_stream<boost::iostreams::output>;
+
+private:
+    std::streambuf* m_Source;
+    std::vector<char> m_Buffer;
+    std::ofstream m_CaptureFile;
+    TFilteredOutput m_Capture;
+    std::chrono::steady_clock::time_point m_Start;
+    std::uint64_t m_BytesCaptured{0};
+};
+
+CCapturingIStream::CCapturingIStream(std::istream& source, const std::string& captureFileName)
+    : std::istream{nullptr}, m_StreamBuf{std::make_unique<CCapturingStreamBuf>(
+                                 source.rdbuf(), captureFileName)} {
+    this->rdbuf(m_StreamBuf.get());
+}
+
+CCapturingIStream::~CCapturingIStream() {
+    this->rdbuf(nullptr);
+}
+
+bool CCapturingIStream::isCapturing() const {
+    return m_StreamBuf->isCapturing();
+}
+
+std::uint64_t CCapturingIStream::bytesCaptured() const {
+    return m_StreamBuf->bytesCaptured();
+}
+}
+}
@@ -11,12 +11,14 @@
 #include <core/CHashing.h>
 #include <core/CLogger.h>
 #include <core/CMemory.h>
+#include <core/CNumaPlacement.h>
 #include <core/CPackedBitVector.h>
 #include <core/CStringUtils.h>
 #include <core/Concurrency.h>
 #include <core/Constants.h>
 
 #include <algorithm>
+#include <atomic>
 #include <future>
 #include <limits>
 #include <memory>
@@ -28,6 +30,12 @@ core::CFloatStorage truncateToFloatRange(double value) {
     double largest{static_cast<double>(std::numeric_limits<float>::max())};
     return std::min(std::max(value, -largest), largest);
 }
+
+//! The number of slices read ahead when reading a data frame asynchronously.
+const std::size_t NUMBER_PREFETCHED_SLICES{2};
+
+//! A placeholder for the node of a slice which hasn't been placed.
+const std::size_t UNPLACED_SLICE{std::numeric_limits<std::size_t>::max()};
 }
 
 namespace data_frame_detail {
@@ -145,10 +153,16 @@ void CDataFrame::reserve(std::size_t numberThreads, std::size_t rowCapacity) {
     std::size_t oldRowCapacity{m_RowCapacity};
     m_RowCapacity = rowCapacity;
 
-    parallel_for_each(numberThreads, m_Slices.begin(), m_Slices.end(),
-                      [oldRowCapacity, this](TRowSlicePtr& slice) {
-                          slice->reserve(oldRowCapacity, m_RowCapacity - oldRowCapacity);
-                      });
+    auto reserve = [oldRowCapacity, this](TRowSlicePtr& slice) {
+        slice->reserve(oldRowCapacity, m_RowCapacity - oldRowCapacity);
+    };
+
+    if (this->placeSlicesOnNumaNodes()) {
+        // Reserving reallocates the slices so do this on their nodes.
+        this->applyToSlicesOnTheirNumaNodes(reserve);
+    } else {
+        parallel_for_each(numberThreads, m_Slices.begin(), m_Slices.end(), std::move(reserve));
+    }
 }
 
 void CDataFrame::resizeColumns(std::size_t numberThreads, std::size_t numberColumns) {
@@ -219,6 +233,77 @@ bool CDataFrame::readRows(std::size_t beginRows,
                : this->sequentialApplyToAllRows(beginRows, endRows, readers, rowMask, false);
 }
 
+bool CDataFrame::readRows(TSizeVecCItr beginRowIndices,
+                          TSizeVecCItr endRowIndices,
+                          TRowFuncVec& readers) const {
+
+    std::size_t numberIndices{static_cast<std::size_t>(endRowIndices - beginRowIndices)};
+    if (numberIndices == 0 || readers.empty()) {
+        return true;
+    }
+
+    std::size_t numberBlocks{std::min(readers.size(), numberIndices)};
+    if (numberBlocks == 1) {
+        return this->applyToIndexedRows(readers[0], beginRowIndices, endRowIndices);
+    }
+
+    std::atomic_bool successful{true};
+
+    parallel_for_each(numberBlocks, 0, numberBlocks, [&](std::size_t block) {
+        auto beginBlock = beginRowIndices + (block * numberIndices) / numberBlocks;
+        auto endBlock = beginRowIndices + ((block + 1) * numberIndices) / numberBlocks;
+        if (this->applyToIndexedRows(readers[block], beginBlock, endBlock) == false) {
+            successful.store(false);
+        }
+    });
+
+    return successful.load();
+}
+
+bool CDataFrame::readRows(const TSizeVecCItrPrVec& rowIndexRanges,
+                          TRowFuncVecVec& readers) const {
+
+    if (readers.size() != rowIndexRanges.size()) {
+        LOG_ERROR(<< "Need one collection of readers for each range: # ranges = "
+                  << rowIndexRanges.size() << ", # readers = " << readers.size());
+        return false;
+    }
+
+    // We flatten the blocks of all the ranges so they share the threads.
+
+    using TSizeSizePr = std::pair<std::size_t, std::size_t>;
+    using TSizeSizePrVec = std::vector<TSizeSizePr>;
+
+    TSizeSizePrVec rangeBlocks;
+    for (std::size_t i = 0; i < rowIndexRanges.size(); ++i) {
+        std::size_t numberIndices{static_cast<std::size_t>(
+            rowIndexRanges[i].second - rowIndexRanges[i].first)};
+        std::size_t numberBlocks{std::min(readers[i].size(), numberIndices)};
+        for (std::size_t block = 0; block < numberBlocks; ++block) {
+            rangeBlocks.emplace_back(i, block);
+        }
+    }
+
+    std::atomic_bool successful{true};
+
+    parallel_for_each(rangeBlocks.size(), 0, rangeBlocks.size(), [&](std::size_t i) {
+        std::size_t range;
+        std::size_t block;
+        std::tie(range, block) = rangeBlocks[i];
+        auto beginRowIndices = rowIndexRanges[range].first;
+        std::size_t numberIndices{
+            static_cast<std::size_t>(rowIndexRanges[range].second - beginRowIndices)};
+        std::size_t numberBlocks{std::min(readers[range].size(), numberIndices)};
+        auto beginBlock = beginRowIndices + (block * numberIndices) / numberBlocks;
+        auto endBlock = beginRowIndices + ((block + 1) * numberIndices) / numberBlocks;
+        if (this->applyToIndexedRows(readers[range][block], beginBlock, endBlock) == false) {
+            successful.store(false);
+        }
+    });
+
+    return successful.load();
+}
+
 CDataFrame::TRowFuncVecBoolPr CDataFrame::writeColumns(std::size_t numberThreads,
                                                        std::size_t beginRows,
                                                        std::size_t endRows,
@@ -242,7 +327,7 @@ CDataFrame::TRowFuncVecBoolPr CDataFrame::writeColumns(std::size_t numberThreads
 
 void CDataFrame::parseAndWriteRow(const TStrCRng& columnValues, const std::string* hash) {
 
-    auto stringToValue = [this](bool isCategorical, TStrSizeUMap& categoryLookup,
+    auto stringToValue = [this](bool isCategorical, TStrSizeCMap& categoryLookup,
                                 TStrVec& categories, const std::string& columnValue) {
         if (columnValue == m_MissingString) {
             ++m_MissingValueCount;
@@ -254,10 +339,9 @@ void CDataFrame::parseAndWriteRow(const TStrCRng& columnValues, const std::strin
             // actual encoding approach is chosen when the analysis runs.
             std::size_t id;
             if (categories.size() == MAX_CATEGORICAL_CARDINALITY) {
-                auto itr = categoryLookup.find(columnValue);
-                id = itr != categoryLookup.end()
-                         ? itr->second
-                         : static_cast<std::int64_t>(MAX_CATEGORICAL_CARDINALITY);
+                const auto* entry = categoryLookup.find(columnValue);
+                id = entry != nullptr ? entry->second
+                                      : static_cast<std::int64_t>(MAX_CATEGORICAL_CARDINALITY);
             } else {
                 // We can represent up to float mantissa bits - 1 distinct
                 // categories so can faithfully store categorical fields with
@@ -265,7 +349,7 @@ void CDataFrame::parseAndWriteRow(const TStrCRng& columnValues, const std::strin
                 // one would need to use some form of dimension reduction such
                 // as hashing anyway.
                 std::size_t newId{categories.size()};
-                id = categoryLookup.emplace(columnValue, newId).first->second;
+                id = categoryLookup.insert(columnValue, newId).first->second;
                 if (id == newId) {
                     categories.push_back(columnValue);
                 }
@@ -289,9 +373,17 @@ void CDataFrame::parseAndWriteRow(const TStrCRng& columnValues, const std::strin
         return truncateToFloatRange(value);
     };
 
-    // This is only used when writing rows so is resized lazily.
+    // This is only used when writing rows so is resized lazily. If we're
+    // appending to rows which have already been written, for example ones
+    // restored from a cache, we need to index their categories so new rows
+    // get the same identifiers.
     if (m_CategoricalColumnValueLookup.size() != m_NumberColumns) {
         m_CategoricalColumnValueLookup.resize(m_NumberColumns);
+        for (std::size_t i = 0; i < m_CategoricalColumnValues.size(); ++i) {
+            for (std::size_t id = 0; id < m_CategoricalColumnValues[i].size(); ++id) {
+                m_CategoricalColumnValueLookup[i].insert(m_CategoricalColumnValues[i][id], id);
+            }
+        }
     }
 
     this->writeRow([&](TFloatVecItr columns, std::int32_t& docHash) {
@@ -351,6 +443,16 @@ void CDataFrame::categoricalColumns(TBoolVec columnIsCategorical) {
     }
 }
 
+void CDataFrame::categoricalColumnValues(TStrVecVec categoricalColumnValues) {
+    if (categoricalColumnValues.size() != m_NumberColumns) {
+        HANDLE_FATAL(<< "Internal error: expected '" << m_NumberColumns
+                     << "' category values but got " << categoricalColumnValues.size());
+    } else {
+        m_CategoricalColumnValues = std::move(categoricalColumnValues);
+        m_CategoricalColumnValueLookup.clear();
+    }
+}
+
 void CDataFrame::finishWritingRows() {
     // Get any slices which have been written, append and clear the writer.
 
@@ -364,6 +466,25 @@ void CDataFrame::finishWritingRows() {
             m_Slices.push_back(std::move(slice));
         }
         LOG_TRACE(<< "# slices = " << m_Slices.size());
+
+        // The new slices were allocated on the node of the writing thread and
+        // appending moves the boundaries between the nodes' blocks of slices.
+        // Each boundary moves by at most the number of slices appended so only
+        // relocating the slices whose node changed keeps the total work linear
+        // in the number of slices however many times we append.
+        if (slices.size() > 0 && this->placeSlicesOnNumaNodes()) {
+            m_SliceNumaNodes.resize(m_Slices.size(), UNPLACED_SLICE);
+            CNumaPlacement::runOnEachNode([this](std::size_t node) {
+                for (std::size_t i = this->beginNumaNodeSlices(node),
+                                 end = this->beginNumaNodeSlices(node + 1);
+                     i < end; ++i) {
+                    if (m_SliceNumaNodes[i] != node) {
+                        m_Slices[i]->relocate();
+                        m_SliceNumaNodes[i] = node;
+                    }
+                }
+            });
+        }
     }
 
     // Recover memory from categorical field parsing.
@@ -378,6 +499,23 @@ void CDataFrame::finishWritingRows() {
     m_CategoricalColumnValueLookup.shrink_to_fit();
 }
 
+void CDataFrame::clearRows() {
+    // Make sure any asynchronous writes to the store have completed.
+    this->finishWritingRows();
+
+    m_Slices.clear();
+    m_Slices.shrink_to_fit();
+    m_SliceNumaNodes.clear();
+    m_SliceNumaNodes.shrink_to_fit();
+    m_NumberRows = 0;
+
+    // The category identifiers are only meaningful for the rows read so these
+    // must be rebuilt for the next rows written.
+    for (auto& values : m_CategoricalColumnValues) {
+        values.clear();
+    }
+}
+
 const CDataFrame::TStrVec& CDataFrame::columnNames() const {
     return m_ColumnNames;
 }
@@ -397,6 +535,7 @@ std::size_t CDataFrame::memoryUsage() const {
     memory += CMemory::dynamicSize(m_MissingString);
     memory += CMemory::dynamicSize(m_ColumnIsCategorical);
     memory += CMemory::dynamicSize(m_Slices);
+    memory += CMemory::dynamicSize(m_SliceNumaNodes);
     memory += CMemory::dynamicSize(m_Writer);
     return memory;
 }
@@ -433,8 +572,6 @@ bool CDataFrame::parallelApplyToAllRows(std::size_t beginRows,
     // from storage and applying the function because we're already fully
     // balancing our work across the slices.
 
-    using TSliceFuncVec = std::vector<std::function<void(const TRowSlicePtr&)>>;
-
     CPackedBitVector::COneBitIndexConstIterator maskedRow;
     CPackedBitVector::COneBitIndexConstIterator endMaskedRows;
     if (rowMask != nullptr) {
@@ -444,8 +581,9 @@ bool CDataFrame::parallelApplyToAllRows(std::size_t beginRows,
 
     std::atomic_bool successful{true};
     CDataFrameRowSliceHandle readSlice;
+    std::size_t endPreviousSliceRows{0};
 
-    TSliceFuncVec sliceFuncs;
+    TRowSliceFuncVec sliceFuncs;
     sliceFuncs.reserve(funcs.size());
 
     for (auto& func : funcs) {
@@ -458,6 +596,12 @@ bool CDataFrame::parallelApplyToAllRows(std::size_t beginRows,
             std::size_t endSliceRows{
                 std::min(slice->indexOfLastRow(m_RowCapacity) + 1, endRows)};
 
+            // NUMA aware reads can visit slices out of order.
+            if (rowMask != nullptr && beginSliceRows < endPreviousSliceRows) {
+                maskedRow = rowMask->beginOneBits();
+            }
+            endPreviousSliceRows = endSliceRows;
+
             if (rowMask != nullptr &&
                 this->maskedRowsInSlice(maskedRow, endMaskedRows,
                                         beginSliceRows, endSliceRows) == false) {
@@ -484,11 +628,54 @@ bool CDataFrame::parallelApplyToAllRows(std::size_t beginRows,
         });
     }
 
-    parallel_for_each(this->beginSlices(beginRows), this->endSlices(endRows), sliceFuncs);
+    if (CNumaPlacement::numaAware()) {
+        this->numaAwareParallelApplyToSlices(this->beginSlices(beginRows),
+                                             this->endSlices(endRows), sliceFuncs);
+    } else {
+        parallel_for_each(this->beginSlices(beginRows), this->endSlices(endRows), sliceFuncs);
+    }
 
     return successful.load();
 }
 
+void CDataFrame::numaAwareParallelApplyToSlices(TRowSlicePtrVecCItr beginSlices,
+                                                TRowSlicePtrVecCItr endSlices,
+                                                TRowSliceFuncVec& funcs) const {
+
+    // Each task claims the unread slices placed on the node it's running on
+    // before helping with the other nodes' slices. Claiming slices dynamically
+    // also balances the work if the tasks run unevenly over the nodes.
+
+    std::size_t numberNodes{CNumaPlacement::numberNodes()};
+    auto begin = static_cast<std::size_t>(beginSlices - m_Slices.begin());
+    auto end = static_cast<std::size_t>(endSlices - m_Slices.begin());
+
+    TSizeVec endNodeSlices(numberNodes);
+    std::unique_ptr<std::atomic_size_t[]> nextNodeSlice{new std::atomic_size_t[numberNodes]};
+    for (std::size_t node = 0; node < numberNodes; ++node) {
+        nextNodeSlice[node].store(
+            std::min(std::max(this->beginNumaNodeSlices(node), begin), end));
+        endNodeSlices[node] =
+            std::min(std::max(this->beginNumaNodeSlices(node + 1), begin), end);
+    }
+
+    std::vector<std::function<void(std::size_t)>> tasks;
+    tasks.reserve(funcs.size());
+    for (auto& func : funcs) {
+        tasks.push_back([&func, &nextNodeSlice, &endNodeSlices, numberNodes, this](std::size_t) {
+            std::size_t node{CNumaPlacement::currentNode()};
+            for (std::size_t i = 0; i < numberNodes; ++i, node = (node + 1) % numberNodes) {
+                for (std::size_t j = nextNodeSlice[node]++; j < endNodeSlices[node];
+                     j = nextNodeSlice[node]++) {
+                    func(m_Slices[j]);
+                }
+            }
+        });
+    }
+
+    parallel_for_each(0, tasks.size(), tasks);
+}
+
 bool CDataFrame::sequentialApplyToAllRows(std::size_t beginRows,
                                           std::size_t endRows,
                                           TRowFuncVec& func,
@@ -506,53 +693,82 @@ bool CDataFrame::sequentialApplyToAllRows(std::size_t beginRows,
 
     switch (m_ReadAndWriteToStoreSyncStrategy) {
     case CDataFrame::EReadWriteToStorage::E_Async: {
-        // The slices get read from storage on the thread executing this
-        // function each slice is then concurrently read by the callback
-        // on a worker thread.
-
-        std::future<void> backgroundApply;
-
-        // We need to wait and this isn't guaranteed by the future destructor.
-        CWaitIfValidWhenExitingScope<void> waitFor(backgroundApply);
+        // The next NUMBER_PREFETCHED_SLICES slices are read from storage by
+        // tasks on the default executor whilst the function is applied to the
+        // current slice on the thread executing this function. If we commit
+        // the result each slice is also written back by a task so we only
+        // wait for a write when its buffer is needed again. This bounds the
+        // number of slices in memory at 2 * NUMBER_PREFETCHED_SLICES + 1.
 
-        for (auto slice = this->beginSlices(beginRows), endSlices = this->endSlices(endRows);
-             slice != endSlices; ++slice) {
+        using TRowSliceHandleFutureVec = std::vector<std::future<CDataFrameRowSliceHandle>>;
+        using TVoidFutureVec = std::vector<std::future<void>>;
 
-            std::size_t beginSliceRows{std::max((*slice)->indexOfFirstRow(), beginRows)};
-            std::size_t endSliceRows{
-                std::min((*slice)->indexOfLastRow(m_RowCapacity) + 1, endRows)};
+        TRowSlicePtrVecCItr slicesRead[NUMBER_PREFETCHED_SLICES];
+        TRowSliceHandleFutureVec reads(NUMBER_PREFETCHED_SLICES);
+        TVoidFutureVec writes(NUMBER_PREFETCHED_SLICES);
 
-            if (rowMask != nullptr &&
-                this->maskedRowsInSlice(maskedRow, endMaskedRows,
-                                        beginSliceRows, endSliceRows) == false) {
-                continue;
+        // We need to wait and this isn't guaranteed by the future destructor.
+        CWaitForAllValidWhenExitingScope<CDataFrameRowSliceHandle> waitForReads(reads);
+        CWaitForAllValidWhenExitingScope<void> waitForWrites(writes);
+
+        // Skipping slices without masked rows mustn't move the iterator used
+        // to apply the function to the slices we're still waiting to read.
+        auto prefetchMaskedRow = maskedRow;
+        auto nextSlice = this->beginSlices(beginRows);
+        auto endSlices = this->endSlices(endRows);
+        std::size_t numberRead{0};
+        std::size_t numberApplied{0};
+
+        auto prefetch = [&] {
+            for (/**/; nextSlice != endSlices && numberRead < numberApplied + NUMBER_PREFETCHED_SLICES;
+                 ++nextSlice) {
+                std::size_t beginSliceRows{std::max((*nextSlice)->indexOfFirstRow(), beginRows)};
+                std::size_t endSliceRows{std::min(
+                    (*nextSlice)->indexOfLastRow(m_RowCapacity) + 1, endRows)};
+                if (rowMask != nullptr &&
+                    this->maskedRowsInSlice(prefetchMaskedRow, endMaskedRows,
+                                            beginSliceRows, endSliceRows) == false) {
+                    continue;
+                }
+                std::size_t buffer{numberRead++ % NUMBER_PREFETCHED_SLICES};
+                slicesRead[buffer] = nextSlice;
+                reads[buffer] = async(defaultAsyncExecutor(),
+                                      [slice = *nextSlice] { return slice->read(); });
             }
+        };
 
-            readSlice = (*slice)->read();
+        for (prefetch(); numberApplied < numberRead; /**/) {
+
+            std::size_t buffer{numberApplied++ % NUMBER_PREFETCHED_SLICES};
+            auto slice = slicesRead[buffer];
+            readSlice = reads[buffer].get();
+            prefetch();
             if (readSlice.bad()) {
                 return false;
             }
 
-            // We wait here so at most one slice is copied into memory.
-            wait_for_valid(backgroundApply);
-
-            backgroundApply = async(
-                defaultAsyncExecutor(),
-                [ =, &func, readSlice_ = std::move(readSlice) ]() mutable {
+            std::size_t beginSliceRows{std::max((*slice)->indexOfFirstRow(), beginRows)};
+            std::size_t endSliceRows{
+                std::min((*slice)->indexOfLastRow(m_RowCapacity) + 1, endRows)};
 
-                    TOptionalPopMaskedRow popMaskedRow;
-                    if (rowMask != nullptr) {
-                        beginSliceRows = *maskedRow;
-                        popMaskedRow = CPopMaskedRow{endSliceRows, maskedRow, endMaskedRows};
-                    }
+            TOptionalPopMaskedRow popMaskedRow;
+            if (rowMask != nullptr) {
+                this->maskedRowsInSlice(maskedRow, endMaskedRows, beginSliceRows, endSliceRows);
+                beginSliceRows = *maskedRow;
+                popMaskedRow = CPopMaskedRow{endSliceRows, maskedRow, endMaskedRows};
+            }
 
-                    this->applyToRowsOfOneSlice(func[0], beginSliceRows, endSliceRows,
-                                                popMaskedRow, readSlice_);
+            this->applyToRowsOfOneSlice(func[0], beginSliceRows, endSliceRows,
+                                        popMaskedRow, readSlice);
 
-                    if (commitResult) {
-                        (*slice)->write(readSlice_.rows(), readSlice_.docHashes());
-                    }
-                });
+            if (commitResult) {
+                wait_for_valid(writes[buffer]);
+                writes[buffer] = async(
+                    defaultAsyncExecutor(),
+                    [ slice_ = *slice, readSlice_ = std::move(readSlice) ] {
+                        slice_->write(readSlice_.rows(), readSlice_.docHashes());
+                    });
+            }
         }
         break;
     }
@@ -594,6 +810,44 @@ bool CDataFrame::sequentialApplyToAllRows(std::size_t beginRows,
     return true;
 }
 
+bool CDataFrame::applyToIndexedRows(TRowFunc& func,
+                                    TSizeVecCItr beginRowIndices,
+                                    TSizeVecCItr endRowIndices) const {
+
+    // Popping the indexed rows of a slice leaves indexedRow pointing at the
+    // first index in a later slice so we simply loop until we've read all the
+    // indices.
+
+    CDataFrameRowSliceHandle readSlice;
+
+    for (auto indexedRow = beginRowIndices; indexedRow != endRowIndices; /**/) {
+
+        std::size_t beginSliceRows{*indexedRow};
+        if (beginSliceRows >= m_NumberRows) {
+            LOG_ERROR(<< "Row index " << beginSliceRows << " out of range " << m_NumberRows);
+            return false;
+        }
+
+        auto slice = this->beginSlices(beginSliceRows);
+        std::size_t endSliceRows{
+            std::min((*slice)->indexOfLastRow(m_RowCapacity) + 1, m_NumberRows)};
+
+        readSlice = (*slice)->read();
+        if (readSlice.bad()) {
+            return false;
+        }
+
+        TOptionalPopMaskedRow popMaskedRow{CPopMaskedRow{endSliceRows, indexedRow, endRowIndices}};
+        this->applyToRowsOfOneSlice(func, beginSliceRows, endSliceRows,
+                                    popMaskedRow, readSlice);
+
+        // Guard against readers which don't visit every row.
+        indexedRow = std::lower_bound(indexedRow, endRowIndices, endSliceRows);
+    }
+
+    return true;
+}
+
 void CDataFrame::applyToRowsOfOneSlice(TRowFunc& func,
                                        std::size_t firstRowToRead,
                                        std::size_t endRowsToRead,
@@ -632,6 +886,27 @@ CDataFrame::TRowSlicePtrVecCItr CDataFrame::endSlices(std::size_t endRows) const
                             });
 }
 
+bool CDataFrame::placeSlicesOnNumaNodes() const {
+    return m_InMainMemory && CNumaPlacement::numaAware() &&
+           CNumaPlacement::numberNodes() > 1;
+}
+
+std::size_t CDataFrame::beginNumaNodeSlices(std::size_t node) const {
+    // Slice i is placed on node floor(i * # nodes / # slices).
+    std::size_t numberNodes{CNumaPlacement::numberNodes()};
+    return (node * m_Slices.size() + numberNodes - 1) / numberNodes;
+}
+
+void CDataFrame::applyToSlicesOnTheirNumaNodes(const std::function<void(TRowSlicePtr&)>& func) {
+    CNumaPlacement::runOnEachNode([&](std::size_t node) {
+        for (std::size_t i = this->beginNumaNodeSlices(node),
+                         end = this->beginNumaNodeSlices(node + 1);
+             i < end; ++i) {
+            func(m_Slices[i]);
+        }
+    });
+}
+
 template<typename ITR>
 bool CDataFrame::maskedRowsInSlice(ITR& maskedRow,
                                    ITR endMaskedRows,
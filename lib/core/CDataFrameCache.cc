@@ -0,0 +1,292 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include <core/CDataFrameCache.h>
+
+#include <core/CDataFrame.h>
+#include <core/CFloatStorage.h>
+#include <core/CHashing.h>
+#include <core/CLogger.h>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace ml {
+namespace core {
+namespace {
+using TBoolVec = std::vector<bool>;
+using TSizeVec = std::vector<std::size_t>;
+using TStrVec = std::vector<std::string>;
+using TStrVecVec = std::vector<TStrVec>;
+using TFloatVec = std::vector<CFloatStorage>;
+using TRowItr = CDataFrame::TRowItr;
+
+const std::string MAGIC{"mldataframe"};
+const std::uint64_t MAXIMUM_STRING_LENGTH{std::uint64_t{1} << 30};
+const std::size_t ROWS_PER_BLOCK{4096};
+
+template<typename T>
+void writeValue(std::ostream& stream, T value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool readValue(std::istream& stream, T& value) {
+    stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return stream.good();
+}
+
+void writeString(std::ostream& stream, const std::string& value) {
+    writeValue(stream, static_cast<std::uint64_t>(value.size()));
+    stream.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+bool readString(std::istream& stream, std::string& value) {
+    std::uint64_t length;
+    if (readValue(stream, length) == false || length > MAXIMUM_STRING_LENGTH) {
+        return false;
+    }
+    value.resize(static_cast<std::size_t>(length));
+    stream.read(&value[0], static_cast<std::streamsize>(length));
+    return stream.good();
+}
+}
+
+CDataFrameCache::CDataFrameCache(const std::string& directory, const std::string& key) {
+    std::ostringstream name;
+    name << "data_frame_" << std::hex
+         << CHashing::safeMurmurHash64(key.data(), static_cast<int>(key.size()), 0)
+         << ".cache";
+    m_FileName = (boost::filesystem::path{directory} / name.str()).string();
+}
+
+const std::string& CDataFrameCache::fileName() const {
+    return m_FileName;
+}
+
+bool CDataFrameCache::exists() const {
+    boost::system::error_code errorCode;
+    return boost::filesystem::exists(m_FileName, errorCode);
+}
+
+bool CDataFrameCache::write(const CDataFrame& frame, const TUInt64Vec& rowHashes) const {
+
+    if (rowHashes.size() != frame.numberRows()) {
+        LOG_ERROR(<< "Expected " << frame.numberRows() << " row hashes but got "
+                  << rowHashes.size());
+        return false;
+    }
+
+    // Separate processes may write the same entry concurrently so each writes
+    // to its own temporary file.
+    std::string temporaryFileName;
+
+    try {
+        temporaryFileName = boost::filesystem::unique_path(m_FileName + ".%%%%-%%%%-%%%%-%%%%.tmp")
+                                .string();
+        std::ofstream file{temporaryFileName, std::ios_base::trunc | std::ios_base::binary};
+        if (file.is_open() == false) {
+            LOG_WARN(<< "Failed to open '" << temporaryFileName << "' for writing");
+            return false;
+        }
+
+        std::size_t numberColumns{frame.numberColumns()};
+
+        file.write(MAGIC.data(), static_cast<std::streamsize>(MAGIC.size()));
+        writeValue(file, VERSION);
+        writeValue(file, static_cast<std::uint64_t>(numberColumns));
+        writeValue(file, static_cast<std::uint64_t>(frame.numberRows()));
+        for (std::size_t i = 0; i < numberColumns; ++i) {
+            writeString(file, frame.columnNames()[i]);
+            writeValue(file, static_cast<std::uint8_t>(frame.columnIsCategorical()[i]));
+        }
+        for (std::size_t i = 0; i < numberColumns; ++i) {
+            const auto& values = frame.categoricalColumnValues()[i];
+            writeValue(file, static_cast<std::uint64_t>(values.size()));
+            for (const auto& value : values) {
+                writeString(file, value);
+            }
+        }
+
+        // Each row is stored as its column values followed by its document hash
+        // and the hash of the input from which it was parsed.
+        TFloatVec columns(numberColumns);
+        frame.readRows(1, [&](TRowItr beginRows, TRowItr endRows) {
+            for (auto row = beginRows; row != endRows; ++row) {
+                for (std::size_t i = 0; i < numberColumns; ++i) {
+                    columns[i] = (*row)[i];
+                }
+                file.write(reinterpret_cast<const char*>(columns.data()),
+                           static_cast<std::streamsize>(sizeof(CFloatStorage) * numberColumns));
+                writeValue(file, row->docHash());
+                writeValue(file, rowHashes[row->index()]);
+            }
+        });
+
+        file.close();
+        if (file.fail()) {
+            LOG_WARN(<< "Failed writing '" << temporaryFileName << "'");
+            boost::filesystem::remove(temporaryFileName);
+            return false;
+        }
+
+        boost::filesystem::rename(temporaryFileName, m_FileName);
+
+    } catch (const std::exception& e) {
+        LOG_WARN(<< "Failed to cache data frame in '" << m_FileName << "': " << e.what());
+        if (temporaryFileName.empty() == false) {
+            boost::system::error_code errorCode;
+            boost::filesystem::remove(temporaryFileName, errorCode);
+        }
+        return false;
+    }
+
+    LOG_DEBUG(<< "Cached " << frame.numberRows() << " rows in '" << m_FileName << "'");
+
+    return true;
+}
+
+bool CDataFrameCache::read(CDataFrame& frame,
+                           TUInt64Vec& rowHashes,
+                           std::size_t maximumNumberRows) const {
+
+    if (frame.numberRows() > 0) {
+        LOG_ERROR(<< "Can only restore cached rows into an empty data frame");
+        return false;
+    }
+
+    std::ifstream file{m_FileName, std::ios_base::binary};
+    if (file.is_open() == false) {
+        return false;
+    }
+
+    std::string magic(MAGIC.size(), ' ');
+    std::uint32_t version;
+    std::uint64_t numberColumns;
+    std::uint64_t numberRows;
+    file.read(&magic[0], static_cast<std::streamsize>(magic.size()));
+    if (file.good() == false || magic != MAGIC ||
+        readValue(file, version) == false || version != VERSION) {
+        LOG_DEBUG(<< "Ignoring '" << m_FileName << "' with unsupported format");
+        return false;
+    }
+    if (readValue(file, numberColumns) == false || readValue(file, numberRows) == false ||
+        numberColumns != frame.numberColumns()) {
+        LOG_DEBUG(<< "Ignoring '" << m_FileName << "' which has a different schema");
+        return false;
+    }
+
+    TStrVec columnNames(numberColumns);
+    TBoolVec columnIsCategorical(numberColumns);
+    for (std::size_t i = 0; i < numberColumns; ++i) {
+        std::uint8_t isCategorical;
+        if (readString(file, columnNames[i]) == false ||
+            readValue(file, isCategorical) == false) {
+            LOG_ERROR(<< "Corrupt data frame cache '" << m_FileName << "'");
+            return false;
+        }
+        columnIsCategorical[i] = (isCategorical != 0);
+    }
+
+    // If the column names have been set these and the types must match.
+    bool named{std::any_of(frame.columnNames().begin(), frame.columnNames().end(),
+                           [](const std::string& name) { return name.size() > 0; })};
+    if (named && (columnNames != frame.columnNames() ||
+                  columnIsCategorical != frame.columnIsCategorical())) {
+        LOG_DEBUG(<< "Ignoring '" << m_FileName << "' which has a different schema");
+        return false;
+    }
+
+    TStrVecVec categoricalColumnValues(numberColumns);
+    for (std::size_t i = 0; i < numberColumns; ++i) {
+        std::uint64_t numberValues;
+        if (readValue(file, numberValues) == false) {
+            LOG_ERROR(<< "Corrupt data frame cache '" << m_FileName << "'");
+            return false;
+        }
+        categoricalColumnValues[i].resize(static_cast<std::size_t>(numberValues));
+        for (auto& value : categoricalColumnValues[i]) {
+            if (readString(file, value) == false) {
+                LOG_ERROR(<< "Corrupt data frame cache '" << m_FileName << "'");
+                return false;
+            }
+        }
+    }
+
+    std::uint64_t numberRowsToRead{
+        std::min(numberRows, static_cast<std::uint64_t>(maximumNumberRows))};
+    rowHashes.clear();
+    rowHashes.reserve(static_cast<std::size_t>(numberRowsToRead));
+
+    // We read blocks of rows to avoid the overhead of many small reads.
+    std::size_t columnBytes{sizeof(CFloatStorage) * numberColumns};
+    std::size_t rowBytes{columnBytes + sizeof(std::int32_t) + sizeof(std::uint64_t)};
+    std::vector<char> block(ROWS_PER_BLOCK * rowBytes);
+    for (std::uint64_t i = 0; i < numberRowsToRead; i += ROWS_PER_BLOCK) {
+        std::size_t rows{static_cast<std::size_t>(
+            std::min(numberRowsToRead - i, static_cast<std::uint64_t>(ROWS_PER_BLOCK)))};
+        file.read(block.data(), static_cast<std::streamsize>(rows * rowBytes));
+        if (file.good() == false) {
+            LOG_ERROR(<< "Corrupt data frame cache '" << m_FileName << "'");
+            frame.clearRows();
+            rowHashes.clear();
+            return false;
+        }
+        for (std::size_t j = 0; j < rows; ++j) {
+            const char* row{block.data() + j * rowBytes};
+            frame.writeRow([&](CDataFrame::TFloatVecItr columns, std::int32_t& docHash) {
+                std::copy_n(reinterpret_cast<const CFloatStorage*>(row), numberColumns, columns);
+                std::copy_n(row + columnBytes, sizeof(std::int32_t),
+                            reinterpret_cast<char*>(&docHash));
+            });
+            std::uint64_t rowHash;
+            std::copy_n(row + columnBytes + sizeof(std::int32_t),
+                        sizeof(std::uint64_t), reinterpret_cast<char*>(&rowHash));
+            rowHashes.push_back(rowHash);
+        }
+    }
+    frame.finishWritingRows();
+
+    // Category identifiers are assigned in the order the categories are first
+    // seen so the categories of a prefix of the rows are a prefix of the cached
+    // dictionary. We drop the rest so that parsing further rows assigns exactly
+    // the identifiers it would have if the prefix had been parsed directly.
+    if (numberRowsToRead < numberRows) {
+        TSizeVec numberCategories(numberColumns, 0);
+        frame.readRows(1, [&](TRowItr beginRows, TRowItr endRows) {
+            for (auto row = beginRows; row != endRows; ++row) {
+                for (std::size_t i = 0; i < numberColumns; ++i) {
+                    double id{(*row)[i]};
+                    if (columnIsCategorical[i] && std::isnan(id) == false) {
+                        numberCategories[i] = std::max(
+                            numberCategories[i], static_cast<std::size_t>(id) + 1);
+                    }
+                }
+            }
+        });
+        for (std::size_t i = 0; i < numberColumns; ++i) {
+            auto& values = categoricalColumnValues[i];
+            values.resize(std::min(values.size(), numberCategories[i]));
+        }
+    }
+
+    frame.columnNames(std::move(columnNames));
+    frame.categoricalColumns(std::move(columnIsCategorical));
+    frame.categoricalColumnValues(std::move(categoricalColumnValues));
+
+    LOG_DEBUG(<< "Restored " << frame.numberRows() << " rows from '" << m_FileName << "'");
+
+    return true;
+}
+
+const std::uint32_t CDataFrameCache::VERSION{2};
+}
+}
@@ -11,6 +11,7 @@
 #include <core/CHashing.h>
 #include <core/CLogger.h>
 #include <core/CMemory.h>
+#include <core/CNumaPlacement.h>
 #include <core/CompressUtils.h>
 
 #include <boost/filesystem.hpp>
@@ -28,6 +29,17 @@ using TInt32VecCItr = TInt32Vec::const_iterator;
 namespace {
 using namespace data_frame_row_slice_detail;
 
+//! Get an empty vector with capacity for \p size values, which is backed by
+//! huge pages if these are configured.
+TFloatVec reserveRows(std::size_t size) {
+    TFloatVec result;
+    result.reserve(size);
+    if (CNumaPlacement::hugePages()) {
+        CNumaPlacement::adviseHugePages(result.data(), size * sizeof(CFloatStorage));
+    }
+    return result;
+}
+
 //! \brief A handle for reading CRawDataFrameRowSlice objects.
 //!
 //! DESCRIPTION:\n
@@ -195,7 +207,9 @@ void CMainMemoryDataFrameRowSlice::reserve(std::size_t numberColumns, std::size_
     std::size_t numberRows{m_Rows.size() / numberColumns};
     std::size_t newNumberColumns{numberColumns + extraColumns};
     try {
-        TFloatVec state(m_Rows.size() + numberRows * extraColumns);
+        std::size_t size{m_Rows.size() + numberRows * extraColumns};
+        TFloatVec state{reserveRows(size)};
+        state.resize(size);
         for (auto i = m_Rows.begin(), j = state.begin(); i != m_Rows.end();
              i += numberColumns, j += newNumberColumns) {
             std::copy(i, i + numberColumns, j);
@@ -223,6 +237,21 @@ void CMainMemoryDataFrameRowSlice::write(const TFloatVec&, const TInt32Vec&) {
     // Nothing to do.
 }
 
+void CMainMemoryDataFrameRowSlice::relocate() {
+    // Pages are allocated on the node of the thread which first writes them
+    // so it suffices to copy the slice's state from the calling thread.
+    try {
+        TFloatVec rows{reserveRows(m_Rows.size())};
+        rows.assign(m_Rows.begin(), m_Rows.end());
+        TInt32Vec docHashes(m_DocHashes);
+        std::swap(rows, m_Rows);
+        std::swap(docHashes, m_DocHashes);
+    } catch (const std::exception& e) {
+        HANDLE_FATAL(<< "Environment error: failed to relocate data frame slice: caught '"
+                     << e.what() << "'. The process is likely out of memory.");
+    }
+}
+
 std::size_t CMainMemoryDataFrameRowSlice::staticSize() const {
     return sizeof(*this);
 }
@@ -371,6 +400,10 @@ void COnDiskDataFrameRowSlice::write(const TFloatVec& rows, const TInt32Vec& doc
     this->writeToDisk(rows, docHashes);
 }
 
+void COnDiskDataFrameRowSlice::relocate() {
+    // Nothing to do: slices are read into memory by the thread reading them.
+}
+
 std::size_t COnDiskDataFrameRowSlice::staticSize() const {
     return sizeof(*this);
 }
@@ -11,21 +11,45 @@
 #include <rapidjson/error/en.h>
 #include <rapidjson/rapidjson.h>
 
+#include <cstring>
+
 namespace ml {
 namespace core {
 
 namespace {
 const std::string EMPTY_STRING;
+const char TRUE_STRING[]{"true"};
+const char FALSE_STRING[]{"false"};
+
+//! Copy \p view into \p cache unless it's already there.
+const std::string&
+materialize(std::string_view view, std::string& cache, const char*& cachedData) {
+    // Views of distinct elements of the buffer never share their start.
+    if (view.data() != cachedData || view.size() != cache.size()) {
+        cache.assign(view.data(), view.size());
+        cachedData = view.data();
+    }
+    return cache;
+}
 }
 
 CJsonStateRestoreTraverser::CJsonStateRestoreTraverser(std::istream& inputStream)
-    : m_ReadStream(inputStream), m_Handler(), m_Started(false),
-      m_DesiredLevel(0), m_IsArrayOfObjects(false) {
+    : m_ReadStream(std::make_unique<rapidjson::IStreamWrapper>(inputStream)),
+      m_Handler(false), m_Started(false), m_DesiredLevel(0),
+      m_IsArrayOfObjects(false), m_CachedNameData(nullptr), m_CachedValueData(nullptr) {
+}
+
+CJsonStateRestoreTraverser::CJsonStateRestoreTraverser(std::string& buffer)
+    : m_InsituStream(std::make_unique<rapidjson::InsituStringStream>(&buffer[0])),
+      m_Handler(true), m_Started(false), m_DesiredLevel(0),
+      m_IsArrayOfObjects(false), m_CachedNameData(nullptr), m_CachedValueData(nullptr) {
 }
 
 bool CJsonStateRestoreTraverser::isEof() const {
-    // Rapid JSON istreamwrapper returns \0 when it reaches EOF
-    return m_ReadStream.Peek() == '\0';
+    // Rapid JSON istreamwrapper returns \0 when it reaches EOF as does the
+    // in-situ stream at the null terminator of the buffer
+    return m_Handler.s_Insitu ? m_InsituStream->Peek() == '\0'
+                              : m_ReadStream->Peek() == '\0';
 }
 
 bool CJsonStateRestoreTraverser::next() {
@@ -88,7 +112,10 @@ const std::string& CJsonStateRestoreTraverser::name() const {
         }
     }
 
-    return this->currentName();
+    if (m_Handler.s_Insitu) {
+        return materialize(this->currentName(), m_NameCache, m_CachedNameData);
+    }
+    return m_Handler.s_NameBuffer[1 - m_Handler.s_NextIndex];
 }
 
 const std::string& CJsonStateRestoreTraverser::value() const {
@@ -98,7 +125,10 @@ const std::string& CJsonStateRestoreTraverser::value() const {
         }
     }
 
-    return this->currentValue();
+    if (m_Handler.s_Insitu) {
+        return materialize(this->currentValue(), m_ValueCache, m_CachedValueData);
+    }
+    return m_Handler.s_ValueBuffer[1 - m_Handler.s_NextIndex];
 }
 
 bool CJsonStateRestoreTraverser::descend() {
@@ -118,8 +148,11 @@ bool CJsonStateRestoreTraverser::descend() {
     // element to be completely empty so that the sub-level traverser will find
     // nothing and then ascend.
     if (this->nextIsEndOfLevel()) {
-        m_Handler.s_Name[1 - m_Handler.s_NextIndex].clear();
-        m_Handler.s_Value[1 - m_Handler.s_NextIndex].clear();
+        std::size_t current{1 - m_Handler.s_NextIndex};
+        m_Handler.s_NameBuffer[current].clear();
+        m_Handler.s_ValueBuffer[current].clear();
+        m_Handler.s_Name[current] = std::string_view{};
+        m_Handler.s_Value[current] = std::string_view{};
         return true;
     }
 
@@ -165,11 +198,11 @@ bool CJsonStateRestoreTraverser::currentIsEndOfLevel() const {
     return m_Handler.s_IsEndOfLevel[1 - m_Handler.s_NextIndex];
 }
 
-const std::string& CJsonStateRestoreTraverser::currentName() const {
+std::string_view CJsonStateRestoreTraverser::currentName() const {
     return m_Handler.s_Name[1 - m_Handler.s_NextIndex];
 }
 
-const std::string& CJsonStateRestoreTraverser::currentValue() const {
+std::string_view CJsonStateRestoreTraverser::currentValue() const {
     return m_Handler.s_Value[1 - m_Handler.s_NextIndex];
 }
 
@@ -181,11 +214,11 @@ bool CJsonStateRestoreTraverser::nextIsEndOfLevel() const {
     return m_Handler.s_IsEndOfLevel[m_Handler.s_NextIndex];
 }
 
-const std::string& CJsonStateRestoreTraverser::nextName() const {
+std::string_view CJsonStateRestoreTraverser::nextName() const {
     return m_Handler.s_Name[m_Handler.s_NextIndex];
 }
 
-const std::string& CJsonStateRestoreTraverser::nextValue() const {
+std::string_view CJsonStateRestoreTraverser::nextValue() const {
     return m_Handler.s_Value[m_Handler.s_NextIndex];
 }
 
@@ -195,10 +228,15 @@ bool CJsonStateRestoreTraverser::parseNext(bool remember) {
         return false;
     }
 
-    const int parseFlags = rapidjson::kParseDefaultFlags;
     m_Handler.s_RememberValue = remember;
 
-    return m_Reader.IterativeParseNext<parseFlags>(m_ReadStream, m_Handler);
+    if (m_Handler.s_Insitu) {
+        const int parseFlags = rapidjson::kParseInsituFlag | rapidjson::kParseNumbersAsStringsFlag;
+        return m_Reader.IterativeParseNext<parseFlags>(*m_InsituStream, m_Handler);
+    }
+
+    const int parseFlags = rapidjson::kParseDefaultFlags;
+    return m_Reader.IterativeParseNext<parseFlags>(*m_ReadStream, m_Handler);
 }
 
 bool CJsonStateRestoreTraverser::skipArray() {
@@ -290,8 +328,9 @@ void CJsonStateRestoreTraverser::logError() {
     this->setBadState();
 }
 
-CJsonStateRestoreTraverser::SRapidJsonHandler::SRapidJsonHandler()
-    : s_Type(SRapidJsonHandler::E_TokenNull), s_NextIndex(0), s_RememberValue(false) {
+CJsonStateRestoreTraverser::SRapidJsonHandler::SRapidJsonHandler(bool insitu)
+    : s_Type(SRapidJsonHandler::E_TokenNull), s_Insitu(insitu), s_NextIndex(0),
+      s_RememberValue(false) {
     s_Level[0] = 0;
     s_Level[1] = 0;
     s_IsEndOfLevel[0] = false;
@@ -306,7 +345,9 @@ bool CJsonStateRestoreTraverser::SRapidJsonHandler::Null() {
 bool CJsonStateRestoreTraverser::SRapidJsonHandler::Bool(bool b) {
     s_Type = E_TokenBool;
     if (s_RememberValue) {
-        s_Value[s_NextIndex].assign(CStringUtils::typeToString(b));
+        const char* value{b ? TRUE_STRING : FALSE_STRING};
+        this->assign(value, static_cast<rapidjson::SizeType>(std::strlen(value)),
+                     s_Value[s_NextIndex], s_ValueBuffer[s_NextIndex]);
     }
 
     return true;
@@ -315,7 +356,8 @@ bool CJsonStateRestoreTraverser::SRapidJsonHandler::Bool(bool b) {
 bool CJsonStateRestoreTraverser::SRapidJsonHandler::Int(int i) {
     s_Type = E_TokenInt;
     if (s_RememberValue) {
-        s_Value[s_NextIndex].assign(CStringUtils::typeToString(i));
+        s_ValueBuffer[s_NextIndex] = CStringUtils::typeToString(i);
+        s_Value[s_NextIndex] = s_ValueBuffer[s_NextIndex];
     }
     return true;
 }
@@ -323,7 +365,8 @@ bool CJsonStateRestoreTraverser::SRapidJsonHandler::Int(int i) {
 bool CJsonStateRestoreTraverser::SRapidJsonHandler::Uint(unsigned u) {
     s_Type = E_TokenUInt;
     if (s_RememberValue) {
-        s_Value[s_NextIndex].assign(CStringUtils::typeToString(u));
+        s_ValueBuffer[s_NextIndex] = CStringUtils::typeToString(u);
+        s_Value[s_NextIndex] = s_ValueBuffer[s_NextIndex];
     }
 
     return true;
@@ -332,7 +375,8 @@ bool CJsonStateRestoreTraverser::SRapidJsonHandler::Uint(unsigned u) {
 bool CJsonStateRestoreTraverser::SRapidJsonHandler::Int64(int64_t i) {
     s_Type = E_TokenInt64;
     if (s_RememberValue) {
-        s_Value[s_NextIndex].assign(CStringUtils::typeToString(i));
+        s_ValueBuffer[s_NextIndex] = CStringUtils::typeToString(i);
+        s_Value[s_NextIndex] = s_ValueBuffer[s_NextIndex];
     }
 
     return true;
@@ -341,7 +385,8 @@ bool CJsonStateRestoreTraverser::SRapidJsonHandler::Int64(int64_t i) {
 bool CJsonStateRestoreTraverser::SRapidJsonHandler::Uint64(uint64_t u) {
     s_Type = E_TokenUInt64;
     if (s_RememberValue) {
-        s_Value[s_NextIndex].assign(CStringUtils::typeToString(u));
+        s_ValueBuffer[s_NextIndex] = CStringUtils::typeToString(u);
+        s_Value[s_NextIndex] = s_ValueBuffer[s_NextIndex];
     }
 
     return true;
@@ -350,16 +395,23 @@ bool CJsonStateRestoreTraverser::SRapidJsonHandler::Uint64(uint64_t u) {
 bool CJsonStateRestoreTraverser::SRapidJsonHandler::Double(double d) {
     s_Type = E_TokenDouble;
     if (s_RememberValue) {
-        s_Value[s_NextIndex].assign(CStringUtils::typeToString(d));
+        s_ValueBuffer[s_NextIndex] = CStringUtils::typeToString(d);
+        s_Value[s_NextIndex] = s_ValueBuffer[s_NextIndex];
     }
 
     return true;
 }
 
-bool CJsonStateRestoreTraverser::SRapidJsonHandler::RawNumber(const char*,
-                                                              rapidjson::SizeType,
+bool CJsonStateRestoreTraverser::SRapidJsonHandler::RawNumber(const char* str,
+                                                              rapidjson::SizeType length,
                                                               bool) {
-    return false;
+    // This is only called when parsing in-situ.
+    s_Type = E_TokenNumber;
+    if (s_RememberValue) {
+        this->assign(str, length, s_Value[s_NextIndex], s_ValueBuffer[s_NextIndex]);
+    }
+
+    return true;
 }
 
 bool CJsonStateRestoreTraverser::SRapidJsonHandler::String(const char* str,
@@ -367,7 +419,7 @@ bool CJsonStateRestoreTraverser::SRapidJsonHandler::String(const char* str,
                                                            bool) {
     s_Type = E_TokenString;
     if (s_RememberValue) {
-        s_Value[s_NextIndex].assign(str, length);
+        this->assign(str, length, s_Value[s_NextIndex], s_ValueBuffer[s_NextIndex]);
     }
 
     return true;
@@ -377,7 +429,8 @@ bool CJsonStateRestoreTraverser::SRapidJsonHandler::StartObject() {
     s_Type = E_TokenObjectStart;
     if (s_RememberValue) {
         ++s_Level[s_NextIndex];
-        s_Value[s_NextIndex].clear();
+        s_ValueBuffer[s_NextIndex].clear();
+        s_Value[s_NextIndex] = std::string_view{};
     }
     return true;
 }
@@ -390,7 +443,7 @@ bool CJsonStateRestoreTraverser::SRapidJsonHandler::Key(const char* str,
         s_NextIndex = 1 - s_NextIndex;
         s_Level[s_NextIndex] = s_Level[1 - s_NextIndex];
         s_IsEndOfLevel[s_NextIndex] = false;
-        s_Name[s_NextIndex].assign(str, length);
+        this->assign(str, length, s_Name[s_NextIndex], s_NameBuffer[s_NextIndex]);
     }
 
     return true;
@@ -403,8 +456,10 @@ bool CJsonStateRestoreTraverser::SRapidJsonHandler::EndObject(rapidjson::SizeTyp
         s_NextIndex = 1 - s_NextIndex;
         s_Level[s_NextIndex] = s_Level[1 - s_NextIndex] - 1;
         s_IsEndOfLevel[s_NextIndex] = true;
-        s_Name[s_NextIndex].clear();
-        s_Value[s_NextIndex].clear();
+        s_NameBuffer[s_NextIndex].clear();
+        s_ValueBuffer[s_NextIndex].clear();
+        s_Name[s_NextIndex] = std::string_view{};
+        s_Value[s_NextIndex] = std::string_view{};
     }
 
     return true;
@@ -419,5 +474,17 @@ bool CJsonStateRestoreTraverser::SRapidJsonHandler::EndArray(rapidjson::SizeType
     s_Type = E_TokenArrayEnd;
     return true;
 }
+
+void CJsonStateRestoreTraverser::SRapidJsonHandler::assign(const char* str,
+                                                           rapidjson::SizeType length,
+                                                           std::string_view& view,
+                                                           std::string& buffer) {
+    if (s_Insitu) {
+        view = std::string_view{str, length};
+    } else {
+        buffer.assign(str, length);
+        view = buffer;
+    }
+}
 }
 }
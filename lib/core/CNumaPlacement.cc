@@ -0,0 +1,47 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CNumaPlacement.h>
+
+namespace ml {
+namespace core {
+namespace {
+bool NUMA_AWARE{false};
+}
+
+void CNumaPlacement::configure(bool numaAware, bool) {
+    // There is only ever one node so this only changes how the data frame
+    // partitions its reads. Huge pages aren't supported.
+    NUMA_AWARE = numaAware;
+}
+
+bool CNumaPlacement::numaAware() {
+    return NUMA_AWARE;
+}
+
+bool CNumaPlacement::hugePages() {
+    return false;
+}
+
+std::size_t CNumaPlacement::numberNodes() {
+    return 1;
+}
+
+std::size_t CNumaPlacement::currentNode() {
+    return 0;
+}
+
+bool CNumaPlacement::bindCurrentThreadToNode(std::size_t) {
+    return false;
+}
+
+void CNumaPlacement::runOnEachNode(const TSizeFunc& f) {
+    f(0);
+}
+
+void CNumaPlacement::adviseHugePages(void*, std::size_t) {
+}
+}
+}
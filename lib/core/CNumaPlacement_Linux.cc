@@ -0,0 +1,220 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CNumaPlacement.h>
+
+#include <core/CLogger.h>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+
+namespace ml {
+namespace core {
+namespace {
+using TSizeVec = std::vector<std::size_t>;
+using TCpuSetVec = std::vector<cpu_set_t>;
+
+//! The size of transparent huge pages on x86_64 and aarch64 with 4KB pages.
+const std::size_t HUGE_PAGE_SIZE{2 * 1024 * 1024};
+const std::string NODE_DIRECTORY{"/sys/devices/system/node"};
+
+bool NUMA_AWARE{false};
+bool HUGE_PAGES{false};
+
+//! \brief The CPUs of each NUMA node the process can run on.
+struct STopology {
+    //! The CPUs of each node.
+    TCpuSetVec s_NodeCpus;
+    //! The node index of each CPU.
+    TSizeVec s_NodeOfCpu;
+};
+
+//! Add the CPUs in \p cpuList, which has the format "0-3,8,10-11", and are
+//! in \p allowed to \p cpus.
+void addCpus(const std::string& cpuList, const cpu_set_t& allowed, cpu_set_t& cpus) {
+    const char* cursor{cpuList.c_str()};
+    while (*cursor != '\0') {
+        char* end{nullptr};
+        unsigned long first{std::strtoul(cursor, &end, 10)};
+        if (end == cursor) {
+            break;
+        }
+        unsigned long last{first};
+        cursor = end;
+        if (*cursor == '-') {
+            last = std::strtoul(cursor + 1, &end, 10);
+            cursor = end;
+        }
+        for (unsigned long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        while (*cursor == ',' || *cursor == '\n' || *cursor == ' ') {
+            ++cursor;
+        }
+    }
+}
+
+STopology readTopology() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        LOG_WARN(<< "Failed to get process CPU affinity: " << ::strerror(errno));
+        for (std::size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            CPU_SET(cpu, &allowed);
+        }
+    }
+
+    // Order the nodes by their identifiers so node indices are stable.
+    using TSizeStrPr = std::pair<std::size_t, std::string>;
+    std::vector<TSizeStrPr> nodes;
+    boost::system::error_code errorCode;
+    for (boost::filesystem::directory_iterator i{NODE_DIRECTORY, errorCode}, end;
+         !errorCode && i != end; i.increment(errorCode)) {
+        std::string name{i->path().filename().string()};
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+            std::all_of(name.begin() + 4, name.end(), [](char c) {
+                return std::isdigit(static_cast<unsigned char>(c)) != 0;
+            })) {
+            nodes.emplace_back(std::stoul(name.substr(4)), i->path().string());
+        }
+    }
+    std::sort(nodes.begin(), nodes.end());
+
+    STopology result;
+    for (const auto& node : nodes) {
+        std::ifstream file{node.second + "/cpulist"};
+        std::string cpuList;
+        if (file.is_open() == false || std::getline(file, cpuList).fail()) {
+            continue;
+        }
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        addCpus(cpuList, allowed, cpus);
+        // Skip memory only nodes and those we can't run on.
+        if (CPU_COUNT(&cpus) > 0) {
+            result.s_NodeCpus.push_back(cpus);
+        }
+    }
+    if (result.s_NodeCpus.empty()) {
+        result.s_NodeCpus.push_back(allowed);
+    }
+
+    result.s_NodeOfCpu.resize(CPU_SETSIZE, 0);
+    for (std::size_t node = 0; node < result.s_NodeCpus.size(); ++node) {
+        for (std::size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &result.s_NodeCpus[node])) {
+                result.s_NodeOfCpu[cpu] = node;
+            }
+        }
+    }
+    LOG_DEBUG(<< "# NUMA nodes = " << result.s_NodeCpus.size());
+
+    return result;
+}
+
+const STopology& topology() {
+    static const STopology result{readTopology()};
+    return result;
+}
+}
+
+void CNumaPlacement::configure(bool numaAware, bool hugePages) {
+    NUMA_AWARE = numaAware;
+    HUGE_PAGES = hugePages;
+}
+
+bool CNumaPlacement::numaAware() {
+    return NUMA_AWARE;
+}
+
+bool CNumaPlacement::hugePages() {
+    return HUGE_PAGES;
+}
+
+std::size_t CNumaPlacement::numberNodes() {
+    return topology().s_NodeCpus.size();
+}
+
+std::size_t CNumaPlacement::currentNode() {
+    int cpu{::sched_getcpu()};
+    const auto& nodeOfCpu = topology().s_NodeOfCpu;
+    return cpu >= 0 && static_cast<std::size_t>(cpu) < nodeOfCpu.size() ? nodeOfCpu[cpu] : 0;
+}
+
+bool CNumaPlacement::bindCurrentThreadToNode(std::size_t node) {
+    const auto& nodeCpus = topology().s_NodeCpus;
+    if (node >= nodeCpus.size()) {
+        LOG_ERROR(<< "Can't bind to node " << node << " there are only "
+                  << nodeCpus.size() << " nodes");
+        return false;
+    }
+    int error{::pthread_setaffinity_np(::pthread_self(), sizeof(cpu_set_t),
+                                       &nodeCpus[node])};
+    if (error != 0) {
+        LOG_WARN(<< "Failed to bind thread to node " << node << ": " << ::strerror(error));
+        return false;
+    }
+    return true;
+}
+
+void CNumaPlacement::runOnEachNode(const TSizeFunc& f) {
+    std::size_t numberNodes{CNumaPlacement::numberNodes()};
+    if (numberNodes == 1) {
+        // All the CPUs we can run on belong to the one node.
+        f(0);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(numberNodes);
+    for (std::size_t node = 0; node < numberNodes; ++node) {
+        threads.emplace_back([&f, node] {
+            bindCurrentThreadToNode(node);
+            try {
+                f(node);
+            } catch (const std::exception& e) {
+                LOG_ERROR(<< "Failed executing on node " << node
+                          << " with error '" << e.what() << "'");
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void CNumaPlacement::adviseHugePages(void* memory, std::size_t bytes) {
+#ifdef MADV_HUGEPAGE
+    auto begin = reinterpret_cast<std::uintptr_t>(memory);
+    std::uintptr_t end{begin + bytes};
+    begin = (begin + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    end = end / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (end > begin &&
+        ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE) != 0) {
+        // Transparent huge pages may be disabled in which case this is benign.
+        LOG_DEBUG(<< "Failed to advise huge pages: " << ::strerror(errno));
+    }
+#endif
+}
+}
+}
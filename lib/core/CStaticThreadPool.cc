@@ -6,7 +6,11 @@
 
 #include <core/CStaticThreadPool.h>
 
+#include <core/CNumaPlacement.h>
+
+#include <algorithm>
 #include <chrono>
+#include <type_traits>
 
 namespace ml {
 namespace core {
@@ -16,12 +20,26 @@ std::size_t computeSize(std::size_t hint) {
     std::size_t size{bound > 0 ? std::min(hint, bound) : hint};
     return std::max(size, std::size_t{1});
 }
+
+//! With strict priority scheduling every STARVATION_INTERVAL'th task a worker
+//! runs is taken from a lower priority lane if one has any tasks.
+const std::size_t STARVATION_INTERVAL{16};
+//! The share of tasks each lane gets with weighted scheduling if every lane
+//! has tasks.
+const std::size_t WEIGHTS[]{8, 4, 1};
+const std::size_t TOTAL_WEIGHT{WEIGHTS[0] + WEIGHTS[1] + WEIGHTS[2]};
+static_assert(std::extent<decltype(WEIGHTS)>::value == CExecutor::NUMBER_PRIORITIES,
+              "There must be one weight per priority");
 }
 
-CStaticThreadPool::CStaticThreadPool(std::size_t size)
-    : m_Busy{false}, m_Cursor{0}, m_TaskQueues{computeSize(size)} {
-    m_Pool.reserve(m_TaskQueues.size());
-    for (std::size_t id = 0; id < m_TaskQueues.size(); ++id) {
+CStaticThreadPool::CStaticThreadPool(std::size_t size, EScheduling scheduling)
+    : m_Size{computeSize(size)}, m_Scheduling{scheduling}, m_Busy{false}, m_Cursor{0},
+      m_TaskQueues{CExecutor::NUMBER_PRIORITIES * m_Size}, m_NumberSleeping{0} {
+    for (auto& depth : m_QueueDepths) {
+        depth.store(0);
+    }
+    m_Pool.reserve(m_Size);
+    for (std::size_t id = 0; id < m_Size; ++id) {
         try {
             m_Pool.emplace_back([this, id] { this->worker(id); });
         } catch (...) {
@@ -35,20 +53,28 @@ CStaticThreadPool::~CStaticThreadPool() {
     this->shutdown();
 }
 
-void CStaticThreadPool::schedule(TTask&& task_) {
-    // Only block if every queue is full.
-    std::size_t size{m_TaskQueues.size()};
+void CStaticThreadPool::schedule(TTask&& task) {
+    this->schedule(std::forward<TTask>(task), currentTaskPriority());
+}
+
+void CStaticThreadPool::schedule(TTask&& task_, EPriority priority) {
+    // We count the task before it's queued so a worker can't go to sleep having
+    // missed it. At worst a worker spins briefly until the push completes.
+    m_QueueDepths[priority].fetch_add(1);
+
+    // Only block if every queue in the lane is full.
     std::size_t i{m_Cursor.load()};
-    std::size_t end{i + size};
-    CWrappedTask task{std::forward<TTask>(task_)};
+    std::size_t end{i + m_Size};
+    CWrappedTask task{std::forward<TTask>(task_), priority};
     for (/**/; i < end; ++i) {
-        if (m_TaskQueues[i % size].tryPush(std::move(task))) {
+        if (this->queue(priority, i % m_Size).tryPush(std::move(task))) {
             break;
         }
     }
     if (i == end) {
-        m_TaskQueues[i % size].push(std::move(task));
+        this->queue(priority, i % m_Size).push(std::move(task));
     }
+    this->notifyWorkers(false);
 
     // For many small tasks the best strategy for minimising contention between the
     // producers and consumers is to 1) not yield, 2) set the cursor to add tasks on
@@ -71,6 +97,10 @@ void CStaticThreadPool::busy(bool value) {
     m_Busy.store(value);
 }
 
+std::size_t CStaticThreadPool::queueDepth(EPriority priority) const {
+    return m_QueueDepths[priority].load();
+}
+
 void CStaticThreadPool::shutdown() {
 
     // Drain the queues before starting to shut down in order to maximise throughput.
@@ -78,10 +108,13 @@ void CStaticThreadPool::shutdown() {
 
     // Signal to each thread that it is finished. We bind each task to a thread so
     // so each thread executes exactly one shutdown task.
-    for (std::size_t id = 0; id < m_TaskQueues.size(); ++id) {
+    for (std::size_t id = 0; id < m_Pool.size(); ++id) {
         TTask done{[this] { m_Done = true; }};
-        m_TaskQueues[id].push(CWrappedTask{std::move(done), id});
+        m_QueueDepths[CExecutor::E_LowPriority].fetch_add(1);
+        this->queue(CExecutor::E_LowPriority, id)
+            .push(CWrappedTask{std::move(done), CExecutor::E_LowPriority, id});
     }
+    this->notifyWorkers(true);
 
     for (auto& thread : m_Pool) {
         if (thread.joinable()) {
@@ -95,29 +128,20 @@ void CStaticThreadPool::shutdown() {
 
 void CStaticThreadPool::worker(std::size_t id) {
 
-    auto ifAllowed = [id](const CWrappedTask& task) {
-        return task.executableOnThread(id);
-    };
+    if (CNumaPlacement::numaAware()) {
+        // Workers with adjacent ids share a node. Since workers try to steal from
+        // the next queues first this tends to keep stolen work on the same node.
+        CNumaPlacement::bindCurrentThreadToNode(id * CNumaPlacement::numberNodes() / m_Size);
+    }
 
     TOptionalTask task;
-    std::size_t size{m_TaskQueues.size()};
+    std::size_t pops{0};
 
     while (m_Done == false) {
-        // We maintain "worker count" queues and each worker has an affinity to a
-        // different queue. We don't immediately block if the worker's "queue" is
-        // empty because different tasks can have different duration and we could
-        // assign imbalanced work to the queues. However, this arrangement means
-        // if everything is working well we have essentially no contention between
-        // workers on queue reads.
-
-        for (std::size_t i = 0; i < size; ++i) {
-            task = m_TaskQueues[(id + i) % size].tryPop(ifAllowed);
-            if (task != boost::none) {
-                break;
-            }
-        }
+        task = this->tryPop(id, pops);
         if (task == boost::none) {
-            task = m_TaskQueues[id].pop();
+            this->waitForTasks();
+            continue;
         }
 
         (*task)();
@@ -132,14 +156,96 @@ void CStaticThreadPool::worker(std::size_t id) {
     }
 }
 
+CStaticThreadPool::TOptionalTask CStaticThreadPool::tryPop(std::size_t id, std::size_t& pops) {
+
+    // Within each lane we maintain "worker count" queues and each worker has an
+    // affinity to a different queue. We steal from the other queues in the lane
+    // before moving on to the next lane because different tasks can have different
+    // duration and we could assign imbalanced work to the queues. However, this
+    // arrangement means if everything is working well we have essentially no
+    // contention between workers on queue reads.
+
+    auto ifAllowed = [id](const CWrappedTask& task) {
+        return task.executableOnThread(id);
+    };
+
+    for (auto priority : this->priorityOrder(pops)) {
+        if (m_QueueDepths[priority].load() == 0) {
+            continue;
+        }
+        for (std::size_t i = 0; i < m_Size; ++i) {
+            TOptionalTask task{this->queue(priority, (id + i) % m_Size).tryPop(ifAllowed)};
+            if (task != boost::none) {
+                m_QueueDepths[priority].fetch_sub(1);
+                ++pops;
+                return task;
+            }
+        }
+    }
+    return boost::none;
+}
+
+CStaticThreadPool::TPriorityArray CStaticThreadPool::priorityOrder(std::size_t pops) const {
+
+    // We try the preferred lane first and then the others in priority order.
+
+    std::size_t preferred{0};
+    switch (m_Scheduling) {
+    case CExecutor::E_StrictPriority:
+        if (pops % STARVATION_INTERVAL == STARVATION_INTERVAL - 1) {
+            preferred = 1 + (pops / STARVATION_INTERVAL) % (CExecutor::NUMBER_PRIORITIES - 1);
+        }
+        break;
+    case CExecutor::E_WeightedPriority:
+        for (std::size_t slot = pops % TOTAL_WEIGHT; slot >= WEIGHTS[preferred]; ++preferred) {
+            slot -= WEIGHTS[preferred];
+        }
+        break;
+    }
+
+    TPriorityArray result{CExecutor::E_HighPriority, CExecutor::E_NormalPriority,
+                          CExecutor::E_LowPriority};
+    std::rotate(result.begin(), result.begin() + preferred, result.begin() + preferred + 1);
+    return result;
+}
+
+void CStaticThreadPool::waitForTasks() {
+    std::unique_lock<std::mutex> lock{m_SleepMutex};
+    ++m_NumberSleeping;
+    m_SleepCondition.wait(lock, [this] {
+        return std::any_of(m_QueueDepths.begin(), m_QueueDepths.end(),
+                           [](const std::atomic_size_t& depth) {
+                               return depth.load() > 0;
+                           });
+    });
+    --m_NumberSleeping;
+}
+
+void CStaticThreadPool::notifyWorkers(bool all) {
+    // Workers only start waiting whilst holding the mutex so we can't notify
+    // between a worker checking for tasks and it waiting.
+    if (m_NumberSleeping.load() > 0) {
+        std::unique_lock<std::mutex> lock{m_SleepMutex};
+        if (all) {
+            m_SleepCondition.notify_all();
+        } else {
+            m_SleepCondition.notify_one();
+        }
+    }
+}
+
 void CStaticThreadPool::drainQueuesWithoutBlocking() {
     TOptionalTask task;
     auto popTask = [&] {
-        for (auto& queue : m_TaskQueues) {
-            task = queue.tryPop();
-            if (task != boost::none) {
-                (*task)();
-                return true;
+        for (std::size_t priority = 0; priority < CExecutor::NUMBER_PRIORITIES; ++priority) {
+            for (std::size_t id = 0; id < m_Size; ++id) {
+                auto priority_ = static_cast<EPriority>(priority);
+                task = this->queue(priority_, id).tryPop();
+                if (task != boost::none) {
+                    m_QueueDepths[priority].fetch_sub(1);
+                    (*task)();
+                    return true;
+                }
             }
         }
         return false;
@@ -148,8 +254,14 @@ void CStaticThreadPool::drainQueuesWithoutBlocking() {
     }
 }
 
-CStaticThreadPool::CWrappedTask::CWrappedTask(TTask&& task, TOptionalSize threadId)
-    : m_Task{std::forward<TTask>(task)}, m_ThreadId{threadId} {
+CStaticThreadPool::TWrappedTaskQueue& CStaticThreadPool::queue(EPriority priority,
+                                                               std::size_t id) {
+    return m_TaskQueues[priority * m_Size + id];
+}
+
+CStaticThreadPool::CWrappedTask::CWrappedTask(TTask&& task, EPriority priority, TOptionalSize threadId)
+    : m_Task{std::forward<TTask>(task)}, m_ThreadId{threadId}, m_Priority{priority},
+      m_AllocationTag{CAllocationTracker::currentTag()} {
 }
 
 bool CStaticThreadPool::CWrappedTask::executableOnThread(std::size_t id) const {
@@ -158,6 +270,8 @@ bool CStaticThreadPool::CWrappedTask::executableOnThread(std::size_t id) const {
 
 void CStaticThreadPool::CWrappedTask::operator()() {
     if (m_Task != nullptr) {
+        CScopedTaskPriority priority{m_Priority};
+        CAllocationTracker::CScopedTag allocationTag{m_AllocationTag};
         try {
             m_Task();
         } catch (const std::exception& e) {
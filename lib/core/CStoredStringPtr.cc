@@ -5,28 +5,30 @@
  */
 #include <core/CStoredStringPtr.h>
 
+#include <core/CHashing.h>
 #include <core/CMemory.h>
 
-#include <boost/functional/hash.hpp>
-
 #include <utility>
 
 namespace ml {
 namespace core {
 
-CStoredStringPtr::CStoredStringPtr() noexcept : m_String{} {
+CStoredStringPtr::CStoredStringPtr() noexcept : m_String{}, m_Hash{0} {
 }
 
 CStoredStringPtr::CStoredStringPtr(const std::string& str)
-    : m_String{std::make_shared<const std::string>(str)} {
+    : m_String{std::make_shared<const std::string>(str)},
+      m_Hash{CHashing::CMurmurHash2String{}(*m_String)} {
 }
 
 CStoredStringPtr::CStoredStringPtr(std::string&& str)
-    : m_String{std::make_shared<const std::string>(std::move(str))} {
+    : m_String{std::make_shared<const std::string>(std::move(str))},
+      m_Hash{CHashing::CMurmurHash2String{}(*m_String)} {
 }
 
 void CStoredStringPtr::swap(CStoredStringPtr& other) noexcept {
     m_String.swap(other.m_String);
+    std::swap(m_Hash, other.m_Hash);
 }
 
 const std::string& CStoredStringPtr::operator*() const noexcept {
@@ -49,6 +51,16 @@ bool CStoredStringPtr::isUnique() const noexcept {
     return m_String.unique();
 }
 
+bool CStoredStringPtr::hasSameString(const CStoredStringPtr& other) const noexcept {
+    if (m_String == other.m_String) {
+        return true;
+    }
+    if (m_String == nullptr || other.m_String == nullptr || m_Hash != other.m_Hash) {
+        return false;
+    }
+    return *m_String == *other.m_String;
+}
+
 bool CStoredStringPtr::operator==(std::nullptr_t rhs) const noexcept {
     return m_String == rhs;
 }
@@ -90,7 +102,7 @@ CStoredStringPtr CStoredStringPtr::makeStoredString(std::string&& str) {
 }
 
 std::size_t hash_value(const CStoredStringPtr& ptr) {
-    return boost::hash_value(ptr.m_String);
+    return ptr.m_Hash;
 }
 
 void swap(CStoredStringPtr& lhs, CStoredStringPtr& rhs) {
@@ -22,18 +22,23 @@ public:
     void schedule(std::function<void()>&& f) override { f(); }
     bool busy() const override { return false; }
     void busy(bool) override {}
+    std::size_t queueDepth(EPriority) const override { return 0; }
 };
 
 //! \brief Executes a function in a thread pool.
 class CThreadPoolExecutor final : public CExecutor {
 public:
-    explicit CThreadPoolExecutor(std::size_t size) : m_ThreadPool{size} {}
+    CThreadPoolExecutor(std::size_t size, EScheduling scheduling)
+        : m_ThreadPool{size, scheduling} {}
 
     void schedule(std::function<void()>&& f) override {
         m_ThreadPool.schedule(std::forward<std::function<void()>>(f));
     }
     bool busy() const override { return m_ThreadPool.busy(); }
     void busy(bool value) override { return m_ThreadPool.busy(value); }
+    std::size_t queueDepth(EPriority priority) const override {
+        return m_ThreadPool.queueDepth(priority);
+    }
 
 private:
     CStaticThreadPool m_ThreadPool;
@@ -44,14 +49,15 @@ public:
     CExecutorHolder()
         : m_ThreadPoolSize{0}, m_Executor(std::make_unique<CImmediateExecutor>()) {}
 
-    static CExecutorHolder makeThreadPool(std::size_t threadPoolSize) {
+    static CExecutorHolder makeThreadPool(std::size_t threadPoolSize,
+                                          CExecutor::EScheduling scheduling) {
         if (threadPoolSize == 0) {
             threadPoolSize = std::thread::hardware_concurrency();
         }
 
         if (threadPoolSize > 0) {
             try {
-                return CExecutorHolder{threadPoolSize};
+                return CExecutorHolder{threadPoolSize, scheduling};
             } catch (const std::exception& e) {
                 LOG_ERROR(<< "Failed to create thread pool with '" << e.what()
                           << "'. Falling back to running single threaded");
@@ -70,9 +76,9 @@ public:
     std::size_t threadPoolSize() const { return m_ThreadPoolSize; }
 
 private:
-    CExecutorHolder(std::size_t threadPoolSize)
+    CExecutorHolder(std::size_t threadPoolSize, CExecutor::EScheduling scheduling)
         : m_ThreadPoolSize{threadPoolSize},
-          m_Executor(std::make_unique<CThreadPoolExecutor>(threadPoolSize)) {}
+          m_Executor(std::make_unique<CThreadPoolExecutor>(threadPoolSize, scheduling)) {}
 
 private:
     std::size_t m_ThreadPoolSize;
@@ -80,13 +86,28 @@ private:
 };
 
 CExecutorHolder singletonExecutor;
+
+thread_local CExecutor::EPriority currentPriority{CExecutor::E_NormalPriority};
+}
+
+CScopedTaskPriority::CScopedTaskPriority(CExecutor::EPriority priority)
+    : m_PreviousPriority{currentPriority} {
+    currentPriority = priority;
+}
+
+CScopedTaskPriority::~CScopedTaskPriority() {
+    currentPriority = m_PreviousPriority;
+}
+
+CExecutor::EPriority currentTaskPriority() {
+    return currentPriority;
 }
 
-void startDefaultAsyncExecutor(std::size_t threadPoolSize) {
+void startDefaultAsyncExecutor(std::size_t threadPoolSize, CExecutor::EScheduling scheduling) {
     // This is purposely not thread safe. This is only meant to be called once from
     // the main thread, typically from main of an executable or in single threaded
     // test code.
-    singletonExecutor = CExecutorHolder::makeThreadPool(threadPoolSize);
+    singletonExecutor = CExecutorHolder::makeThreadPool(threadPoolSize, scheduling);
 }
 
 void stopDefaultAsyncExecutor() {
@@ -0,0 +1,119 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include <core/CAllocationTracker.h>
+#include <core/Concurrency.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(CAllocationTrackerTest)
+
+using namespace ml;
+
+namespace {
+using TCharVec = std::vector<char>;
+using TCharVecUPtr = std::unique_ptr<TCharVec>;
+
+struct alignas(64) SAligned {
+    char s_Data[64];
+};
+using TAlignedVec = std::vector<SAligned>;
+using TAlignedVecUPtr = std::unique_ptr<TAlignedVec>;
+}
+
+BOOST_AUTO_TEST_CASE(testScopedTags) {
+
+    // Test tags nest, are thread local and are inherited by thread pool tasks.
+
+    BOOST_REQUIRE_EQUAL(core::CAllocationTracker::E_Untagged,
+                        core::CAllocationTracker::currentTag());
+    {
+        core::CAllocationTracker::CScopedTag outer{core::CAllocationTracker::E_Models};
+        BOOST_REQUIRE_EQUAL(core::CAllocationTracker::E_Models,
+                            core::CAllocationTracker::currentTag());
+        {
+            core::CAllocationTracker::CScopedTag inner{core::CAllocationTracker::E_Results};
+            BOOST_REQUIRE_EQUAL(core::CAllocationTracker::E_Results,
+                                core::CAllocationTracker::currentTag());
+        }
+        BOOST_REQUIRE_EQUAL(core::CAllocationTracker::E_Models,
+                            core::CAllocationTracker::currentTag());
+
+        core::CAllocationTracker::ETag otherThreadTag{core::CAllocationTracker::E_DataFrame};
+        std::thread thread{[&] { otherThreadTag = core::CAllocationTracker::currentTag(); }};
+        thread.join();
+        BOOST_REQUIRE_EQUAL(core::CAllocationTracker::E_Untagged, otherThreadTag);
+    }
+    BOOST_REQUIRE_EQUAL(core::CAllocationTracker::E_Untagged,
+                        core::CAllocationTracker::currentTag());
+
+    // Tasks scheduled on the thread pool inherit the scheduling thread's tag.
+    core::startDefaultAsyncExecutor(2);
+    {
+        core::CAllocationTracker::CScopedTag tag{core::CAllocationTracker::E_Gatherers};
+        auto result = core::async(core::defaultAsyncExecutor(), [] {
+            return core::CAllocationTracker::currentTag();
+        });
+        BOOST_REQUIRE_EQUAL(core::CAllocationTracker::E_Gatherers, result.get());
+    }
+    core::stopDefaultAsyncExecutor();
+
+    BOOST_REQUIRE_EQUAL(std::string{"data_frame"},
+                        core::CAllocationTracker::print(core::CAllocationTracker::E_DataFrame));
+}
+
+BOOST_AUTO_TEST_CASE(testLiveBytes) {
+
+    // Test allocations are attributed to the tag in scope when they're made
+    // and credited back to it when they're freed.
+
+    if (core::CAllocationTracker::enabled() == false) {
+        BOOST_REQUIRE_EQUAL(0, core::CAllocationTracker::totalLiveBytes());
+        return;
+    }
+
+    std::size_t bytes{1000000};
+    std::size_t before{core::CAllocationTracker::liveBytes(core::CAllocationTracker::E_Models)};
+
+    TCharVecUPtr buffer;
+    {
+        core::CAllocationTracker::CScopedTag tag{core::CAllocationTracker::E_Models};
+        buffer = std::make_unique<TCharVec>(bytes);
+    }
+    std::size_t during{core::CAllocationTracker::liveBytes(core::CAllocationTracker::E_Models)};
+    BOOST_TEST_REQUIRE(during >= before + bytes);
+    BOOST_TEST_REQUIRE(core::CAllocationTracker::totalLiveBytes() >= during);
+
+    {
+        // Freeing under a different tag credits the original tag.
+        core::CAllocationTracker::CScopedTag tag{core::CAllocationTracker::E_Results};
+        buffer.reset();
+    }
+    BOOST_REQUIRE_EQUAL(before, core::CAllocationTracker::liveBytes(
+                                    core::CAllocationTracker::E_Models));
+
+    // Over-aligned allocations are tracked and correctly aligned.
+    TAlignedVecUPtr aligned;
+    {
+        core::CAllocationTracker::CScopedTag tag{core::CAllocationTracker::E_Models};
+        aligned = std::make_unique<TAlignedVec>(100);
+    }
+    BOOST_TEST_REQUIRE(core::CAllocationTracker::liveBytes(core::CAllocationTracker::E_Models) >=
+                       before + 100 * sizeof(SAligned));
+    BOOST_REQUIRE_EQUAL(0, reinterpret_cast<std::uintptr_t>(aligned->data()) %
+                               alignof(SAligned));
+    aligned.reset();
+    BOOST_REQUIRE_EQUAL(before, core::CAllocationTracker::liveBytes(
+                                    core::CAllocationTracker::E_Models));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
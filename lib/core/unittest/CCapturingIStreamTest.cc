@@ -0,0 +1,93 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include <core/CCaptureReader.h>
+#include <core/CCapturingIStream.h>
+
+#include <test/CTestTmpDir.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+BOOST_AUTO_TEST_SUITE(CCapturingIStreamTest)
+
+using namespace ml;
+
+BOOST_AUTO_TEST_CASE(testCaptureAndReplay) {
+
+    // Test the captured stream reads the same data as the source and that
+    // the capture reproduces it exactly.
+
+    std::string captureFileName{test::CTestTmpDir::tmpDir() + "/capture.gz"};
+
+    std::string input;
+    for (std::size_t i = 0; i < 20000; ++i) {
+        input += "time=" + std::to_string(1000 + i) + ",value=" +
+                 std::to_string(i % 17) + '\n';
+    }
+
+    std::string read;
+    std::uint64_t bytesCaptured{0};
+    {
+        std::istringstream source{input};
+        core::CCapturingIStream captured{source, captureFileName};
+        BOOST_TEST_REQUIRE(captured.isCapturing());
+        std::string line;
+        while (std::getline(captured, line)) {
+            read += line + '\n';
+        }
+        bytesCaptured = captured.bytesCaptured();
+    }
+    BOOST_REQUIRE_EQUAL(input, read);
+    BOOST_REQUIRE_EQUAL(input.size(), bytesCaptured);
+
+    core::CCaptureReader reader{captureFileName};
+    BOOST_TEST_REQUIRE(reader.isOpen());
+    std::string replayed;
+    std::size_t chunks{0};
+    std::uint64_t lastElapsed{0};
+    std::uint64_t elapsed;
+    std::string chunk;
+    while (reader.next(elapsed, chunk)) {
+        BOOST_TEST_REQUIRE(elapsed >= lastElapsed);
+        lastElapsed = elapsed;
+        replayed += chunk;
+        ++chunks;
+    }
+    BOOST_REQUIRE_EQUAL(input, replayed);
+    BOOST_TEST_REQUIRE(chunks > 1);
+
+    std::remove(captureFileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testBadCaptureFile) {
+
+    // Test input still passes through if the capture can't be written and
+    // that a file which isn't a capture is rejected.
+
+    std::string input{"a,b,c\n1,2,3\n"};
+    {
+        std::istringstream source{input};
+        core::CCapturingIStream captured{source, "/does/not/exist/capture.gz"};
+        BOOST_TEST_REQUIRE(captured.isCapturing() == false);
+        std::ostringstream read;
+        read << captured.rdbuf();
+        BOOST_REQUIRE_EQUAL(input, read.str());
+        BOOST_REQUIRE_EQUAL(0, captured.bytesCaptured());
+    }
+
+    core::CCaptureReader reader{"testfiles/withNs.xml"};
+    BOOST_TEST_REQUIRE(reader.isOpen() == false);
+    std::uint64_t elapsed;
+    std::string chunk;
+    BOOST_TEST_REQUIRE(reader.next(elapsed, chunk) == false);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -94,6 +94,31 @@ BOOST_AUTO_TEST_CASE(testAsyncWithExecutorsAndExceptions) {
     core::stopDefaultAsyncExecutor();
 }
 
+BOOST_AUTO_TEST_CASE(testAsyncWithPriority) {
+
+    core::stopDefaultAsyncExecutor();
+
+    for (auto tag : {"sequential", "parallel"}) {
+
+        LOG_DEBUG(<< "Testing " << tag);
+
+        auto result = core::async(core::defaultAsyncExecutor(),
+                                  core::CExecutor::E_HighPriority,
+                                  [](int i) { return i + 42; }, 1);
+        BOOST_REQUIRE_EQUAL(43, result.get());
+
+        auto priority = core::async(core::defaultAsyncExecutor(),
+                                    core::CExecutor::E_LowPriority,
+                                    []() { return core::currentTaskPriority(); });
+        BOOST_REQUIRE_EQUAL(core::CExecutor::E_LowPriority, priority.get());
+        BOOST_REQUIRE_EQUAL(core::CExecutor::E_NormalPriority, core::currentTaskPriority());
+
+        core::startDefaultAsyncExecutor(2, core::CExecutor::E_WeightedPriority);
+    }
+
+    core::stopDefaultAsyncExecutor();
+}
+
 BOOST_AUTO_TEST_CASE(testParallelForEachWithEmpty) {
 
     core::startDefaultAsyncExecutor();
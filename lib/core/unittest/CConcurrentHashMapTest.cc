@@ -0,0 +1,231 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include <core/CConcurrentHashMap.h>
+#include <core/CLogger.h>
+#include <core/CMemory.h>
+#include <core/CMemoryUsage.h>
+#include <core/CStringUtils.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(CConcurrentHashMapTest)
+
+using namespace ml;
+
+namespace {
+using TSizeSizeCMap = core::CConcurrentHashMap<std::size_t, std::size_t>;
+using TStrSizeCMap = core::CConcurrentHashMap<std::string, std::size_t>;
+using TStrVec = std::vector<std::string>;
+
+//! Hashes which collide a lot to exercise probing.
+struct SBadHash {
+    std::size_t operator()(std::size_t key) const { return key % 7; }
+};
+using TSizeSizeBadHashCMap = core::CConcurrentHashMap<std::size_t, std::size_t, SBadHash>;
+}
+
+BOOST_AUTO_TEST_CASE(testInsertAndFind) {
+
+    // Test inserts and lookups against boost::unordered_map across growth.
+
+    TSizeSizeCMap map;
+    boost::unordered_map<std::size_t, std::size_t> expected;
+
+    BOOST_TEST_REQUIRE(map.empty());
+    BOOST_TEST_REQUIRE(map.find(1) == nullptr);
+
+    std::size_t initialCapacity{map.capacity()};
+    for (std::size_t i = 0; i < 10000; i += 3) {
+        auto inserted = map.insert(i, 2 * i);
+        BOOST_TEST_REQUIRE(inserted.second);
+        BOOST_REQUIRE_EQUAL(i, inserted.first->first);
+        BOOST_REQUIRE_EQUAL(2 * i, inserted.first->second);
+        expected.emplace(i, 2 * i);
+    }
+    BOOST_REQUIRE_EQUAL(expected.size(), map.size());
+    BOOST_TEST_REQUIRE(map.capacity() > initialCapacity);
+
+    // Inserting an existing key returns the existing entry.
+    auto inserted = map.insert(9, 0);
+    BOOST_TEST_REQUIRE(inserted.second == false);
+    BOOST_REQUIRE_EQUAL(18, inserted.first->second);
+
+    for (std::size_t i = 0; i < 10000; ++i) {
+        const auto* entry = map.find(i);
+        auto i_ = expected.find(i);
+        if (i_ == expected.end()) {
+            BOOST_TEST_REQUIRE(entry == nullptr);
+        } else {
+            BOOST_TEST_REQUIRE(entry != nullptr);
+            BOOST_REQUIRE_EQUAL(i_->second, entry->second);
+        }
+    }
+
+    std::size_t count{0};
+    map.forEach([&](const TSizeSizeCMap::TKeyValuePr& entry) {
+        BOOST_REQUIRE_EQUAL(expected[entry.first], entry.second);
+        ++count;
+    });
+    BOOST_REQUIRE_EQUAL(expected.size(), count);
+}
+
+BOOST_AUTO_TEST_CASE(testHeterogeneousLookup) {
+
+    // Test we can look up and insert string keys using a const char*.
+
+    struct SHash {
+        std::size_t operator()(const std::string& key) const {
+            return boost::hash<std::string>{}(key);
+        }
+        std::size_t operator()(const char* key) const {
+            return boost::hash_range(key, key + std::strlen(key));
+        }
+    };
+    struct SEqual {
+        bool operator()(const char* lhs, const std::string& rhs) const {
+            return rhs == lhs;
+        }
+    };
+
+    TStrSizeCMap map;
+    map.insert("a", 1);
+    map.insert("b", 2);
+
+    const auto* entry = map.find("b", SHash{}, SEqual{});
+    BOOST_TEST_REQUIRE(entry != nullptr);
+    BOOST_REQUIRE_EQUAL(2, entry->second);
+    BOOST_TEST_REQUIRE(map.find("c", SHash{}, SEqual{}) == nullptr);
+
+    std::size_t made{0};
+    auto make = [&] {
+        ++made;
+        return TStrSizeCMap::TKeyValuePr{"c", 3};
+    };
+    BOOST_TEST_REQUIRE(map.insert("c", SHash{}, SEqual{}, make).second);
+    BOOST_TEST_REQUIRE(map.insert("c", SHash{}, SEqual{}, make).second == false);
+    BOOST_REQUIRE_EQUAL(1, made);
+    BOOST_REQUIRE_EQUAL(3, map.find("c")->second);
+}
+
+BOOST_AUTO_TEST_CASE(testErase) {
+
+    // Test erasing preserves every other probe sequence. The hash collides
+    // heavily so probe sequences overlap and wrap.
+
+    TSizeSizeBadHashCMap map;
+    for (std::size_t i = 0; i < 200; ++i) {
+        map.insert(i, i);
+    }
+
+    BOOST_TEST_REQUIRE(map.eraseNotThreadSafe(7));
+    BOOST_TEST_REQUIRE(map.eraseNotThreadSafe(7) == false);
+    BOOST_TEST_REQUIRE(map.eraseNotThreadSafe(1000) == false);
+    BOOST_REQUIRE_EQUAL(199, map.size());
+    for (std::size_t i = 0; i < 200; ++i) {
+        BOOST_REQUIRE_EQUAL(i != 7, map.find(i) != nullptr);
+    }
+
+    std::size_t erased{map.eraseIfNotThreadSafe(
+        [](const TSizeSizeBadHashCMap::TKeyValuePr& entry) {
+            return entry.first % 2 == 0;
+        })};
+    BOOST_REQUIRE_EQUAL(100, erased);
+    BOOST_REQUIRE_EQUAL(99, map.size());
+    for (std::size_t i = 0; i < 200; ++i) {
+        BOOST_REQUIRE_EQUAL(i != 7 && i % 2 == 1, map.find(i) != nullptr);
+    }
+
+    for (std::size_t i = 0; i < 200; i += 4) {
+        map.insert(i, i);
+    }
+    for (std::size_t i = 0; i < 200; ++i) {
+        BOOST_REQUIRE_EQUAL(i != 7 && (i % 2 == 1 || i % 4 == 0),
+                            map.find(i) != nullptr);
+    }
+
+    map.clearNotThreadSafe();
+    BOOST_TEST_REQUIRE(map.empty());
+    BOOST_TEST_REQUIRE(map.find(1) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(testConcurrentInserts) {
+
+    // Test many threads inserting overlapping keys each get a single shared
+    // entry per key.
+
+    TStrVec keys;
+    for (std::size_t i = 0; i < 5000; ++i) {
+        keys.push_back(core::CStringUtils::typeToString(i));
+    }
+
+    TStrSizeCMap map;
+    std::atomic<std::size_t> inserts{0};
+    std::atomic<std::size_t> mismatches{0};
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            for (std::size_t i = 0; i < 4 * keys.size(); ++i) {
+                const std::string& key{keys[(i + 613 * t) % keys.size()]};
+                auto inserted = map.insert(key, key.size());
+                if (inserted.second) {
+                    inserts.fetch_add(1);
+                }
+                const auto* entry = map.find(key);
+                if (entry != inserted.first || entry->first != key) {
+                    mismatches.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    BOOST_REQUIRE_EQUAL(0, mismatches.load());
+    BOOST_REQUIRE_EQUAL(keys.size(), inserts.load());
+    BOOST_REQUIRE_EQUAL(keys.size(), map.size());
+}
+
+BOOST_AUTO_TEST_CASE(testMemoryUsage) {
+
+    // Test the memory usage accounts the table, nodes and key strings, and
+    // that the debug memory usage agrees.
+
+    TStrSizeCMap map;
+    std::size_t emptyMemory{core::CMemory::dynamicSize(map)};
+    BOOST_TEST_REQUIRE(emptyMemory >= map.capacity() * sizeof(void*));
+
+    std::string longKey(100, 'x');
+    map.insert(longKey, 1);
+    map.insert("short", 2);
+    std::size_t memory{core::CMemory::dynamicSize(map)};
+    LOG_DEBUG(<< "empty = " << emptyMemory << ", memory = " << memory);
+    BOOST_TEST_REQUIRE(memory >= emptyMemory + core::CMemory::dynamicSize(longKey));
+
+    for (std::size_t i = 0; i < 1000; ++i) {
+        map.insert(core::CStringUtils::typeToString(i), i);
+    }
+    memory = core::CMemory::dynamicSize(map);
+
+    auto mem = std::make_shared<core::CMemoryUsage>();
+    core::CMemoryDebug::dynamicSize("map", map, mem);
+    LOG_DEBUG(<< "memory = " << memory << ", debug memory = " << mem->usage());
+    BOOST_TEST_REQUIRE(mem->usage() <= memory);
+    BOOST_TEST_REQUIRE(mem->usage() + 1000 >= memory);
+
+    map.clearNotThreadSafe();
+    BOOST_REQUIRE_EQUAL(emptyMemory, core::CMemory::dynamicSize(map));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,265 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include <core/CDataFrame.h>
+#include <core/CDataFrameCache.h>
+#include <core/CFloatStorage.h>
+#include <core/CStringUtils.h>
+
+#include <test/CRandomNumbers.h>
+#include <test/CTestTmpDir.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(CDataFrameCacheTest)
+
+using namespace ml;
+
+namespace {
+using TDoubleVec = std::vector<double>;
+using TStrVec = std::vector<std::string>;
+using TStrVecVec = std::vector<TStrVec>;
+using TFloatVec = std::vector<core::CFloatStorage>;
+using TFloatVecVec = std::vector<TFloatVec>;
+using TInt32Vec = std::vector<std::int32_t>;
+using TUInt64Vec = core::CDataFrameCache::TUInt64Vec;
+using TRowItr = core::CDataFrame::TRowItr;
+using TDataFrameUPtr = std::unique_ptr<core::CDataFrame>;
+
+const std::string KEY{"index-1"};
+
+void writeRows(std::size_t begin, std::size_t end, core::CDataFrame& frame) {
+    test::CRandomNumbers rng;
+    TDoubleVec values;
+    rng.generateUniformSamples(0.0, 10.0, 2 * end, values);
+    for (std::size_t i = begin; i < end; ++i) {
+        const TStrVec row{core::CStringUtils::typeToString(values[2 * i]),
+                          "c" + core::CStringUtils::typeToString(i % 5),
+                          i % 7 == 0 ? "" : core::CStringUtils::typeToString(values[2 * i + 1])};
+        std::string docHash{core::CStringUtils::typeToString(3 * i + 1)};
+        frame.parseAndWriteRow(core::make_range(row, 0, row.size()), &docHash);
+    }
+    frame.finishWritingRows();
+}
+
+TDataFrameUPtr makeFrame(std::size_t rows) {
+    auto frame = core::makeMainStorageDataFrame(3).first;
+    frame->columnNames({"x", "category", "y"});
+    frame->categoricalColumns(TStrVec{"category"});
+    writeRows(0, rows, *frame);
+    return frame;
+}
+
+TUInt64Vec makeRowHashes(std::size_t rows) {
+    TUInt64Vec result(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        result[i] = 17 * i + 5;
+    }
+    return result;
+}
+
+void readRows(const core::CDataFrame& frame, TFloatVecVec& rows, TInt32Vec& docHashes) {
+    frame.readRows(1, [&](TRowItr beginRows, TRowItr endRows) {
+        for (auto row = beginRows; row != endRows; ++row) {
+            rows.emplace_back(frame.numberColumns());
+            row->copyTo(rows.back().begin());
+            docHashes.push_back(row->docHash());
+        }
+    });
+}
+
+void removeEntry(const core::CDataFrameCache& cache) {
+    boost::system::error_code errorCode;
+    boost::filesystem::remove(cache.fileName(), errorCode);
+}
+}
+
+BOOST_AUTO_TEST_CASE(testRoundTrip) {
+
+    // Test we restore the rows, document hashes, row hashes, column names and
+    // types and category dictionaries exactly.
+
+    std::size_t rows{1000};
+
+    core::CDataFrameCache cache{test::CTestTmpDir::tmpDir(), KEY};
+    removeEntry(cache);
+    BOOST_TEST_REQUIRE(cache.exists() == false);
+
+    auto frame = makeFrame(rows);
+    BOOST_TEST_REQUIRE(cache.write(*frame, makeRowHashes(rows - 1)) == false);
+    BOOST_TEST_REQUIRE(cache.exists() == false);
+    BOOST_TEST_REQUIRE(cache.write(*frame, makeRowHashes(rows)));
+    BOOST_TEST_REQUIRE(cache.exists());
+
+    TFloatVecVec expectedRows;
+    TInt32Vec expectedDocHashes;
+    readRows(*frame, expectedRows, expectedDocHashes);
+
+    for (bool named : {false, true}) {
+        auto restored = core::makeMainStorageDataFrame(3).first;
+        if (named) {
+            restored->columnNames({"x", "category", "y"});
+            restored->categoricalColumns(TStrVec{"category"});
+        }
+        TUInt64Vec rowHashes;
+        BOOST_TEST_REQUIRE(cache.read(*restored, rowHashes));
+        BOOST_REQUIRE_EQUAL(rows, restored->numberRows());
+        BOOST_TEST_REQUIRE(makeRowHashes(rows) == rowHashes);
+
+        TFloatVecVec actualRows;
+        TInt32Vec actualDocHashes;
+        readRows(*restored, actualRows, actualDocHashes);
+        BOOST_REQUIRE_EQUAL(expectedDocHashes.size(), actualDocHashes.size());
+        BOOST_TEST_REQUIRE(expectedDocHashes == actualDocHashes);
+        for (std::size_t i = 0; i < rows; ++i) {
+            for (std::size_t j = 0; j < 3; ++j) {
+                // Missing values are stored as NaN.
+                if (std::isnan(expectedRows[i][j])) {
+                    BOOST_TEST_REQUIRE(std::isnan(actualRows[i][j]));
+                } else {
+                    BOOST_REQUIRE_EQUAL(expectedRows[i][j], actualRows[i][j]);
+                }
+            }
+        }
+
+        BOOST_TEST_REQUIRE(frame->columnNames() == restored->columnNames());
+        BOOST_TEST_REQUIRE(frame->columnIsCategorical() == restored->columnIsCategorical());
+        BOOST_TEST_REQUIRE(frame->categoricalColumnValues() ==
+                           restored->categoricalColumnValues());
+    }
+
+    removeEntry(cache);
+}
+
+BOOST_AUTO_TEST_CASE(testReadPrefix) {
+
+    // Test that restoring a prefix of the cached rows and parsing the rest
+    // gives the same data frame as parsing all the rows. In particular, the
+    // category identifiers must match.
+
+    std::size_t rows{100};
+
+    core::CDataFrameCache cache{test::CTestTmpDir::tmpDir(), KEY};
+    removeEntry(cache);
+
+    // The first rows only contain some of the categories.
+    auto cached = makeFrame(rows);
+    BOOST_TEST_REQUIRE(cache.write(*cached, makeRowHashes(rows)));
+
+    TFloatVecVec expectedRows;
+    TInt32Vec expectedDocHashes;
+    readRows(*cached, expectedRows, expectedDocHashes);
+
+    auto restored = core::makeMainStorageDataFrame(3).first;
+    restored->columnNames({"x", "category", "y"});
+    restored->categoricalColumns(TStrVec{"category"});
+    TUInt64Vec rowHashes;
+    BOOST_TEST_REQUIRE(cache.read(*restored, rowHashes, 3));
+    BOOST_REQUIRE_EQUAL(3, restored->numberRows());
+    BOOST_TEST_REQUIRE(makeRowHashes(3) == rowHashes);
+    BOOST_TEST_REQUIRE((TStrVecVec{{}, {"c0", "c1", "c2"}, {}}) ==
+                       restored->categoricalColumnValues());
+
+    writeRows(3, rows, *restored);
+    BOOST_REQUIRE_EQUAL(rows, restored->numberRows());
+
+    TFloatVecVec actualRows;
+    TInt32Vec actualDocHashes;
+    readRows(*restored, actualRows, actualDocHashes);
+    BOOST_TEST_REQUIRE(expectedDocHashes == actualDocHashes);
+    for (std::size_t i = 0; i < rows; ++i) {
+        for (std::size_t j = 0; j < 3; ++j) {
+            if (std::isnan(expectedRows[i][j])) {
+                BOOST_TEST_REQUIRE(std::isnan(actualRows[i][j]));
+            } else {
+                BOOST_REQUIRE_EQUAL(expectedRows[i][j], actualRows[i][j]);
+            }
+        }
+    }
+    BOOST_TEST_REQUIRE(cached->categoricalColumnValues() ==
+                       restored->categoricalColumnValues());
+
+    removeEntry(cache);
+}
+
+BOOST_AUTO_TEST_CASE(testKeys) {
+
+    // Test different keys are stored in different entries.
+
+    core::CDataFrameCache cache1{test::CTestTmpDir::tmpDir(), "index-1"};
+    core::CDataFrameCache cache2{test::CTestTmpDir::tmpDir(), "index-2"};
+    BOOST_TEST_REQUIRE(cache1.fileName() != cache2.fileName());
+
+    removeEntry(cache1);
+    removeEntry(cache2);
+    BOOST_TEST_REQUIRE(cache1.write(*makeFrame(10), makeRowHashes(10)));
+    BOOST_TEST_REQUIRE(cache1.exists());
+    BOOST_TEST_REQUIRE(cache2.exists() == false);
+
+    removeEntry(cache1);
+}
+
+BOOST_AUTO_TEST_CASE(testMismatch) {
+
+    // Test we fail to restore into data frames with a different schema and
+    // from corrupt entries.
+
+    core::CDataFrameCache cache{test::CTestTmpDir::tmpDir(), KEY};
+    removeEntry(cache);
+    BOOST_TEST_REQUIRE(cache.write(*makeFrame(100), makeRowHashes(100)));
+
+    TUInt64Vec rowHashes;
+
+    {
+        auto restored = core::makeMainStorageDataFrame(4).first;
+        BOOST_TEST_REQUIRE(cache.read(*restored, rowHashes) == false);
+        BOOST_REQUIRE_EQUAL(0, restored->numberRows());
+    }
+    {
+        auto restored = core::makeMainStorageDataFrame(3).first;
+        restored->columnNames({"x", "category", "z"});
+        restored->categoricalColumns(TStrVec{"category"});
+        BOOST_TEST_REQUIRE(cache.read(*restored, rowHashes) == false);
+        BOOST_REQUIRE_EQUAL(0, restored->numberRows());
+    }
+    {
+        auto restored = core::makeMainStorageDataFrame(3).first;
+        restored->columnNames({"x", "category", "y"});
+        BOOST_TEST_REQUIRE(cache.read(*restored, rowHashes) == false);
+        BOOST_REQUIRE_EQUAL(0, restored->numberRows());
+    }
+
+    // Truncate the entry.
+    boost::filesystem::resize_file(cache.fileName(),
+                                   boost::filesystem::file_size(cache.fileName()) / 2);
+    {
+        auto restored = core::makeMainStorageDataFrame(3).first;
+        BOOST_TEST_REQUIRE(cache.read(*restored, rowHashes) == false);
+        BOOST_REQUIRE_EQUAL(0, restored->numberRows());
+    }
+
+    // Overwrite the format header.
+    {
+        std::ofstream file{cache.fileName(), std::ios_base::trunc | std::ios_base::binary};
+        file << "not a data frame";
+    }
+    {
+        auto restored = core::makeMainStorageDataFrame(3).first;
+        BOOST_TEST_REQUIRE(cache.read(*restored, rowHashes) == false);
+        BOOST_REQUIRE_EQUAL(0, restored->numberRows());
+    }
+
+    removeEntry(cache);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -9,6 +9,7 @@
 #include <core/CDataFrame.h>
 #include <core/CDataFrameRowSlice.h>
 #include <core/CFloatStorage.h>
+#include <core/CNumaPlacement.h>
 #include <core/CPackedBitVector.h>
 #include <core/Concurrency.h>
 
@@ -19,8 +20,15 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/unordered_map.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <functional>
+#include <iterator>
 #include <mutex>
+#include <numeric>
+#include <set>
+#include <string>
+#include <thread>
 #include <vector>
 
 BOOST_AUTO_TEST_SUITE(CDataFrameTest)
@@ -31,8 +39,10 @@ namespace {
 using TBoolVec = std::vector<bool>;
 using TDoubleVec = std::vector<double>;
 using TSizeVec = std::vector<std::size_t>;
+using TSizeVecVec = std::vector<TSizeVec>;
 using TFloatVec =
     std::vector<core::CFloatStorage, core::CAlignedAllocator<core::CFloatStorage>>;
+using TFloatVecVec = std::vector<TFloatVec>;
 using TFloatVecItr = TFloatVec::iterator;
 using TFloatVecCItr = TFloatVec::const_iterator;
 using TSizeFloatVecUMap = boost::unordered_map<std::size_t, TFloatVec>;
@@ -114,6 +124,19 @@ public:
     ~CTestFixture() { core::stopDefaultAsyncExecutor(); }
 };
 
+class CNumaAwareTestFixture {
+public:
+    CNumaAwareTestFixture() {
+        core::CNumaPlacement::configure(true, true);
+        core::startDefaultAsyncExecutor();
+    }
+
+    ~CNumaAwareTestFixture() {
+        core::stopDefaultAsyncExecutor();
+        core::CNumaPlacement::configure(false, false);
+    }
+};
+
 BOOST_FIXTURE_TEST_CASE(testInMainMemoryBasicReadWrite, CTestFixture) {
 
     // Check we get the rows we write to the data frame in the order we write them.
@@ -263,6 +286,64 @@ BOOST_FIXTURE_TEST_CASE(testOnDiskParallelRead, CTestFixture) {
     BOOST_REQUIRE_EQUAL(rows, rowsRead);
 }
 
+BOOST_AUTO_TEST_CASE(testOnDiskPrefetch) {
+
+    // Check that prefetching slices and writing them back asynchronously
+    // visits rows in order and that the writes are visible to later reads
+    // for both the sequential and thread pool executors.
+
+    std::size_t rows{5000};
+    std::size_t cols{10};
+    std::size_t capacity{100};
+    TFloatVec components{testData(rows, cols)};
+
+    for (std::size_t threads : {0, 2}) {
+        LOG_DEBUG(<< "# threads = " << threads);
+        if (threads > 0) {
+            core::startDefaultAsyncExecutor(threads);
+        }
+
+        auto frame = core::makeDiskStorageDataFrame(
+                         test::CTestTmpDir::tmpDir(), cols, rows, capacity,
+                         core::CDataFrame::EReadWriteToStorage::E_Async)
+                         .first;
+        for (std::size_t i = 0; i < components.size(); i += cols) {
+            frame->writeRow(makeWriter(components, cols, i));
+        }
+        frame->finishWritingRows();
+
+        frame->resizeColumns(1, cols + 1);
+        bool inOrder{true};
+        std::size_t nextRow{0};
+        bool successful;
+        std::tie(std::ignore, successful) =
+            frame->writeColumns(1, [&](TRowItr beginRows, TRowItr endRows) {
+                for (auto row = beginRows; row != endRows; ++row) {
+                    inOrder &= (row->index() == nextRow++);
+                    row->writeColumn(cols, static_cast<double>(row->index()));
+                }
+            });
+        BOOST_TEST_REQUIRE(successful);
+        BOOST_TEST_REQUIRE(inOrder);
+        BOOST_REQUIRE_EQUAL(rows, nextRow);
+
+        bool passed{true};
+        nextRow = 0;
+        std::tie(std::ignore, successful) =
+            frame->readRows(1, [&](TRowItr beginRows, TRowItr endRows) {
+                for (auto row = beginRows; row != endRows; ++row) {
+                    passed &= (row->index() == nextRow++);
+                    passed &= ((*row)[cols] == static_cast<double>(row->index()));
+                }
+            });
+        BOOST_TEST_REQUIRE(successful);
+        BOOST_TEST_REQUIRE(passed);
+        BOOST_REQUIRE_EQUAL(rows, nextRow);
+
+        core::stopDefaultAsyncExecutor();
+    }
+}
+
 BOOST_FIXTURE_TEST_CASE(testReadRange, CTestFixture) {
 
     // Check we get the only the rows rows we request.
@@ -700,6 +781,54 @@ BOOST_FIXTURE_TEST_CASE(testDocHashes, CTestFixture) {
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(testClearRows, CTestFixture) {
+
+    // Test we can reuse a data frame for successive batches of rows and that
+    // the categories are rebuilt for each batch.
+
+    using TStrVec = std::vector<std::string>;
+    using TStrVecVec = std::vector<TStrVec>;
+
+    std::size_t cols{3};
+    std::size_t capacity{100};
+
+    auto frame = core::makeMainStorageDataFrame(cols, capacity).first;
+    frame->columnNames({"x1", "x2", "x3"});
+    frame->categoricalColumns(TStrVec{"x2"});
+
+    TStrVecVec batches[]{{{"1.0", "a", "2.0"}, {"3.0", "b", "4.0"}, {"5.0", "a", "6.0"}},
+                         {{"7.0", "c", "8.0"}, {"9.0", "a", "10.0"}}};
+    TStrVecVec expectedCategories[]{{{}, {"a", "b"}, {}}, {{}, {"c", "a"}, {}}};
+    TDoubleVec expectedIds[]{{0.0, 1.0, 0.0}, {0.0, 1.0}};
+
+    for (std::size_t batch = 0; batch < 2; ++batch) {
+        for (const auto& fieldValues : batches[batch]) {
+            frame->parseAndWriteRow(
+                core::CVectorRange<const TStrVec>(fieldValues, 0, cols));
+        }
+        frame->finishWritingRows();
+
+        BOOST_REQUIRE_EQUAL(batches[batch].size(), frame->numberRows());
+        BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedCategories[batch]),
+                            core::CContainerPrinter::print(frame->categoricalColumnValues()));
+
+        TDoubleVec ids;
+        TDoubleVec values;
+        frame->readRows(1, [&](TRowItr beginRows, TRowItr endRows) {
+            for (auto row = beginRows; row != endRows; ++row) {
+                ids.push_back((*row)[1]);
+                values.push_back((*row)[0]);
+            }
+        });
+        BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedIds[batch]),
+                            core::CContainerPrinter::print(ids));
+        BOOST_REQUIRE_EQUAL(std::stod(batches[batch][0][0]), values[0]);
+
+        frame->clearRows();
+        BOOST_REQUIRE_EQUAL(std::size_t{0}, frame->numberRows());
+    }
+}
+
 BOOST_FIXTURE_TEST_CASE(testRowMask, CTestFixture) {
 
     // Test we read only the rows in a mask.
@@ -834,6 +963,286 @@ BOOST_FIXTURE_TEST_CASE(testRowMask, CTestFixture) {
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(testNumaAwareReadRows, CNumaAwareTestFixture) {
+
+    // Test NUMA aware reads visit every row exactly once, respect the row mask
+    // and range and see the values after slices are appended, relocated and
+    // reserved.
+
+    std::size_t rows{5000};
+    std::size_t cols{10};
+    std::size_t extraCols{2};
+    std::size_t capacity{300};
+    std::size_t batches{3};
+    TFloatVec components{testData(rows, cols)};
+
+    test::CRandomNumbers rng;
+
+    // Write the rows in several batches so slices are appended to ones which
+    // have already been placed.
+    auto frame = core::makeMainStorageDataFrame(cols, capacity).first;
+    for (std::size_t i = 0; i < batches; ++i) {
+        for (std::size_t j = (i * rows) / batches; j < ((i + 1) * rows) / batches; ++j) {
+            frame->writeRow(makeWriter(components, cols, j * cols));
+        }
+        frame->finishWritingRows();
+    }
+    BOOST_REQUIRE_EQUAL(rows, frame->numberRows());
+
+    for (auto numberThreads : {1, 3}) {
+        LOG_DEBUG(<< "# threads = " << numberThreads);
+
+        // Check that reserving, which reallocates the slices, is handled.
+        std::size_t numberColumns{numberThreads == 3 ? cols + extraCols : cols};
+        frame->resizeColumns(numberThreads, numberColumns);
+
+        std::vector<CThreadReader> readers;
+        bool successful;
+        std::tie(readers, successful) = frame->readRows(numberThreads, CThreadReader{});
+        BOOST_TEST_REQUIRE(successful);
+
+        TBoolVec rowRead(rows, false);
+        for (const auto& reader : readers) {
+            BOOST_REQUIRE_EQUAL(false, reader.duplicates());
+            for (const auto& row : reader.rowsRead()) {
+                BOOST_REQUIRE_EQUAL(numberColumns, row.second.size());
+                BOOST_TEST_REQUIRE(std::equal(components.begin() + row.first * cols,
+                                              components.begin() + (row.first + 1) * cols,
+                                              row.second.begin()));
+                BOOST_REQUIRE_EQUAL(false, rowRead[row.first]);
+                rowRead[row.first] = true;
+            }
+        }
+        std::size_t rowsRead(std::count(rowRead.begin(), rowRead.end(), true));
+        BOOST_REQUIRE_EQUAL(rows, rowsRead);
+
+        TSizeVec strides;
+        TSizeVec rowMaskIndices;
+        TSizeVec readRowsIndices;
+        for (std::size_t i = 0; i < 20; ++i) {
+            rng.generateUniformSamples(0, 50, 150, strides);
+
+            core::CPackedBitVector rowMask{strides[0] == 0};
+            for (auto stride : strides) {
+                if (rowMask.size() + stride > rows) {
+                    break;
+                }
+                if (stride > 0) {
+                    rowMask.extend(false, stride);
+                    rowMask.extend(true);
+                }
+            }
+            rowMask.extend(false, rows - rowMask.size());
+            rowMaskIndices.clear();
+            std::copy_if(rowMask.beginOneBits(), rowMask.endOneBits(),
+                         std::back_inserter(rowMaskIndices),
+                         [](std::size_t index) { return index >= 950 && index < 4100; });
+
+            auto results =
+                frame
+                    ->readRows(numberThreads, 950, 4100,
+                               core::bindRetrievableState(
+                                   [](TSizeVec& readerReadRowsIndices,
+                                      TRowItr beginRows, TRowItr endRows) mutable {
+                                       for (auto row = beginRows; row != endRows; ++row) {
+                                           readerReadRowsIndices.push_back(row->index());
+                                       }
+                                   },
+                                   TSizeVec{}),
+                               &rowMask)
+                    .first;
+
+            readRowsIndices.clear();
+            for (const auto& result : results) {
+                readRowsIndices.insert(readRowsIndices.end(),
+                                       result.s_FunctionState.begin(),
+                                       result.s_FunctionState.end());
+            }
+            std::sort(readRowsIndices.begin(), readRowsIndices.end());
+
+            BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(rowMaskIndices),
+                                core::CContainerPrinter::print(readRowsIndices));
+        }
+    }
+
+    // Test relocating a slice preserves its state.
+
+    TFloatVec sliceRows(components.begin(), components.begin() + 100 * cols);
+    core::CDataFrameRowSlice::TInt32Vec docHashes(100);
+    std::iota(docHashes.begin(), docHashes.end(), 0);
+    core::CMainMemoryDataFrameRowSlice slice{0, sliceRows, docHashes};
+    slice.relocate();
+    auto handle = slice.read();
+    BOOST_TEST_REQUIRE(std::equal(sliceRows.begin(), sliceRows.end(), handle.rows().begin()));
+    BOOST_TEST_REQUIRE(docHashes == handle.docHashes());
+}
+
+BOOST_FIXTURE_TEST_CASE(testRowIndices, CTestFixture) {
+
+    // Test we read exactly the rows with the supplied indices and that each
+    // reader reads a contiguous block of the indices in order.
+
+    std::size_t rows{5000};
+    std::size_t cols{15};
+    std::size_t extraCols{3};
+    std::size_t capacity{1000};
+    TFloatVec components{testData(rows, cols + extraCols)};
+
+    test::CRandomNumbers rng;
+
+    TFactoryFunc makeOnDisk = [=] {
+        return core::makeDiskStorageDataFrame(
+                   boost::filesystem::current_path().string(), cols, rows,
+                   capacity, core::CDataFrame::EReadWriteToStorage::E_Async)
+            .first;
+    };
+    TFactoryFunc makeMainMemory = [=] {
+        return core::makeMainStorageDataFrame(
+                   cols, capacity, core::CDataFrame::EReadWriteToStorage::E_Sync)
+            .first;
+    };
+
+    std::string type[]{"on disk", "main memory"};
+    std::size_t t{0};
+    for (const auto& factory : {makeOnDisk, makeMainMemory}) {
+        LOG_DEBUG(<< "Test read row indices " << type[t++]);
+
+        auto frame = factory();
+
+        for (std::size_t i = 0; i < components.size(); i += cols + extraCols) {
+            frame->writeRow(makeWriter(components, cols, i));
+        }
+        frame->finishWritingRows();
+
+        TSizeVec strides;
+        TSizeVec rowIndices;
+        TSizeVecVec readRowsIndices;
+        TFloatVecVec readRowsValues;
+
+        for (std::size_t numberThreads : {1, 3}) {
+            LOG_DEBUG(<< "# threads = " << numberThreads);
+
+            for (std::size_t i = 0; i < 100; ++i) {
+                rng.generateUniformSamples(1, 50, 200, strides);
+
+                rowIndices.clear();
+                for (std::size_t index = strides[0] - 1, j = 1;
+                     index < rows && j < strides.size(); index += strides[j++]) {
+                    rowIndices.push_back(index);
+                }
+
+                readRowsIndices.assign(numberThreads, TSizeVec{});
+                readRowsValues.assign(numberThreads, TFloatVec{});
+                core::CDataFrame::TRowFuncVec readers;
+                for (std::size_t j = 0; j < numberThreads; ++j) {
+                    readers.push_back([&readRowsIndices, &readRowsValues,
+                                       j](TRowItr beginRows, TRowItr endRows) {
+                        for (auto row = beginRows; row != endRows; ++row) {
+                            readRowsIndices[j].push_back(row->index());
+                            readRowsValues[j].push_back((*row)[0]);
+                        }
+                    });
+                }
+
+                BOOST_TEST_REQUIRE(frame->readRows(rowIndices.begin(),
+                                                   rowIndices.end(), readers));
+
+                TSizeVec allReadRowsIndices;
+                for (std::size_t j = 0; j < numberThreads; ++j) {
+                    for (std::size_t k = 0; k < readRowsIndices[j].size(); ++k) {
+                        std::size_t index{readRowsIndices[j][k]};
+                        BOOST_REQUIRE_EQUAL(components[index * (cols + extraCols)],
+                                            readRowsValues[j][k]);
+                        allReadRowsIndices.push_back(index);
+                    }
+                }
+                BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(rowIndices),
+                                    core::CContainerPrinter::print(allReadRowsIndices));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testRowIndicesForSeveralRanges) {
+
+    // Test reading several ranges of row indices is equivalent to reading each
+    // range separately and that the reads run on several threads.
+
+    std::size_t rows{5000};
+    std::size_t cols{15};
+    std::size_t capacity{1000};
+    std::size_t numberRanges{4};
+    std::size_t numberThreads{2};
+    TFloatVec components{testData(rows, cols)};
+
+    core::startDefaultAsyncExecutor(numberRanges * numberThreads);
+
+    auto frame = core::makeMainStorageDataFrame(cols, capacity).first;
+    for (std::size_t i = 0; i < components.size(); i += cols) {
+        frame->writeRow(makeWriter(components, cols, i));
+    }
+    frame->finishWritingRows();
+
+    // Disjoint ranges of every third row.
+    TSizeVec rowIndices;
+    for (std::size_t i = 0; i < rows; i += 3) {
+        rowIndices.push_back(i);
+    }
+    core::CDataFrame::TSizeVecCItrPrVec rowIndexRanges;
+    for (std::size_t i = 0; i < numberRanges; ++i) {
+        rowIndexRanges.emplace_back(
+            rowIndices.begin() + (i * rowIndices.size()) / numberRanges,
+            rowIndices.begin() + ((i + 1) * rowIndices.size()) / numberRanges);
+    }
+
+    std::mutex threadIdsMutex;
+    std::set<std::thread::id> threadIds;
+    TSizeVecVec readRowsIndices(numberRanges * numberThreads);
+    TFloatVecVec readRowsValues(numberRanges * numberThreads);
+    core::CDataFrame::TRowFuncVecVec readers(numberRanges);
+    for (std::size_t i = 0; i < numberRanges; ++i) {
+        for (std::size_t j = 0; j < numberThreads; ++j) {
+            std::size_t k{numberThreads * i + j};
+            readers[i].push_back([&, k](TRowItr beginRows, TRowItr endRows) {
+                for (auto row = beginRows; row != endRows; ++row) {
+                    readRowsIndices[k].push_back(row->index());
+                    readRowsValues[k].push_back((*row)[0]);
+                }
+                // Make sure each read takes long enough that all threads get
+                // some work.
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                std::lock_guard<std::mutex> lock{threadIdsMutex};
+                threadIds.insert(std::this_thread::get_id());
+            });
+        }
+    }
+
+    BOOST_TEST_REQUIRE(frame->readRows(rowIndexRanges, readers));
+
+    // The thread pool size is capped at the hardware concurrency.
+    LOG_DEBUG(<< "# threads used = " << threadIds.size());
+    if (std::thread::hardware_concurrency() > 1) {
+        BOOST_TEST_REQUIRE(threadIds.size() > 1);
+    }
+
+    TSizeVec allReadRowsIndices;
+    for (std::size_t k = 0; k < readRowsIndices.size(); ++k) {
+        for (std::size_t l = 0; l < readRowsIndices[k].size(); ++l) {
+            std::size_t index{readRowsIndices[k][l]};
+            BOOST_REQUIRE_EQUAL(components[index * cols], readRowsValues[k][l]);
+            allReadRowsIndices.push_back(index);
+        }
+    }
+    BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(rowIndices),
+                        core::CContainerPrinter::print(allReadRowsIndices));
+
+    // Mismatched ranges and readers is an error.
+    readers.pop_back();
+    BOOST_TEST_REQUIRE(frame->readRows(rowIndexRanges, readers) == false);
+
+    core::stopDefaultAsyncExecutor();
+}
+
 BOOST_FIXTURE_TEST_CASE(testAlignment, CTestFixture) {
 
     // Test all the rows have the requested alignment.
@@ -5,10 +5,13 @@
  */
 
 #include <core/CJsonStateRestoreTraverser.h>
+#include <core/CStringUtils.h>
 
 #include <boost/test/unit_test.hpp>
 
 #include <sstream>
+#include <string>
+#include <utility>
 
 BOOST_AUTO_TEST_SUITE(CJsonStateRestoreTraverserTest)
 
@@ -217,4 +220,60 @@ BOOST_AUTO_TEST_CASE(testRestore1IgnoreArraysNested) {
     BOOST_TEST_REQUIRE(!traverser.next());
 }
 
+BOOST_AUTO_TEST_CASE(testRestoreInsitu) {
+    // Check in-situ parsing restores exactly the same as streaming.
+
+    using TTraverseFunc = bool (*)(ml::core::CStateRestoreTraverser&);
+
+    std::pair<std::string, TTraverseFunc> documents[]{
+        {"{\"_source\":{\"level1A\":\"a\",\"level1B\":\"25\",\"level1C\":{\"level2A\":\"3.14\",\"level2B\":\"z\"}}}",
+         &traverse1stLevel1},
+        {"{\"_source\":{\"level1A\":\"a\",\"level1B\":\"25\",\"level1C\":{\"level2A\":\"3.14\",\"level2B\":\"z\"},\"level1D\":"
+         "\"afterAscending\"}}",
+         &traverse1stLevel2},
+        {"{\"_source\":{\"level1A\":\"a\",\"level1B\":\"25\",\"level1C\":{},\"level1D\":\"afterAscending\"}}",
+         &traverse1stLevel3},
+        {"{\"_source\":{\"level1A\":\"a\",\"level1B\":\"25\",\"level1C\":{\"level2A\":\"3.14\",\"level2B\":\"z\"}}}",
+         &traverse1stLevel4},
+        {"{\"_source\":{\"level1A\":\"a\",\"someArray\":[{\"nestedArray\":[42]}],\"level1B\":\"25\",\"level1C\":{\"level2A\":"
+         "\"3.14\",\"level2B\":\"z\"}}}",
+         &traverse1stLevel1}};
+
+    for (auto& document : documents) {
+        ml::core::CJsonStateRestoreTraverser traverser(document.first);
+
+        BOOST_REQUIRE_EQUAL(std::string("_source"), traverser.name());
+        BOOST_TEST_REQUIRE(traverser.hasSubLevel());
+        BOOST_TEST_REQUIRE(traverser.traverseSubLevel(document.second));
+        BOOST_TEST_REQUIRE(!traverser.next());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testInsitu) {
+    // Check escaped strings and numbers when parsing in-situ.
+
+    std::string json("{\"a\":\"x\\\"y\",\"b\":1.0e-10,\"c\":-7,\"d\":false,\"e\":\"\"}");
+
+    ml::core::CJsonStateRestoreTraverser traverser(json);
+
+    BOOST_REQUIRE_EQUAL(std::string("a"), traverser.name());
+    BOOST_REQUIRE_EQUAL(std::string("x\"y"), traverser.value());
+    BOOST_TEST_REQUIRE(traverser.next());
+    BOOST_REQUIRE_EQUAL(std::string("b"), traverser.name());
+    BOOST_REQUIRE_EQUAL(std::string("1.0e-10"), traverser.value());
+    double b;
+    BOOST_TEST_REQUIRE(ml::core::CStringUtils::stringToType(traverser.value(), b));
+    BOOST_REQUIRE_EQUAL(1e-10, b);
+    BOOST_TEST_REQUIRE(traverser.next());
+    BOOST_REQUIRE_EQUAL(std::string("c"), traverser.name());
+    BOOST_REQUIRE_EQUAL(std::string("-7"), traverser.value());
+    BOOST_TEST_REQUIRE(traverser.next());
+    BOOST_REQUIRE_EQUAL(std::string("d"), traverser.name());
+    BOOST_REQUIRE_EQUAL(std::string("false"), traverser.value());
+    BOOST_TEST_REQUIRE(traverser.next());
+    BOOST_REQUIRE_EQUAL(std::string("e"), traverser.name());
+    BOOST_TEST_REQUIRE(traverser.value().empty());
+    BOOST_TEST_REQUIRE(!traverser.next());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,93 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include <core/CAlignment.h>
+#include <core/CNumaPlacement.h>
+#include <core/Concurrency.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <future>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(CNumaPlacementTest)
+
+using namespace ml;
+
+namespace {
+using TSizeVec = std::vector<std::size_t>;
+}
+
+BOOST_AUTO_TEST_CASE(testTopology) {
+
+    // Test the node of the current thread is valid and we run on each node
+    // once and, if we're bound to it, on that node.
+
+    std::size_t numberNodes{core::CNumaPlacement::numberNodes()};
+    LOG_DEBUG(<< "# nodes = " << numberNodes);
+    BOOST_TEST_REQUIRE(numberNodes >= 1);
+    BOOST_TEST_REQUIRE(core::CNumaPlacement::currentNode() < numberNodes);
+
+    std::mutex mutex;
+    TSizeVec nodesRun;
+    core::CNumaPlacement::runOnEachNode([&](std::size_t node) {
+        std::size_t currentNode{core::CNumaPlacement::currentNode()};
+        std::lock_guard<std::mutex> lock{mutex};
+        nodesRun.push_back(node);
+        if (numberNodes > 1) {
+            BOOST_REQUIRE_EQUAL(node, currentNode);
+        }
+    });
+    std::sort(nodesRun.begin(), nodesRun.end());
+    TSizeVec expectedNodesRun(numberNodes);
+    std::iota(expectedNodesRun.begin(), expectedNodesRun.end(), 0);
+    BOOST_TEST_REQUIRE(expectedNodesRun == nodesRun);
+
+    // Binding to a node which doesn't exist fails.
+    std::thread thread{[numberNodes] {
+        BOOST_REQUIRE_EQUAL(false, core::CNumaPlacement::bindCurrentThreadToNode(numberNodes));
+    }};
+    thread.join();
+}
+
+BOOST_AUTO_TEST_CASE(testConfigure) {
+
+    // Test the configuration is remembered and thread pool workers run on valid
+    // nodes when we're NUMA aware.
+
+    BOOST_REQUIRE_EQUAL(false, core::CNumaPlacement::numaAware());
+
+    core::CNumaPlacement::configure(true, true);
+    BOOST_REQUIRE_EQUAL(true, core::CNumaPlacement::numaAware());
+
+    core::startDefaultAsyncExecutor(4);
+    std::vector<std::future<std::size_t>> nodes;
+    for (std::size_t i = 0; i < 8; ++i) {
+        nodes.push_back(core::async(core::defaultAsyncExecutor(),
+                                    [] { return core::CNumaPlacement::currentNode(); }));
+    }
+    for (auto& node : nodes) {
+        BOOST_TEST_REQUIRE(node.get() < core::CNumaPlacement::numberNodes());
+    }
+    core::stopDefaultAsyncExecutor();
+
+    // Advising huge pages must leave the memory usable.
+    std::vector<double, core::CAlignedAllocator<double>> values;
+    values.reserve(1000000);
+    core::CNumaPlacement::adviseHugePages(values.data(), 1000000 * sizeof(double));
+    values.resize(1000000, 1.0);
+    BOOST_REQUIRE_EQUAL(1000000.0, std::accumulate(values.begin(), values.end(), 0.0));
+
+    core::CNumaPlacement::configure(false, false);
+    BOOST_REQUIRE_EQUAL(false, core::CNumaPlacement::numaAware());
+    BOOST_REQUIRE_EQUAL(false, core::CNumaPlacement::hugePages());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,17 +6,20 @@
 
 #include <core/CLogger.h>
 #include <core/CRapidJsonLineWriter.h>
+#include <core/CScopedRapidJsonPoolAllocator.h>
 #include <core/CStopWatch.h>
 #include <core/CStringUtils.h>
 
 // beware: testing internal methods of rapidjson, might break after update
 #include <rapidjson/internal/dtoa.h>
 #include <rapidjson/ostreamwrapper.h>
+#include <rapidjson/stringbuffer.h>
 
 #include <boost/test/unit_test.hpp>
 
 #include <limits>
 #include <sstream>
+#include <vector>
 
 #include <stdio.h>
 
@@ -90,6 +93,113 @@ BOOST_AUTO_TEST_CASE(testDoublePrecissionDtoa) {
     BOOST_REQUIRE_EQUAL(std::string("1e-300"), std::string(buffer, ret));
 }
 
+BOOST_AUTO_TEST_CASE(testWriteMembers) {
+
+    // Check streaming extra fields after a document's members gives the same
+    // output as adding them to the document.
+
+    using TGenericLineWriter =
+        ml::core::CRapidJsonLineWriter<rapidjson::OStreamWrapper, rapidjson::UTF8<>,
+                                       rapidjson::UTF8<>, rapidjson::CrtAllocator>;
+
+    auto makeDoc = [](const TGenericLineWriter& writer) {
+        rapidjson::Document doc{writer.makeDoc()};
+        writer.addStringFieldReferenceToObj(STR_NAME, STR_NAME, doc);
+        rapidjson::Value nested{writer.makeObject()};
+        writer.addDoubleFieldToObj(DOUBLE_NAME, 1.5, nested);
+        writer.addMember(EMPTY1_NAME, nested, doc);
+        writer.addDoubleArrayFieldToObj(DOUBLE_ARRAY_NAME, std::vector<double>{0.5, 2.0}, doc);
+        return doc;
+    };
+
+    std::ostringstream expected;
+    {
+        rapidjson::OStreamWrapper writeStream(expected);
+        TGenericLineWriter writer(writeStream);
+        rapidjson::Document doc{makeDoc(writer)};
+        writer.StartObject();
+        writer.Key(STR_ARRAY_NAME);
+        writer.StartArray();
+        writer.addIntFieldToObj(INT_NAME, -3, doc);
+        writer.addTimeFieldToObj(TTIME_ARRAY_NAME, 10, doc);
+        writer.addBoolFieldToObj(BOOL_NAME, true, doc);
+        writer.write(doc);
+        writer.EndArray();
+        writer.EndObject();
+    }
+
+    std::ostringstream actual;
+    {
+        rapidjson::OStreamWrapper writeStream(actual);
+        TGenericLineWriter writer(writeStream);
+        rapidjson::Document doc{makeDoc(writer)};
+        writer.StartObject();
+        writer.Key(STR_ARRAY_NAME);
+        writer.StartArray();
+        writer.StartObject();
+        writer.writeMembers(doc);
+        writer.Key(INT_NAME);
+        writer.Int64(-3);
+        writer.Key(TTIME_ARRAY_NAME);
+        writer.Time(10);
+        writer.Key(BOOL_NAME);
+        writer.Bool(true);
+        writer.EndObject();
+        writer.EndArray();
+        writer.EndObject();
+    }
+
+    LOG_DEBUG(<< "actual = " << actual.str());
+    BOOST_REQUIRE_EQUAL(expected.str(), actual.str());
+}
+
+BOOST_AUTO_TEST_CASE(testStreamingMicroBenchmark, *boost::unit_test::disabled()) {
+
+    // Compare adding fields to a document before writing it with streaming
+    // them straight to the output.
+
+    using TGenericLineWriter =
+        ml::core::CRapidJsonLineWriter<rapidjson::StringBuffer, rapidjson::UTF8<>,
+                                       rapidjson::UTF8<>, rapidjson::CrtAllocator>;
+    rapidjson::StringBuffer buffer;
+    TGenericLineWriter writer(buffer);
+    std::string jobId{"job"};
+    std::size_t runs{1000000};
+
+    ml::core::CStopWatch stopWatch{true};
+    for (std::size_t i = 0; i < runs; ++i) {
+        ml::core::CScopedRapidJsonPoolAllocator<TGenericLineWriter> allocator{"benchmark", writer};
+        rapidjson::Document doc{writer.makeDoc()};
+        writer.addDoubleFieldToObj(DOUBLE_NAME, 0.5, doc);
+        writer.addStringFieldCopyToObj(STR_NAME, jobId, doc);
+        writer.addIntFieldToObj(INT_NAME, 2, doc);
+        writer.addTimeFieldToObj(TTIME_ARRAY_NAME, 1000, doc);
+        writer.write(doc);
+        buffer.Clear();
+        writer.Reset(buffer);
+    }
+    std::uint64_t elapsed{stopWatch.stop()};
+    LOG_INFO(<< "Writing via a document " << runs << " runs took " << elapsed);
+
+    stopWatch.reset(true);
+    for (std::size_t i = 0; i < runs; ++i) {
+        writer.StartObject();
+        writer.Key(DOUBLE_NAME);
+        writer.Double(0.5);
+        writer.Key(STR_NAME);
+        writer.String(jobId);
+        writer.Key(INT_NAME);
+        writer.Int64(2);
+        writer.Key(TTIME_ARRAY_NAME);
+        writer.Time(1000);
+        writer.EndObject();
+        buffer.Clear();
+        writer.Reset(buffer);
+    }
+    elapsed = stopWatch.stop();
+    LOG_INFO(<< "Streaming " << runs << " runs took " << elapsed);
+}
+
 BOOST_AUTO_TEST_CASE(testMicroBenchmark, *boost::unit_test::disabled()) {
     char buffer[100];
     ml::core::CStopWatch stopWatch;
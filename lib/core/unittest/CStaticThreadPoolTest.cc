@@ -13,7 +13,11 @@
 
 #include <atomic>
 #include <chrono>
+#include <future>
+#include <mutex>
+#include <numeric>
 #include <thread>
+#include <vector>
 
 BOOST_AUTO_TEST_SUITE(CStaticThreadPoolTest)
 
@@ -34,6 +38,60 @@ void slowTask(std::atomic_uint& counter) {
     std::this_thread::sleep_for(pause);
     ++counter;
 }
+
+using TPriorityVec = std::vector<core::CExecutor::EPriority>;
+
+//! Block the pool's single worker until the returned promise is satisfied.
+std::promise<void> blockWorker(core::CStaticThreadPool& pool) {
+    std::promise<void> started;
+    std::promise<void> release;
+    pool.schedule([&started, released = release.get_future().share() ] {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+    return release;
+}
+
+//! Run \p numbers[p] tasks with each priority p on a single worker pool and
+//! get the order in which the priorities ran.
+TPriorityVec executionOrder(core::CExecutor::EScheduling scheduling,
+                            const std::vector<std::size_t>& numbers) {
+    std::mutex mutex;
+    TPriorityVec result;
+    {
+        core::CStaticThreadPool pool{1, scheduling};
+        auto release = blockWorker(pool);
+        for (std::size_t p = numbers.size(); p > 0; --p) {
+            auto priority = static_cast<core::CExecutor::EPriority>(p - 1);
+            for (std::size_t i = 0; i < numbers[p - 1]; ++i) {
+                pool.schedule(
+                    [&, priority] {
+                        std::lock_guard<std::mutex> lock{mutex};
+                        result.push_back(priority);
+                    },
+                    priority);
+            }
+        }
+        for (std::size_t p = 0; p < numbers.size(); ++p) {
+            BOOST_REQUIRE_EQUAL(numbers[p], pool.queueDepth(
+                                                static_cast<core::CExecutor::EPriority>(p)));
+        }
+        release.set_value();
+
+        // Wait for the worker to finish since the pool's destructor would run
+        // any queued tasks on this thread.
+        std::size_t total{std::accumulate(numbers.begin(), numbers.end(), std::size_t{0})};
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            std::lock_guard<std::mutex> lock{mutex};
+            if (result.size() == total) {
+                break;
+            }
+        }
+    }
+    return result;
+}
 }
 
 // ASSERTIONS BASED ON TIMINGS ARE NOT RELIABLE IN OUR VIRTUALISED TEST ENVIRONMENT
@@ -200,4 +258,78 @@ BOOST_AUTO_TEST_CASE(testWithExceptions) {
     BOOST_REQUIRE_EQUAL(200u, counter.load());
 }
 
+BOOST_AUTO_TEST_CASE(testStrictPriority) {
+
+    // Check higher priority tasks run first, but that lower priority tasks
+    // aren't starved.
+
+    TPriorityVec order{executionOrder(core::CExecutor::E_StrictPriority, {40, 0, 10})};
+    BOOST_REQUIRE_EQUAL(50, order.size());
+
+    std::ptrdiff_t firstLow{
+        std::find(order.begin(), order.end(), core::CExecutor::E_LowPriority) -
+        order.begin()};
+    std::ptrdiff_t lastHigh{
+        order.rend() -
+        std::find(order.rbegin(), order.rend(), core::CExecutor::E_HighPriority) - 1};
+    LOG_DEBUG(<< "first low = " << firstLow << ", last high = " << lastHigh);
+    BOOST_TEST_REQUIRE(firstLow >= 15);
+    BOOST_TEST_REQUIRE(firstLow < lastHigh);
+    BOOST_REQUIRE_EQUAL(1, std::count(order.begin(), order.begin() + 40,
+                                      core::CExecutor::E_LowPriority));
+}
+
+BOOST_AUTO_TEST_CASE(testWeightedPriority) {
+
+    // Check each lane gets its share of the worker whilst it has tasks.
+
+    TPriorityVec order{executionOrder(core::CExecutor::E_WeightedPriority, {30, 30, 30})};
+    BOOST_REQUIRE_EQUAL(90, order.size());
+
+    std::size_t numberHigh(std::count(order.begin(), order.begin() + 26,
+                                      core::CExecutor::E_HighPriority));
+    std::size_t numberNormal(std::count(order.begin(), order.begin() + 26,
+                                        core::CExecutor::E_NormalPriority));
+    std::size_t numberLow(std::count(order.begin(), order.begin() + 26,
+                                     core::CExecutor::E_LowPriority));
+    LOG_DEBUG(<< "high = " << numberHigh << ", normal = " << numberNormal
+              << ", low = " << numberLow);
+    BOOST_REQUIRE_EQUAL(16, numberHigh);
+    BOOST_REQUIRE_EQUAL(8, numberNormal);
+    BOOST_REQUIRE_EQUAL(2, numberLow);
+}
+
+BOOST_AUTO_TEST_CASE(testPriorityInheritance) {
+
+    // Check tasks run with the priority they were scheduled with and tasks
+    // they schedule inherit it.
+
+    BOOST_REQUIRE_EQUAL(core::CExecutor::E_NormalPriority, core::currentTaskPriority());
+
+    std::promise<TPriorityVec> priorities;
+    {
+        core::CStaticThreadPool pool{2};
+        {
+            core::CScopedTaskPriority priority{core::CExecutor::E_LowPriority};
+            BOOST_REQUIRE_EQUAL(core::CExecutor::E_LowPriority,
+                                core::currentTaskPriority());
+            pool.schedule(
+                [&] {
+                    auto outer = core::currentTaskPriority();
+                    pool.schedule([&priorities, outer] {
+                        priorities.set_value({outer, core::currentTaskPriority()});
+                    });
+                },
+                core::CExecutor::E_HighPriority);
+        }
+        BOOST_REQUIRE_EQUAL(core::CExecutor::E_NormalPriority,
+                            core::currentTaskPriority());
+
+        TPriorityVec result{priorities.get_future().get()};
+        BOOST_REQUIRE_EQUAL(2, result.size());
+        BOOST_REQUIRE_EQUAL(core::CExecutor::E_HighPriority, result[0]);
+        BOOST_REQUIRE_EQUAL(core::CExecutor::E_HighPriority, result[1]);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
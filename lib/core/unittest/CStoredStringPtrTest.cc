@@ -4,6 +4,7 @@
  * you may not use this file except in compliance with the Elastic License.
  */
 
+#include <core/CHashing.h>
 #include <core/CMemory.h>
 #include <core/CStoredStringPtr.h>
 
@@ -114,4 +115,42 @@ BOOST_AUTO_TEST_CASE(testHash) {
     BOOST_REQUIRE_EQUAL(std::size_t(1), s.count(key));
 }
 
+BOOST_AUTO_TEST_CASE(testCachedHash) {
+
+    // Test the cached hash matches hashing the string and equality of the
+    // strings for different pointers.
+
+    ml::core::CHashing::CMurmurHash2String hasher;
+
+    std::string str("influencer");
+    ml::core::CStoredStringPtr ptr1 = ml::core::CStoredStringPtr::makeStoredString(str);
+    ml::core::CStoredStringPtr ptr2 = ml::core::CStoredStringPtr::makeStoredString(str);
+    ml::core::CStoredStringPtr ptr3 =
+        ml::core::CStoredStringPtr::makeStoredString(std::string("person"));
+    ml::core::CStoredStringPtr null;
+
+    BOOST_REQUIRE_EQUAL(hasher(str), ptr1.hash());
+    BOOST_REQUIRE_EQUAL(hasher(str), hasher(ptr1));
+    BOOST_REQUIRE_EQUAL(ptr1.hash(), hash_value(ptr1));
+    BOOST_REQUIRE_EQUAL(ptr1.hash(), ptr2.hash());
+    BOOST_REQUIRE_EQUAL(hasher(std::string("person")), ptr3.hash());
+    BOOST_REQUIRE_EQUAL(std::size_t(0), null.hash());
+
+    // A different seed hashes the string.
+    ml::core::CHashing::CMurmurHash2String seededHasher(1);
+    BOOST_REQUIRE_EQUAL(seededHasher(str), seededHasher(ptr1));
+
+    BOOST_TEST_REQUIRE(ptr1 != ptr2);
+    BOOST_TEST_REQUIRE(ptr1.hasSameString(ptr1));
+    BOOST_TEST_REQUIRE(ptr1.hasSameString(ptr2));
+    BOOST_TEST_REQUIRE(ptr1.hasSameString(ptr3) == false);
+    BOOST_TEST_REQUIRE(ptr1.hasSameString(null) == false);
+    BOOST_TEST_REQUIRE(null.hasSameString(ml::core::CStoredStringPtr()));
+
+    ptr1.swap(ptr3);
+    BOOST_REQUIRE_EQUAL(std::string("person"), *ptr1);
+    BOOST_REQUIRE_EQUAL(hasher(std::string("person")), ptr1.hash());
+    BOOST_REQUIRE_EQUAL(hasher(str), ptr3.hash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
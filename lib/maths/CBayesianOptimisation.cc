@@ -74,6 +74,46 @@ double integrate1dKernelProduct(double theta1, double xit, double xjt) {
         (std::erf(c / boost::math::constants::root_two<double>() * (xit + xjt)) -
          std::erf(c / boost::math::constants::root_two<double>() * (xit + xjt - 2))));
 }
+
+using TVector = CBayesianOptimisation::TVector;
+using TMatrix = CDenseMatrix<double>;
+
+//! Get the 1D kernel integrals for each coordinate of each column of \p x.
+TMatrix integrate1dKernels(const TVector& theta1, const TMatrix& x) {
+    TMatrix result{x.rows(), x.cols()};
+    for (int i = 0; i < x.cols(); ++i) {
+        for (int t = 0; t < x.rows(); ++t) {
+            result(t, i) = integrate1dKernel(theta1(t), x(t, i));
+        }
+    }
+    return result;
+}
+
+//! Get the 1D kernel product integrals for the \p t'th coordinate of every
+//! pair of columns of \p x.
+TMatrix integrate1dKernelProducts(double theta1, const TMatrix& x, int t) {
+    TMatrix result{x.cols(), x.cols()};
+    for (int i = 0; i < x.cols(); ++i) {
+        for (int j = 0; j <= i; ++j) {
+            result(i, j) = result(j, i) = integrate1dKernelProduct(theta1, x(t, i), x(t, j));
+        }
+    }
+    return result;
+}
+
+//! Get the product of the 1D kernel integrals \p integrals of every coordinate
+//! except the \p t'th for each column.
+TVector integrate1dKernelsExcept(const TMatrix& integrals, int t) {
+    TVector result{TVector::Ones(integrals.cols())};
+    for (int i = 0; i < integrals.cols(); ++i) {
+        for (int d = 0; d < integrals.rows(); ++d) {
+            if (d != t) {
+                result(i) *= integrals(d, i);
+            }
+        }
+    }
+    return result;
+}
 }
 
 CBayesianOptimisation::CBayesianOptimisation(TDoubleDoublePrVec parameterBounds,
@@ -148,14 +188,22 @@ CBayesianOptimisation::maximumExpectedImprovement() {
 
     } else {
 
-        TVector x;
-        for (std::size_t i = 0; i < interpolates.size(); /**/) {
-
+        // Score all the random candidates together since it is much cheaper to
+        // compute their kernel covariates in one go.
+        TMatrix candidates{interpolate.size(), 3 * static_cast<int>(m_Restarts)};
+        for (std::size_t i = 0, k = 0; i < interpolates.size(); ++k) {
             for (int j = 0; j < interpolate.size(); ++i, ++j) {
                 interpolate(j) = interpolates[i];
             }
-            x = a + interpolate.cwiseProduct(b - a);
-            double fx{minusEI(x)};
+            candidates.col(k) = a + interpolate.cwiseProduct(b - a);
+        }
+        TVector fcandidates{this->minusExpectedImprovement(candidates)};
+
+        TVector x;
+        for (int i = 0; i < candidates.cols(); ++i) {
+
+            x = candidates.col(i);
+            double fx{fcandidates(i)};
             LOG_TRACE(<< "x = " << x.transpose() << " EI(x) = " << fx);
 
             if (COrderings::lexicographical_compare(fmax, xmax, -fx, x)) {
@@ -234,27 +282,17 @@ double CBayesianOptimisation::evaluate(const TVector& Kinvf, const TVector& inpu
 
 double CBayesianOptimisation::evaluate1D(const TVector& Kinvf, double input, int dimension) const {
     TVector scaledKernelParameters{this->scaledKernelParameters()};
-    auto prodXt = [&scaledKernelParameters, this](const TVector& x, int t) {
-        double prod{1.0};
-        for (int d = 0; d < m_MinBoundary.size(); ++d) {
-            if (d != t) {
-                prod *= integrate1dKernel(scaledKernelParameters(d), x(d));
-            }
-        }
-        return prod;
-    };
+    TMatrix x{this->pointsTo01()};
+    TVector prodXt{integrate1dKernelsExcept(
+        integrate1dKernels(scaledKernelParameters, x), dimension)};
 
-    double sum{0.0};
     input = (input - m_MinBoundary(dimension)) /
             (m_MaxBoundary(dimension) - m_MinBoundary(dimension));
-    for (std::size_t i = 0; i < m_FunctionMeanValues.size(); ++i) {
-        TVector x{this->transformTo01(m_FunctionMeanValues[i].first)};
-        sum += Kinvf(static_cast<int>(i)) *
-               std::exp(-(CTools::pow2(scaledKernelParameters[dimension]) +
-                          MINIMUM_KERNEL_COORDINATE_DISTANCE_SCALE) *
-                        CTools::pow2(input - x(dimension))) *
-               prodXt(x, dimension);
-    }
+    double c2{CTools::pow2(scaledKernelParameters[dimension]) +
+              MINIMUM_KERNEL_COORDINATE_DISTANCE_SCALE};
+    TVector kernelt{(x.row(dimension).array() - input).square().matrix().transpose()};
+    kernelt = kernelt.unaryExpr([c2](double d2) { return std::exp(-c2 * d2); });
+    double sum{Kinvf.dot(kernelt.cwiseProduct(prodXt))};
 
     double theta02{CTools::pow2(m_KernelParameters(0))};
     double scale{std::max(1.0, theta02)}; //prevent cancellation errors
@@ -272,16 +310,8 @@ double CBayesianOptimisation::evaluate1D(double input, int dimension) const {
 }
 
 double CBayesianOptimisation::anovaConstantFactor(const TVector& Kinvf) const {
-    TVector scaledKernelParameters{this->scaledKernelParameters()};
-    double sum{0.0};
-    for (std::size_t i = 0; i < m_FunctionMeanValues.size(); ++i) {
-        double prod{1.0};
-        TVector x{this->transformTo01(m_FunctionMeanValues[i].first)};
-        for (int d = 0; d < m_MinBoundary.size(); ++d) {
-            prod *= integrate1dKernel(scaledKernelParameters(d), x(d));
-        }
-        sum += Kinvf(i) * prod;
-    }
+    TMatrix integrals{integrate1dKernels(this->scaledKernelParameters(), this->pointsTo01())};
+    double sum{Kinvf.dot(integrals.colwise().prod().transpose())};
     return CTools::pow2(m_KernelParameters(0)) * sum;
 }
 
@@ -291,22 +321,14 @@ double CBayesianOptimisation::anovaConstantFactor() const {
 
 double CBayesianOptimisation::anovaTotalVariance(const TVector& Kinvf) const {
     TVector scaledKernelParameters{this->scaledKernelParameters()};
-    auto prodIj = [this, &scaledKernelParameters, &Kinvf](std::size_t i, std::size_t j) {
-        TVector xi{this->transformTo01(m_FunctionMeanValues[i].first)};
-        TVector xj{this->transformTo01(m_FunctionMeanValues[j].first)};
-        double prod{1.0};
-        for (int t = 0; t < m_MinBoundary.size(); ++t) {
-            prod *= integrate1dKernelProduct(scaledKernelParameters[t], xi(t), xj(t));
-        }
-        return Kinvf(static_cast<int>(i)) * Kinvf(static_cast<int>(j)) * prod;
-    };
-
-    double sum{0.0};
-    for (std::size_t i = 0; i < m_FunctionMeanValues.size(); ++i) {
-        for (std::size_t j = 0; j < m_FunctionMeanValues.size(); ++j) {
-            sum += prodIj(i, j);
-        }
+    TMatrix x{this->pointsTo01()};
+    TMatrix products{TMatrix::Ones(x.cols(), x.cols())};
+    for (int t = 0; t < x.rows(); ++t) {
+        products.array() *=
+            integrate1dKernelProducts(scaledKernelParameters(t), x, t).array();
     }
+    double sum{Kinvf.dot(products * Kinvf)};
+
     double theta04{std::pow(m_KernelParameters(0), 4)};
     double scale{std::max(1.0, theta04)}; // prevent cancellation errors
     double f02{CTools::pow2(this->anovaConstantFactor(Kinvf)) / scale};
@@ -320,33 +342,15 @@ double CBayesianOptimisation::anovaTotalVariance() const {
 
 double CBayesianOptimisation::anovaMainEffect(const TVector& Kinvf, int dimension) const {
     TVector scaledKernelParameters{this->scaledKernelParameters()};
-    auto prodXt = [this, &scaledKernelParameters](const TVector& x, int t) {
-        double prod{1.0};
-        for (int d = 0; d < m_MinBoundary.size(); ++d) {
-            if (d != t) {
-                prod *= integrate1dKernel(scaledKernelParameters(d), x(d));
-            }
-        }
-        return prod;
-    };
-    double sum1{0.0};
-    double sum2{0.0};
-    for (std::size_t i = 0; i < m_FunctionMeanValues.size(); ++i) {
-        TVector xi{this->transformTo01(m_FunctionMeanValues[i].first)};
-        for (std::size_t j = 0; j < m_FunctionMeanValues.size(); ++j) {
-            TVector xj{this->transformTo01(m_FunctionMeanValues[j].first)};
-            sum1 += Kinvf(static_cast<int>(i)) * Kinvf(static_cast<int>(j)) *
-                    prodXt(xi, dimension) * prodXt(xj, dimension) *
-                    integrate1dKernelProduct(scaledKernelParameters(dimension),
-                                             xi(dimension), xj(dimension));
-        }
-        sum2 += Kinvf(static_cast<int>(i)) *
-                integrate1dKernel(scaledKernelParameters(dimension), xi(dimension)) *
-                prodXt(xi, dimension);
-    }
+    TMatrix x{this->pointsTo01()};
+    TMatrix integrals{integrate1dKernels(scaledKernelParameters, x)};
+    TVector KinvfProdXt{Kinvf.cwiseProduct(integrate1dKernelsExcept(integrals, dimension))};
+    double sum1{KinvfProdXt.dot(
+        integrate1dKernelProducts(scaledKernelParameters(dimension), x, dimension) * KinvfProdXt)};
+    double sum2{KinvfProdXt.dot(integrals.row(dimension).transpose())};
     double theta02{CTools::pow2(m_KernelParameters(0))};
     double theta04{std::pow(m_KernelParameters(0), 4)};
-    double f0{this->anovaConstantFactor()};
+    double f0{this->anovaConstantFactor(Kinvf)};
     double f02{CTools::pow2(f0)};
     double scale{std::max(1.0, theta04)}; // prevent cancellation errors
     return scale * (theta04 * sum1 / scale - 2 * theta02 * sum2 * f0 / scale + f02 / scale);
@@ -454,12 +458,7 @@ CBayesianOptimisation::minusExpectedImprovementAndGradient() const {
     TVector dKxndx;
     TVector zGradient;
 
-    double fmin{
-        std::min_element(m_FunctionMeanValues.begin(), m_FunctionMeanValues.end(),
-                         [](const TVectorDoublePr& lhs, const TVectorDoublePr& rhs) {
-                             return lhs.second < rhs.second;
-                         })
-            ->second};
+    double fmin{this->functionMinimum()};
 
     auto EI = [=](const TVector& x) mutable {
         double Kxx;
@@ -522,6 +521,37 @@ CBayesianOptimisation::minusExpectedImprovementAndGradient() const {
     return {std::move(EI), std::move(EIGradient)};
 }
 
+CBayesianOptimisation::TVector
+CBayesianOptimisation::minusExpectedImprovement(const TMatrix& x) const {
+
+    TMatrix K{this->kernel(m_KernelParameters, this->meanErrorVariance())};
+    Eigen::LDLT<Eigen::MatrixXd> Kldl{K};
+    TVector Kinvf{Kldl.solve(this->function())};
+    double Kxx{CTools::pow2(m_KernelParameters(0)) + this->meanErrorVariance()};
+    double fmin{this->functionMinimum()};
+
+    TMatrix Kxn{this->kernelCovariates(m_KernelParameters, x)};
+    TMatrix KinvKxn{Kldl.solve(Kxn)};
+    TVector mu{Kxn.transpose() * Kinvf};
+
+    TVector result(x.cols());
+    for (int i = 0; i < x.cols(); ++i) {
+        double sigma{Kxx - Kxn.col(i).dot(KinvKxn.col(i))};
+        if (sigma <= 0.0) {
+            result(i) = 0.0;
+            continue;
+        }
+        sigma = std::sqrt(sigma);
+
+        double z{(fmin - mu(i)) / sigma};
+        double cdfz{stableNormCdf(z)};
+        double pdfz{stableNormPdf(z)};
+        result(i) = -sigma * (z * cdfz + pdfz);
+    }
+
+    return result;
+}
+
 const CBayesianOptimisation::TVector& CBayesianOptimisation::maximumLikelihoodKernel() {
 
     // Use random restarts of L-BFGS to find maximum likelihood parameters.
@@ -616,6 +646,22 @@ double CBayesianOptimisation::meanErrorVariance() const {
     return CBasicStatistics::mean(variance);
 }
 
+double CBayesianOptimisation::functionMinimum() const {
+    return std::min_element(m_FunctionMeanValues.begin(), m_FunctionMeanValues.end(),
+                            [](const TVectorDoublePr& lhs, const TVectorDoublePr& rhs) {
+                                return lhs.second < rhs.second;
+                            })
+        ->second;
+}
+
+CBayesianOptimisation::TMatrix CBayesianOptimisation::pointsTo01() const {
+    TMatrix result{m_MinBoundary.size(), m_FunctionMeanValues.size()};
+    for (std::size_t i = 0; i < m_FunctionMeanValues.size(); ++i) {
+        result.col(i) = this->transformTo01(m_FunctionMeanValues[i].first);
+    }
+    return result;
+}
+
 CBayesianOptimisation::TMatrix CBayesianOptimisation::dKerneld(const TVector& a, int k) const {
     TMatrix result{m_FunctionMeanValues.size(), m_FunctionMeanValues.size()};
     for (std::size_t i = 0; i < m_FunctionMeanValues.size(); ++i) {
@@ -647,11 +693,23 @@ CBayesianOptimisation::TMatrix CBayesianOptimisation::kernel(const TVector& a, d
 CBayesianOptimisation::TVectorDoublePr
 CBayesianOptimisation::kernelCovariates(const TVector& a, const TVector& x, double vx) const {
     double Kxx{CTools::pow2(a(0)) + vx};
-    TVector Kxn(m_FunctionMeanValues.size());
+    TVector Kxn{this->kernelCovariates(a, TMatrix{x}).col(0)};
+    return {std::move(Kxn), Kxx};
+}
+
+CBayesianOptimisation::TMatrix
+CBayesianOptimisation::kernelCovariates(const TVector& a, const TMatrix& x) const {
+    // Compute the scaled squared distances from each point to every column of x
+    // using whole row operations and then compute the kernel values in one pass.
+    TVector scales{m_MinimumKernelCoordinateDistanceScale + a.tail(a.size() - 1).cwiseAbs2()};
+    TMatrix result{m_FunctionMeanValues.size(), x.cols()};
     for (std::size_t i = 0; i < m_FunctionMeanValues.size(); ++i) {
-        Kxn(i) = this->kernel(a, x, m_FunctionMeanValues[i].first);
+        result.row(i) = scales.transpose() *
+                        (x.colwise() - m_FunctionMeanValues[i].first).cwiseAbs2();
     }
-    return {std::move(Kxn), Kxx};
+    double theta02{CTools::pow2(a(0))};
+    return result.unaryExpr(
+        [theta02](double d2) { return theta02 * CTools::stableExp(-d2); });
 }
 
 double CBayesianOptimisation::kernel(const TVector& a, const TVector& x, const TVector& y) const {
@@ -39,6 +39,8 @@ const std::size_t BEST_PARAMETER_INDEX{1};
 const std::size_t MAX_PARAMETER_INDEX{2};
 const std::size_t MAX_LINE_SEARCH_ITERATIONS{10};
 const double LINE_SEARCH_MINIMUM_RELATIVE_EI_TO_CONTINUE{0.01};
+const double LINE_SEARCH_MINIMUM_SAMPLE_SIZE{1000.0};
+const double LINE_SEARCH_MAXIMUM_SAMPLE_FRACTION{0.5};
 const double MIN_ROWS_PER_FEATURE{20.0};
 const double MIN_SOFT_DEPTH_LIMIT{2.0};
 const double MIN_SOFT_DEPTH_LIMIT_TOLERANCE{0.05};
@@ -88,6 +90,20 @@ std::size_t computeMaximumNumberTrees(double eta) {
 bool intervalIsEmpty(const CBoostedTreeFactory::TVector& interval) {
     return interval(MAX_PARAMETER_INDEX) - interval(MIN_PARAMETER_INDEX) == 0.0;
 }
+
+core::CPackedBitVector sampleRowMask(CPRNG::CXorOShiro128Plus& rng,
+                                     const core::CPackedBitVector& rowMask,
+                                     double fraction) {
+    core::CPackedBitVector result;
+    for (auto i = rowMask.beginOneBits(); i != rowMask.endOneBits(); ++i) {
+        if (CSampling::uniformSample(rng, 0.0, 1.0) < fraction) {
+            result.extend(false, *i - result.size());
+            result.extend(true);
+        }
+    }
+    result.extend(false, rowMask.size() - result.size());
+    return result;
+}
 }
 
 CBoostedTreeFactory::TBoostedTreeUPtr
@@ -168,6 +184,52 @@ CBoostedTreeFactory::restoreFor(core::CDataFrame& frame, std::size_t dependentVa
         new CBoostedTree{frame, m_RecordTrainingState, std::move(m_TreeImpl)}};
 }
 
+CBoostedTreeFactory::TBoostedTreeUPtr
+CBoostedTreeFactory::restoreForPrediction(core::CDataFrame& frame, std::size_t dependentVariable) {
+
+    if (dependentVariable != m_TreeImpl->m_DependentVariable) {
+        HANDLE_FATAL(<< "Internal error: expected dependent variable "
+                     << m_TreeImpl->m_DependentVariable << " got " << dependentVariable);
+        return nullptr;
+    }
+    if (m_TreeImpl->m_BestForest.empty()) {
+        HANDLE_FATAL(<< "Input error: the restored state doesn't contain a trained model.");
+        return nullptr;
+    }
+
+    // We only need space for the predictions: the training masks and example
+    // weights refer to the rows of the training data frame.
+    std::tie(m_TreeImpl->m_ExtraColumns, m_TreeImpl->m_PaddedExtraColumns) =
+        frame.resizeColumns(m_TreeImpl->m_NumberThreads,
+                            extraColumns(m_TreeImpl->m_Loss->numberParameters(),
+                                         m_TreeImpl->m_Loss->isCurvatureDiagonal()));
+
+    // State recorded before the classification weights were persisted doesn't
+    // have them so we fall back to using the class probabilities unadjusted.
+    if (m_TreeImpl->m_ClassificationWeights.size() == 0) {
+        switch (m_TreeImpl->m_Loss->type()) {
+        case boosted_tree::E_BinaryClassification:
+            m_TreeImpl->m_ClassificationWeights = CBoostedTreeImpl::TVector::Ones(2);
+            break;
+        case boosted_tree::E_MulticlassClassification:
+            m_TreeImpl->m_ClassificationWeights =
+                CBoostedTreeImpl::TVector::Ones(m_TreeImpl->m_Loss->numberParameters());
+            break;
+        case boosted_tree::E_MseRegression:
+        case boosted_tree::E_MsleRegression:
+        case boosted_tree::E_HuberRegression:
+            break;
+        }
+    }
+    m_TreeImpl->initializeTreeShap(frame);
+    m_TreeImpl->m_Instrumentation->updateMemoryUsage(core::CMemory::dynamicSize(m_TreeImpl));
+    m_TreeImpl->m_Instrumentation->lossType(m_TreeImpl->m_Loss->name());
+    m_TreeImpl->m_Instrumentation->flush();
+
+    return TBoostedTreeUPtr{
+        new CBoostedTree{frame, m_RecordTrainingState, std::move(m_TreeImpl)}};
+}
+
 std::size_t CBoostedTreeFactory::numberHyperparameterTuningRounds() const {
     return std::max(m_TreeImpl->m_MaximumOptimisationRoundsPerHyperparameter *
                         m_TreeImpl->numberHyperparametersToTune(),
@@ -347,7 +409,9 @@ void CBoostedTreeFactory::resizeDataFrame(core::CDataFrame& frame) const {
     std::size_t numberLossParameters{m_TreeImpl->m_Loss->numberParameters()};
     std::size_t frameMemory{core::CMemory::dynamicSize(frame)};
     std::tie(m_TreeImpl->m_ExtraColumns, m_TreeImpl->m_PaddedExtraColumns) =
-        frame.resizeColumns(m_TreeImpl->m_NumberThreads, extraColumns(numberLossParameters));
+        frame.resizeColumns(m_TreeImpl->m_NumberThreads,
+                            extraColumns(numberLossParameters,
+                                         m_TreeImpl->m_Loss->isCurvatureDiagonal()));
     m_TreeImpl->m_Instrumentation->updateMemoryUsage(
         core::CMemory::dynamicSize(frame) - frameMemory);
     m_TreeImpl->m_Instrumentation->flush();
@@ -789,6 +853,9 @@ void CBoostedTreeFactory::initializeUnsetDownsampleFactor(core::CDataFrame& fram
                     return scale;
                 };
 
+                // Note we don't sample rows for this line search: the sample size
+                // depends on the downsample factor and the factor we choose would
+                // be applied to all the training rows not the sample.
                 double numberTrainingRows{m_TreeImpl->m_TrainingRowMasks[0].manhattan()};
 
                 auto applyDownsampleFactor = [&](CBoostedTreeImpl& tree,
@@ -822,7 +889,8 @@ void CBoostedTreeFactory::initializeUnsetDownsampleFactor(core::CDataFrame& fram
                             frame, applyDownsampleFactor,
                             logMinDownsampleFactor, logMaxDownsampleFactor,
                             CTools::stableLog(MIN_DOWNSAMPLE_FACTOR_SCALE),
-                            CTools::stableLog(MAX_DOWNSAMPLE_FACTOR_SCALE), adjustTestLoss)
+                            CTools::stableLog(MAX_DOWNSAMPLE_FACTOR_SCALE),
+                            adjustTestLoss, false /*sample rows*/)
                         .value_or(fallback);
 
                 // Truncate the log(factor) to be less than or equal to log(1.0) and the
@@ -999,7 +1067,8 @@ CBoostedTreeFactory::testLossLineSearch(core::CDataFrame& frame,
                                         double intervalRightEnd,
                                         double returnedIntervalLeftEndOffset,
                                         double returnedIntervalRightEndOffset,
-                                        const TAdjustTestLoss& adjustTestLoss_) const {
+                                        const TAdjustTestLoss& adjustTestLoss_,
+                                        bool sampleRows) const {
 
     // This has the following steps:
     //   1. Coarse search the interval [intervalLeftEnd, intervalRightEnd] using
@@ -1018,6 +1087,33 @@ CBoostedTreeFactory::testLossLineSearch(core::CDataFrame& frame,
     using TMeanVarAccumulator = CBasicStatistics::SSampleMeanVar<double>::TAccumulator;
     using TMinAccumulator = CBasicStatistics::SMin<double>::TAccumulator;
 
+    core::CPackedBitVector trainingRowMask;
+    core::CPackedBitVector testingRowMask;
+    double sampleFraction{
+        this->lineSearchRowMasks(sampleRows, trainingRowMask, testingRowMask)};
+    LOG_TRACE(<< "line search sample fraction = " << sampleFraction);
+
+    auto computeTestLoss = [&] {
+        // The regularisers are defined w.r.t. the loss summed over the rows each
+        // tree is trained on. The loss, and so its gain and curvature per split,
+        // is additive over rows. We scale up the downsample factor so each tree
+        // sees the same number of rows as it would training on all rows, which
+        // keeps the trade off between loss and model complexity unchanged. If
+        // the downsample factor is capped we scale the regularisers by the ratio
+        // of the number of rows each tree sees to restore the trade off.
+        CBoostedTreeImpl::TRegularization regularization{m_TreeImpl->m_Regularization};
+        double downsampleFactor{m_TreeImpl->m_DownsampleFactor};
+        m_TreeImpl->m_DownsampleFactor = std::min(downsampleFactor / sampleFraction, 1.0);
+        m_TreeImpl->scaleRegularizers(sampleFraction * m_TreeImpl->m_DownsampleFactor /
+                                      downsampleFactor);
+        double testLoss;
+        std::tie(std::ignore, testLoss, std::ignore) = m_TreeImpl->trainForest(
+            frame, trainingRowMask, testingRowMask, m_TreeImpl->m_TrainingProgress);
+        m_TreeImpl->m_Regularization = regularization;
+        m_TreeImpl->m_DownsampleFactor = downsampleFactor;
+        return testLoss;
+    };
+
     TMinAccumulator minTestLoss;
     TDoubleDoublePrVec testLosses;
     testLosses.reserve(MAX_LINE_SEARCH_ITERATIONS);
@@ -1033,11 +1129,7 @@ CBoostedTreeFactory::testLossLineSearch(core::CDataFrame& frame,
             break;
         }
 
-        CBoostedTreeImpl::TNodeVecVec forest;
-        double testLoss;
-        std::tie(forest, testLoss, std::ignore) = m_TreeImpl->trainForest(
-            frame, m_TreeImpl->m_TrainingRowMasks[0],
-            m_TreeImpl->m_TestingRowMasks[0], m_TreeImpl->m_TrainingProgress);
+        double testLoss{computeTestLoss()};
         minTestLoss.add(testLoss);
         testLosses.emplace_back(parameter, testLoss);
     }
@@ -1078,12 +1170,7 @@ CBoostedTreeFactory::testLossLineSearch(core::CDataFrame& frame,
             break;
         }
 
-        CBoostedTreeImpl::TNodeVecVec forest;
-        double testLoss;
-        std::tie(forest, testLoss, std::ignore) = m_TreeImpl->trainForest(
-            frame, m_TreeImpl->m_TrainingRowMasks[0],
-            m_TreeImpl->m_TestingRowMasks[0], m_TreeImpl->m_TrainingProgress);
-
+        double testLoss{computeTestLoss()};
         minTestLoss.add(testLoss);
 
         double adjustedTestLoss{adjustTestLoss(parameter(0), testLoss)};
@@ -1185,6 +1272,44 @@ CBoostedTreeFactory::testLossLineSearch(core::CDataFrame& frame,
     return TOptionalVector{interval};
 }
 
+double CBoostedTreeFactory::lineSearchRowMasks(bool sampleRows,
+                                               core::CPackedBitVector& trainingRowMask,
+                                               core::CPackedBitVector& testingRowMask) const {
+
+    // Each line search trains many forests and the cost of training a forest
+    // has terms which scale with the total number of training and test rows,
+    // i.e. updating predictions, loss derivatives and test loss for every tree.
+    // We target the same number of rows per feature in each tree we train as
+    // we do for the initial downsample factor and only use enough training rows
+    // to achieve this given the current downsample factor.
+
+    trainingRowMask = m_TreeImpl->m_TrainingRowMasks[0];
+    testingRowMask = m_TreeImpl->m_TestingRowMasks[0];
+
+    double numberTrainingRows{trainingRowMask.manhattan()};
+    double numberFeatures{static_cast<double>(m_TreeImpl->m_Encoder->numberEncodedColumns())};
+    double sampleSize{std::max(m_InitialDownsampleRowsPerFeature * numberFeatures /
+                                   m_TreeImpl->m_DownsampleFactor,
+                               LINE_SEARCH_MINIMUM_SAMPLE_SIZE)};
+    LOG_TRACE(<< "line search sample size = " << sampleSize
+              << ", number training rows = " << numberTrainingRows);
+
+    if (sampleRows == false || m_DownsampleLineSearches == false ||
+        sampleSize > LINE_SEARCH_MAXIMUM_SAMPLE_FRACTION * numberTrainingRows) {
+        return 1.0;
+    }
+
+    // Sample using a jumped copy of the tree's generator. This is deterministic
+    // given the tree's state and leaves the tree's own random sequence unchanged.
+    CPRNG::CXorOShiro128Plus rng{m_TreeImpl->m_Rng};
+    rng.jump();
+    double fraction{sampleSize / numberTrainingRows};
+    trainingRowMask = sampleRowMask(rng, trainingRowMask, fraction);
+    testingRowMask = sampleRowMask(rng, testingRowMask, fraction);
+
+    return trainingRowMask.manhattan() / numberTrainingRows;
+}
+
 CBoostedTreeFactory CBoostedTreeFactory::constructFromParameters(std::size_t numberThreads,
                                                                  TLossFunctionUPtr loss) {
     return {numberThreads, std::move(loss)};
@@ -1410,6 +1535,20 @@ CBoostedTreeFactory& CBoostedTreeFactory::earlyStoppingEnabled(bool enable) {
     return *this;
 }
 
+CBoostedTreeFactory& CBoostedTreeFactory::downsampleLineSearches(bool enable) {
+    m_DownsampleLineSearches = enable;
+    return *this;
+}
+
+CBoostedTreeFactory& CBoostedTreeFactory::numberConcurrentLeafSplits(std::size_t number) {
+    if (number == 0) {
+        LOG_WARN(<< "Must split at least one leaf at a time");
+        number = 1;
+    }
+    m_TreeImpl->m_NumberConcurrentLeafSplits = number;
+    return *this;
+}
+
 std::size_t CBoostedTreeFactory::estimateMemoryUsage(std::size_t numberRows,
                                                      std::size_t numberColumns) const {
     std::size_t maximumNumberTrees{this->mainLoopMaximumNumberTrees(
@@ -1424,7 +1563,8 @@ std::size_t CBoostedTreeFactory::estimateMemoryUsage(std::size_t numberRows,
 std::size_t CBoostedTreeFactory::numberExtraColumnsForTrain() const {
     return m_TreeImpl->m_PaddedExtraColumns == boost::none
                ? CBoostedTreeImpl::numberExtraColumnsForTrain(
-                     m_TreeImpl->m_Loss->numberParameters())
+                     m_TreeImpl->m_Loss->numberParameters(),
+                     m_TreeImpl->m_Loss->isCurvatureDiagonal())
                : *m_TreeImpl->m_PaddedExtraColumns;
 }
 
@@ -13,6 +13,7 @@
 #include <core/CPersistUtils.h>
 #include <core/CProgramCounters.h>
 #include <core/CStopWatch.h>
+#include <core/Concurrency.h>
 #include <core/Constants.h>
 #include <core/RestoreMacros.h>
 
@@ -137,9 +138,16 @@ double lossAtNSigma(double n, const TMeanVarAccumulator& lossMoments) {
            n * std::sqrt(CBasicStatistics::variance(lossMoments));
 }
 
-double trace(std::size_t columns, const TMemoryMappedFloatVector& upperTriangle) {
-    // This assumes the upper triangle of the matrix is stored row major.
+double trace(std::size_t columns, bool diagonal, const TMemoryMappedFloatVector& upperTriangle) {
+    // This assumes the upper triangle of the matrix is stored row major or
+    // that only the diagonal is stored if diagonal is true.
     double result{0.0};
+    if (diagonal) {
+        for (int i = 0; i < upperTriangle.size(); ++i) {
+            result += upperTriangle(i);
+        }
+        return result;
+    }
     for (int i = 0, j = static_cast<int>(columns);
          i < upperTriangle.size() && j > 0; i += j, --j) {
         result += upperTriangle(i);
@@ -267,6 +275,15 @@ void CBoostedTreeImpl::train(core::CDataFrame& frame,
         std::tie(m_BestForest, std::ignore, std::ignore) = this->trainForest(
             frame, allTrainingRowsMask, allTrainingRowsMask, m_TrainingProgress);
 
+        // We persist the number of training samples reaching each node so we
+        // can compute SHAP values when we're restored only to make predictions.
+        CTreeShapFeatureImportance::computeNumberSamples(m_NumberThreads, frame,
+                                                         *m_Encoder, m_BestForest);
+
+        // Similarly, we persist the classification weights so predictions are
+        // adjusted in the same way.
+        this->computeClassificationWeights(frame);
+
         this->recordState(recordTrainStateCallback);
         m_Instrumentation->iteration(m_CurrentRound);
         m_Instrumentation->flush(TRAIN_FINAL_FOREST);
@@ -282,9 +299,9 @@ void CBoostedTreeImpl::train(core::CDataFrame& frame,
             m_BestForest.size();
     } else {
         this->skipProgressMonitoringFinalTrain();
+        this->computeClassificationWeights(frame);
     }
 
-    this->computeClassificationWeights(frame);
     this->initializeTreeShap(frame);
 
     // Force progress to one because we can have early exit from loop skip altogether.
@@ -338,25 +355,18 @@ std::size_t CBoostedTreeImpl::estimateMemoryUsage(std::size_t numberRows,
         this->numberHyperparametersToTune() * sizeof(int)};
     std::size_t hyperparameterSamplesMemoryUsage{
         (m_NumberRounds / 3 + 1) * this->numberHyperparametersToTune() * sizeof(double)};
-    // The leaves' row masks memory is accounted for here because it's proportional
-    // to the log2(number of nodes). The compressed bit vector representation uses
-    // roughly log2(E[run length]) / E[run length] bytes per bit. As we grow the
-    // tree we partition the data and so the average run length (sequential unmasked
-    // values) is just equal to the number of leaves. Putting this together, if there
-    // are n rows and m leaves each leaf will use n * log2(m) / m and so their total
-    // memory will be n * log2(m). In practice, we don't get the optimal compression,
-    // a reasonable margin is a factor of 4.
-    std::size_t rowMaskMemoryUsage{4 * numberRows *
-                                   static_cast<std::size_t>(std::ceil(std::log2(
-                                       static_cast<double>(maximumNumberLeaves))))};
+    // The leaves' rows are stored as ranges of a single array of row indices.
+    // Partitioning a leaf's rows between its children additionally uses per
+    // thread buffers which, in total, hold at most twice the number of rows.
+    std::size_t rowIndicesMemoryUsage{3 * numberRows * sizeof(std::size_t)};
     // We only maintain statistics for leaves we know we may possibly split this
-    // halves the peak number of statistics we maintain.
+    // halves the peak number of statistics we maintain. Each additional leaf we
+    // split concurrently needs a workspace which holds one leaf's derivatives.
+    std::size_t leafMemoryUsage{CBoostedTreeLeafNodeStatistics::estimateMemoryUsage(
+        maximumNumberFeatures, m_NumberSplitsPerFeature, m_Loss->numberParameters())};
     std::size_t leafNodeStatisticsMemoryUsage{
-        rowMaskMemoryUsage + maximumNumberLeaves *
-                                 CBoostedTreeLeafNodeStatistics::estimateMemoryUsage(
-                                     maximumNumberFeatures, m_NumberSplitsPerFeature,
-                                     m_Loss->numberParameters()) /
-                                 2};
+        rowIndicesMemoryUsage + maximumNumberLeaves * leafMemoryUsage / 2 +
+        (m_NumberConcurrentLeafSplits - 1) * leafMemoryUsage};
     std::size_t dataTypeMemoryUsage{maximumNumberFeatures * sizeof(CDataFrameUtils::SDataType)};
     std::size_t featureSampleProbabilities{maximumNumberFeatures * sizeof(double)};
     // Assuming either many or few missing rows, we get good compression of the bit
@@ -499,9 +509,11 @@ void CBoostedTreeImpl::computeClassificationWeights(const core::CDataFrame& fram
 }
 
 void CBoostedTreeImpl::initializeTreeShap(const core::CDataFrame& frame) {
-    // Populate number samples reaching each node.
-    CTreeShapFeatureImportance::computeNumberSamples(m_NumberThreads, frame,
-                                                     *m_Encoder, m_BestForest);
+    // Populate number samples reaching each node if they haven't been restored.
+    if (m_BestForest.empty() == false && m_BestForest[0][0].numberSamples() == 0) {
+        CTreeShapFeatureImportance::computeNumberSamples(m_NumberThreads, frame,
+                                                         *m_Encoder, m_BestForest);
+    }
 
     if (m_NumberTopShapValues > 0) {
         // Create the SHAP calculator.
@@ -591,7 +603,8 @@ CBoostedTreeImpl::TNodeVec CBoostedTreeImpl::initializePredictionsAndLossDerivat
             for (auto row = beginRows; row != endRows; ++row) {
                 zeroPrediction(*row, m_ExtraColumns, numberLossParameters);
                 zeroLossGradient(*row, m_ExtraColumns, numberLossParameters);
-                zeroLossCurvature(*row, m_ExtraColumns, numberLossParameters);
+                zeroLossCurvature(*row, m_ExtraColumns, numberLossParameters,
+                                  m_Loss->isCurvatureDiagonal());
             }
         },
         &updateRowMask);
@@ -649,11 +662,11 @@ CBoostedTreeImpl::trainForest(core::CDataFrame& frame,
     TDoubleVec losses;
     losses.reserve(m_MaximumNumberTrees);
     CTrainForestStoppingCondition stoppingCondition{m_MaximumNumberTrees};
-    TWorkspace workspace;
+    TWorkspaceVec workspaces(m_NumberConcurrentLeafSplits);
 
     do {
         auto tree = this->trainTree(frame, downsampledRowMask, candidateSplits,
-                                    maximumTreeSize, workspace);
+                                    maximumTreeSize, workspaces);
 
         retries = tree.size() == 1 ? retries + 1 : 0;
 
@@ -753,8 +766,10 @@ CBoostedTreeImpl::candidateSplits(const core::CDataFrame& frame,
             m_Encoder.get(),
             [this](const TRowRef& row) {
                 std::size_t numberLossParameters{m_Loss->numberParameters()};
-                return trace(numberLossParameters,
-                             readLossCurvature(row, m_ExtraColumns, numberLossParameters));
+                bool diagonalCurvature{m_Loss->isCurvatureDiagonal()};
+                return trace(numberLossParameters, diagonalCurvature,
+                             readLossCurvature(row, m_ExtraColumns, numberLossParameters,
+                                               diagonalCurvature));
             })
             .first;
 
@@ -773,17 +788,17 @@ CBoostedTreeImpl::candidateSplits(const core::CDataFrame& frame,
         // case, we can happily initialize the candidate splits to an empty set
         // since we'll only be choosing how to assign missing values.
         if (featureQuantiles[i].count() > 0.0) {
-            featureSplits.reserve(m_NumberSplitsPerFeature - 1);
+            TDoubleVec ranks;
+            ranks.reserve(m_NumberSplitsPerFeature - 1);
             for (std::size_t j = 1; j < m_NumberSplitsPerFeature; ++j) {
-                double rank{100.0 * static_cast<double>(j) /
-                                static_cast<double>(m_NumberSplitsPerFeature) +
-                            CSampling::uniformSample(m_Rng, -0.1, 0.1)};
-                double q;
-                if (featureQuantiles[i].quantile(rank, q)) {
-                    featureSplits.push_back(q);
-                } else {
-                    LOG_WARN(<< "Failed to compute quantile " << rank << ": ignoring split");
-                }
+                ranks.push_back(100.0 * static_cast<double>(j) /
+                                    static_cast<double>(m_NumberSplitsPerFeature) +
+                                CSampling::uniformSample(m_Rng, -0.1, 0.1));
+            }
+            if (featureQuantiles[i].quantiles(ranks, featureSplits) == false) {
+                LOG_WARN(<< "Failed to compute quantiles for feature '"
+                         << features[i] << "': ignoring splits");
+                featureSplits.clear();
             }
         }
 
@@ -821,14 +836,31 @@ CBoostedTreeImpl::trainTree(core::CDataFrame& frame,
                             const core::CPackedBitVector& trainingRowMask,
                             const TImmutableRadixSetVec& candidateSplits,
                             const std::size_t maximumNumberInternalNodes,
-                            TWorkspace& workspace) const {
+                            TWorkspaceVec& workspaces) const {
 
     LOG_TRACE(<< "Training one tree...");
 
     using TLeafNodeStatisticsPtr = CBoostedTreeLeafNodeStatistics::TPtr;
+    using TLeafNodeStatisticsPtrVec = std::vector<TLeafNodeStatisticsPtr>;
     using TLeafNodeStatisticsPtrQueue = boost::circular_buffer<TLeafNodeStatisticsPtr>;
-
-    workspace.reinitialize(m_NumberThreads, candidateSplits, m_Loss->numberParameters());
+    using TLeafNodeStatisticsPtrPrVec = std::vector<CBoostedTreeLeafNodeStatistics::TPtrPtrPr>;
+
+    // When we split several leaves concurrently each gets an equal share of
+    // the threads for reading its rows. The first workspace owns the row indices
+    // and the others share them.
+    auto& workspace = workspaces[0];
+    std::size_t numberConcurrentLeafSplits{workspaces.size()};
+    std::size_t numberThreadsPerConcurrentLeafSplit{
+        std::max(m_NumberThreads / numberConcurrentLeafSplits, std::size_t{1})};
+
+    workspace.reinitialize(m_NumberThreads, candidateSplits, m_Loss->numberParameters(),
+                           m_Loss->isCurvatureDiagonal());
+    for (std::size_t i = 1; i < numberConcurrentLeafSplits; ++i) {
+        workspaces[i].reinitialize(numberThreadsPerConcurrentLeafSplit, candidateSplits,
+                                   m_Loss->numberParameters(),
+                                   m_Loss->isCurvatureDiagonal());
+        workspaces[i].shareRowIndices(workspace);
+    }
 
     TNodeVec tree(1);
     // Since number of leaves in a perfect binary tree is (numberInternalNodes+1)
@@ -839,17 +871,18 @@ CBoostedTreeImpl::trainTree(core::CDataFrame& frame,
     // the loop adding nodes so we only allocate the vector once.
     TDoubleVec featureSampleProbabilities{m_FeatureSampleProbabilities};
     TSizeVec treeFeatureBag;
-    TSizeVec nodeFeatureBag;
+    TSizeVecVec nodeFeatureBags(numberConcurrentLeafSplits);
     this->treeFeatureBag(featureSampleProbabilities, treeFeatureBag);
 
     featureSampleProbabilities = m_FeatureSampleProbabilities;
-    this->nodeFeatureBag(treeFeatureBag, featureSampleProbabilities, nodeFeatureBag);
+    this->nodeFeatureBag(treeFeatureBag, featureSampleProbabilities, nodeFeatureBags[0]);
 
     TLeafNodeStatisticsPtrQueue splittableLeaves(maximumNumberInternalNodes / 2 + 3);
     splittableLeaves.push_back(std::make_shared<CBoostedTreeLeafNodeStatistics>(
-        0 /*root*/, m_ExtraColumns, m_Loss->numberParameters(), m_NumberThreads,
-        frame, *m_Encoder, m_Regularization, candidateSplits, treeFeatureBag,
-        nodeFeatureBag, 0 /*depth*/, trainingRowMask, workspace));
+        0 /*root*/, m_ExtraColumns, m_Loss->numberParameters(),
+        m_Loss->isCurvatureDiagonal(), m_NumberThreads, frame, *m_Encoder,
+        m_Regularization, candidateSplits, treeFeatureBag, nodeFeatureBags[0],
+        0 /*depth*/, trainingRowMask, workspace));
 
     // We update local variables because the callback can be expensive if it
     // requires accessing atomics.
@@ -863,91 +896,151 @@ CBoostedTreeImpl::trainTree(core::CDataFrame& frame,
     }};
     CScopeRecordMemoryUsage scopeMemoryUsage{splittableLeaves,
                                              std::move(localRecordMemoryUsage)};
-    scopeMemoryUsage.add(workspace);
+    scopeMemoryUsage.add(workspaces);
 
     // For each iteration we:
-    //   1. Find the leaf with the greatest decrease in loss
+    //   1. Find the leaves with the greatest decrease in loss
     //   2. If no split (significantly) reduced the loss we terminate
-    //   3. Otherwise we split that leaf
+    //   3. Otherwise we split those leaves
+    //
+    // All the choices which depend on the order in which we split leaves, i.e.
+    // node identifiers, feature bags and the gain thresholds, are made in order
+    // of decreasing gain before we split any leaves and the children are added
+    // in the same order afterwards. So the tree only depends on the number of
+    // leaves we split concurrently and not on the thread scheduling.
 
     double totalGain{0.0};
 
     COrderings::SLess less;
 
-    for (std::size_t i = 0; i < maximumNumberInternalNodes; ++i) {
+    TLeafNodeStatisticsPtrVec leavesToSplit;
+    leavesToSplit.reserve(numberConcurrentLeafSplits);
+    TDoubleVec smallestCandidateGains(numberConcurrentLeafSplits);
+    TLeafNodeStatisticsPtrPrVec children(numberConcurrentLeafSplits);
+    core::CDataFrame::TRowFuncVecVec readers;
+    core::CDataFrame::TSizeVecCItrPrVec rowIndexRanges;
+    readers.reserve(numberConcurrentLeafSplits);
+    rowIndexRanges.reserve(numberConcurrentLeafSplits);
 
-        if (splittableLeaves.empty()) {
-            break;
-        }
+    std::size_t numberSplits{0};
+    bool done{false};
 
-        auto leaf = splittableLeaves.back();
-        splittableLeaves.pop_back();
+    while (done == false && numberSplits < maximumNumberInternalNodes) {
 
-        scopeMemoryUsage.remove(leaf);
+        leavesToSplit.clear();
 
-        if (leaf->gain() < MINIMUM_RELATIVE_GAIN_PER_SPLIT * totalGain) {
-            break;
-        }
+        while (splittableLeaves.size() > 0 && leavesToSplit.size() < numberConcurrentLeafSplits &&
+               numberSplits < maximumNumberInternalNodes) {
+
+            auto leaf = splittableLeaves.back();
+            splittableLeaves.pop_back();
 
-        totalGain += leaf->gain();
-        workspace.minimumGain(MINIMUM_RELATIVE_GAIN_PER_SPLIT * totalGain);
-        LOG_TRACE(<< "splitting " << leaf->id() << " leaf gain = " << leaf->gain()
-                  << " total gain = " << totalGain);
+            scopeMemoryUsage.remove(leaf);
 
-        std::size_t splitFeature;
-        double splitValue;
-        std::tie(splitFeature, splitValue) = leaf->bestSplit();
+            if (leaf->gain() < MINIMUM_RELATIVE_GAIN_PER_SPLIT * totalGain) {
+                done = true;
+                break;
+            }
+
+            totalGain += leaf->gain();
+            workspace.minimumGain(MINIMUM_RELATIVE_GAIN_PER_SPLIT * totalGain);
+            LOG_TRACE(<< "splitting " << leaf->id() << " leaf gain = " << leaf->gain()
+                      << " total gain = " << totalGain);
+
+            std::size_t splitFeature;
+            double splitValue;
+            std::tie(splitFeature, splitValue) = leaf->bestSplit();
 
-        bool assignMissingToLeft{leaf->assignMissingToLeft()};
+            bool assignMissingToLeft{leaf->assignMissingToLeft()};
 
-        // add the left and right children to the tree
-        std::size_t leftChildId, rightChildId;
-        std::tie(leftChildId, rightChildId) =
+            // add the left and right children to the tree
             tree[leaf->id()].split(splitFeature, splitValue, assignMissingToLeft,
                                    leaf->gain(), leaf->curvature(), tree);
+            ++numberSplits;
+
+            featureSampleProbabilities = m_FeatureSampleProbabilities;
+            this->nodeFeatureBag(treeFeatureBag, featureSampleProbabilities,
+                                 nodeFeatureBags[leavesToSplit.size()]);
+
+            std::size_t numberSplittableLeaves{splittableLeaves.size()};
+            std::size_t currentNumberInternalNodes{(tree.size() - 1) / 2};
+            auto smallestCurrentCandidateGainIndex =
+                static_cast<std::ptrdiff_t>(numberSplittableLeaves) -
+                static_cast<std::ptrdiff_t>(maximumNumberInternalNodes - currentNumberInternalNodes);
+            smallestCandidateGains[leavesToSplit.size()] =
+                smallestCurrentCandidateGainIndex >= 0
+                    ? splittableLeaves[static_cast<std::size_t>(smallestCurrentCandidateGainIndex)]
+                          ->gain()
+                    : 0.0;
+
+            leavesToSplit.push_back(std::move(leaf));
+        }
 
-        featureSampleProbabilities = m_FeatureSampleProbabilities;
-        this->nodeFeatureBag(treeFeatureBag, featureSampleProbabilities, nodeFeatureBag);
-
-        std::size_t numberSplittableLeaves{splittableLeaves.size()};
-        std::size_t currentNumberInternalNodes{(tree.size() - 1) / 2};
-        auto smallestCurrentCandidateGainIndex =
-            static_cast<std::ptrdiff_t>(numberSplittableLeaves) -
-            static_cast<std::ptrdiff_t>(maximumNumberInternalNodes - currentNumberInternalNodes);
-        double smallestCandidateGain{
-            smallestCurrentCandidateGainIndex >= 0
-                ? splittableLeaves[static_cast<std::size_t>(smallestCurrentCandidateGainIndex)]
-                      ->gain()
-                : 0.0};
-
-        TLeafNodeStatisticsPtr leftChild;
-        TLeafNodeStatisticsPtr rightChild;
-        std::tie(leftChild, rightChild) = leaf->split(
-            leftChildId, rightChildId, m_NumberThreads, smallestCandidateGain,
-            frame, *m_Encoder, m_Regularization, treeFeatureBag, nodeFeatureBag,
-            tree[leaf->id()], workspace);
-
-        // Need gain to be computed to compare here
-        if (leftChild != nullptr && rightChild != nullptr && less(rightChild, leftChild)) {
-            std::swap(leftChild, rightChild);
+        if (leavesToSplit.empty()) {
+            break;
         }
 
-        if (leftChild != nullptr &&
-            leftChild->gain() >= MINIMUM_RELATIVE_GAIN_PER_SPLIT * totalGain) {
-            scopeMemoryUsage.add(leftChild);
-            splittableLeaves.push_back(std::move(leftChild));
+        if (leavesToSplit.size() == 1) {
+            const auto& leaf = leavesToSplit[0];
+            const auto& node = tree[leaf->id()];
+            children[0] = leaf->split(node.leftChildIndex(), node.rightChildIndex(),
+                                      m_NumberThreads, smallestCandidateGains[0],
+                                      frame, *m_Encoder, m_Regularization,
+                                      treeFeatureBag, nodeFeatureBags[0], node, workspace);
+        } else {
+            // Nested parallel loops run sequentially so we can't simply split
+            // each leaf in parallel. Instead, we read all the leaves' rows in
+            // one parallel loop and then compute their children in another.
+            readers.clear();
+            rowIndexRanges.clear();
+            for (std::size_t i = 0; i < leavesToSplit.size(); ++i) {
+                const auto& leaf = leavesToSplit[i];
+                workspaces[i].minimumGain(workspace.minimumGain());
+                readers.push_back(leaf->prepareSplit(
+                    numberThreadsPerConcurrentLeafSplit, smallestCandidateGains[i],
+                    *m_Encoder, treeFeatureBag, tree[leaf->id()], workspaces[i]));
+                rowIndexRanges.push_back(leaf->rowIndices(workspaces[i]));
+            }
+            frame.readRows(rowIndexRanges, readers);
+            core::parallel_for_each(0, leavesToSplit.size(), [&](std::size_t i) {
+                const auto& leaf = leavesToSplit[i];
+                const auto& node = tree[leaf->id()];
+                children[i] = leaf->finishSplit(node.leftChildIndex(),
+                                                node.rightChildIndex(),
+                                                smallestCandidateGains[i], m_Regularization,
+                                                nodeFeatureBags[i], workspaces[i]);
+            });
         }
-        if (rightChild != nullptr &&
-            rightChild->gain() >= MINIMUM_RELATIVE_GAIN_PER_SPLIT * totalGain) {
-            scopeMemoryUsage.add(rightChild);
-            splittableLeaves.push_back(std::move(rightChild));
+
+        for (std::size_t i = 0; i < leavesToSplit.size(); ++i) {
+
+            TLeafNodeStatisticsPtr leftChild;
+            TLeafNodeStatisticsPtr rightChild;
+            std::tie(leftChild, rightChild) = std::move(children[i]);
+
+            // Need gain to be computed to compare here
+            if (leftChild != nullptr && rightChild != nullptr && less(rightChild, leftChild)) {
+                std::swap(leftChild, rightChild);
+            }
+
+            std::size_t numberSplittableLeaves{splittableLeaves.size()};
+            if (leftChild != nullptr &&
+                leftChild->gain() >= MINIMUM_RELATIVE_GAIN_PER_SPLIT * totalGain) {
+                scopeMemoryUsage.add(leftChild);
+                splittableLeaves.push_back(std::move(leftChild));
+            }
+            if (rightChild != nullptr &&
+                rightChild->gain() >= MINIMUM_RELATIVE_GAIN_PER_SPLIT * totalGain) {
+                scopeMemoryUsage.add(rightChild);
+                splittableLeaves.push_back(std::move(rightChild));
+            }
+            std::inplace_merge(splittableLeaves.begin(),
+                               splittableLeaves.begin() + numberSplittableLeaves,
+                               splittableLeaves.end(), less);
         }
-        std::inplace_merge(splittableLeaves.begin(),
-                           splittableLeaves.begin() + numberSplittableLeaves,
-                           splittableLeaves.end(), less);
 
         // Drop any leaves which can't possibly be split.
-        while (splittableLeaves.size() + i + 1 > maximumNumberInternalNodes) {
+        while (splittableLeaves.size() + numberSplits > maximumNumberInternalNodes) {
             scopeMemoryUsage.remove(splittableLeaves.front());
             workspace.minimumGain(splittableLeaves.front()->gain());
             splittableLeaves.pop_front();
@@ -1606,6 +1699,7 @@ const std::string BEST_FOREST_TAG{"best_forest"};
 const std::string BEST_FOREST_TEST_LOSS_TAG{"best_forest_test_loss"};
 const std::string BEST_HYPERPARAMETERS_TAG{"best_hyperparameters"};
 const std::string CLASSIFICATION_WEIGHTS_OVERRIDE_TAG{"classification_weights_tag"};
+const std::string CLASSIFICATION_WEIGHTS_TAG{"classification_weights"};
 const std::string CURRENT_ROUND_TAG{"current_round"};
 const std::string DEPENDENT_VARIABLE_TAG{"dependent_variable"};
 const std::string DOWNSAMPLE_FACTOR_OVERRIDE_TAG{"downsample_factor_override"};
@@ -1634,6 +1728,7 @@ const std::string NUMBER_FOLDS_OVERRIDE_TAG{"number_folds_override"};
 const std::string NUMBER_ROUNDS_TAG{"number_rounds"};
 const std::string NUMBER_SPLITS_PER_FEATURE_TAG{"number_splits_per_feature"};
 const std::string NUMBER_THREADS_TAG{"number_threads"};
+const std::string NUMBER_CONCURRENT_LEAF_SPLITS_TAG{"number_concurrent_leaf_splits"};
 const std::string RANDOM_NUMBER_GENERATOR_TAG{"random_number_generator"};
 const std::string REGULARIZATION_TAG{"regularization"};
 const std::string REGULARIZATION_OVERRIDE_TAG{"regularization_override"};
@@ -1674,6 +1769,10 @@ void CBoostedTreeImpl::acceptPersistInserter(core::CStatePersistInserter& insert
     core::CPersistUtils::persist(BEST_HYPERPARAMETERS_TAG, m_BestHyperparameters, inserter);
     core::CPersistUtils::persistIfNotNull(CLASSIFICATION_WEIGHTS_OVERRIDE_TAG,
                                           m_ClassificationWeightsOverride, inserter);
+    if (m_ClassificationWeights.size() > 0) {
+        core::CPersistUtils::persist(CLASSIFICATION_WEIGHTS_TAG,
+                                     m_ClassificationWeights, inserter);
+    }
     core::CPersistUtils::persist(CURRENT_ROUND_TAG, m_CurrentRound, inserter);
     core::CPersistUtils::persist(DEPENDENT_VARIABLE_TAG, m_DependentVariable, inserter);
     core::CPersistUtils::persist(DOWNSAMPLE_FACTOR_OVERRIDE_TAG,
@@ -1715,6 +1814,8 @@ void CBoostedTreeImpl::acceptPersistInserter(core::CStatePersistInserter& insert
     core::CPersistUtils::persist(NUMBER_SPLITS_PER_FEATURE_TAG,
                                  m_NumberSplitsPerFeature, inserter);
     core::CPersistUtils::persist(NUMBER_THREADS_TAG, m_NumberThreads, inserter);
+    core::CPersistUtils::persist(NUMBER_CONCURRENT_LEAF_SPLITS_TAG,
+                                 m_NumberConcurrentLeafSplits, inserter);
     core::CPersistUtils::persist(NUMBER_TOP_SHAP_VALUES_TAG, m_NumberTopShapValues, inserter);
     inserter.insertValue(RANDOM_NUMBER_GENERATOR_TAG, m_Rng.toString());
     core::CPersistUtils::persist(REGULARIZATION_OVERRIDE_TAG,
@@ -1770,6 +1871,9 @@ bool CBoostedTreeImpl::acceptRestoreTraverser(core::CStateRestoreTraverser& trav
             core::CPersistUtils::restore(CLASSIFICATION_WEIGHTS_OVERRIDE_TAG,
                                          *m_ClassificationWeightsOverride, traverser),
             /*no-op*/)
+        RESTORE(CLASSIFICATION_WEIGHTS_TAG,
+                core::CPersistUtils::restore(CLASSIFICATION_WEIGHTS_TAG,
+                                             m_ClassificationWeights, traverser))
         RESTORE(CURRENT_ROUND_TAG,
                 core::CPersistUtils::restore(CURRENT_ROUND_TAG, m_CurrentRound, traverser))
         RESTORE(DEPENDENT_VARIABLE_TAG,
@@ -1838,6 +1942,9 @@ bool CBoostedTreeImpl::acceptRestoreTraverser(core::CStateRestoreTraverser& trav
                                              m_NumberSplitsPerFeature, traverser))
         RESTORE(NUMBER_THREADS_TAG,
                 core::CPersistUtils::restore(NUMBER_THREADS_TAG, m_NumberThreads, traverser))
+        RESTORE(NUMBER_CONCURRENT_LEAF_SPLITS_TAG,
+                core::CPersistUtils::restore(NUMBER_CONCURRENT_LEAF_SPLITS_TAG,
+                                             m_NumberConcurrentLeafSplits, traverser))
         RESTORE(NUMBER_TOP_SHAP_VALUES_TAG,
                 core::CPersistUtils::restore(NUMBER_TOP_SHAP_VALUES_TAG,
                                              m_NumberTopShapValues, traverser))
@@ -14,6 +14,7 @@
 #include <maths/CDataFrameCategoryEncoder.h>
 #include <maths/CTools.h>
 
+#include <algorithm>
 #include <limits>
 
 namespace ml {
@@ -37,6 +38,7 @@ CBoostedTreeLeafNodeStatistics::CBoostedTreeLeafNodeStatistics(
     std::size_t id,
     const TSizeVec& extraColumns,
     std::size_t numberLossParameters,
+    bool diagonalCurvature,
     std::size_t numberThreads,
     const core::CDataFrame& frame,
     const CDataFrameCategoryEncoder& encoder,
@@ -48,19 +50,23 @@ CBoostedTreeLeafNodeStatistics::CBoostedTreeLeafNodeStatistics(
     const core::CPackedBitVector& rowMask,
     CWorkspace& workspace)
     : m_Id{id}, m_Depth{depth}, m_ExtraColumns{extraColumns},
-      m_NumberLossParameters{numberLossParameters}, m_CandidateSplits{candidateSplits} {
+      m_NumberLossParameters{numberLossParameters},
+      m_DiagonalCurvature{diagonalCurvature}, m_CandidateSplits{candidateSplits} {
+
+    auto& rowIndices = workspace.rowIndices();
+    rowIndices.assign(rowMask.beginOneBits(), rowMask.endOneBits());
+    m_EndRowIndex = rowIndices.size();
 
     this->computeAggregateLossDerivatives(numberThreads, frame, encoder,
-                                          treeFeatureBag, rowMask, workspace);
+                                          treeFeatureBag, workspace);
 
-    // Lazily copy the mask and derivatives to avoid unnecessary allocations.
+    // Lazily copy the derivatives to avoid unnecessary allocations.
 
     m_Derivatives.swap(workspace.reducedDerivatives());
     m_BestSplit = this->computeBestSplitStatistics(regularization, nodeFeatureBag);
     workspace.reducedDerivatives().swap(m_Derivatives);
 
     if (this->gain() > workspace.minimumGain()) {
-        m_RowMask = rowMask;
         CSplitsDerivatives tmp{workspace.derivatives()[0]};
         m_Derivatives = std::move(tmp);
     }
@@ -69,37 +75,22 @@ CBoostedTreeLeafNodeStatistics::CBoostedTreeLeafNodeStatistics(
 CBoostedTreeLeafNodeStatistics::CBoostedTreeLeafNodeStatistics(
     std::size_t id,
     const CBoostedTreeLeafNodeStatistics& parent,
-    std::size_t numberThreads,
-    const core::CDataFrame& frame,
-    const CDataFrameCategoryEncoder& encoder,
     const TRegularization& regularization,
-    const TSizeVec& treeFeatureBag,
     const TSizeVec& nodeFeatureBag,
     bool isLeftChild,
-    const CBoostedTreeNode& split,
     CWorkspace& workspace)
     : m_Id{id}, m_Depth{parent.m_Depth + 1}, m_ExtraColumns{parent.m_ExtraColumns},
-      m_NumberLossParameters{parent.m_NumberLossParameters}, m_CandidateSplits{
-                                                                 parent.m_CandidateSplits} {
+      m_NumberLossParameters{parent.m_NumberLossParameters},
+      m_DiagonalCurvature{parent.m_DiagonalCurvature},
+      m_CandidateSplits{parent.m_CandidateSplits},
+      m_BeginRowIndex{parent.m_BeginRowIndex}, m_EndRowIndex{parent.m_EndRowIndex} {
 
-    // The number of threads we'll use breaks down as follows:
-    //   - We need a minimum number of rows per thread to ensure reasonable
-    //     load balancing.
-    //   - We need a minimum amount of work per thread to make the overheads
-    //     of distributing worthwhile.
-    std::size_t features{treeFeatureBag.size()};
-    std::size_t rows{parent.minimumChildRowCount()};
-    std::size_t rowsPerThreadConstraint{rows / 64};
-    std::size_t workPerThreadConstraint{(features * rows) / (8 * 128)};
-    std::size_t maximumNumberThreads{std::max(
-        std::min(rowsPerThreadConstraint, workPerThreadConstraint), std::size_t{1})};
-    numberThreads = std::min(numberThreads, maximumNumberThreads);
+    // The parent's rows have been partitioned and this child's derivatives
+    // aggregated by the readers created in prepareSplit.
 
-    this->computeRowMaskAndAggregateLossDerivatives(numberThreads, frame, encoder,
-                                                    isLeftChild, split, treeFeatureBag,
-                                                    parent.m_RowMask, workspace);
+    (isLeftChild ? m_EndRowIndex : m_BeginRowIndex) = workspace.rightChildBeginRowIndex();
 
-    // Lazily copy the mask and derivatives to avoid unnecessary allocations.
+    // Lazily copy the derivatives to avoid unnecessary allocations.
 
     m_Derivatives.swap(workspace.reducedDerivatives());
     m_BestSplit = this->computeBestSplitStatistics(regularization, nodeFeatureBag);
@@ -107,7 +98,6 @@ CBoostedTreeLeafNodeStatistics::CBoostedTreeLeafNodeStatistics(
 
     if (this->gain() >= workspace.minimumGain()) {
         CSplitsDerivatives tmp{workspace.reducedDerivatives()};
-        m_RowMask = workspace.reducedMask(parent.m_RowMask.size());
         m_Derivatives = std::move(tmp);
     }
 }
@@ -115,22 +105,24 @@ CBoostedTreeLeafNodeStatistics::CBoostedTreeLeafNodeStatistics(
 CBoostedTreeLeafNodeStatistics::CBoostedTreeLeafNodeStatistics(
     std::size_t id,
     CBoostedTreeLeafNodeStatistics&& parent,
+    bool isLeftChild,
     const TRegularization& regularization,
     const TSizeVec& nodeFeatureBag,
     CWorkspace& workspace)
     : m_Id{id}, m_Depth{parent.m_Depth + 1}, m_ExtraColumns{parent.m_ExtraColumns},
       m_NumberLossParameters{parent.m_NumberLossParameters},
-      m_CandidateSplits{parent.m_CandidateSplits}, m_Derivatives{std::move(
-                                                       parent.m_Derivatives)} {
+      m_DiagonalCurvature{parent.m_DiagonalCurvature},
+      m_CandidateSplits{parent.m_CandidateSplits},
+      m_BeginRowIndex{parent.m_BeginRowIndex}, m_EndRowIndex{parent.m_EndRowIndex},
+      m_Derivatives{std::move(parent.m_Derivatives)} {
+
+    // The sibling's rows were partitioned out of the parent's range so these
+    // are the complement of its range.
 
-    // Lazily compute the row mask to avoid unnecessary work.
+    (isLeftChild ? m_EndRowIndex : m_BeginRowIndex) = workspace.rightChildBeginRowIndex();
 
     m_Derivatives.subtract(workspace.reducedDerivatives());
     m_BestSplit = this->computeBestSplitStatistics(regularization, nodeFeatureBag);
-    if (this->gain() >= workspace.minimumGain()) {
-        m_RowMask = std::move(parent.m_RowMask);
-        m_RowMask ^= workspace.reducedMask(m_RowMask.size());
-    }
 }
 
 CBoostedTreeLeafNodeStatistics::TPtrPtrPr
@@ -145,37 +137,117 @@ CBoostedTreeLeafNodeStatistics::split(std::size_t leftChildId,
                                       const TSizeVec& nodeFeatureBag,
                                       const CBoostedTreeNode& split,
                                       CWorkspace& workspace) {
+    auto readers = this->prepareSplit(numberThreads, gainThreshold, encoder,
+                                      treeFeatureBag, split, workspace);
+    if (readers.size() > 0) {
+        auto rowIndices = this->rowIndices(workspace);
+        frame.readRows(rowIndices.first, rowIndices.second, readers);
+    }
+    return this->finishSplit(leftChildId, rightChildId, gainThreshold,
+                             regularization, nodeFeatureBag, workspace);
+}
+
+CBoostedTreeLeafNodeStatistics::TRowFuncVec
+CBoostedTreeLeafNodeStatistics::prepareSplit(std::size_t numberThreads,
+                                             double gainThreshold,
+                                             const CDataFrameCategoryEncoder& encoder,
+                                             const TSizeVec& treeFeatureBag,
+                                             const CBoostedTreeNode& split,
+                                             CWorkspace& workspace) const {
+
+    EChildToRead childToRead{this->childToRead(gainThreshold)};
+    if (childToRead == E_NoChild) {
+        return {};
+    }
+    bool isLeftChild{childToRead == E_LeftChild};
+
+    // The number of threads we'll use breaks down as follows:
+    //   - We need a minimum number of rows per thread to ensure reasonable
+    //     load balancing.
+    //   - We need a minimum amount of work per thread to make the overheads
+    //     of distributing worthwhile.
+    std::size_t features{treeFeatureBag.size()};
+    std::size_t rows{this->minimumChildRowCount()};
+    std::size_t rowsPerThreadConstraint{rows / 64};
+    std::size_t workPerThreadConstraint{(features * rows) / (8 * 128)};
+    std::size_t maximumNumberThreads{std::max(
+        std::min(rowsPerThreadConstraint, workPerThreadConstraint), std::size_t{1})};
+    numberThreads = std::min(numberThreads, maximumNumberThreads);
+
+    // Each reader processes a contiguous block of the parent's rows in order.
+    // So concatenating the per thread left and then right child rows stably
+    // partitions the parent's range and the children's rows remain sorted.
+
+    workspace.newLeaf(numberThreads);
+
+    TRowFuncVec readers;
+    readers.reserve(numberThreads);
+
+    for (std::size_t i = 0; i < numberThreads; ++i) {
+        auto& leftChildRowIndices = workspace.leftChildRowIndices()[i];
+        auto& rightChildRowIndices = workspace.rightChildRowIndices()[i];
+        auto& splitsDerivatives = workspace.derivatives()[i];
+        leftChildRowIndices.clear();
+        rightChildRowIndices.clear();
+        splitsDerivatives.zero();
+        readers.push_back([&, isLeftChild](TRowItr beginRows, TRowItr endRows) {
+            for (auto row = beginRows; row != endRows; ++row) {
+                auto encodedRow = encoder.encode(*row);
+                bool assignToLeft{split.assignToLeft(encodedRow)};
+                (assignToLeft ? leftChildRowIndices : rightChildRowIndices).push_back(row->index());
+                if (assignToLeft == isLeftChild) {
+                    this->addRowDerivatives(treeFeatureBag, encodedRow, splitsDerivatives);
+                }
+            }
+        });
+    }
+
+    return readers;
+}
+
+CBoostedTreeLeafNodeStatistics::TSizeVecCItrPr
+CBoostedTreeLeafNodeStatistics::rowIndices(const CWorkspace& workspace) const {
+    const auto& rowIndices = workspace.rowIndices();
+    return {rowIndices.begin() + m_BeginRowIndex, rowIndices.begin() + m_EndRowIndex};
+}
+
+CBoostedTreeLeafNodeStatistics::TPtrPtrPr
+CBoostedTreeLeafNodeStatistics::finishSplit(std::size_t leftChildId,
+                                            std::size_t rightChildId,
+                                            double gainThreshold,
+                                            const TRegularization& regularization,
+                                            const TSizeVec& nodeFeatureBag,
+                                            CWorkspace& workspace) {
+
+    EChildToRead childToRead{this->childToRead(gainThreshold)};
+    if (childToRead == E_NoChild) {
+        return {};
+    }
+
+    this->copyChildRowIndices(workspace);
+
+    // We only read the child with more rows if we don't need the other child.
+
     TPtr leftChild;
     TPtr rightChild;
-    if (this->leftChildHasFewerRows()) {
-        if (this->m_BestSplit.s_LeftChildMaxGain > gainThreshold) {
-            leftChild = std::make_shared<CBoostedTreeLeafNodeStatistics>(
-                leftChildId, *this, numberThreads, frame, encoder, regularization,
-                treeFeatureBag, nodeFeatureBag, true /*is left child*/, split, workspace);
-            if (this->m_BestSplit.s_RightChildMaxGain > gainThreshold) {
-                rightChild = std::make_shared<CBoostedTreeLeafNodeStatistics>(
-                    rightChildId, std::move(*this), regularization, nodeFeatureBag, workspace);
-            }
-        } else if (this->m_BestSplit.s_RightChildMaxGain > gainThreshold) {
+    if (childToRead == E_LeftChild) {
+        leftChild = std::make_shared<CBoostedTreeLeafNodeStatistics>(
+            leftChildId, *this, regularization, nodeFeatureBag,
+            true /*is left child*/, workspace);
+        if (m_BestSplit.s_RightChildMaxGain > gainThreshold) {
             rightChild = std::make_shared<CBoostedTreeLeafNodeStatistics>(
-                rightChildId, *this, numberThreads, frame, encoder, regularization,
-                treeFeatureBag, nodeFeatureBag, false /*is left child*/, split, workspace);
+                rightChildId, std::move(*this), false /*is left child*/,
+                regularization, nodeFeatureBag, workspace);
         }
-        return {std::move(leftChild), std::move(rightChild)};
-    }
-
-    if (this->m_BestSplit.s_RightChildMaxGain > gainThreshold) {
+    } else {
         rightChild = std::make_shared<CBoostedTreeLeafNodeStatistics>(
-            rightChildId, *this, numberThreads, frame, encoder, regularization,
-            treeFeatureBag, nodeFeatureBag, false /*is left child*/, split, workspace);
-        if (this->m_BestSplit.s_LeftChildMaxGain > gainThreshold) {
+            rightChildId, *this, regularization, nodeFeatureBag,
+            false /*is left child*/, workspace);
+        if (m_BestSplit.s_LeftChildMaxGain > gainThreshold) {
             leftChild = std::make_shared<CBoostedTreeLeafNodeStatistics>(
-                leftChildId, std::move(*this), regularization, nodeFeatureBag, workspace);
+                leftChildId, std::move(*this), true /*is left child*/,
+                regularization, nodeFeatureBag, workspace);
         }
-    } else if (this->m_BestSplit.s_LeftChildMaxGain > gainThreshold) {
-        leftChild = std::make_shared<CBoostedTreeLeafNodeStatistics>(
-            leftChildId, *this, numberThreads, frame, encoder, regularization,
-            treeFeatureBag, nodeFeatureBag, true /*is left child*/, split, workspace);
     }
     return {std::move(leftChild), std::move(rightChild)};
 }
@@ -220,12 +292,12 @@ std::size_t CBoostedTreeLeafNodeStatistics::id() const {
     return m_Id;
 }
 
-core::CPackedBitVector& CBoostedTreeLeafNodeStatistics::rowMask() {
-    return m_RowMask;
+std::size_t CBoostedTreeLeafNodeStatistics::numberRows() const {
+    return m_EndRowIndex - m_BeginRowIndex;
 }
 
 std::size_t CBoostedTreeLeafNodeStatistics::memoryUsage() const {
-    return core::CMemory::dynamicSize(m_RowMask) + core::CMemory::dynamicSize(m_Derivatives);
+    return core::CMemory::dynamicSize(m_Derivatives);
 }
 
 std::size_t
@@ -233,7 +305,7 @@ CBoostedTreeLeafNodeStatistics::estimateMemoryUsage(std::size_t numberFeatures,
                                                     std::size_t numberSplitsPerFeature,
                                                     std::size_t numberLossParameters) {
     // See CBoostedTreeImpl::estimateMemoryUsage for a discussion of the cost
-    // of the row mask.
+    // of the row indices.
     std::size_t splitsDerivativesSize{CSplitsDerivatives::estimateMemoryUsage(
         numberFeatures, numberSplitsPerFeature, numberLossParameters)};
     return sizeof(CBoostedTreeLeafNodeStatistics) + splitsDerivativesSize;
@@ -244,7 +316,6 @@ void CBoostedTreeLeafNodeStatistics::computeAggregateLossDerivatives(
     const core::CDataFrame& frame,
     const CDataFrameCategoryEncoder& encoder,
     const TSizeVec& featureBag,
-    const core::CPackedBitVector& rowMask,
     CWorkspace& workspace) const {
 
     workspace.newLeaf(numberThreads);
@@ -262,43 +333,38 @@ void CBoostedTreeLeafNodeStatistics::computeAggregateLossDerivatives(
         });
     }
 
-    frame.readRows(0, frame.numberRows(), aggregators, &rowMask);
+    const auto& rowIndices = workspace.rowIndices();
+    frame.readRows(rowIndices.begin() + m_BeginRowIndex,
+                   rowIndices.begin() + m_EndRowIndex, aggregators);
 }
 
-void CBoostedTreeLeafNodeStatistics::computeRowMaskAndAggregateLossDerivatives(
-    std::size_t numberThreads,
-    const core::CDataFrame& frame,
-    const CDataFrameCategoryEncoder& encoder,
-    bool isLeftChild,
-    const CBoostedTreeNode& split,
-    const TSizeVec& featureBag,
-    const core::CPackedBitVector& parentRowMask,
-    CWorkspace& workspace) const {
-
-    workspace.newLeaf(numberThreads);
-
-    core::CDataFrame::TRowFuncVec aggregators;
-    aggregators.reserve(numberThreads);
+CBoostedTreeLeafNodeStatistics::EChildToRead
+CBoostedTreeLeafNodeStatistics::childToRead(double gainThreshold) const {
+    // We read the child with fewer rows and compute the other child from the
+    // difference if we need both. Otherwise, we read the child we need.
+    bool needLeftChild{m_BestSplit.s_LeftChildMaxGain > gainThreshold};
+    bool needRightChild{m_BestSplit.s_RightChildMaxGain > gainThreshold};
+    if (needLeftChild && needRightChild) {
+        return this->leftChildHasFewerRows() ? E_LeftChild : E_RightChild;
+    }
+    return needLeftChild ? E_LeftChild : (needRightChild ? E_RightChild : E_NoChild);
+}
 
+void CBoostedTreeLeafNodeStatistics::copyChildRowIndices(CWorkspace& workspace) const {
+    std::size_t numberThreads{workspace.numberThreads()};
+    auto& rowIndices = workspace.rowIndices();
+    auto rowIndex = rowIndices.begin() + m_BeginRowIndex;
     for (std::size_t i = 0; i < numberThreads; ++i) {
-        auto& mask = workspace.masks()[i];
-        auto& splitsDerivatives = workspace.derivatives()[i];
-        mask.clear();
-        splitsDerivatives.zero();
-        aggregators.push_back([&](TRowItr beginRows, TRowItr endRows) {
-            for (auto row = beginRows; row != endRows; ++row) {
-                auto encodedRow = encoder.encode(*row);
-                if (split.assignToLeft(encodedRow) == isLeftChild) {
-                    std::size_t index{row->index()};
-                    mask.extend(false, index - mask.size());
-                    mask.extend(true);
-                    this->addRowDerivatives(featureBag, encodedRow, splitsDerivatives);
-                }
-            }
-        });
+        const auto& leftChildRowIndices = workspace.leftChildRowIndices()[i];
+        rowIndex = std::copy(leftChildRowIndices.begin(), leftChildRowIndices.end(), rowIndex);
     }
-
-    frame.readRows(0, frame.numberRows(), aggregators, &parentRowMask);
+    std::size_t rightChildBeginRowIndex(rowIndex - rowIndices.begin());
+    for (std::size_t i = 0; i < numberThreads; ++i) {
+        const auto& rightChildRowIndices = workspace.rightChildRowIndices()[i];
+        rowIndex = std::copy(rightChildRowIndices.begin(),
+                             rightChildRowIndices.end(), rowIndex);
+    }
+    workspace.rightChildBeginRowIndex(rightChildBeginRowIndex);
 }
 
 void CBoostedTreeLeafNodeStatistics::addRowDerivatives(const TSizeVec& featureBag,
@@ -306,7 +372,7 @@ void CBoostedTreeLeafNodeStatistics::addRowDerivatives(const TSizeVec& featureBa
                                                        CSplitsDerivatives& splitsDerivatives) const {
 
     auto derivatives = readLossDerivatives(row.unencodedRow(), m_ExtraColumns,
-                                           m_NumberLossParameters);
+                                           m_NumberLossParameters, m_DiagonalCurvature);
 
     if (derivatives.size() == 2) {
         if (derivatives(0) >= 0.0) {
@@ -370,6 +436,21 @@ CBoostedTreeLeafNodeStatistics::computeBestSplitStatistics(const TRegularization
         minimumLoss = [&](const TDoubleVector& g, const TDoubleMatrix& h) -> double {
             return CTools::pow2(g(0)) / (h(0, 0) + lambda);
         };
+    } else if (m_DiagonalCurvature) {
+        // If we only have the diagonal of the Hessian then H(\lambda) is diagonal
+        // and we can avoid the decomposition altogether.
+        minimumLoss = [&](const TDoubleVector& g, const TDoubleMatrix& h) -> double {
+            double result{0.0};
+            for (int i = 0; i < d; ++i) {
+                double curvature{h(i, i) + lambda};
+                if (curvature > 0.0) {
+                    result += CTools::pow2(g(i)) / curvature;
+                } else if (g(i) != 0.0) {
+                    return -INF / 2.0; // The loss is unbounded: discard this split.
+                }
+            }
+            return result;
+        };
     } else {
         minimumLoss = [&](const TDoubleVector& g, const TDoubleMatrix& h) -> double {
             hessian_ = hessian =
@@ -41,6 +41,7 @@ const std::size_t HUBER_OPTIMIZATION_ITERATIONS{15};
 
 // Persistence and restoration
 const std::string NUMBER_CLASSES_TAG{"number_classes"};
+const std::string DIAGONAL_CURVATURE_TAG{"diagonal_curvature"};
 const std::string OFFSET_TAG{"offset"};
 const std::string DELTA_TAG{"delta"};
 const std::string NAME_TAG{"name"};
@@ -728,6 +729,10 @@ bool CMse::isCurvatureConstant() const {
     return true;
 }
 
+bool CMse::isCurvatureDiagonal() const {
+    return false;
+}
+
 CMse::TDoubleVector CMse::transform(const TMemoryMappedFloatVector& prediction) const {
     return TDoubleVector{prediction};
 }
@@ -813,6 +818,10 @@ bool CMsle::isCurvatureConstant() const {
     return false;
 }
 
+bool CMsle::isCurvatureDiagonal() const {
+    return false;
+}
+
 CMsle::TDoubleVector CMsle::transform(const TMemoryMappedFloatVector& prediction) const {
     TDoubleVector result{1};
     result(0) = std::exp(prediction(0));
@@ -897,6 +906,10 @@ bool CPseudoHuber::isCurvatureConstant() const {
     return false;
 }
 
+bool CPseudoHuber::isCurvatureDiagonal() const {
+    return false;
+}
+
 CPseudoHuber::TDoubleVector
 CPseudoHuber::transform(const TMemoryMappedFloatVector& prediction) const {
     TDoubleVector result{1};
@@ -984,6 +997,10 @@ bool CBinomialLogisticLoss::isCurvatureConstant() const {
     return false;
 }
 
+bool CBinomialLogisticLoss::isCurvatureDiagonal() const {
+    return false;
+}
+
 CBinomialLogisticLoss::TDoubleVector
 CBinomialLogisticLoss::transform(const TMemoryMappedFloatVector& prediction) const {
     double p1{CTools::logisticFunction(prediction(0))};
@@ -1014,8 +1031,8 @@ bool CBinomialLogisticLoss::acceptRestoreTraverser(core::CStateRestoreTraverser&
 
 const std::string CBinomialLogisticLoss::NAME{"binomial_logistic"};
 
-CMultinomialLogisticLoss::CMultinomialLogisticLoss(std::size_t numberClasses)
-    : m_NumberClasses{numberClasses} {
+CMultinomialLogisticLoss::CMultinomialLogisticLoss(std::size_t numberClasses, bool diagonalCurvature)
+    : m_NumberClasses{numberClasses}, m_DiagonalCurvature{diagonalCurvature} {
 }
 
 CMultinomialLogisticLoss::CMultinomialLogisticLoss(core::CStateRestoreTraverser& traverser) {
@@ -1026,7 +1043,7 @@ CMultinomialLogisticLoss::CMultinomialLogisticLoss(core::CStateRestoreTraverser&
 }
 
 std::unique_ptr<CLoss> CMultinomialLogisticLoss::clone() const {
-    return std::make_unique<CMultinomialLogisticLoss>(m_NumberClasses);
+    return std::make_unique<CMultinomialLogisticLoss>(m_NumberClasses, m_DiagonalCurvature);
 }
 
 ELossType CMultinomialLogisticLoss::type() const {
@@ -1095,7 +1112,8 @@ void CMultinomialLogisticLoss::curvature(const TMemoryMappedFloatVector& predict
                                          TWriter writer,
                                          double weight) const {
 
-    // Return the lower triangle of the Hessian column major.
+    // Return the lower triangle of the Hessian column major or just its diagonal
+    // if we're approximating it by its diagonal.
 
     // We prefer an implementation which avoids any memory allocations.
 
@@ -1124,6 +1142,9 @@ void CMultinomialLogisticLoss::curvature(const TMemoryMappedFloatVector& predict
         } else {
             writer(k++, weight * probability * (1.0 - probability));
         }
+        if (m_DiagonalCurvature) {
+            continue;
+        }
         for (std::size_t j = i + 1; j < m_NumberClasses; ++j) {
             double probabilities[]{CTools::stableExp(predictions(i) - logZ),
                                    CTools::stableExp(predictions(j) - logZ)};
@@ -1136,6 +1157,10 @@ bool CMultinomialLogisticLoss::isCurvatureConstant() const {
     return false;
 }
 
+bool CMultinomialLogisticLoss::isCurvatureDiagonal() const {
+    return m_DiagonalCurvature;
+}
+
 CMultinomialLogisticLoss::TDoubleVector
 CMultinomialLogisticLoss::transform(const TMemoryMappedFloatVector& prediction) const {
     TDoubleVector result{prediction};
@@ -1159,6 +1184,7 @@ bool CMultinomialLogisticLoss::isRegression() const {
 
 void CMultinomialLogisticLoss::acceptPersistInserter(core::CStatePersistInserter& inserter) const {
     core::CPersistUtils::persist(NUMBER_CLASSES_TAG, m_NumberClasses, inserter);
+    core::CPersistUtils::persist(DIAGONAL_CURVATURE_TAG, m_DiagonalCurvature, inserter);
 }
 
 bool CMultinomialLogisticLoss::acceptRestoreTraverser(core::CStateRestoreTraverser& traverser) {
@@ -1166,6 +1192,8 @@ bool CMultinomialLogisticLoss::acceptRestoreTraverser(core::CStateRestoreTravers
         const std::string& name = traverser.name();
         RESTORE(NUMBER_CLASSES_TAG,
                 core::CPersistUtils::restore(NUMBER_CLASSES_TAG, m_NumberClasses, traverser))
+        RESTORE(DIAGONAL_CURVATURE_TAG,
+                core::CPersistUtils::restore(DIAGONAL_CURVATURE_TAG, m_DiagonalCurvature, traverser))
     } while (traverser.next());
     return true;
 }
@@ -41,8 +41,11 @@ void writeLossGradient(const TRowRef& row,
                   [&writer](std::size_t i, double value) { writer(i, value); }, weight);
 }
 
-void zeroLossCurvature(const TRowRef& row, const TSizeVec& extraColumns, std::size_t numberLossParameters) {
-    for (std::size_t i = 0, size = lossHessianUpperTriangleSize(numberLossParameters);
+void zeroLossCurvature(const TRowRef& row,
+                       const TSizeVec& extraColumns,
+                       std::size_t numberLossParameters,
+                       bool diagonalCurvature) {
+    for (std::size_t i = 0, size = lossHessianStoredSize(numberLossParameters, diagonalCurvature);
          i < size; ++i) {
         row.writeColumn(extraColumns[E_Curvature] + i, 0.0);
     }
@@ -27,6 +27,9 @@
 #include <boost/unordered_map.hpp>
 
 #include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <numeric>
@@ -43,7 +46,6 @@ using TFloatVecVec = std::vector<TFloatVec>;
 using TRowItr = core::CDataFrame::TRowItr;
 using TRowRef = core::CDataFrame::TRowRef;
 using TRowSampler = CSampling::CReservoirSampler<TRowRef>;
-using TRowSamplerVec = std::vector<TRowSampler>;
 using TSizeEncoderPtrUMap =
     boost::unordered_map<std::size_t, std::unique_ptr<CDataFrameUtils::CColumnValue>>;
 using TPackedBitVectorVec = CDataFrameUtils::TPackedBitVectorVec;
@@ -68,159 +70,346 @@ bool doReduce(std::pair<std::vector<READER>, bool> readResults,
     return true;
 }
 
-//! \brief Manages stratified sampling.
-class CStratifiedSampler {
+//! \brief Assigns the rows of a data frame to stratified random folds.
+//!
+//! DESCRIPTION:\n
+//! The row reader passed to core::CDataFrame::readRows is called once for the
+//! masked rows of each slice, whatever the number of threads. We treat these as
+//! blocks, identified by their first row. One pass counts the rows of each stratum
+//! in each block. The rows of each stratum still to assign to each fold are then
+//! apportioned to the blocks in turn, in proportion to the rows of the stratum
+//! still to assign, so that the fold totals are exact. A second pass randomly
+//! permutes the fold labels of each block using a generator seeded by the block.
+//! Both passes can be run in parallel and the folds depend only on the seed, not
+//! the number of threads.
+class CStratifiedFoldAssigner {
 public:
-    using TSamplerSelector = std::function<std::size_t(const TRowRef&)>;
+    using TStratumSelector = std::function<std::size_t(const TRowRef&)>;
+
+    //! The maximum number of folds supported.
+    static const std::size_t MAXIMUM_NUMBER_FOLDS;
 
 public:
-    CStratifiedSampler(std::size_t size) : m_SampledRowIndices(size) {
-        m_DesiredCounts.reserve(size);
-        m_Samplers.reserve(size);
-    }
+    explicit CStratifiedFoldAssigner(TStratumSelector selector)
+        : m_Selector{std::move(selector)} {}
+
+    //! Count the rows of each stratum in each block of \p rowMask.
+    bool countStrata(std::size_t numberThreads,
+                     const core::CDataFrame& frame,
+                     const core::CPackedBitVector& rowMask) {
+
+        auto countRows = core::bindRetrievableState(
+            [this](TSizeSizeVecPrVec& blocks, TRowItr beginRows, TRowItr endRows) {
+                if (beginRows == endRows) {
+                    return;
+                }
+                TSizeVec counts;
+                for (auto row = beginRows; row != endRows; ++row) {
+                    std::size_t stratum{m_Selector(*row)};
+                    counts.resize(std::max(counts.size(), stratum + 1), 0);
+                    ++counts[stratum];
+                }
+                blocks.emplace_back(beginRows->index(), std::move(counts));
+            },
+            TSizeSizeVecPrVec{});
+        auto copyBlocks = [](TSizeSizeVecPrVec blocks_, TSizeSizeVecPrVec& blocks) {
+            blocks = std::move(blocks_);
+        };
+        auto reduceBlocks = [](TSizeSizeVecPrVec blocks_, TSizeSizeVecPrVec& blocks) {
+            std::move(blocks_.begin(), blocks_.end(), std::back_inserter(blocks));
+        };
 
-    void sample(const TRowRef& row) { m_Samplers[m_Selector(row)].sample(row); }
+        TSizeSizeVecPrVec blocks;
+        if (doReduce(frame.readRows(numberThreads, 0, frame.numberRows(), countRows, &rowMask),
+                     copyBlocks, reduceBlocks, blocks) == false) {
+            return false;
+        }
+        std::sort(blocks.begin(), blocks.end(), COrderings::SFirstLess{});
 
-    //! Add one of the strata samplers.
-    void addSampler(std::size_t count, CPRNG::CXorOShiro128Plus rng) {
-        TSizeVec& samples{m_SampledRowIndices[m_Samplers.size()]};
-        samples.reserve(count);
-        auto sampler = [&](std::size_t slot, const TRowRef& row) {
-            if (slot >= samples.size()) {
-                samples.resize(slot + 1);
+        std::size_t numberStrata{0};
+        for (const auto& block : blocks) {
+            numberStrata = std::max(numberStrata, block.second.size());
+        }
+
+        m_BlockFirstRows.clear();
+        m_BlockStrataCounts.clear();
+        m_StrataCounts.assign(numberStrata, 0);
+        m_BlockFirstRows.reserve(blocks.size());
+        m_BlockStrataCounts.reserve(blocks.size());
+        for (auto& block : blocks) {
+            block.second.resize(numberStrata, 0);
+            for (std::size_t i = 0; i < numberStrata; ++i) {
+                m_StrataCounts[i] += block.second[i];
             }
-            samples[slot] = row.index();
-        };
-        m_DesiredCounts.push_back(count);
-        m_Samplers.emplace_back(count, sampler, rng);
+            m_BlockFirstRows.push_back(block.first);
+            m_BlockStrataCounts.push_back(std::move(block.second));
+        }
+        LOG_TRACE(<< "# blocks = " << m_BlockFirstRows.size()
+                  << ", strata counts = " << core::CContainerPrinter::print(m_StrataCounts));
+
+        return true;
     }
 
-    //! Define the callback to select the sampler.
-    void samplerSelector(TSamplerSelector selector) {
-        m_Selector = std::move(selector);
+    //! Get the total count of each stratum.
+    const TSizeVec& strataCounts() const { return m_StrataCounts; }
+
+    //! Assign the rows of \p rowMask to folds.
+    //!
+    //! \param[in] foldCounts The number of rows of each stratum to assign to each
+    //! fold. This is indexed by stratum then fold and the counts of each stratum
+    //! must sum to its total count.
+    //! \param[in] seed The seed from which to generate the random folds.
+    //! \return The row mask of each fold.
+    std::pair<TPackedBitVectorVec, bool> assign(std::size_t numberThreads,
+                                                const core::CDataFrame& frame,
+                                                const core::CPackedBitVector& rowMask,
+                                                const TSizeVecVec& foldCounts,
+                                                std::uint64_t seed) const {
+
+        std::size_t numberStrata{m_StrataCounts.size()};
+        std::size_t numberFolds{foldCounts.empty() ? 1 : foldCounts[0].size()};
+
+        TSizeVec blockFoldCounts{this->apportionToBlocks(foldCounts, numberFolds)};
+
+        auto assignFolds = core::bindRetrievableState(
+            [&](TSizeFoldVecPrVec& blocks, TRowItr beginRows, TRowItr endRows) {
+                if (beginRows == endRows) {
+                    return;
+                }
+
+                std::size_t block(std::lower_bound(m_BlockFirstRows.begin(),
+                                                   m_BlockFirstRows.end(),
+                                                   beginRows->index()) -
+                                  m_BlockFirstRows.begin());
+
+                CPRNG::CXorOShiro128Plus rng{seed + block};
+                TFoldVecVec strataFolds(numberStrata);
+                for (std::size_t i = 0, j = block * numberStrata * numberFolds;
+                     i < numberStrata; ++i) {
+                    strataFolds[i].reserve(m_BlockStrataCounts[block][i]);
+                    for (std::size_t fold = 0; fold < numberFolds; ++fold, ++j) {
+                        strataFolds[i].insert(strataFolds[i].end(), blockFoldCounts[j],
+                                              static_cast<TFold>(fold));
+                    }
+                    CSampling::random_shuffle(rng, strataFolds[i].begin(),
+                                              strataFolds[i].end());
+                }
+
+                TSizeVec next(numberStrata, 0);
+                TFoldVec folds;
+                for (auto row = beginRows; row != endRows; ++row) {
+                    std::size_t stratum{m_Selector(*row)};
+                    folds.push_back(strataFolds[stratum][next[stratum]++]);
+                }
+                blocks.emplace_back(block, std::move(folds));
+            },
+            TSizeFoldVecPrVec{});
+        auto copyBlocks = [](TSizeFoldVecPrVec blocks_, TSizeFoldVecPrVec& blocks) {
+            blocks = std::move(blocks_);
+        };
+        auto reduceBlocks = [](TSizeFoldVecPrVec blocks_, TSizeFoldVecPrVec& blocks) {
+            std::move(blocks_.begin(), blocks_.end(), std::back_inserter(blocks));
+        };
+
+        TSizeFoldVecPrVec blocks;
+        if (doReduce(frame.readRows(numberThreads, 0, frame.numberRows(), assignFolds, &rowMask),
+                     copyBlocks, reduceBlocks, blocks) == false) {
+            return {TPackedBitVectorVec(numberFolds), false};
+        }
+        std::sort(blocks.begin(), blocks.end(), COrderings::SFirstLess{});
+
+        // The blocks visit the rows of the mask in order.
+        TPackedBitVectorVec result(numberFolds);
+        auto row = rowMask.beginOneBits();
+        for (const auto& block : blocks) {
+            for (auto fold : block.second) {
+                result[fold].extend(false, *row - result[fold].size());
+                result[fold].extend(true);
+                ++row;
+            }
+        }
+        for (auto& mask : result) {
+            mask.extend(false, rowMask.size() - mask.size());
+        }
+
+        return {std::move(result), true};
     }
 
-    //! This selects the final samples, writing to \p result, and resets the sampling
-    //! state so this is ready to sample again.
-    void finishSampling(CPRNG::CXorOShiro128Plus& rng, TSizeVec& result) {
-        result.clear();
-        for (std::size_t i = 0; i < m_SampledRowIndices.size(); ++i) {
-            std::size_t sampleSize{m_Samplers[i].sampleSize()};
-            std::size_t desiredCount{std::min(m_DesiredCounts[i], sampleSize)};
-            CSampling::random_shuffle(rng, m_SampledRowIndices[i].begin(),
-                                      m_SampledRowIndices[i].begin() + sampleSize);
-            result.insert(result.end(), m_SampledRowIndices[i].begin(),
-                          m_SampledRowIndices[i].begin() + desiredCount);
-            m_SampledRowIndices[i].clear();
-            m_Samplers[i].reset();
+private:
+    using TFold = std::uint8_t;
+    using TFoldVec = std::vector<TFold>;
+    using TFoldVecVec = std::vector<TFoldVec>;
+    using TSizeSizeVecPr = std::pair<std::size_t, TSizeVec>;
+    using TSizeSizeVecPrVec = std::vector<TSizeSizeVecPr>;
+    using TSizeFoldVecPr = std::pair<std::size_t, TFoldVec>;
+    using TSizeFoldVecPrVec = std::vector<TSizeFoldVecPr>;
+
+private:
+    //! Get the count of each stratum in each fold for each block.
+    //!
+    //! The rows of each block are divided between the folds in proportion to
+    //! the stratum's rows still to assign to each fold, rounding using largest
+    //! remainders. Since the last block has exactly the rows still to assign
+    //! the fold totals are exact.
+    //!
+    //! \return The counts flattened in block, stratum and fold order.
+    TSizeVec apportionToBlocks(const TSizeVecVec& foldCounts, std::size_t numberFolds) const {
+
+        std::size_t numberStrata{m_StrataCounts.size()};
+
+        TSizeVec result(m_BlockStrataCounts.size() * numberStrata * numberFolds, 0);
+
+        TSizeVecVec remainingFoldCounts{foldCounts};
+        TSizeVec remainingCounts{m_StrataCounts};
+        TSizeVec remainders(numberFolds);
+        TSizeVec largestRemainders(numberFolds);
+
+        for (std::size_t block = 0, j = 0; block < m_BlockStrataCounts.size(); ++block) {
+            for (std::size_t i = 0; i < numberStrata; ++i, j += numberFolds) {
+                std::uint64_t count{m_BlockStrataCounts[block][i]};
+                std::uint64_t remaining{remainingCounts[i]};
+                if (count == 0) {
+                    continue;
+                }
+
+                std::size_t assigned{0};
+                for (std::size_t fold = 0; fold < numberFolds; ++fold) {
+                    std::uint64_t share{count * remainingFoldCounts[i][fold]};
+                    result[j + fold] = static_cast<std::size_t>(share / remaining);
+                    remainders[fold] = static_cast<std::size_t>(share % remaining);
+                    assigned += result[j + fold];
+                }
+
+                std::iota(largestRemainders.begin(), largestRemainders.end(), 0);
+                std::stable_sort(largestRemainders.begin(), largestRemainders.end(),
+                                 [&](std::size_t lhs, std::size_t rhs) {
+                                     return remainders[lhs] > remainders[rhs];
+                                 });
+                for (std::size_t k = 0; assigned < count; ++k, ++assigned) {
+                    ++result[j + largestRemainders[k]];
+                }
+
+                for (std::size_t fold = 0; fold < numberFolds; ++fold) {
+                    remainingFoldCounts[i][fold] -= result[j + fold];
+                }
+                remainingCounts[i] -= static_cast<std::size_t>(count);
+            }
         }
+
+        return result;
     }
 
 private:
-    TSizeVec m_DesiredCounts;
-    TSizeVecVec m_SampledRowIndices;
-    TRowSamplerVec m_Samplers;
-    TSamplerSelector m_Selector;
+    TStratumSelector m_Selector;
+    //! The first row of each block.
+    TSizeVec m_BlockFirstRows;
+    //! The count of each stratum in each block.
+    TSizeVecVec m_BlockStrataCounts;
+    //! The total count of each stratum.
+    TSizeVec m_StrataCounts;
 };
-using TStratifiedSamplerPtr = std::unique_ptr<CStratifiedSampler>;
-
-//! Get a classifier stratified row sampler for cross fold validation.
-std::pair<TStratifiedSamplerPtr, TDoubleVec>
-classifierStratifiedCrossValidationRowSampler(std::size_t numberThreads,
-                                              const core::CDataFrame& frame,
-                                              std::size_t targetColumn,
-                                              CPRNG::CXorOShiro128Plus rng,
-                                              std::size_t desiredCount,
-                                              const core::CPackedBitVector& rowMask) {
-
-    TDoubleVec categoryFrequencies{CDataFrameUtils::categoryFrequencies(
-        numberThreads, frame, rowMask, {targetColumn})[targetColumn]};
-
-    TSizeVec categoryCounts;
-    CSampling::weightedSample(desiredCount, categoryFrequencies, categoryCounts);
-    LOG_TRACE(<< "desired category counts per test fold = "
-              << core::CContainerPrinter::print(categoryCounts));
-
-    auto sampler = std::make_unique<CStratifiedSampler>(categoryCounts.size());
-    for (std::size_t i = 0; i < categoryCounts.size(); ++i) {
-        sampler->addSampler(categoryCounts[i], rng);
-    }
-    sampler->samplerSelector([targetColumn](const TRowRef& row) mutable {
-        return static_cast<std::size_t>(row[targetColumn]);
-    });
 
-    return {std::move(sampler), std::move(categoryFrequencies)};
+const std::size_t CStratifiedFoldAssigner::MAXIMUM_NUMBER_FOLDS{
+    static_cast<std::size_t>(std::numeric_limits<std::uint8_t>::max()) + 1};
+
+//! Get a stratum selector for classification which uses the target class.
+CStratifiedFoldAssigner::TStratumSelector classifierStratumSelector(std::size_t targetColumn) {
+    return [targetColumn](const TRowRef& row) {
+        return static_cast<std::size_t>(row[targetColumn]);
+    };
 }
 
-//! Get a regression stratified row sampler for cross fold validation.
-TStratifiedSamplerPtr
-regressionStratifiedCrossValiationRowSampler(std::size_t numberThreads,
-                                             const core::CDataFrame& frame,
-                                             std::size_t targetColumn,
-                                             CPRNG::CXorOShiro128Plus rng,
-                                             std::size_t desiredCount,
-                                             std::size_t numberBuckets,
-                                             const core::CPackedBitVector& rowMask) {
-
-    auto quantiles = CDataFrameUtils::columnQuantiles(
-                         numberThreads, frame, rowMask, {targetColumn},
-                         CQuantileSketch{CQuantileSketch::E_Linear, 50})
-                         .first;
+//! Get a stratum selector for regression which uses the target quantile bucket.
+CStratifiedFoldAssigner::TStratumSelector
+regressionStratumSelector(std::size_t numberThreads,
+                          const core::CDataFrame& frame,
+                          std::size_t targetColumn,
+                          std::size_t numberBuckets,
+                          const core::CPackedBitVector& rowMask) {
+
+    using TSizeQuantileSketchPr = std::pair<std::size_t, CQuantileSketch>;
+    using TSizeQuantileSketchPrVec = std::vector<TSizeQuantileSketchPr>;
+
+    // Merging sketches isn't associative so we sketch each block and merge them
+    // in row order to get the same buckets whatever the number of threads.
+    auto readQuantiles = core::bindRetrievableState(
+        [targetColumn](TSizeQuantileSketchPrVec& blocks, TRowItr beginRows, TRowItr endRows) {
+            if (beginRows == endRows) {
+                return;
+            }
+            CQuantileSketch sketch{CQuantileSketch::E_Linear, 50};
+            for (auto row = beginRows; row != endRows; ++row) {
+                if (CDataFrameUtils::isMissing((*row)[targetColumn]) == false) {
+                    sketch.add((*row)[targetColumn]);
+                }
+            }
+            blocks.emplace_back(beginRows->index(), std::move(sketch));
+        },
+        TSizeQuantileSketchPrVec{});
+    auto copyBlocks = [](TSizeQuantileSketchPrVec blocks_, TSizeQuantileSketchPrVec& blocks) {
+        blocks = std::move(blocks_);
+    };
+    auto reduceBlocks = [](TSizeQuantileSketchPrVec blocks_, TSizeQuantileSketchPrVec& blocks) {
+        std::move(blocks_.begin(), blocks_.end(), std::back_inserter(blocks));
+    };
+
+    TSizeQuantileSketchPrVec blocks;
+    doReduce(frame.readRows(numberThreads, 0, frame.numberRows(), readQuantiles, &rowMask),
+             copyBlocks, reduceBlocks, blocks);
+    std::sort(blocks.begin(), blocks.end(), COrderings::SFirstLess{});
+
+    CQuantileSketch quantiles{CQuantileSketch::E_Linear, 50};
+    for (const auto& block : blocks) {
+        quantiles += block.second;
+    }
 
     TDoubleVec buckets;
     for (double step = 100.0 / static_cast<double>(numberBuckets), percentile = step;
          percentile < 100.0; percentile += step) {
         double xQuantile;
-        quantiles[0].quantile(percentile, xQuantile);
+        quantiles.quantile(percentile, xQuantile);
         buckets.push_back(xQuantile);
     }
     buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
     buckets.push_back(std::numeric_limits<double>::max());
     LOG_TRACE(<< "buckets = " << core::CContainerPrinter::print(buckets));
 
-    auto bucketSelector = [buckets, targetColumn](const TRowRef& row) mutable {
+    return [ buckets = std::move(buckets), targetColumn ](const TRowRef& row) {
         return static_cast<std::size_t>(
             std::upper_bound(buckets.begin(), buckets.end(), row[targetColumn]) -
             buckets.begin());
     };
+}
 
-    auto countBucketRows = core::bindRetrievableState(
-        [&](TDoubleVec& bucketCounts, TRowItr beginRows, TRowItr endRows) {
-            for (auto row = beginRows; row != endRows; ++row) {
-                bucketCounts[bucketSelector(*row)] += 1.0;
-            }
-        },
-        TDoubleVec(buckets.size(), 0.0));
-    auto copyBucketRowCounts = [](TDoubleVec counts_, TDoubleVec& counts) {
-        counts = std::move(counts_);
-    };
-    auto reduceBucketRowCounts = [](TDoubleVec counts_, TDoubleVec& counts) {
-        for (std::size_t i = 0; i < counts.size(); ++i) {
-            counts[i] += counts_[i];
-        }
-    };
-
-    TDoubleVec bucketFrequencies;
-    doReduce(frame.readRows(numberThreads, 0, frame.numberRows(), countBucketRows, &rowMask),
-             copyBucketRowCounts, reduceBucketRowCounts, bucketFrequencies);
-    double totalCount{std::accumulate(bucketFrequencies.begin(),
-                                      bucketFrequencies.end(), 0.0)};
-    for (auto& frequency : bucketFrequencies) {
-        frequency /= totalCount;
+//! Get the count of each stratum in each fold so that each stratum is divided
+//! equally between the folds and each of the first \p numberFolds - 1 folds
+//! has close to \p desiredCount rows.
+TSizeVecVec stratifiedFoldCounts(const TSizeVec& strataCounts,
+                                 std::size_t numberFolds,
+                                 std::size_t desiredCount) {
+
+    double totalCount{static_cast<double>(
+        std::accumulate(strataCounts.begin(), strataCounts.end(), std::size_t{0}))};
+    TDoubleVec strataFrequencies(strataCounts.size());
+    for (std::size_t i = 0; i < strataCounts.size(); ++i) {
+        strataFrequencies[i] = static_cast<double>(strataCounts[i]) / totalCount;
     }
 
-    TSizeVec bucketCounts;
-    CSampling::weightedSample(desiredCount, bucketFrequencies, bucketCounts);
-    LOG_TRACE(<< "desired bucket counts per fold = "
-              << core::CContainerPrinter::print(bucketCounts));
-
-    auto sampler = std::make_unique<CStratifiedSampler>(buckets.size());
-    for (std::size_t i = 0; i < buckets.size(); ++i) {
-        sampler->addSampler(bucketCounts[i], rng);
+    TSizeVec desiredStrataCounts;
+    CSampling::weightedSample(desiredCount, strataFrequencies, desiredStrataCounts);
+    LOG_TRACE(<< "desired strata counts per fold = "
+              << core::CContainerPrinter::print(desiredStrataCounts));
+
+    TSizeVecVec result(strataCounts.size(), TSizeVec(numberFolds, 0));
+    for (std::size_t i = 0; i < strataCounts.size(); ++i) {
+        std::size_t remaining{strataCounts[i]};
+        for (std::size_t fold = 0; fold + 1 < numberFolds; ++fold) {
+            result[i][fold] = std::min(desiredStrataCounts[i], remaining);
+            remaining -= result[i][fold];
+        }
+        result[i][numberFolds - 1] = remaining;
     }
-    sampler->samplerSelector(bucketSelector);
-
-    return sampler;
+    return result;
 }
 
 //! Get the test row masks corresponding to \p foldRowMasks.
@@ -255,20 +444,25 @@ auto rowSampler(TFloatVecVec& samples) {
     };
 }
 
-template<typename TARGET>
 auto computeEncodedCategory(CMic& mic,
-                            const TARGET& target,
+                            const CDataFrameUtils::CColumnValue& target,
                             TSizeEncoderPtrUMap& encoders,
                             TFloatVecVec& samples) {
 
+    // The target is independent of the encoding so we compute it once and
+    // we encode all samples in one call for each encoder.
+    TDoubleVec targets;
+    TDoubleVec encoded;
+    target(samples, targets);
+
     CDataFrameUtils::TSizeDoublePrVec encodedMics;
     encodedMics.reserve(encoders.size());
     for (const auto& encoder : encoders) {
         std::size_t category{encoder.first};
-        const auto& encode = *encoder.second;
+        (*encoder.second)(samples, encoded);
         mic.clear();
-        for (const auto& sample : samples) {
-            mic.add(encode(sample), target(sample));
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            mic.add(encoded[i], targets[i]);
         }
         encodedMics.emplace_back(category, mic.compute());
     }
@@ -446,14 +640,20 @@ CDataFrameUtils::columnQuantiles(std::size_t numberThreads,
                                  const CDataFrameCategoryEncoder* encoder,
                                  const TWeightFunc& weight) {
 
+    using TFloatFloatPrVecVec = std::vector<CQuantileSketch::TFloatFloatPrVec>;
+
     auto readQuantiles = core::bindRetrievableState(
         [&](TQuantileSketchVec& quantiles, TRowItr beginRows, TRowItr endRows) {
+            // We gather each column's values for the rows and add them to its
+            // sketch in one batch, which is much faster than adding them one
+            // at a time.
+            TFloatFloatPrVecVec values(columnMask.size());
             if (encoder != nullptr) {
                 for (auto row = beginRows; row != endRows; ++row) {
                     CEncodedDataFrameRowRef encodedRow{encoder->encode(*row)};
                     for (std::size_t i = 0; i < columnMask.size(); ++i) {
                         if (isMissing(encodedRow[columnMask[i]]) == false) {
-                            quantiles[i].add(encodedRow[columnMask[i]], weight(*row));
+                            values[i].emplace_back(encodedRow[columnMask[i]], weight(*row));
                         }
                     }
                 }
@@ -461,11 +661,14 @@ CDataFrameUtils::columnQuantiles(std::size_t numberThreads,
                 for (auto row = beginRows; row != endRows; ++row) {
                     for (std::size_t i = 0; i < columnMask.size(); ++i) {
                         if (isMissing((*row)[columnMask[i]]) == false) {
-                            quantiles[i].add((*row)[columnMask[i]], weight(*row));
+                            values[i].emplace_back((*row)[columnMask[i]], weight(*row));
                         }
                     }
                 }
             }
+            for (std::size_t i = 0; i < columnMask.size(); ++i) {
+                quantiles[i].add(values[i]);
+            }
         },
         TQuantileSketchVec(columnMask.size(), std::move(estimateQuantiles)));
     auto copyQuantiles = [](TQuantileSketchVec quantiles, TQuantileSketchVec& result) {
@@ -495,55 +698,46 @@ CDataFrameUtils::stratifiedCrossValidationRowMasks(std::size_t numberThreads,
                                                    std::size_t numberFolds,
                                                    std::size_t numberBuckets,
                                                    const core::CPackedBitVector& allTrainingRowsMask) {
-    TDoubleVec frequencies;
-    TStratifiedSamplerPtr sampler;
+    if (numberFolds > CStratifiedFoldAssigner::MAXIMUM_NUMBER_FOLDS) {
+        HANDLE_FATAL(<< "Input error: at most " << CStratifiedFoldAssigner::MAXIMUM_NUMBER_FOLDS
+                     << " folds are supported but " << numberFolds << " were requested.");
+        numberFolds = CStratifiedFoldAssigner::MAXIMUM_NUMBER_FOLDS;
+    }
 
-    double numberTrainingRows{allTrainingRowsMask.manhattan()};
-    std::size_t desiredCount{
-        (static_cast<std::size_t>(numberTrainingRows) + numberFolds / 2) / numberFolds};
+    bool isClassification{frame.columnIsCategorical()[targetColumn]};
 
-    if (frame.columnIsCategorical()[targetColumn]) {
-        std::tie(sampler, frequencies) = classifierStratifiedCrossValidationRowSampler(
-            numberThreads, frame, targetColumn, rng, desiredCount, allTrainingRowsMask);
-    } else {
-        sampler = regressionStratifiedCrossValiationRowSampler(
-            numberThreads, frame, targetColumn, rng, desiredCount,
-            numberBuckets, allTrainingRowsMask);
+    CStratifiedFoldAssigner assigner{
+        isClassification ? classifierStratumSelector(targetColumn)
+                         : regressionStratumSelector(numberThreads, frame, targetColumn,
+                                                     numberBuckets, allTrainingRowsMask)};
+    if (assigner.countStrata(numberThreads, frame, allTrainingRowsMask) == false) {
+        HANDLE_FATAL(<< "Internal error: failed to count cross-validation strata."
+                     << " Please report this problem.");
     }
 
-    LOG_TRACE(<< "number training rows = " << allTrainingRowsMask.manhattan());
-
-    TPackedBitVectorVec testingRowMasks(numberFolds);
+    double numberTrainingRows{allTrainingRowsMask.manhattan()};
+    std::size_t desiredCount{
+        (static_cast<std::size_t>(numberTrainingRows) + numberFolds / 2) / numberFolds};
+    LOG_TRACE(<< "number training rows = " << numberTrainingRows);
 
-    TSizeVec rowIndices;
-    core::CPackedBitVector candidateTestingRowsMask{allTrainingRowsMask};
-    for (std::size_t fold = 0; fold < numberFolds - 1; ++fold) {
-        frame.readRows(1, 0, frame.numberRows(),
-                       [&](TRowItr beginRows, TRowItr endRows) {
-                           for (auto row = beginRows; row != endRows; ++row) {
-                               sampler->sample(*row);
-                           }
-                       },
-                       &candidateTestingRowsMask);
-        sampler->finishSampling(rng, rowIndices);
-        std::sort(rowIndices.begin(), rowIndices.end());
-        LOG_TRACE(<< "# row indices = " << rowIndices.size());
-
-        for (auto row : rowIndices) {
-            testingRowMasks[fold].extend(false, row - testingRowMasks[fold].size());
-            testingRowMasks[fold].extend(true);
+    TDoubleVec frequencies;
+    if (isClassification) {
+        const auto& classCounts = assigner.strataCounts();
+        frequencies.reserve(classCounts.size());
+        for (auto count : classCounts) {
+            frequencies.push_back(static_cast<double>(count) / numberTrainingRows);
         }
-        testingRowMasks[fold].extend(false, allTrainingRowsMask.size() -
-                                                testingRowMasks[fold].size());
-
-        // We exclusive or here to remove the rows we've selected for the current
-        //test fold. This is equivalent to samplng without replacement
-        candidateTestingRowsMask ^= testingRowMasks[fold];
     }
 
-    // Everything which is left.
-    testingRowMasks.back() = std::move(candidateTestingRowsMask);
-    LOG_TRACE(<< "# remaining rows = " << testingRowMasks.back().manhattan());
+    TPackedBitVectorVec testingRowMasks;
+    bool successful;
+    std::tie(testingRowMasks, successful) = assigner.assign(
+        numberThreads, frame, allTrainingRowsMask,
+        stratifiedFoldCounts(assigner.strataCounts(), numberFolds, desiredCount), rng());
+    if (successful == false) {
+        HANDLE_FATAL(<< "Internal error: failed to assign cross-validation folds."
+                     << " Please report this problem.");
+    }
 
     TPackedBitVectorVec trainingRowMasks{complementRowMasks(testingRowMasks, allTrainingRowsMask)};
 
@@ -805,7 +999,8 @@ CDataFrameUtils::TSizeDoublePrVecVecVec CDataFrameUtils::categoricalMicWithColum
                 encoders.emplace(hash, std::move(encoder));
             }
 
-            auto target_ = [](const TFloatVec& sample) { return sample[1]; };
+            // The sampled target values are in the second column.
+            CMetricColumnValue target_{1};
             mics[i] = computeEncodedCategory(mic, target_, encoders, samples);
         }
 
@@ -983,12 +1178,15 @@ CDataFrameUtils::metricMicWithColumnDataFrameOnDisk(const CColumnValue& target,
 
     // Compute MICe
 
+    TDoubleVec targets;
+    target(samples, targets);
+
     for (auto i : columnMask) {
         CMic mic;
         mic.reserve(samples.size());
-        for (const auto& sample : samples) {
-            if (isMissing(sample[i]) == false) {
-                mic.add(sample[i], target(sample));
+        for (std::size_t j = 0; j < samples.size(); ++j) {
+            if (isMissing(samples[j][i]) == false) {
+                mic.add(samples[j][i], targets[j]);
             }
         }
         mics[i] = (1.0 - fractionMissing[i]) * mic.compute();
@@ -1076,27 +1274,22 @@ CDataFrameUtils::maximizeMinimumRecallForMulticlass(std::size_t numberThreads,
 
     // No need to sample if were going to use every row we've been given.
     if (numberSamples < static_cast<std::size_t>(rowMask.manhattan())) {
-        TStratifiedSamplerPtr sampler;
-        std::tie(sampler, std::ignore) = classifierStratifiedCrossValidationRowSampler(
-            numberThreads, frame, targetColumn, rng, numberSamples, rowMask);
-
-        TSizeVec rowIndices;
-        frame.readRows(1, 0, frame.numberRows(),
-                       [&](TRowItr beginRows, TRowItr endRows) {
-                           for (auto row = beginRows; row != endRows; ++row) {
-                               sampler->sample(*row);
-                           }
-                       },
-                       &rowMask);
-        sampler->finishSampling(rng, rowIndices);
-        std::sort(rowIndices.begin(), rowIndices.end());
-        LOG_TRACE(<< "# row indices = " << rowIndices.size());
-
-        for (auto row : rowIndices) {
-            sampleMask.extend(false, row - sampleMask.size());
-            sampleMask.extend(true);
+        CStratifiedFoldAssigner assigner{classifierStratumSelector(targetColumn)};
+        bool successful{assigner.countStrata(numberThreads, frame, rowMask)};
+        if (successful) {
+            // We assign the sample to the first fold and the rest to the second.
+            TSizeVecVec foldCounts{stratifiedFoldCounts(assigner.strataCounts(), 2, numberSamples)};
+            // Seed from a copy so sampling doesn't perturb the restarts below.
+            TPackedBitVectorVec foldRowMasks;
+            std::tie(foldRowMasks, successful) = assigner.assign(
+                numberThreads, frame, rowMask, foldCounts, CPRNG::CXorOShiro128Plus{rng}());
+            sampleMask = std::move(foldRowMasks[0]);
+        }
+        if (successful == false) {
+            HANDLE_FATAL(<< "Internal error: failed to sample rows. Please report this problem.");
+            return TDoubleVector::Ones(numberClasses);
         }
-        sampleMask.extend(false, rowMask.size() - sampleMask.size());
+        LOG_TRACE(<< "# samples = " << sampleMask.manhattan());
     } else {
         sampleMask = rowMask;
     }
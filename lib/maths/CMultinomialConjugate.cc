@@ -1375,110 +1375,9 @@ void CMultinomialConjugate::probabilitiesOfLessLikelyCategories(maths_t::EProbab
     } break;
 
     case maths_t::E_TwoSided: {
-        TDoubleDoubleSizeTrVec pCategories;
-        pCategories.reserve(m_Categories.size());
-        double pU = 0.0;
-
-        {
-            double r = 1.0 / static_cast<double>(m_Concentrations.size());
-            for (std::size_t i = 0; i < m_Concentrations.size(); ++i) {
-                double p = m_Concentrations[i] / m_TotalConcentration;
-                pCategories.emplace_back(p, p, i);
-                pU += r - p;
-            }
-        }
-        std::sort(pCategories.begin(), pCategories.end());
-        LOG_TRACE(<< "pCategories = " << core::CContainerPrinter::print(pCategories));
-
-        // Get the index of largest probability less than or equal to P(U).
-        double pl = 0.0;
-        {
-            std::size_t l = pCategories.size();
-            if (pU > 0.0) {
-                l = std::lower_bound(pCategories.begin(), pCategories.end(),
-                                     TDoubleDoubleSizeTr(pU, pU, 0)) -
-                    pCategories.begin();
-            }
-
-            // Compute probabilities of less likely categories.
-            double pCumulative = 0.0;
-            for (std::size_t i = 0u, j = 0; i < pCategories.size(); /**/) {
-                // Find the probability equal range [i, j).
-                double p = pCategories[i].get<1>();
-                pCumulative += p;
-                while (++j < pCategories.size() && pCategories[j].get<1>() == p) {
-                    pCumulative += p;
-                }
-
-                // Update the equal range probabilities [i, j).
-                for (/**/; i < j; ++i) {
-                    pCategories[i].get<1>() = pCumulative;
-                }
-            }
-
-            if (l < pCategories.size()) {
-                pl = pCategories[l].get<1>();
-            }
-        }
-
-        LOG_TRACE(<< "pCategories = " << core::CContainerPrinter::print(pCategories));
-        LOG_TRACE(<< "P(U) = " << pU << ", P(l) = " << pl);
-
-        lowerBounds.resize(pCategories.size(), 0.0);
-        upperBounds.resize(pCategories.size(), 0.0);
-
-        double p = 0.0;
-        double pLast = -1.0;
-        std::size_t n = detail::numberPriorSamples(m_TotalConcentration);
-        LOG_TRACE(<< "n = " << n);
-        for (std::size_t i = 0; i < pCategories.size(); ++i) {
-            std::size_t j = pCategories[i].get<2>();
-
-            // We compute the average probability over a set of
-            // independent samples from the marginal prior for this
-            // category, which by the law of large numbers converges
-            // to E[ P(p) ] w.r.t. to marginal for p. The constants
-            // a and b are a(i) and Sum_j( a(j) ) - a(i), respectively.
-            // See confidenceIntervalProbabilities for a discussion.
-
-            if (pCategories[i].get<0>() != pLast) {
-                TDouble7Vec samples;
-                double a = m_Concentrations[j];
-                double b = m_TotalConcentration - m_Concentrations[j];
-                detail::generateBetaSamples(a, b, n, samples);
-                LOG_TRACE(<< "E[p] = " << pCategories[i].get<0>()
-                          << ", mean = " << CBasicStatistics::mean(samples)
-                          << ", samples = " << core::CContainerPrinter::print(samples));
-
-                TMeanAccumulator pAcc;
-                for (std::size_t k = 0; k < samples.size(); ++k) {
-                    TDoubleDoubleSizeTr x(1.05 * samples[k], 0.0, 0);
-                    ptrdiff_t r = std::min(
-                        std::upper_bound(pCategories.begin(), pCategories.end(), x) -
-                            pCategories.begin(),
-                        static_cast<ptrdiff_t>(pCategories.size()) - 1);
-
-                    double fl = r > 0 ? pCategories[r - 1].get<0>() : 0.0;
-                    double fr = pCategories[r].get<0>();
-                    double pl_ = r > 0 ? pCategories[r - 1].get<1>() : 0.0;
-                    double pr_ = pCategories[r].get<1>();
-                    double alpha = std::min(
-                        (fr - fl == 0.0) ? 0.0 : (x.get<0>() - fl) / (fr - fl), 1.0);
-                    double px = (1.0 - alpha) * pl_ + alpha * pr_;
-                    LOG_TRACE(<< "E[p(l)] = " << fl << ", P(l) = " << pl_
-                              << ", E[p(r)] = " << fr << ", P(r) = " << pr_
-                              << ", alpha = " << alpha << ", p = " << px);
-
-                    pAcc.add(px);
-                }
-                p = CBasicStatistics::mean(pAcc);
-                pLast = pCategories[i].get<0>();
-            }
-
-            LOG_TRACE(<< "p = " << p);
-            lowerBounds[j] = p + (p >= pU ? pU : 0.0);
-            upperBounds[j] = p + pU;
-        }
+        CLessLikelyCategoriesCalculator calculator;
+        calculator.update(*this);
+        calculator.all(lowerBounds, upperBounds);
     } break;
 
     case maths_t::E_OneSidedAbove: {
@@ -1569,6 +1468,187 @@ void CMultinomialConjugate::shrink() {
     }
 }
 
+const double CMultinomialConjugate::CLessLikelyCategoriesCalculator::MAXIMUM_FRACTION_TO_REPAIR{0.25};
+
+void CMultinomialConjugate::CLessLikelyCategoriesCalculator::update(const CMultinomialConjugate& prior) {
+    // See probabilityOfLessLikelySamples for an explanation of these
+    // calculations.
+
+    bool categoriesChanged{prior.m_Categories != m_Categories};
+    if (categoriesChanged) {
+        m_Categories = prior.m_Categories;
+    }
+    m_Concentrations = prior.m_Concentrations;
+    m_TotalConcentration = prior.m_TotalConcentration;
+    m_NumberSamples = detail::numberPriorSamples(m_TotalConcentration);
+
+    std::size_t n{m_Concentrations.size()};
+    m_Pu = 0.0;
+    double r{1.0 / static_cast<double>(n)};
+    for (std::size_t i = 0; i < n; ++i) {
+        m_Pu += r - m_Concentrations[i] / m_TotalConcentration;
+    }
+
+    if (categoriesChanged || m_Ranked.size() != n) {
+        // The category indices have changed so the old order is no use.
+        this->sort();
+    } else {
+        for (auto& category : m_Ranked) {
+            double p{m_Concentrations[category.s_Index] / m_TotalConcentration};
+            category.s_P = p;
+            category.s_Cumulative = p;
+        }
+        this->repairOrder();
+    }
+
+    // Compute probabilities of less likely categories.
+    double pCumulative{0.0};
+    for (std::size_t i = 0, j = 0; i < n; /**/) {
+        // Find the probability equal range [i, j).
+        double p{m_Ranked[i].s_P};
+        pCumulative += p;
+        while (++j < n && m_Ranked[j].s_P == p) {
+            pCumulative += p;
+        }
+
+        // Update the equal range probabilities [i, j).
+        for (/**/; i < j; ++i) {
+            m_Ranked[i].s_Cumulative = pCumulative;
+        }
+    }
+
+    LOG_TRACE(<< "P(U) = " << m_Pu << ", # categories = " << n);
+}
+
+std::size_t CMultinomialConjugate::CLessLikelyCategoriesCalculator::numberCategories() const {
+    return m_Ranked.size();
+}
+
+void CMultinomialConjugate::CLessLikelyCategoriesCalculator::
+operator()(std::size_t index, double& lowerBound, double& upperBound) const {
+    double p{this->probability(index)};
+    lowerBound = p + (p >= m_Pu ? m_Pu : 0.0);
+    upperBound = p + m_Pu;
+}
+
+void CMultinomialConjugate::CLessLikelyCategoriesCalculator::all(TDoubleVec& lowerBounds,
+                                                                 TDoubleVec& upperBounds) const {
+    lowerBounds.assign(m_Ranked.size(), 0.0);
+    upperBounds.assign(m_Ranked.size(), 0.0);
+
+    // Categories with equal probability have equal concentrations and so
+    // the same marginal prior. These are adjacent in rank order.
+    double p{0.0};
+    double pLast{-1.0};
+    for (const auto& category : m_Ranked) {
+        if (category.s_P != pLast) {
+            p = this->probability(category.s_Index);
+            pLast = category.s_P;
+        }
+        LOG_TRACE(<< "p = " << p);
+        lowerBounds[category.s_Index] = p + (p >= m_Pu ? m_Pu : 0.0);
+        upperBounds[category.s_Index] = p + m_Pu;
+    }
+}
+
+void CMultinomialConjugate::CLessLikelyCategoriesCalculator::debugMemoryUsage(
+    const core::CMemoryUsage::TMemoryUsagePtr& mem) const {
+    mem->setName("CMultinomialConjugate::CLessLikelyCategoriesCalculator");
+    core::CMemoryDebug::dynamicSize("m_Categories", m_Categories, mem);
+    core::CMemoryDebug::dynamicSize("m_Concentrations", m_Concentrations, mem);
+    core::CMemoryDebug::dynamicSize("m_Ranked", m_Ranked, mem);
+}
+
+std::size_t CMultinomialConjugate::CLessLikelyCategoriesCalculator::memoryUsage() const {
+    std::size_t mem{core::CMemory::dynamicSize(m_Categories)};
+    mem += core::CMemory::dynamicSize(m_Concentrations);
+    mem += core::CMemory::dynamicSize(m_Ranked);
+    return mem;
+}
+
+void CMultinomialConjugate::CLessLikelyCategoriesCalculator::sort() {
+    std::size_t n{m_Concentrations.size()};
+    m_Ranked.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        double p{m_Concentrations[i] / m_TotalConcentration};
+        m_Ranked[i] = SCategory{p, p, i};
+    }
+    std::sort(m_Ranked.begin(), m_Ranked.end());
+    LOG_TRACE(<< "sorted " << n << " categories");
+}
+
+void CMultinomialConjugate::CLessLikelyCategoriesCalculator::repairOrder() {
+    // The ranked categories are in their previous order. Greedily keep a
+    // sorted subsequence: each time a category is smaller than the last one
+    // kept we displace both. Every out of place category displaces at most
+    // one other so if only k categories moved at most 2k are displaced. We
+    // then sort the displaced categories and merge them back in. Ties are
+    // broken by index so the result is identical to sorting.
+
+    std::size_t n{m_Ranked.size()};
+    TCategoryVec displaced;
+    std::size_t kept{0};
+    for (std::size_t i = 0; i < n; ++i) {
+        SCategory category{m_Ranked[i]};
+        if (kept > 0 && category < m_Ranked[kept - 1]) {
+            displaced.push_back(m_Ranked[--kept]);
+            displaced.push_back(category);
+            if (static_cast<double>(displaced.size()) >
+                MAXIMUM_FRACTION_TO_REPAIR * static_cast<double>(n)) {
+                break;
+            }
+        } else {
+            m_Ranked[kept++] = category;
+        }
+    }
+
+    if (static_cast<double>(displaced.size()) > MAXIMUM_FRACTION_TO_REPAIR * static_cast<double>(n)) {
+        this->sort();
+    } else if (displaced.size() > 0) {
+        std::sort(displaced.begin(), displaced.end());
+        m_Ranked.resize(kept);
+        m_Ranked.insert(m_Ranked.end(), displaced.begin(), displaced.end());
+        std::inplace_merge(m_Ranked.begin(), m_Ranked.begin() + kept, m_Ranked.end());
+        LOG_TRACE(<< "repaired order of " << displaced.size() << "/" << n << " categories");
+    }
+}
+
+double CMultinomialConjugate::CLessLikelyCategoriesCalculator::probability(std::size_t index) const {
+    // We compute the average probability over a set of independent samples
+    // from the marginal prior for this category, which by the law of large
+    // numbers converges to E[ P(p) ] w.r.t. to marginal for p. The constants
+    // a and b are a(i) and Sum_j( a(j) ) - a(i), respectively. See
+    // confidenceIntervalProbabilities for a discussion.
+
+    TDouble7Vec samples;
+    double a{m_Concentrations[index]};
+    double b{m_TotalConcentration - m_Concentrations[index]};
+    detail::generateBetaSamples(a, b, m_NumberSamples, samples);
+    LOG_TRACE(<< "E[p] = " << a / m_TotalConcentration
+              << ", mean = " << CBasicStatistics::mean(samples)
+              << ", samples = " << core::CContainerPrinter::print(samples));
+
+    TMeanAccumulator pAcc;
+    for (std::size_t k = 0; k < samples.size(); ++k) {
+        SCategory x{1.05 * samples[k], 0.0, 0};
+        ptrdiff_t r{std::min(std::upper_bound(m_Ranked.begin(), m_Ranked.end(), x) -
+                                 m_Ranked.begin(),
+                             static_cast<ptrdiff_t>(m_Ranked.size()) - 1)};
+
+        double fl{r > 0 ? m_Ranked[r - 1].s_P : 0.0};
+        double fr{m_Ranked[r].s_P};
+        double pl_{r > 0 ? m_Ranked[r - 1].s_Cumulative : 0.0};
+        double pr_{m_Ranked[r].s_Cumulative};
+        double alpha{std::min((fr - fl == 0.0) ? 0.0 : (x.s_P - fl) / (fr - fl), 1.0)};
+        double px{(1.0 - alpha) * pl_ + alpha * pr_};
+        LOG_TRACE(<< "E[p(l)] = " << fl << ", P(l) = " << pl_ << ", E[p(r)] = " << fr
+                  << ", P(r) = " << pr_ << ", alpha = " << alpha << ", p = " << px);
+
+        pAcc.add(px);
+    }
+    return CBasicStatistics::mean(pAcc);
+}
+
 const double CMultinomialConjugate::NON_INFORMATIVE_CONCENTRATION = 0.0;
 }
 }
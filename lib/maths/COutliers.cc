@@ -21,6 +21,7 @@
 
 #include <boost/math/distributions/lognormal.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <numeric>
 #include <sstream>
@@ -185,10 +186,22 @@ public:
     //! Compute the outlier scores for \p points.
     TScorerVec computeOutlierScores(const std::vector<POINT>& points) const;
 
+    //! Compute the outlier scores for \p points and the feature influence
+    //! for only those points whose scores are at least the \p quantile of
+    //! all their scores.
+    //!
+    //! \note The scores are first computed without feature influence. The
+    //! influences are then computed in a second pass over the selected points
+    //! which reuses each model's nearest neighbour lookup.
+    TScorerVec computeOutlierScores(const std::vector<POINT>& points,
+                                    double pOutlier,
+                                    double quantile);
+
     //! Estimate the amount of memory that will be used by the ensemble.
     static std::size_t estimateMemoryUsage(TMethodSize methodSize,
                                            std::size_t numberMethodsPerModel,
                                            bool computeFeatureInfluence,
+                                           double featureInfluenceQuantile,
                                            std::size_t totalNumberPoints,
                                            std::size_t partitionNumberPoints,
                                            std::size_t dimension);
@@ -211,6 +224,14 @@ private:
 
         void proportionOfRuntimePerMethod(double proportion);
 
+        void computeFeatureInfluence(bool computeFeatureInfluence) {
+            m_Method->computeFeatureInfluence(computeFeatureInfluence);
+        }
+
+        TProgressCallback& progressRecorder() {
+            return m_Method->progressRecorder();
+        }
+
         void addOutlierScores(const std::vector<POINT>& points,
                               TScorerVec& scores,
                               const TMemoryUsageCallback& recordMemoryUsage) const;
@@ -392,10 +413,74 @@ CEnsemble<POINT>::computeOutlierScores(const std::vector<POINT>& points) const {
     return scores;
 }
 
+template<typename POINT>
+typename CEnsemble<POINT>::TScorerVec
+CEnsemble<POINT>::computeOutlierScores(const std::vector<POINT>& points,
+                                       double pOutlier,
+                                       double quantile) {
+
+    for (auto& model : m_Models) {
+        model.computeFeatureInfluence(false);
+    }
+    TScorerVec scores(this->computeOutlierScores(points));
+    for (auto& model : m_Models) {
+        model.computeFeatureInfluence(true);
+    }
+    if (scores.empty()) {
+        return scores;
+    }
+
+    TDoubleVec outlierScores(scores.size());
+    for (std::size_t i = 0; i < scores.size(); ++i) {
+        outlierScores[i] = scores[i].compute(pOutlier)[0];
+    }
+    TDoubleVec sortedOutlierScores(outlierScores);
+    std::size_t nth{std::min(static_cast<std::size_t>(
+                                 quantile * static_cast<double>(scores.size())),
+                             scores.size() - 1)};
+    std::nth_element(sortedOutlierScores.begin(), sortedOutlierScores.begin() + nth,
+                     sortedOutlierScores.end());
+    double threshold{sortedOutlierScores[nth]};
+
+    TSizeVec selected;
+    std::vector<POINT> selectedPoints;
+    for (std::size_t i = 0; i < scores.size(); ++i) {
+        if (outlierScores[i] >= threshold) {
+            selected.push_back(i);
+            selectedPoints.push_back(points[i]);
+        }
+    }
+    LOG_TRACE(<< "Computing feature influence for " << selected.size() << "/"
+              << points.size() << " points with scores >= " << threshold);
+
+    std::int64_t selectedPointsMemory{signedMemoryUsage(selectedPoints)};
+    m_RecordMemoryUsage(selectedPointsMemory);
+
+    // The progress of the first pass accounts for the whole computation so
+    // we don't record any progress for the second pass.
+    std::vector<TProgressCallback> recordProgress(m_Models.size(), [](double) {});
+    for (std::size_t i = 0; i < m_Models.size(); ++i) {
+        m_Models[i].progressRecorder().swap(recordProgress[i]);
+    }
+    TScorerVec selectedScores(this->computeOutlierScores(selectedPoints));
+    for (std::size_t i = 0; i < m_Models.size(); ++i) {
+        m_Models[i].progressRecorder().swap(recordProgress[i]);
+    }
+
+    std::int64_t scoresMemory{signedMemoryUsage(scores) + signedMemoryUsage(selectedScores)};
+    for (std::size_t i = 0; i < selected.size(); ++i) {
+        scores[selected[i]] = std::move(selectedScores[i]);
+    }
+    m_RecordMemoryUsage(signedMemoryUsage(scores) - scoresMemory - selectedPointsMemory);
+
+    return scores;
+}
+
 template<typename POINT>
 std::size_t CEnsemble<POINT>::estimateMemoryUsage(TMethodSize methodSize,
                                                   std::size_t numberMethodsPerModel,
                                                   bool computeFeatureInfluence,
+                                                  double featureInfluenceQuantile,
                                                   std::size_t totalNumberPoints,
                                                   std::size_t partitionNumberPoints,
                                                   std::size_t dimension) {
@@ -408,16 +493,26 @@ std::size_t CEnsemble<POINT>::estimateMemoryUsage(TMethodSize methodSize,
 
     std::size_t pointsMemory{partitionNumberPoints *
                              (sizeof(TPoint) + las::estimateMemoryUsage<TPoint>(dimension))};
+    // If we only compute feature influence for the points whose scores exceed
+    // a quantile then only that fraction of the points need the extra state.
+    std::size_t influencePoints{
+        computeFeatureInfluence == false
+            ? 0
+            : (featureInfluenceQuantile > 0.0
+                   ? static_cast<std::size_t>(
+                         std::ceil((1.0 - featureInfluenceQuantile) *
+                                   static_cast<double>(partitionNumberPoints)))
+                   : partitionNumberPoints)};
+
     std::size_t scorersMemory{
-        partitionNumberPoints *
-        CScorer::estimateMemoryUsage(computeFeatureInfluence ? dimension : 0)};
+        (partitionNumberPoints - influencePoints) * CScorer::estimateMemoryUsage(0) +
+        influencePoints * CScorer::estimateMemoryUsage(dimension)};
     std::size_t modelMemory{CModel::estimateMemoryUsage(
         methodSize, sampleSize, maxNumberNeighbours, projectionDimension, dimension)};
     // The scores for a single method plus bookkeeping overhead for a single partition.
     std::size_t partitionScoringMemory{
-        numberMethodsPerModel * partitionNumberPoints *
-            (sizeof(TDouble1Vec) +
-             (computeFeatureInfluence ? projectionDimension * sizeof(double) : 0)) +
+        numberMethodsPerModel * (partitionNumberPoints * sizeof(TDouble1Vec) +
+                                 influencePoints * projectionDimension * sizeof(double)) +
         methodSize(maxNumberNeighbours, partitionNumberPoints, projectionDimension)};
 
     return pointsMemory + scorersMemory + numberModels * modelMemory + partitionScoringMemory;
@@ -536,12 +631,13 @@ typename CEnsemble<POINT>::CModelBuilder::TSampler
 CEnsemble<POINT>::CModelBuilder::makeSampler(CPRNG::CXorOShiro128Plus& rng,
                                              std::size_t sampleSize) {
     auto onSample = [this](std::size_t index, const TRowRef& row) {
+        // We project a view of the row's memory and overwrite replaced samples
+        // in place so sampling only allocates when the sample set grows.
+        auto point = CDataFrameUtils::rowTo<TMemoryMappedFloatVector>(row);
         if (index >= m_SampledProjectedPoints.size()) {
-            m_SampledProjectedPoints.emplace_back(
-                m_Projection * CDataFrameUtils::rowTo<POINT>(row));
+            m_SampledProjectedPoints.emplace_back(m_Projection * point);
         } else {
-            m_SampledProjectedPoints[index] = m_Projection *
-                                              CDataFrameUtils::rowTo<POINT>(row);
+            m_SampledProjectedPoints[index].noalias() = m_Projection * point;
         }
     };
     return {sampleSize, onSample, rng};
@@ -878,6 +974,34 @@ CEnsemble<POINT> buildEnsemble(const COutliers::SComputeParameters& params,
         std::move(builders), std::move(recordMemoryUsage), std::move(recordStep)};
 }
 
+template<typename POINT>
+typename CEnsemble<POINT>::TScorerVec
+computeOutlierScores(const COutliers::SComputeParameters& params,
+                     CEnsemble<POINT>& ensemble,
+                     const std::vector<POINT>& points) {
+    return params.s_ComputeFeatureInfluence && params.s_FeatureInfluenceQuantile > 0.0
+               ? ensemble.computeOutlierScores(points, params.s_OutlierFraction,
+                                               params.s_FeatureInfluenceQuantile)
+               : ensemble.computeOutlierScores(points);
+}
+
+template<typename SCORER>
+void writeScores(const COutliers::SComputeParameters& params,
+                 const SCORER& scorer,
+                 std::size_t dimension,
+                 const core::CDataFrame::TRowRef& row) {
+    // Points for which we didn't compute the feature influence have zero
+    // influence.
+    std::size_t index{dimension};
+    for (auto value : scorer.compute(params.s_OutlierFraction)) {
+        row.writeColumn(index++, value);
+    }
+    for (std::size_t end = (params.s_ComputeFeatureInfluence ? 2 : 1) * dimension + 1;
+         index < end; ++index) {
+        row.writeColumn(index, 0.0);
+    }
+}
+
 bool computeOutliersNoPartitions(const COutliers::SComputeParameters& params,
                                  core::CDataFrame& frame,
                                  CDataFrameAnalysisInstrumentationInterface& instrumentation) {
@@ -922,7 +1046,7 @@ bool computeOutliersNoPartitions(const COutliers::SComputeParameters& params,
         }
 
         watch.reset(true);
-        scores = ensemble.computeOutlierScores(points);
+        scores = computeOutlierScores(params, ensemble, points);
         core::CProgramCounters::counter(counter_t::E_DFOTimeToComputeScores) =
             watch.stop();
 
@@ -939,12 +1063,9 @@ bool computeOutliersNoPartitions(const COutliers::SComputeParameters& params,
 
     std::size_t dimension{frame.numberColumns()};
 
-    auto writeScores = [&](TRowItr beginRows, TRowItr endRows) {
+    auto writeScores_ = [&](TRowItr beginRows, TRowItr endRows) {
         for (auto row = beginRows; row != endRows; ++row) {
-            std::size_t index{dimension};
-            for (auto value : scores[row->index()].compute(params.s_OutlierFraction)) {
-                row->writeColumn(index++, value);
-            }
+            writeScores(params, scores[row->index()], dimension, *row);
         }
     };
 
@@ -954,7 +1075,7 @@ bool computeOutliersNoPartitions(const COutliers::SComputeParameters& params,
     instrumentation.updateMemoryUsage(signedMemoryUsage(frame) - frameMemory);
 
     bool successful;
-    std::tie(std::ignore, successful) = frame.writeColumns(params.s_NumberThreads, writeScores);
+    std::tie(std::ignore, successful) = frame.writeColumns(params.s_NumberThreads, writeScores_);
     if (successful == false) {
         LOG_ERROR(<< "Failed to write scores to the data frame");
         return false;
@@ -1024,22 +1145,19 @@ bool computeOutliersPartitioned(const COutliers::SComputeParameters& params,
         }
 
         watch.reset(true);
-        auto scores = ensemble.computeOutlierScores(points);
+        auto scores = computeOutlierScores(params, ensemble, points);
         core::CProgramCounters::counter(counter_t::E_DFOTimeToComputeScores) +=
             watch.stop();
 
-        auto writeScores = [&](TRowItr beginRows, TRowItr endRows) {
+        auto writeScores_ = [&](TRowItr beginRows, TRowItr endRows) {
             for (auto row = beginRows; row != endRows; ++row) {
                 std::size_t offset{row->index() - beginPartitionRows};
-                std::size_t index{dimension};
-                for (auto value : scores[offset].compute(params.s_OutlierFraction)) {
-                    row->writeColumn(index++, value);
-                }
+                writeScores(params, scores[offset], dimension, *row);
             }
         };
 
         std::tie(std::ignore, successful) = frame.writeColumns(
-            params.s_NumberThreads, beginPartitionRows, endPartitionRows, writeScores);
+            params.s_NumberThreads, beginPartitionRows, endPartitionRows, writeScores_);
         if (successful == false) {
             LOG_ERROR(<< "Failed to write scores to the data frame");
             return false;
@@ -1104,22 +1222,27 @@ std::size_t COutliers::estimateMemoryUsedByCompute(const SComputeParameters& par
 
         k = params.s_NumberNeighbours > 0 ? params.s_NumberNeighbours : k;
 
+        // The first pass over all points doesn't compute feature influence
+        // if it is only computed for points whose score exceeds a quantile.
+        bool computeFeatureInfluence{params.s_ComputeFeatureInfluence &&
+                                     params.s_FeatureInfluenceQuantile <= 0.0};
+
         if (params.s_Method == E_Ensemble) {
             // On average half of models use CLof.
-            return TLof::estimateOwnMemoryOverhead(params.s_ComputeFeatureInfluence,
-                                                   k, numberPoints, projectionDimension) /
+            return TLof::estimateOwnMemoryOverhead(computeFeatureInfluence, k,
+                                                   numberPoints, projectionDimension) /
                    2;
         }
         if (params.s_Method == E_Lof) {
-            return TLof::estimateOwnMemoryOverhead(params.s_ComputeFeatureInfluence,
-                                                   k, numberPoints, projectionDimension);
+            return TLof::estimateOwnMemoryOverhead(computeFeatureInfluence, k,
+                                                   numberPoints, projectionDimension);
         }
         return std::size_t{0};
     };
     return CEnsemble<POINT>::estimateMemoryUsage(
         methodSize, params.s_Method == E_Ensemble ? 2 : 1 /*number methods*/,
-        params.s_ComputeFeatureInfluence, totalNumberPoints,
-        partitionNumberPoints, dimension);
+        params.s_ComputeFeatureInfluence, params.s_FeatureInfluenceQuantile,
+        totalNumberPoints, partitionNumberPoints, dimension);
 }
 
 void COutliers::noopRecordProgress(double) {
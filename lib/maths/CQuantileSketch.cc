@@ -18,8 +18,12 @@
 #include <boost/operators.hpp>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstring>
+#include <iterator>
 #include <limits>
+#include <numeric>
 #include <random>
 
 namespace ml {
@@ -95,6 +99,55 @@ std::ptrdiff_t nextDifferent(TFloatFloatPrVec& knots, std::size_t index) {
     return next.index();
 }
 
+//! Get a key whose order, as an unsigned integer, matches the order of \p x.
+std::uint32_t radixKey(CFloatStorage x) {
+    float x_{static_cast<float>(static_cast<double>(x))};
+    std::uint32_t bits;
+    std::memcpy(&bits, &x_, sizeof(bits));
+    // Flip all the bits of negative values and the sign bit of positive ones.
+    return (bits & 0x80000000) != 0 ? ~bits : bits | 0x80000000;
+}
+
+//! Sort \p values by their first element.
+//!
+//! This uses a least significant digit radix sort on the float bits for
+//! large collections, skipping any digit which is the same for all values.
+void radixSort(TFloatFloatPrVec& values, TFloatFloatPrVec& workspace) {
+
+    std::size_t n{values.size()};
+    if (n < 256) {
+        std::sort(values.begin(), values.end(), COrderings::SFirstLess{});
+        return;
+    }
+
+    using TSizeArray = std::array<std::size_t, 256>;
+    std::array<TSizeArray, 4> counts{};
+    for (const auto& value : values) {
+        std::uint32_t key{radixKey(value.first)};
+        for (std::size_t digit = 0; digit < 4; ++digit) {
+            ++counts[digit][(key >> (8 * digit)) & 0xff];
+        }
+    }
+
+    workspace.resize(n);
+    for (std::size_t digit = 0; digit < 4; ++digit) {
+        TSizeArray& offsets{counts[digit]};
+        if (std::find(offsets.begin(), offsets.end(), n) != offsets.end()) {
+            continue;
+        }
+        std::size_t offset{0};
+        for (auto& count : offsets) {
+            std::size_t next{offset + count};
+            count = offset;
+            offset = next;
+        }
+        for (const auto& value : values) {
+            workspace[offsets[(radixKey(value.first) >> (8 * digit)) & 0xff]++] = value;
+        }
+        values.swap(workspace);
+    }
+}
+
 const double EPS = static_cast<double>(std::numeric_limits<float>::epsilon());
 const std::size_t MINIMUM_MAX_SIZE = 3;
 const core::TPersistenceTag UNSORTED_TAG("a", "unsorted");
@@ -148,6 +201,61 @@ void CQuantileSketch::add(double x, double n) {
     }
 }
 
+void CQuantileSketch::add(TFloatFloatPrVec& values) {
+    if (values.empty()) {
+        return;
+    }
+
+    if (m_Unsorted > 0) {
+        this->orderAndDeduplicate();
+    }
+
+    TFloatFloatPrVec knots;
+    radixSort(values, knots);
+    for (const auto& value : values) {
+        m_Count += value.second;
+    }
+
+    // Reducing many more knots than the maximum size at once is slow because
+    // the merged knots are only deduplicated at the end. It is also less
+    // accurate than adding the values one at a time, which reduces each time
+    // the sketch grows by the difference between its maximum and target size.
+    // Instead we merge the batch in strided subsets, which are sorted and span
+    // its full range, of this size.
+    std::size_t target{this->target()};
+    std::size_t subsetSize{m_MaxSize > target ? m_MaxSize - target : 1};
+    std::size_t stride{(values.size() + subsetSize - 1) / subsetSize};
+    TFloatFloatPrVec subset;
+    subset.reserve(values.size() / stride + 1);
+    knots.reserve(m_Knots.size() + subset.capacity());
+    for (std::size_t i = 0; i < stride; ++i) {
+        subset.clear();
+        for (std::size_t j = i; j < values.size(); j += stride) {
+            subset.push_back(values[j]);
+        }
+        knots.clear();
+        std::merge(m_Knots.begin(), m_Knots.end(), subset.begin(), subset.end(),
+                   std::back_inserter(knots), COrderings::SFirstLess{});
+        m_Knots.swap(knots);
+        LOG_TRACE(<< "knots = " << core::CContainerPrinter::print(m_Knots));
+
+        this->orderAndDeduplicate();
+        if (m_Knots.size() > m_MaxSize) {
+            this->reduce();
+        }
+    }
+
+    // Don't hold on to memory for the batch.
+    if (m_Knots.capacity() > m_MaxSize + 1) {
+        TFloatFloatPrVec shrunk;
+        shrunk.reserve(m_MaxSize + 1);
+        shrunk.assign(m_Knots.begin(), m_Knots.end());
+        m_Knots.swap(shrunk);
+    }
+
+    values.clear();
+}
+
 void CQuantileSketch::age(double factor) {
     for (auto& knot : m_Knots) {
         knot.second *= factor;
@@ -308,6 +416,40 @@ bool CQuantileSketch::quantile(double percentage, double& result) const {
     return true;
 }
 
+bool CQuantileSketch::quantiles(const TDoubleVec& percentages, TDoubleVec& result) const {
+    result.clear();
+    if (m_Knots.empty()) {
+        LOG_ERROR(<< "No values added to quantile sketch");
+        return false;
+    }
+    if (m_Unsorted > 0) {
+        const_cast<CQuantileSketch*>(this)->reduce();
+    }
+    for (auto percentage : percentages) {
+        if (percentage < 0.0 || percentage > 100.0) {
+            LOG_ERROR(<< "Invalid percentile " << percentage);
+            return false;
+        }
+    }
+
+    // Visit the percentages in increasing order so we can resume the search
+    // for each quantile from where the last one finished.
+    TSizeVec ordering(percentages.size());
+    std::iota(ordering.begin(), ordering.end(), 0);
+    std::stable_sort(ordering.begin(), ordering.end(), [&](std::size_t lhs, std::size_t rhs) {
+        return percentages[lhs] < percentages[rhs];
+    });
+
+    result.resize(percentages.size());
+    std::size_t i{0};
+    double partial{0.0};
+    for (auto j : ordering) {
+        quantile(m_Interpolation, m_Knots, m_Count, percentages[j], i, partial, result[j]);
+    }
+
+    return true;
+}
+
 const CQuantileSketch::TFloatFloatPrVec& CQuantileSketch::knots() const {
     return m_Knots;
 }
@@ -369,15 +511,26 @@ void CQuantileSketch::quantile(EInterpolation interpolation,
                                double count,
                                double percentage,
                                double& result) {
+    std::size_t i{0};
+    double partial{0.0};
+    quantile(interpolation, knots, count, percentage, i, partial, result);
+}
+
+void CQuantileSketch::quantile(EInterpolation interpolation,
+                               const TFloatFloatPrVec& knots,
+                               double count,
+                               double percentage,
+                               std::size_t& i,
+                               double& partial,
+                               double& result) {
     std::size_t n = knots.size();
 
     percentage /= 100.0;
 
-    double partial = 0.0;
     double cutoff = percentage * count;
-    for (std::size_t i = 0; i < n; ++i) {
-        partial += knots[i].second;
-        if (partial >= cutoff - count * EPS) {
+    for (/**/; i < n; ++i) {
+        double partial_ = partial + knots[i].second;
+        if (partial_ >= cutoff - count * EPS) {
             switch (interpolation) {
             case E_Linear:
                 if (n == 1) {
@@ -395,12 +548,12 @@ void CQuantileSketch::quantile(EInterpolation interpolation,
                     double dx = (xb - xa);
                     double nb = knots[i].second;
                     double m = nb / dx;
-                    result = xb + (cutoff - partial) / m;
+                    result = xb + (cutoff - partial_) / m;
                 }
                 return;
 
             case E_PiecewiseConstant:
-                if (i + 1 == n || partial > cutoff + count * EPS) {
+                if (i + 1 == n || partial_ > cutoff + count * EPS) {
                     result = knots[i].first;
                 } else {
                     result = (knots[i].first + knots[i + 1].first) / 2.0;
@@ -408,6 +561,7 @@ void CQuantileSketch::quantile(EInterpolation interpolation,
                 return;
             }
         }
+        partial = partial_;
     }
 
     result = knots[n - 1].second;
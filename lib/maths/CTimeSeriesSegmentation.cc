@@ -19,11 +19,98 @@
 #include <maths/CTools.h>
 
 #include <algorithm>
+#include <array>
 #include <limits>
 #include <numeric>
 
 namespace ml {
 namespace maths {
+namespace {
+
+//! \brief Cumulative weighted moments of the bucket times and values.
+//!
+//! DESCRIPTION:\n
+//! These are sufficient to compute the residual sum of squares of the weighted
+//! least squares linear fit to any contiguous range of the values in constant
+//! time. The times and values are centred on the range being segmented, which
+//! keeps the cancellation when differencing the moments under control.
+class CPiecewiseLinearResiduals {
+public:
+    template<typename ITR>
+    CPiecewiseLinearResiduals(ITR begin, ITR end) {
+        std::size_t n{static_cast<std::size_t>(std::distance(begin, end))};
+        double origin{0.5 * static_cast<double>(n)};
+        CBasicStatistics::SSampleMean<double>::TAccumulator mean;
+        for (ITR i = begin; i != end; ++i) {
+            mean.add(CBasicStatistics::mean(*i), CBasicStatistics::count(*i));
+        }
+        double offset{CBasicStatistics::mean(mean)};
+
+        m_Moments.resize(n + 1, TDoubleAry{});
+        for (std::size_t i = 0; i < n; ++i, ++begin) {
+            double w{CBasicStatistics::count(*begin)};
+            double t{static_cast<double>(i) - origin};
+            double x{CBasicStatistics::mean(*begin) - offset};
+            TDoubleAry& moments{m_Moments[i + 1]};
+            moments = m_Moments[i];
+            if (w > 0.0) {
+                moments[0] += w;
+                moments[1] += w * t;
+                moments[2] += w * t * t;
+                moments[3] += w * x;
+                moments[4] += w * t * x;
+                moments[5] += w * x * x;
+            }
+        }
+    }
+
+    //! Get the total weight of the values.
+    double count() const { return m_Moments.back()[0]; }
+
+    //! Get the maximum likelihood variance of the residuals of separate linear
+    //! models fit to the values either side of \p split.
+    double variance(std::size_t split) const {
+        double n{this->count()};
+        return n == 0.0 ? 0.0
+                        : (this->residualSumSquares(0, split) +
+                           this->residualSumSquares(split, m_Moments.size() - 1)) /
+                              n;
+    }
+
+private:
+    using TDoubleAry = std::array<double, 6>;
+    using TDoubleAryVec = std::vector<TDoubleAry>;
+
+private:
+    //! Compute the residual sum of squares of the least squares linear model
+    //! fit to the values [\p a, \p b).
+    double residualSumSquares(std::size_t a, std::size_t b) const {
+        const TDoubleAry& lower{m_Moments[a]};
+        const TDoubleAry& upper{m_Moments[b]};
+        double w{upper[0] - lower[0]};
+        if (w <= 0.0) {
+            return 0.0;
+        }
+        double st{upper[1] - lower[1]};
+        double sx{upper[3] - lower[3]};
+        double ctt{(upper[2] - lower[2]) - st * st / w};
+        double ctx{(upper[4] - lower[4]) - st * sx / w};
+        double cxx{(upper[5] - lower[5]) - sx * sx / w};
+        // If there is only one distinct time we can only fit a constant.
+        double explained{ctt > EPSILON * (upper[2] - lower[2]) ? ctx * ctx / ctt : 0.0};
+        return std::max(cxx - explained, 0.0);
+    }
+
+private:
+    static constexpr double EPSILON{1e-10};
+
+private:
+    //! The cumulative moments of the values [0, i) for each i.
+    TDoubleAryVec m_Moments;
+};
+
+constexpr double CPiecewiseLinearResiduals::EPSILON;
+}
 
 CTimeSeriesSegmentation::TSizeVec
 CTimeSeriesSegmentation::piecewiseLinear(const TFloatMeanAccumulatorVec& values,
@@ -350,14 +437,6 @@ void CTimeSeriesSegmentation::fitTopDownPiecewiseLinear(ITR begin,
         using TDoubleItrPr = std::pair<double, ITR>;
         using TMinAccumulator = typename CBasicStatistics::SMin<TDoubleItrPr>::TAccumulator;
 
-        auto variance = [](const TMeanVarAccumulator& l, const TMeanVarAccumulator& r) {
-            double nl{CBasicStatistics::count(l)};
-            double nr{CBasicStatistics::count(r)};
-            return (nl * CBasicStatistics::maximumLikelihoodVariance(l) +
-                    nr * CBasicStatistics::maximumLikelihoodVariance(r)) /
-                   (nl + nr);
-        };
-
         // We iterate through every possible binary split of the data into
         // contiguous ranges looking for the split which minimizes the total
         // variance of the values minus linear model predictions. Outliers
@@ -374,22 +453,15 @@ void CTimeSeriesSegmentation::fitTopDownPiecewiseLinear(ITR begin,
             TRegressionArray leftParameters;
             TRegressionArray rightParameters;
 
+            // Each candidate split is evaluated in constant time from the
+            // cumulative moments of the (reweighted) values.
+            CPiecewiseLinearResiduals residuals{reweighted.cbegin(), reweighted.cend()};
+
             auto minimumResidualVarianceSplit = [&](ITR begin_, ITR end_, std::ptrdiff_t j) {
                 TMinAccumulator result;
-                double splitTime{startTime +
-                                 static_cast<double>(begin_ - reweighted.cbegin())};
-                leftModel = fitLinearModel(reweighted.cbegin(), begin_, startTime);
-                rightModel = fitLinearModel(begin_, reweighted.cend(), splitTime);
-                for (ITR i = begin_; j < end_ - i;
-                     i = i + j, splitTime += static_cast<double>(j)) {
-                    TRegression deltaModel{fitLinearModel(i, i + j, splitTime)};
-                    leftModel += deltaModel;
-                    rightModel -= deltaModel;
-                    double residualVariance{variance(
-                        residualMoments(reweighted.cbegin(), i + j, startTime, leftModel),
-                        residualMoments(i + j, reweighted.cend(),
-                                        splitTime + static_cast<double>(j), rightModel))};
-                    result.add({residualVariance, i + j});
+                for (ITR i = begin_; j < end_ - i; i = i + j) {
+                    std::size_t split(std::distance(reweighted.cbegin(), i + j));
+                    result.add({residuals.variance(split), i + j});
                 }
                 return result;
             };
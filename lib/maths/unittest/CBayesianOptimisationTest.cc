@@ -16,6 +16,7 @@
 #include <test/BoostTestCloseAbsolute.h>
 #include <test/CRandomNumbers.h>
 
+#include <boost/math/constants/constants.hpp>
 #include <boost/test/unit_test.hpp>
 
 #include <vector>
@@ -28,6 +29,7 @@ namespace {
 using TDoubleVec = std::vector<double>;
 using TDoubleVecVec = std::vector<TDoubleVec>;
 using TVector = maths::CDenseVector<double>;
+using TMatrix = maths::CDenseMatrix<double>;
 
 TVector vector(TDoubleVec components) {
     TVector result(components.size());
@@ -257,6 +259,47 @@ BOOST_AUTO_TEST_CASE(testExpectedImprovementGradient) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(testMinusExpectedImprovementForCandidates) {
+
+    // Test that scoring a batch of candidates gives the same expected improvement
+    // as scoring each candidate separately.
+
+    test::CRandomNumbers rng;
+    TDoubleVec coordinates;
+
+    maths::CBayesianOptimisation bopt{
+        {{-10.0, 10.0}, {-10.0, 10.0}, {-10.0, 10.0}, {-10.0, 10.0}}};
+
+    for (std::size_t i = 0; i < 8; ++i) {
+        rng.generateUniformSamples(-10.0, 10.0, 4, coordinates);
+        TVector x{vector(coordinates)};
+        bopt.add(x, x.squaredNorm(), 1.0);
+    }
+    bopt.maximumLikelihoodKernel();
+
+    maths::CBayesianOptimisation::TEIFunc ei;
+    std::tie(ei, std::ignore) = bopt.minusExpectedImprovementAndGradient();
+
+    TMatrix candidates{4, 30};
+    for (int i = 0; i < candidates.cols(); ++i) {
+        rng.generateUniformSamples(-0.5, 0.5, 4, coordinates);
+        candidates.col(i) = vector(coordinates);
+    }
+    // Include some of the points at which we've evaluated the function.
+    for (int i = 0; i < 3; ++i) {
+        candidates.col(i) = bopt.m_FunctionMeanValues[i].first;
+    }
+
+    TVector eis{bopt.minusExpectedImprovement(candidates)};
+
+    BOOST_REQUIRE_EQUAL(candidates.cols(), eis.size());
+    for (int i = 0; i < candidates.cols(); ++i) {
+        double expected{ei(candidates.col(i))};
+        BOOST_REQUIRE_CLOSE_ABSOLUTE(expected, eis(i),
+                                     1e-10 * std::max(1.0, std::fabs(expected)));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(testMaximumExpectedImprovement) {
 
     // This tests the efficiency of the search on a variety of non-convex functions.
@@ -516,4 +559,100 @@ BOOST_AUTO_TEST_CASE(testAnovaMainEffect) {
     verify(0.2, 0.8);
 }
 
+BOOST_AUTO_TEST_CASE(testAnovaVersusPairwiseSums) {
+
+    // Test the ANOVA terms against summing the kernel integrals over every
+    // pair of function evaluations one at a time.
+
+    auto integrate1dKernel = [](double theta1, double x) {
+        double c{std::sqrt(maths::CTools::pow2(theta1) + 1e-8)};
+        return boost::math::constants::root_pi<double>() *
+               (std::erf(c * (1 - x)) + std::erf(c * x)) / (2 * c);
+    };
+    auto integrate1dKernelProduct = [](double theta1, double xit, double xjt) {
+        double c{std::sqrt(maths::CTools::pow2(theta1) + 1e-8)};
+        return boost::math::constants::root_half_pi<double>() / (2 * c) *
+               std::exp(-0.5 * maths::CTools::pow2(c) * maths::CTools::pow2(xit - xjt)) *
+               (std::erf(c / boost::math::constants::root_two<double>() * (xit + xjt)) -
+                std::erf(c / boost::math::constants::root_two<double>() * (xit + xjt - 2)));
+    };
+
+    test::CRandomNumbers rng;
+    std::size_t dim{3};
+    TDoubleVec coordinates;
+
+    auto verify = [&](double min, double max) {
+        maths::CBayesianOptimisation::TDoubleDoublePrVec boundaries(dim, {min, max});
+        maths::CBayesianOptimisation bopt{boundaries};
+        for (std::size_t i = 0; i < 15; ++i) {
+            rng.generateUniformSamples(min, max, dim, coordinates);
+            TVector x{vector(coordinates)};
+            bopt.add(x, x.squaredNorm(), 1.0);
+        }
+        bopt.kernelParameters(vector({0.7, 0.5, 0.8, 0.3}));
+
+        TVector Kinvf{bopt.kinvf()};
+        TVector theta1{bopt.scaledKernelParameters()};
+        double theta02{maths::CTools::pow2(bopt.m_KernelParameters(0))};
+        double theta04{maths::CTools::pow2(theta02)};
+        std::vector<TVector> x;
+        for (const auto& value : bopt.m_FunctionMeanValues) {
+            x.push_back(bopt.transformTo01(value.first));
+        }
+        int n{static_cast<int>(x.size())};
+        int d{static_cast<int>(dim)};
+
+        auto prodXt = [&](const TVector& xi, int t) {
+            double prod{1.0};
+            for (int s = 0; s < d; ++s) {
+                if (s != t) {
+                    prod *= integrate1dKernel(theta1(s), xi(s));
+                }
+            }
+            return prod;
+        };
+
+        double f0{0.0};
+        for (int i = 0; i < n; ++i) {
+            f0 += Kinvf(i) * prodXt(x[i], -1);
+        }
+        f0 *= theta02;
+        BOOST_REQUIRE_CLOSE_ABSOLUTE(f0, bopt.anovaConstantFactor(),
+                                     1e-10 * std::max(1.0, std::fabs(f0)));
+
+        double sum{0.0};
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                double prod{1.0};
+                for (int t = 0; t < d; ++t) {
+                    prod *= integrate1dKernelProduct(theta1(t), x[i](t), x[j](t));
+                }
+                sum += Kinvf(i) * Kinvf(j) * prod;
+            }
+        }
+        double totalVariance{std::max(0.0, theta04 * sum - maths::CTools::pow2(f0))};
+        BOOST_REQUIRE_CLOSE_ABSOLUTE(totalVariance, bopt.anovaTotalVariance(),
+                                     1e-10 * std::max(1.0, theta04 * std::fabs(sum)));
+
+        for (int t = 0; t < d; ++t) {
+            double sum1{0.0};
+            double sum2{0.0};
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j) {
+                    sum1 += Kinvf(i) * Kinvf(j) * prodXt(x[i], t) * prodXt(x[j], t) *
+                            integrate1dKernelProduct(theta1(t), x[i](t), x[j](t));
+                }
+                sum2 += Kinvf(i) * integrate1dKernel(theta1(t), x[i](t)) * prodXt(x[i], t);
+            }
+            double mainEffect{theta04 * sum1 - 2.0 * theta02 * sum2 * f0 +
+                              maths::CTools::pow2(f0)};
+            BOOST_REQUIRE_CLOSE_ABSOLUTE(mainEffect, bopt.anovaMainEffect(t),
+                                         1e-10 * std::max(1.0, theta04 * std::fabs(sum1)));
+        }
+    };
+    verify(0.0, 1.0);
+    verify(-3.0, 3.0);
+    verify(0.2, 0.8);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -303,6 +303,61 @@ BOOST_AUTO_TEST_CASE(testDerivatives) {
     testDerivativesFor(3 /*loss function parameters*/);
 }
 
+BOOST_AUTO_TEST_CASE(testDiagonalDerivatives) {
+
+    // Test derivatives accumulation when we only store the diagonal of the
+    // loss Hessian. In particular, the remapped curvature should be diagonal.
+
+    test::CRandomNumbers rng;
+
+    for (std::size_t numberParameters : {3, 4, 7}) {
+
+        LOG_DEBUG(<< "Testing " << numberParameters << " parameters");
+
+        TDoubleVec gradients;
+        TDoubleVec curvatures;
+        rng.generateUniformSamples(-1.0, 1.5, 10 * numberParameters, gradients);
+        rng.generateUniformSamples(0.1, 0.5, 10 * numberParameters, curvatures);
+
+        std::size_t paddedNumberGradients{core::CAlignment::roundup<double>(
+            core::CAlignment::E_Aligned16, numberParameters)};
+
+        TAlignedDoubleVec storage(paddedNumberGradients + numberParameters * numberParameters, 0.0);
+        TDerivatives derivatives{numberParameters, &storage[0],
+                                 &storage[paddedNumberGradients], true /*diagonal*/};
+
+        TVector expectedGradient{TVector::Zero(numberParameters)};
+        TVector expectedCurvature{TVector::Zero(numberParameters)};
+        for (std::size_t j = 0; j < 10; ++j) {
+            TAlignedFloatVec rowStorage;
+            for (std::size_t i = 0; i < numberParameters; ++i) {
+                rowStorage.push_back(gradients[j * numberParameters + i]);
+                expectedGradient(i) += rowStorage.back();
+            }
+            for (std::size_t i = 0; i < numberParameters; ++i) {
+                rowStorage.push_back(curvatures[j * numberParameters + i]);
+                expectedCurvature(i) += rowStorage.back();
+            }
+            derivatives.add(1, makeAlignedVector<Eigen::Aligned16>(
+                                   &rowStorage[0], 2 * numberParameters));
+        }
+        derivatives.remapCurvature();
+
+        BOOST_REQUIRE_EQUAL(10, derivatives.count());
+        for (std::size_t i = 0; i < numberParameters; ++i) {
+            BOOST_REQUIRE_CLOSE(expectedGradient(i), derivatives.gradient()(i), 1e-4);
+            for (std::size_t j = 0; j < numberParameters; ++j) {
+                if (i == j) {
+                    BOOST_REQUIRE_CLOSE(expectedCurvature(i),
+                                        derivatives.curvature()(i, j), 1e-4);
+                } else {
+                    BOOST_REQUIRE_EQUAL(0.0, derivatives.curvature()(i, j));
+                }
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(testPerSplitDerivatives) {
 
     // Test per split derivatives accumulation for single and multi parameter
@@ -387,9 +442,9 @@ BOOST_AUTO_TEST_CASE(testGainBoundComputation) {
         TNodeVec tree(1);
 
         auto rootSplit = std::make_shared<maths::CBoostedTreeLeafNodeStatistics>(
-            0 /*root*/, extraColumns, 1, numberThreads, *frame, encoder,
-            regularization, featureSplits, treeFeatureBag, nodeFeatureBag,
-            0 /*depth*/, trainingRowMask, workspace);
+            0 /*root*/, extraColumns, 1, false /*diagonal curvature*/, numberThreads,
+            *frame, encoder, regularization, featureSplits, treeFeatureBag,
+            nodeFeatureBag, 0 /*depth*/, trainingRowMask, workspace);
 
         std::size_t splitFeature;
         double splitValue;
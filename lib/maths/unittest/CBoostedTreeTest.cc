@@ -70,6 +70,8 @@ public:
         m_TreeImpl.nodeFeatureBag(treeFeatureBag, probabilities, nodeFeatureBag);
     }
 
+    double eta() const { return m_TreeImpl.m_Eta; }
+
 private:
     CBoostedTreeImpl& m_TreeImpl;
 };
@@ -725,6 +727,89 @@ BOOST_AUTO_TEST_CASE(testThreading) {
     core::stopDefaultAsyncExecutor();
 }
 
+BOOST_AUTO_TEST_CASE(testConcurrentLeafSplits) {
+
+    // Test that splitting several leaves concurrently gives the same results
+    // whether we actually execute in parallel or not and similar accuracy to
+    // splitting one leaf at a time.
+
+    test::CRandomNumbers rng;
+    std::size_t rows{500};
+    std::size_t cols{6};
+    std::size_t capacity{100};
+
+    auto target = [&] {
+        TDoubleVec m;
+        TDoubleVec s;
+        rng.generateUniformSamples(0.0, 10.0, cols - 1, m);
+        rng.generateUniformSamples(-10.0, 10.0, cols - 1, s);
+        return [m, s, cols](const TRowRef& row) {
+            double result{0.0};
+            for (std::size_t i = 0; i < cols - 1; ++i) {
+                result += m[i] + s[i] * row[i];
+            }
+            return result;
+        };
+    }();
+
+    TDoubleVecVec x(cols - 1);
+    for (std::size_t i = 0; i < cols - 1; ++i) {
+        rng.generateUniformSamples(0.0, 10.0, rows, x[i]);
+    }
+
+    TDoubleVec noise;
+    rng.generateNormalSamples(0.0, 0.1, rows, noise);
+
+    core::stopDefaultAsyncExecutor();
+
+    TDoubleVec modelBias;
+    TDoubleVec modelMse;
+
+    std::string tests[]{"one leaf", "concurrent leaves serial", "concurrent leaves parallel"};
+    std::size_t numberConcurrentLeafSplits[]{1, 4, 4};
+
+    for (std::size_t test = 0; test < 3; ++test) {
+
+        LOG_DEBUG(<< tests[test]);
+
+        if (test == 2) {
+            core::startDefaultAsyncExecutor(4);
+        }
+
+        auto frame = core::makeMainStorageDataFrame(cols, capacity).first;
+
+        fillDataFrame(rows, 0, cols, x, noise, target, *frame);
+
+        auto regression = maths::CBoostedTreeFactory::constructFromParameters(
+                              4, std::make_unique<maths::boosted_tree::CMse>())
+                              .numberConcurrentLeafSplits(numberConcurrentLeafSplits[test])
+                              .buildFor(*frame, cols - 1);
+
+        regression->train();
+        regression->predict();
+
+        TMeanVarAccumulator modelPredictionErrorMoments;
+
+        frame->readRows(1, [&](TRowItr beginRows, TRowItr endRows) {
+            for (auto row = beginRows; row != endRows; ++row) {
+                modelPredictionErrorMoments.add(
+                    target(*row) - regression->readPrediction(*row)[0]);
+            }
+        });
+
+        LOG_DEBUG(<< "model prediction error moments = " << modelPredictionErrorMoments);
+
+        modelBias.push_back(maths::CBasicStatistics::mean(modelPredictionErrorMoments));
+        modelMse.push_back(maths::CBasicStatistics::variance(modelPredictionErrorMoments));
+    }
+
+    BOOST_REQUIRE_EQUAL(modelBias[1], modelBias[2]);
+    BOOST_REQUIRE_EQUAL(modelMse[1], modelMse[2]);
+    BOOST_TEST_REQUIRE(modelMse[1] < 1.5 * modelMse[0]);
+
+    core::stopDefaultAsyncExecutor();
+}
+
 BOOST_AUTO_TEST_CASE(testConstantFeatures) {
 
     // Test constant features are excluded from the model.
@@ -1163,6 +1248,106 @@ BOOST_AUTO_TEST_CASE(testTranslationInvariance) {
     BOOST_REQUIRE_CLOSE_ABSOLUTE(rsquared[0], rsquared[1], 0.01);
 }
 
+BOOST_AUTO_TEST_CASE(testDownsampledLineSearches) {
+
+    // Test that running the hyperparameter line searches on a sample of the
+    // training rows gives similar accuracy to running them on all rows.
+
+    test::CRandomNumbers rng;
+    double noiseVariance{4.0};
+    std::size_t trainRows{8000};
+    std::size_t rows{9000};
+    std::size_t cols{4};
+    std::size_t capacity{1000};
+
+    TDoubleVecVec x(cols - 1);
+    for (std::size_t i = 0; i < cols - 1; ++i) {
+        rng.generateUniformSamples(0.0, 10.0, rows, x[i]);
+    }
+
+    TDoubleVec noise;
+    rng.generateNormalSamples(0.0, noiseVariance, rows, noise);
+
+    auto target = [](const TRowRef& row) {
+        return 10.0 * std::sin(row[0]) + (row[1] > 5.0 ? 5.0 : 0.0) + row[2] * row[2] / 5.0;
+    };
+
+    TDoubleVec rsquared;
+    TDoubleVec eta;
+
+    for (auto downsample : {false, true}) {
+
+        auto frame = core::makeMainStorageDataFrame(cols, capacity).first;
+
+        fillDataFrame(trainRows, rows - trainRows, cols, x, noise, target, *frame);
+
+        // Choose the initial downsample rows per feature so we sample rows
+        // for the line searches.
+        auto regression = maths::CBoostedTreeFactory::constructFromParameters(
+                              1, std::make_unique<maths::boosted_tree::CMse>())
+                              .initialDownsampleRowsPerFeature(20.0)
+                              .downsampleLineSearches(downsample)
+                              .buildFor(*frame, cols - 1);
+
+        // This is the value the line searches chose.
+        eta.push_back(maths::CBoostedTreeImplForTest{regression->impl()}.eta());
+
+        regression->train();
+        regression->predict();
+
+        double modelBias;
+        double modelRSquared;
+        std::tie(modelBias, modelRSquared) = computeEvaluationMetrics(
+            *frame, trainRows, rows,
+            [&](const TRowRef& row) {
+                return regression->readPrediction(row)[0];
+            },
+            target, noiseVariance / static_cast<double>(rows));
+
+        LOG_DEBUG(<< "downsample = " << downsample << ", bias = " << modelBias
+                  << ", R^2 = " << modelRSquared << ", line search eta = " << eta.back()
+                  << ", eta = " << regression->bestHyperparameters().eta());
+        rsquared.push_back(modelRSquared);
+    }
+
+    BOOST_REQUIRE_CLOSE_ABSOLUTE(rsquared[0], rsquared[1], 0.01);
+    BOOST_REQUIRE_CLOSE(eta[0], eta[1], 15.0); // 15 %
+
+    // The downsample factor line search always uses all rows since the factor
+    // it chooses applies to all rows. If the downsample factor is the only
+    // parameter we tune we should therefore get exactly the same value.
+
+    TDoubleVec downsampleFactor;
+
+    for (auto downsample : {false, true}) {
+
+        auto frame = core::makeMainStorageDataFrame(cols, capacity).first;
+
+        fillDataFrame(trainRows, rows - trainRows, cols, x, noise, target, *frame);
+
+        auto regression = maths::CBoostedTreeFactory::constructFromParameters(
+                              1, std::make_unique<maths::boosted_tree::CMse>())
+                              .initialDownsampleRowsPerFeature(20.0)
+                              .downsampleLineSearches(downsample)
+                              .depthPenaltyMultiplier(1.0)
+                              .treeSizePenaltyMultiplier(1.0)
+                              .leafWeightPenaltyMultiplier(1.0)
+                              .softTreeDepthLimit(4.0)
+                              .softTreeDepthTolerance(0.2)
+                              .eta(0.1)
+                              .featureBagFraction(0.8)
+                              .buildFor(*frame, cols - 1);
+
+        regression->train();
+
+        LOG_DEBUG(<< "downsample = " << downsample << ", downsample factor = "
+                  << regression->bestHyperparameters().downsampleFactor());
+        downsampleFactor.push_back(regression->bestHyperparameters().downsampleFactor());
+    }
+
+    BOOST_REQUIRE_EQUAL(downsampleFactor[0], downsampleFactor[1]);
+}
+
 BOOST_AUTO_TEST_CASE(testDepthBasedRegularization) {
 
     // Test that the trained tree depth is correctly limited based on a target.
@@ -1543,6 +1728,102 @@ BOOST_AUTO_TEST_CASE(testMultinomialLogisticRegression) {
     BOOST_TEST_REQUIRE(maths::CBasicStatistics::mean(meanLogRelativeError) < 1.5);
 }
 
+BOOST_AUTO_TEST_CASE(testMultinomialLogisticRegressionDiagonalCurvature) {
+
+    // Test that approximating the Hessian of the multinomial logistic loss by
+    // its diagonal significantly reduces the number of columns we need to add
+    // to the data frame and doesn't significantly affect the accuracy of the
+    // estimated class probabilities.
+
+    using TVector = maths::CDenseVector<double>;
+    using TMemoryMappedMatrix = maths::CMemoryMappedDenseMatrix<double>;
+
+    test::CRandomNumbers testRng;
+
+    std::size_t trainRows{1000};
+    std::size_t rows{1200};
+    std::size_t cols{4};
+    std::size_t capacity{600};
+    int numberClasses{5};
+    int numberFeatures{static_cast<int>(cols - 1)};
+
+    TDoubleVec weights;
+    TDoubleVec noise;
+    testRng.generateUniformSamples(-2.0, 2.0, numberClasses * numberFeatures, weights);
+    testRng.generateNormalSamples(0.0, 1.0, numberClasses * rows, noise);
+
+    auto probability = [&](const TRowRef& row) {
+        TMemoryMappedMatrix W(&weights[0], numberClasses, numberFeatures);
+        TVector x(numberFeatures);
+        TVector n(numberClasses);
+        for (int i = 0; i < numberFeatures; ++i) {
+            x(i) = row[i];
+        }
+        for (int i = 0; i < numberClasses; ++i) {
+            n(i) = noise[numberClasses * row.index() + i];
+        }
+        TVector result{W * x + n};
+        maths::CTools::inplaceSoftmax(result);
+        return result;
+    };
+
+    TDoubleVecVec x(cols - 1);
+    for (std::size_t i = 0; i < cols - 1; ++i) {
+        testRng.generateUniformSamples(0.0, 4.0, rows, x[i]);
+    }
+
+    double logRelativeErrors[2];
+    std::size_t numberColumns[2];
+
+    for (auto diagonalCurvature : {false, true}) {
+
+        maths::CPRNG::CXorOShiro128Plus rng;
+        auto target = [&](const TRowRef& row) {
+            TDoubleVec probabilities{probability(row).to<TDoubleVec>()};
+            return static_cast<double>(maths::CSampling::categoricalSample(rng, probabilities));
+        };
+
+        auto frame = core::makeMainStorageDataFrame(cols, capacity).first;
+
+        fillDataFrame(trainRows, rows - trainRows, cols, {false, false, false, true},
+                      x, TDoubleVec(rows, 0.0), target, *frame);
+
+        auto classifier = maths::CBoostedTreeFactory::constructFromParameters(
+                              1, std::make_unique<maths::boosted_tree::CMultinomialLogisticLoss>(
+                                     numberClasses, diagonalCurvature))
+                              .buildFor(*frame, cols - 1);
+
+        classifier->train();
+        classifier->predict();
+
+        TMeanAccumulator logRelativeError;
+        frame->readRows(1, [&](TRowItr beginRows, TRowItr endRows) {
+            for (auto row = beginRows; row != endRows; ++row) {
+                if (row->index() >= trainRows) {
+                    TVector expectedProbability{probability(*row)};
+                    TVector actualProbability{
+                        TVector::fromSmallVector(classifier->readPrediction(*row))};
+                    logRelativeError.add(
+                        (expectedProbability.cwiseMax(actualProbability).array() /
+                         expectedProbability.cwiseMin(actualProbability).array())
+                            .log()
+                            .sum() /
+                        static_cast<double>(numberClasses));
+                }
+            }
+        });
+        LOG_DEBUG(<< "diagonal curvature = " << diagonalCurvature << " log relative error = "
+                  << maths::CBasicStatistics::mean(logRelativeError)
+                  << ", number columns = " << frame->numberColumns());
+
+        logRelativeErrors[diagonalCurvature] = maths::CBasicStatistics::mean(logRelativeError);
+        numberColumns[diagonalCurvature] = frame->numberColumns();
+    }
+
+    BOOST_TEST_REQUIRE(numberColumns[1] + 8 <= numberColumns[0]);
+    BOOST_TEST_REQUIRE(logRelativeErrors[1] < 1.1 * logRelativeErrors[0]);
+}
+
 BOOST_AUTO_TEST_CASE(testEstimateMemoryUsedByTrain) {
 
     // Test estimation of the memory used training a model.
@@ -26,6 +26,7 @@
 
 #include <functional>
 #include <limits>
+#include <memory>
 #include <numeric>
 #include <vector>
 
@@ -296,6 +297,7 @@ BOOST_AUTO_TEST_CASE(testColumnQuantiles) {
 
     TDoubleVecVec values(4);
     TQuantileSketchVec expectedQuantiles(4, {maths::CQuantileSketch::E_Linear, 100});
+    TQuantileSketchVec expectedMergedQuantiles(4, {maths::CQuantileSketch::E_Linear, 100});
     {
         std::size_t i = 0;
         for (auto a : {-10.0, 0.0}) {
@@ -303,9 +305,24 @@ BOOST_AUTO_TEST_CASE(testColumnQuantiles) {
                 rng.generateUniformSamples(a, b, rows, values[i++]);
             }
         }
+        // The values are added to the sketches in one batch per slice. With
+        // one thread all the batches are added to the same sketch. With four
+        // threads each thread reads one slice and the sketches are merged.
+        maths::CQuantileSketch::TFloatFloatPrVec batch;
         for (i = 0; i < cols; ++i) {
-            for (auto x : values[i]) {
-                expectedQuantiles[i].add(x);
+            for (std::size_t j = 0; j < rows; j += capacity) {
+                maths::CQuantileSketch sliceQuantiles{maths::CQuantileSketch::E_Linear, 100};
+                for (std::size_t k = j; k < std::min(j + capacity, rows); ++k) {
+                    batch.emplace_back(values[i][k], 1.0);
+                }
+                maths::CQuantileSketch::TFloatFloatPrVec sliceBatch{batch};
+                expectedQuantiles[i].add(batch);
+                sliceQuantiles.add(sliceBatch);
+                if (j == 0) {
+                    expectedMergedQuantiles[i] = std::move(sliceQuantiles);
+                } else {
+                    expectedMergedQuantiles[i] += sliceQuantiles;
+                }
             }
         }
     }
@@ -347,13 +364,14 @@ BOOST_AUTO_TEST_CASE(testColumnQuantiles) {
 
             // Check the quantile sketches match.
 
+            const auto& expected = threads == 1 ? expectedQuantiles : expectedMergedQuantiles;
             TMeanAccumulatorVec columnsMae(4);
 
             for (std::size_t i = 5; i < 100; i += 5) {
                 for (std::size_t feature = 0; feature < columnMask.size(); ++feature) {
                     double x{static_cast<double>(i)};
                     double qa, qe;
-                    BOOST_TEST_REQUIRE(expectedQuantiles[feature].quantile(x, qe));
+                    BOOST_TEST_REQUIRE(expected[feature].quantile(x, qe));
                     BOOST_TEST_REQUIRE(actualQuantiles[feature].quantile(x, qa));
                     BOOST_REQUIRE_CLOSE_ABSOLUTE(
                         qe, qa, 0.02 * std::max(std::fabs(qa), 1.5));
@@ -430,15 +448,20 @@ BOOST_AUTO_TEST_CASE(testColumnQuantilesWithEncoding) {
     TSizeVec columnMask(encoder.numberEncodedColumns());
     std::iota(columnMask.begin(), columnMask.end(), 0);
 
+    // The values are added to the sketches in one batch per slice.
     TQuantileSketchVec expectedQuantiles{columnMask.size(),
                                          {maths::CQuantileSketch::E_Linear, 100}};
     frame->readRows(1, [&](core::CDataFrame::TRowItr beginRows, core::CDataFrame::TRowItr endRows) {
+        std::vector<maths::CQuantileSketch::TFloatFloatPrVec> values(columnMask.size());
         for (auto row = beginRows; row != endRows; ++row) {
             maths::CEncodedDataFrameRowRef encodedRow{encoder.encode(*row)};
             for (std::size_t i = 0; i < columnMask.size(); ++i) {
-                expectedQuantiles[i].add(encodedRow[columnMask[i]]);
+                values[i].emplace_back(encodedRow[columnMask[i]], 1.0);
             }
         }
+        for (std::size_t i = 0; i < columnMask.size(); ++i) {
+            expectedQuantiles[i].add(values[i]);
+        }
     });
 
     TQuantileSketchVec actualQuantiles;
@@ -606,6 +629,61 @@ BOOST_AUTO_TEST_CASE(testStratifiedCrossValidationRowMasks) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(testStratifiedCrossValidationRowMasksThreadIndependence) {
+
+    // Test we get the same masks for a given seed whatever the number of threads.
+
+    test::CRandomNumbers testRng;
+
+    std::size_t numberRows{5000};
+    std::size_t capacity{300};
+    std::size_t numberFolds{4};
+    std::size_t numberBins{10};
+
+    for (bool isClassification : {true, false}) {
+
+        TDoubleVec values;
+        testRng.generateNormalSamples(0.0, 3.0, numberRows, values);
+
+        auto frame = core::makeMainStorageDataFrame(1, capacity).first;
+        frame->categoricalColumns(TBoolVec{isClassification});
+        for (std::size_t i = 0; i < numberRows; ++i) {
+            frame->writeRow([&](core::CDataFrame::TFloatVecItr column, std::int32_t&) {
+                *column = isClassification ? std::floor(std::fabs(values[i])) : values[i];
+            });
+        }
+        frame->finishWritingRows();
+
+        core::CPackedBitVector allTrainingRowsMask{generateRandomRowMask(testRng, numberRows)};
+
+        maths::CDataFrameUtils::TPackedBitVectorVec expectedTrainingRowMasks;
+        maths::CDataFrameUtils::TPackedBitVectorVec expectedTestingRowMasks;
+        TDoubleVec expectedFrequencies;
+        std::tie(expectedTrainingRowMasks, expectedTestingRowMasks, expectedFrequencies) =
+            maths::CDataFrameUtils::stratifiedCrossValidationRowMasks(
+                1, *frame, 0, maths::CPRNG::CXorOShiro128Plus{}, numberFolds,
+                numberBins, allTrainingRowsMask);
+
+        for (std::size_t threads : {2, 4}) {
+            core::startDefaultAsyncExecutor(threads);
+
+            maths::CDataFrameUtils::TPackedBitVectorVec trainingRowMasks;
+            maths::CDataFrameUtils::TPackedBitVectorVec testingRowMasks;
+            TDoubleVec frequencies;
+            std::tie(trainingRowMasks, testingRowMasks, frequencies) =
+                maths::CDataFrameUtils::stratifiedCrossValidationRowMasks(
+                    threads, *frame, 0, maths::CPRNG::CXorOShiro128Plus{},
+                    numberFolds, numberBins, allTrainingRowsMask);
+
+            core::stopDefaultAsyncExecutor();
+
+            BOOST_TEST_REQUIRE(expectedTrainingRowMasks == trainingRowMasks);
+            BOOST_TEST_REQUIRE(expectedTestingRowMasks == testingRowMasks);
+            BOOST_TEST_REQUIRE(expectedFrequencies == frequencies);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(testMicWithColumn) {
 
     // Test we get the exact MICe value when the number of rows is less than
@@ -1307,13 +1385,97 @@ BOOST_AUTO_TEST_CASE(testMaximumMinimumRecallClassWeights) {
             // We improved the minimum class recall by at least 10%.
             BOOST_TEST_REQUIRE(minRecalls[0][0] > 1.1 * minRecalls[0][1]);
 
-            // The minimum and maximum class recalls are close: we're at the global maximum.
-            BOOST_TEST_REQUIRE(1.06 * minRecalls[0][0] > maxRecalls[0][0]);
-            BOOST_TEST_REQUIRE(1.06 * minRecalls[1][0] > maxRecalls[1][0]);
+            // The minimum and maximum class recalls are close: we're at the global
+            // maximum up to the error in estimating recalls from the row sample.
+            BOOST_TEST_REQUIRE(1.08 * minRecalls[0][0] > maxRecalls[0][0]);
+            BOOST_TEST_REQUIRE(1.08 * minRecalls[1][0] > maxRecalls[1][0]);
         }
     }
 
     core::stopDefaultAsyncExecutor();
 }
 
+BOOST_AUTO_TEST_CASE(testRowToAndColumnValueBlocks) {
+
+    // Test converting rows in place and computing column values for a block
+    // of rows match converting and computing values row by row.
+
+    using TFloatVecVec = maths::CDataFrameUtils::TFloatVecVec;
+    using TDenseVector = maths::CDenseVector<double>;
+    using TMemoryMappedVector = maths::CMemoryMappedDenseVector<maths::CFloatStorage>;
+    using TColumnValueUPtr = std::unique_ptr<maths::CDataFrameUtils::CColumnValue>;
+
+    std::size_t rows{100};
+    std::size_t cols{3};
+
+    test::CRandomNumbers rng;
+
+    TDoubleVec categories;
+    TDoubleVec values;
+    rng.generateUniformSamples(0.0, 4.0, rows, categories);
+    rng.generateNormalSamples(0.0, 1.0, 2 * rows, values);
+
+    auto frame = core::makeMainStorageDataFrame(cols).first;
+    for (std::size_t i = 0; i < rows; ++i) {
+        frame->writeRow([&](core::CDataFrame::TFloatVecItr column, std::int32_t&) {
+            *(column++) = std::floor(categories[i]);
+            *(column++) = values[2 * i];
+            *column = i % 10 == 0 ? core::CDataFrame::valueOfMissing() : values[2 * i + 1];
+        });
+    }
+    frame->finishWritingRows();
+
+    auto equal = [](const auto& lhs, const auto& rhs) {
+        bool result{lhs.size() == rhs.size()};
+        for (std::ptrdiff_t i = 0; result && i < lhs.size(); ++i) {
+            result = maths::CDataFrameUtils::isMissing(lhs(i))
+                         ? maths::CDataFrameUtils::isMissing(rhs(i))
+                         : lhs(i) == rhs(i);
+        }
+        return result;
+    };
+
+    TDenseVector dense;
+    TMemoryMappedVector mapped{nullptr, 1};
+    TFloatVecVec block;
+    bool passed{true};
+    frame->readRows(1, [&](core::CDataFrame::TRowItr beginRows,
+                           core::CDataFrame::TRowItr endRows) {
+        for (auto row = beginRows; row != endRows; ++row) {
+            maths::CDataFrameUtils::rowTo(*row, dense);
+            maths::CDataFrameUtils::rowTo(*row, mapped);
+            passed &= equal(dense, maths::CDataFrameUtils::rowTo<TDenseVector>(*row));
+            passed &= (mapped.data() == row->data());
+            block.emplace_back(cols);
+            row->copyTo(block.back().begin());
+        }
+    });
+    BOOST_TEST_REQUIRE(passed);
+
+    TDoubleVec frequencies{0.1, 0.2, 0.3, 0.4};
+    boost::unordered_set<std::size_t> rareCategories{1};
+    TDoubleVec targetMeans{1.0, 2.0, 3.0, 4.0};
+
+    TColumnValueUPtr columnValues[]{
+        std::make_unique<maths::CDataFrameUtils::CMetricColumnValue>(2),
+        std::make_unique<maths::CDataFrameUtils::COneHotCategoricalColumnValue>(0, 2),
+        std::make_unique<maths::CDataFrameUtils::CFrequencyCategoricalColumnValue>(0, frequencies),
+        std::make_unique<maths::CDataFrameUtils::CTargetMeanCategoricalColumnValue>(
+            0, rareCategories, targetMeans)};
+
+    for (const auto& columnValue : columnValues) {
+        TDoubleVec blockValues;
+        (*columnValue)(block, blockValues);
+        BOOST_REQUIRE_EQUAL(block.size(), blockValues.size());
+        for (std::size_t i = 0; i < block.size(); ++i) {
+            double expected{(*columnValue)(block[i])};
+            if (maths::CDataFrameUtils::isMissing(expected)) {
+                BOOST_TEST_REQUIRE(maths::CDataFrameUtils::isMissing(blockValues[i]));
+            } else {
+                BOOST_REQUIRE_EQUAL(expected, blockValues[i]);
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
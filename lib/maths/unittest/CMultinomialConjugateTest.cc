@@ -777,6 +777,90 @@ BOOST_AUTO_TEST_CASE(testProbabilityOfLessLikelySamples) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(testLessLikelyCategoriesCalculator) {
+    // Test that a calculator which is updated as the prior changes gives
+    // identical results to computing from scratch and that computing one
+    // category's probability matches computing them all.
+
+    using TCalculator = maths::CMultinomialConjugate::CLessLikelyCategoriesCalculator;
+
+    test::CRandomNumbers rng;
+
+    maths::CMultinomialConjugate prior(
+        maths::CMultinomialConjugate::nonInformativePrior(600, 0.01));
+
+    auto addSamples = [&](std::size_t n, std::size_t numberCategories) {
+        TDoubleVec samples;
+        TDoubleVec counts;
+        rng.generateUniformSamples(0.0, static_cast<double>(numberCategories), n, samples);
+        rng.generateUniformSamples(1.0, 5.0, n, counts);
+        for (std::size_t i = 0; i < n; ++i) {
+            // Integer counts so there are many ties.
+            prior.addSamples({std::floor(samples[i])},
+                             {maths_t::countWeight(std::floor(counts[i]))});
+        }
+    };
+
+    TCalculator incremental;
+    TDoubleVec expectedLowerBounds;
+    TDoubleVec expectedUpperBounds;
+    TDoubleVec lowerBounds;
+    TDoubleVec upperBounds;
+
+    addSamples(5000, 400);
+    for (std::size_t t = 0; t < 30; ++t) {
+        switch (t % 5) {
+        case 0:
+        case 1:
+            // A few categories change.
+            addSamples(10, 400);
+            break;
+        case 2:
+            // Decay scales every concentration.
+            prior.propagateForwardsByTime(1.0);
+            break;
+        case 3:
+            // New categories.
+            addSamples(5, 500);
+            break;
+        case 4:
+            // Many categories change.
+            addSamples(1000, 400);
+            break;
+        }
+        if (t == 17) {
+            prior.removeCategories({3.0, 50.0, 100.0});
+        }
+
+        incremental.update(prior);
+        TCalculator fresh;
+        fresh.update(prior);
+
+        BOOST_REQUIRE_EQUAL(fresh.numberCategories(), incremental.numberCategories());
+
+        fresh.all(expectedLowerBounds, expectedUpperBounds);
+        incremental.all(lowerBounds, upperBounds);
+        BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedLowerBounds),
+                            core::CContainerPrinter::print(lowerBounds));
+        BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedUpperBounds),
+                            core::CContainerPrinter::print(upperBounds));
+
+        prior.probabilitiesOfLessLikelyCategories(maths_t::E_TwoSided, lowerBounds, upperBounds);
+        BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedLowerBounds),
+                            core::CContainerPrinter::print(lowerBounds));
+        BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expectedUpperBounds),
+                            core::CContainerPrinter::print(upperBounds));
+
+        for (std::size_t i = 0; i < incremental.numberCategories(); i += 7) {
+            double lowerBound;
+            double upperBound;
+            incremental(i, lowerBound, upperBound);
+            BOOST_REQUIRE_EQUAL(expectedLowerBounds[i], lowerBound);
+            BOOST_REQUIRE_EQUAL(expectedUpperBounds[i], upperBound);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(testAnomalyScore, *boost::unit_test::disabled()) {
     // TODO
 }
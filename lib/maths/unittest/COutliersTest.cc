@@ -163,7 +163,8 @@ void outlierErrorStatisticsForEnsemble(std::size_t numberThreads,
                                                     maths::COutliers::E_Ensemble,
                                                     0, // Compute number neighbours
                                                     false, // Compute feature influences
-                                                    0.05}; // Outlier fraction
+                                                    0.05, // Outlier fraction
+                                                    0.0}; // Feature influence quantile
         maths::COutliers::compute(params, *frame, instrumentation);
 
         frame->readRows(1, [&scores](core::CDataFrame::TRowItr beginRows,
@@ -510,7 +511,8 @@ BOOST_AUTO_TEST_CASE(testFeatureInfluences) {
                                                         maths::COutliers::E_Ensemble,
                                                         0, // Compute number neighbours
                                                         true, // Compute feature influences
-                                                        0.05}; // Outlier fraction
+                                                        0.05, // Outlier fraction
+                                                        0.0}; // Feature influence quantile
             maths::COutliers::compute(params, *frame, instrumentation);
 
             bool passed{true};
@@ -552,6 +554,83 @@ BOOST_AUTO_TEST_CASE(testFeatureInfluences) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(testFeatureInfluenceQuantile) {
+
+    // Test that if we only compute feature influences for points whose scores
+    // are at least a specified quantile we get the same scores and influences
+    // for those points and zero influence for the rest.
+
+    test::CRandomNumbers rng;
+
+    TDoubleVecVec inliers;
+    rng.generateMultivariateNormalSamples({0.0, 0.0}, {{7.0, 1.0}, {1.0, 8.0}},
+                                          500, inliers);
+
+    TPointVec points(inliers.size(), TPoint{2});
+    for (std::size_t i = 0; i < inliers.size(); ++i) {
+        points[i] << inliers[i][0], inliers[i][1];
+    }
+    points.emplace_back(2);
+    points.back() << 0.0, 30.0;
+    points.emplace_back(2);
+    points.back() << 40.0, 0.0;
+    points.emplace_back(2);
+    points.back() << -25.0, -25.0;
+
+    CTestInstrumentation instrumentation;
+
+    for (std::size_t numberPartitions : {1, 2}) {
+        LOG_DEBUG(<< "# partitions = " << numberPartitions);
+
+        TDoubleVecVec results[2];
+        double quantiles[]{0.0, 0.9};
+        for (std::size_t i = 0; i < 2; ++i) {
+            auto frame = test::CDataFrameTestUtils::toMainMemoryDataFrame(points);
+            maths::COutliers::SComputeParameters params{1, // Number threads
+                                                        numberPartitions,
+                                                        true, // Standardize columns
+                                                        maths::COutliers::E_Ensemble,
+                                                        0, // Compute number neighbours
+                                                        true, // Compute feature influences
+                                                        0.05, // Outlier fraction
+                                                        quantiles[i]};
+            maths::COutliers::compute(params, *frame, instrumentation);
+
+            frame->readRows(1, [&](core::CDataFrame::TRowItr beginRows,
+                                   core::CDataFrame::TRowItr endRows) {
+                for (auto row = beginRows; row != endRows; ++row) {
+                    results[i].push_back({(*row)[2], (*row)[3], (*row)[4]});
+                }
+            });
+        }
+
+        std::size_t numberWithInfluence{0};
+        double maxScoreError{0.0};
+        double maxInfluenceError{0.0};
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            maxScoreError = std::max(maxScoreError,
+                                     std::fabs(results[0][i][0] - results[1][i][0]));
+            if (results[1][i][1] + results[1][i][2] > 0.0) {
+                ++numberWithInfluence;
+                for (std::size_t j = 1; j < 3; ++j) {
+                    maxInfluenceError = std::max(
+                        maxInfluenceError, std::fabs(results[0][i][j] - results[1][i][j]));
+                }
+            }
+        }
+        LOG_DEBUG(<< "# with influence = " << numberWithInfluence);
+        LOG_DEBUG(<< "max score error = " << maxScoreError
+                  << ", max influence error = " << maxInfluenceError);
+
+        BOOST_TEST_REQUIRE(maxScoreError < 1e-6);
+        BOOST_TEST_REQUIRE(maxInfluenceError < 1e-4);
+        BOOST_TEST_REQUIRE(numberWithInfluence <= 55);
+        for (std::size_t i = points.size() - 3; i < points.size(); ++i) {
+            BOOST_TEST_REQUIRE(results[1][i][1] + results[1][i][2] > 0.99);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(testEstimateMemoryUsedByCompute) {
 
     // Test that the memory estimated for compute is close to what it uses.
@@ -593,7 +672,8 @@ BOOST_AUTO_TEST_CASE(testEstimateMemoryUsedByCompute) {
                                                     methods[i],
                                                     numberNeighbours[i],
                                                     computeFeatureInfluences[i],
-                                                    0.05}; // Outlier fraction
+                                                    0.05, // Outlier fraction
+                                                    0.0}; // Feature influence quantile
 
         std::int64_t estimatedMemoryUsage(
             core::CDataFrame::estimateMemoryUsage(i == 0, 40500, 6, core::CAlignment::E_Aligned16) +
@@ -677,7 +757,8 @@ BOOST_AUTO_TEST_CASE(testProgressMonitoring) {
                                                         maths::COutliers::E_Ensemble,
                                                         0, // Compute number neighbours
                                                         false, // Compute feature influences
-                                                        0.05}; // Outlier fraction
+                                                        0.05, // Outlier fraction
+                                                        0.0}; // Feature influence quantile
             maths::COutliers::compute(params, *frame, instrumentation);
             finished.store(true);
         }};
@@ -735,7 +816,8 @@ BOOST_AUTO_TEST_CASE(testMostlyDuplicate) {
                                                     maths::COutliers::E_Ensemble,
                                                     0, // Compute number neighbours
                                                     false, // Compute feature influences
-                                                    0.05}; // Outlier fraction
+                                                    0.05, // Outlier fraction
+                                                    0.0}; // Feature influence quantile
         maths::COutliers::compute(params, *frame, instrumentation);
 
         TDoubleVec outlierScores(outliers.size());
@@ -792,7 +874,8 @@ BOOST_AUTO_TEST_CASE(testFewPoints) {
                                                     maths::COutliers::E_Ensemble,
                                                     0, // Compute number neighbours
                                                     true, // Compute feature influences
-                                                    0.05}; // Outlier fraction
+                                                    0.05, // Outlier fraction
+                                                    0.0}; // Feature influence quantile
         maths::COutliers::compute(params, *frame, instrumentation);
 
         bool passed{true};
@@ -548,6 +548,121 @@ BOOST_AUTO_TEST_CASE(testQuantileAccuracy) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(testBulkAdd) {
+    // Test adding values in batches gives quantiles which are as accurate as
+    // adding them one at a time and preserves the sketch invariants.
+
+    using TFloatFloatPrVec = maths::CQuantileSketch::TFloatFloatPrVec;
+
+    test::CRandomNumbers rng;
+
+    TMeanAccumulator meanErrors[2];
+
+    for (std::size_t t = 0; t < 20; ++t) {
+        TDoubleVec samples;
+        switch (t % 4) {
+        case 0:
+            rng.generateUniformSamples(-100.0, 100.0, 5000, samples);
+            break;
+        case 1:
+            rng.generateNormalSamples(-10.0, 20.0, 5000, samples);
+            break;
+        case 2:
+            rng.generateLogNormalSamples(1.0, 0.5, 5000, samples);
+            break;
+        case 3:
+            // Lots of duplicates.
+            rng.generateUniformSamples(-10.0, 10.0, 5000, samples);
+            for (auto& sample : samples) {
+                sample = std::floor(sample);
+            }
+            break;
+        }
+
+        std::size_t size{t < 10 ? std::size_t{20} : std::size_t{50}};
+        maths::CQuantileSketch sketch{maths::CQuantileSketch::E_Linear, size};
+        maths::CQuantileSketch bulkSketch{maths::CQuantileSketch::E_Linear, size};
+        TFloatFloatPrVec batch;
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            sketch.add(samples[i]);
+            batch.emplace_back(samples[i], 1.0);
+            if (batch.size() == 100 * (t % 5 + 1)) {
+                bulkSketch.add(batch);
+                BOOST_TEST_REQUIRE(batch.empty());
+                BOOST_TEST_REQUIRE(bulkSketch.checkInvariants());
+            }
+        }
+        bulkSketch.add(batch);
+
+        BOOST_REQUIRE_CLOSE(sketch.count(), bulkSketch.count(), 1e-6);
+
+        // The extreme values are never merged.
+        std::sort(samples.begin(), samples.end());
+        double min;
+        double max;
+        bulkSketch.minimum(min);
+        bulkSketch.maximum(max);
+        BOOST_REQUIRE_EQUAL(static_cast<float>(samples.front()), min);
+        BOOST_REQUIRE_EQUAL(static_cast<float>(samples.back()), max);
+
+        double scale{samples.back() - samples.front()};
+        TMeanAccumulator errors[2];
+        for (std::size_t i = 1; i < 20; ++i) {
+            double q{static_cast<double>(i) / 20.0};
+            double xq{samples[static_cast<std::size_t>(static_cast<double>(samples.size()) * q)]};
+            double sq[2];
+            BOOST_TEST_REQUIRE(sketch.quantile(100.0 * q, sq[0]));
+            BOOST_TEST_REQUIRE(bulkSketch.quantile(100.0 * q, sq[1]));
+            errors[0].add(std::fabs(xq - sq[0]) / scale);
+            errors[1].add(std::fabs(xq - sq[1]) / scale);
+        }
+        LOG_DEBUG(<< "error = " << maths::CBasicStatistics::mean(errors[0])
+                  << ", bulk error = " << maths::CBasicStatistics::mean(errors[1]));
+        BOOST_TEST_REQUIRE(maths::CBasicStatistics::mean(errors[1]) <
+                           2.0 * maths::CBasicStatistics::mean(errors[0]) + 0.005);
+        meanErrors[0] += errors[0];
+        meanErrors[1] += errors[1];
+    }
+
+    LOG_DEBUG(<< "mean error = " << maths::CBasicStatistics::mean(meanErrors[0])
+              << ", mean bulk error = " << maths::CBasicStatistics::mean(meanErrors[1]));
+    BOOST_TEST_REQUIRE(maths::CBasicStatistics::mean(meanErrors[1]) <
+                       1.1 * maths::CBasicStatistics::mean(meanErrors[0]));
+}
+
+BOOST_AUTO_TEST_CASE(testQuantiles) {
+    // Test computing many quantiles at once matches computing them one by one.
+
+    test::CRandomNumbers rng;
+
+    TDoubleVec samples;
+    rng.generateNormalSamples(5.0, 4.0, 1000, samples);
+
+    for (auto interpolation : {maths::CQuantileSketch::E_Linear,
+                               maths::CQuantileSketch::E_PiecewiseConstant}) {
+        maths::CQuantileSketch sketch{interpolation, 30};
+        sketch = std::for_each(samples.begin(), samples.end(), sketch);
+
+        TDoubleVec percentages;
+        rng.generateUniformSamples(0.0, 100.0, 50, percentages);
+        percentages.push_back(0.0);
+        percentages.push_back(100.0);
+        percentages.push_back(percentages[3]);
+
+        TDoubleVec quantiles;
+        BOOST_TEST_REQUIRE(sketch.quantiles(percentages, quantiles));
+        BOOST_REQUIRE_EQUAL(percentages.size(), quantiles.size());
+        for (std::size_t i = 0; i < percentages.size(); ++i) {
+            double expected;
+            sketch.quantile(percentages[i], expected);
+            BOOST_REQUIRE_EQUAL(expected, quantiles[i]);
+        }
+
+        percentages.push_back(101.0);
+        BOOST_TEST_REQUIRE(sketch.quantiles(percentages, quantiles) == false);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(testCdf) {
     // Test that quantile and c.d.f. are idempotent.
 
@@ -6,6 +6,7 @@
 
 #include <model/CAnomalyDetector.h>
 
+#include <core/CAllocationTracker.h>
 #include <core/CContainerPrinter.h>
 #include <core/CLogger.h>
 #include <core/CMemory.h>
@@ -345,6 +346,8 @@ const CAnomalyDetector::TStrVec& CAnomalyDetector::fieldsOfInterest() const {
 }
 
 void CAnomalyDetector::addRecord(core_t::TTime time, const TStrCPtrVec& fieldValues) {
+    core::CAllocationTracker::CScopedTag allocationTag{core::CAllocationTracker::E_Gatherers};
+
     const TStrCPtrVec& processedFieldValues = this->preprocessFieldValues(fieldValues);
 
     CEventData eventData;
@@ -388,8 +391,11 @@ void CAnomalyDetector::sample(core_t::TTime startTime,
 
     core_t::TTime bucketLength = m_ModelConfig.bucketLength();
 
-    for (core_t::TTime time = startTime; time < endTime; time += bucketLength) {
-        m_Model->sample(time, time + bucketLength, resourceMonitor);
+    {
+        core::CAllocationTracker::CScopedTag allocationTag{core::CAllocationTracker::E_Models};
+        for (core_t::TTime time = startTime; time < endTime; time += bucketLength) {
+            m_Model->sample(time, time + bucketLength, resourceMonitor);
+        }
     }
 
     if ((endTime / bucketLength) % 10 == 0) {
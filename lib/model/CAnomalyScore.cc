@@ -962,8 +962,9 @@ const std::string& CAnomalyScore::normalizedScoreToSeverity(double normalizedSco
 }
 
 bool CAnomalyScore::normalizerFromJson(const std::string& json, CNormalizer& normalizer) {
-    std::istringstream iss(json);
-    core::CJsonStateRestoreTraverser traverser(iss);
+    // Parsing in-situ avoids copying every name and value.
+    std::string buffer(json);
+    core::CJsonStateRestoreTraverser traverser(buffer);
 
     return normalizerFromJson(traverser, normalizer);
 }
@@ -5,7 +5,6 @@
  */
 #include <model/CCategoryExamplesCollector.h>
 
-#include <core/CContainerPrinter.h>
 #include <core/CLogger.h>
 #include <core/CMemory.h>
 #include <core/CStatePersistInserter.h>
@@ -13,6 +12,7 @@
 #include <core/CStringUtils.h>
 
 #include <algorithm>
+#include <cstring>
 #include <vector>
 
 namespace ml {
@@ -24,10 +24,22 @@ const std::string EXAMPLES_BY_CATEGORY_TAG("a");
 const std::string CATEGORY_TAG("b");
 const std::string EXAMPLE_TAG("c");
 
-const CCategoryExamplesCollector::TStrFSet EMPTY_EXAMPLES;
-
 const std::string ELLIPSIS(3, '.');
 
+//! The number of bytes used to encode each length of a front coded example.
+const std::size_t LENGTH_BYTES{sizeof(std::uint16_t)};
+
+std::size_t readLength(const std::string& encoded, std::size_t pos) {
+    std::uint16_t length;
+    std::memcpy(&length, encoded.data() + pos, LENGTH_BYTES);
+    return length;
+}
+
+void appendLength(std::size_t length, std::string& encoded) {
+    auto length_ = static_cast<std::uint16_t>(length);
+    encoded.append(reinterpret_cast<const char*>(&length_), LENGTH_BYTES);
+}
+
 } // unnamed
 
 const std::size_t CCategoryExamplesCollector::MAX_EXAMPLE_LENGTH(1000);
@@ -47,11 +59,11 @@ bool CCategoryExamplesCollector::add(CLocalCategoryId categoryId, const std::str
     if (m_MaxExamples == 0) {
         return false;
     }
-    TStrFSet& examplesForCategory = m_ExamplesByCategory[categoryId];
+    CCompactExamples& examplesForCategory = m_ExamplesByCategory[categoryId];
     if (examplesForCategory.size() >= m_MaxExamples) {
         return false;
     }
-    return examplesForCategory.insert(truncateExample(example)).second;
+    return examplesForCategory.insert(truncateExample(example));
 }
 
 std::size_t CCategoryExamplesCollector::numberOfExamplesForCategory(CLocalCategoryId categoryId) const {
@@ -59,23 +71,30 @@ std::size_t CCategoryExamplesCollector::numberOfExamplesForCategory(CLocalCatego
     return (iterator == m_ExamplesByCategory.end()) ? 0 : iterator->second.size();
 }
 
-const CCategoryExamplesCollector::TStrFSet&
+CCategoryExamplesCollector::TStrFSet
 CCategoryExamplesCollector::examples(CLocalCategoryId categoryId) const {
+    TStrFSet result;
     auto iterator = m_ExamplesByCategory.find(categoryId);
-    if (iterator == m_ExamplesByCategory.end()) {
-        return EMPTY_EXAMPLES;
+    if (iterator != m_ExamplesByCategory.end()) {
+        result.reserve(iterator->second.size());
+        // The examples are visited in order so each insert is at the end.
+        iterator->second.forEach([&result](const std::string& example) {
+            result.insert(result.end(), example);
+        });
     }
-    return iterator->second;
+    return result;
 }
 
 void CCategoryExamplesCollector::acceptPersistInserter(core::CStatePersistInserter& inserter) const {
     // Persist the examples sorted by category ID to make it easier to compare
     // persisted state
 
-    using TLocalCategoryIdStrFSetCPtrPr = std::pair<CLocalCategoryId, const TStrFSet*>;
-    using TLocalCategoryIdStrFSetCPtrPrVec = std::vector<TLocalCategoryIdStrFSetCPtrPr>;
+    using TLocalCategoryIdCompactExamplesCPtrPr =
+        std::pair<CLocalCategoryId, const CCompactExamples*>;
+    using TLocalCategoryIdCompactExamplesCPtrPrVec =
+        std::vector<TLocalCategoryIdCompactExamplesCPtrPr>;
 
-    TLocalCategoryIdStrFSetCPtrPrVec orderedData;
+    TLocalCategoryIdCompactExamplesCPtrPrVec orderedData;
     orderedData.reserve(m_ExamplesByCategory.size());
 
     for (const auto& exampleByCategory : m_ExamplesByCategory) {
@@ -94,12 +113,12 @@ void CCategoryExamplesCollector::acceptPersistInserter(core::CStatePersistInsert
 }
 
 void CCategoryExamplesCollector::persistExamples(CLocalCategoryId categoryId,
-                                                 const TStrFSet& examples,
+                                                 const CCompactExamples& examples,
                                                  core::CStatePersistInserter& inserter) const {
     inserter.insertValue(CATEGORY_TAG, categoryId.id());
-    for (TStrFSetCItr itr = examples.begin(); itr != examples.end(); ++itr) {
-        inserter.insertValue(EXAMPLE_TAG, *itr);
-    }
+    examples.forEach([&inserter](const std::string& example) {
+        inserter.insertValue(EXAMPLE_TAG, example);
+    });
 }
 
 bool CCategoryExamplesCollector::acceptRestoreTraverser(core::CStateRestoreTraverser& traverser) {
@@ -120,7 +139,7 @@ bool CCategoryExamplesCollector::acceptRestoreTraverser(core::CStateRestoreTrave
 
 bool CCategoryExamplesCollector::restoreExamples(core::CStateRestoreTraverser& traverser) {
     CLocalCategoryId categoryId;
-    TStrFSet examples;
+    CCompactExamples examples;
     do {
         const std::string& name = traverser.name();
         if (name == CATEGORY_TAG) {
@@ -129,14 +148,16 @@ bool CCategoryExamplesCollector::restoreExamples(core::CStateRestoreTraverser& t
                 return false;
             }
         } else if (name == EXAMPLE_TAG) {
-            examples.insert(traverser.value());
+            // Examples are truncated when they're added so this is a no-op
+            // for valid state, but the encoding relies on it.
+            examples.insert(truncateExample(traverser.value()));
         }
     } while (traverser.next());
 
     if (categoryId.isValid()) {
-        LOG_TRACE(<< "Restoring examples for category " << categoryId << ": "
-                  << core::CContainerPrinter::print(examples));
-        m_ExamplesByCategory[categoryId].swap(examples);
+        LOG_TRACE(<< "Restoring " << examples.size()
+                  << " examples for category " << categoryId);
+        m_ExamplesByCategory[categoryId] = std::move(examples);
     }
 
     return true;
@@ -173,5 +194,82 @@ std::string CCategoryExamplesCollector::truncateExample(std::string example) {
     // semantics on return
     return example;
 }
+
+std::size_t CCategoryExamplesCollector::CCompactExamples::size() const {
+    return m_Size;
+}
+
+bool CCategoryExamplesCollector::CCompactExamples::insert(const std::string& example) {
+
+    // Find the position of the example, checking if it's already present.
+
+    std::string previous;
+    std::string current;
+    std::size_t pos{0};
+    while (pos < m_Encoded.size()) {
+        std::size_t next{this->decodeNext(pos, current)};
+        int comparison{current.compare(example)};
+        if (comparison == 0) {
+            return false;
+        }
+        if (comparison > 0) {
+            break;
+        }
+        previous = current;
+        pos = next;
+    }
+
+    // Only the example and its successor change encoding.
+
+    std::string encoded;
+    encoded.reserve(m_Encoded.size() + 2 * LENGTH_BYTES + example.size());
+    encoded.assign(m_Encoded, 0, pos);
+    encode(previous, example, encoded);
+    if (pos < m_Encoded.size()) {
+        pos = this->decodeNext(pos, current);
+        encode(example, current, encoded);
+        encoded.append(m_Encoded, pos, std::string::npos);
+    }
+    encoded.shrink_to_fit();
+    m_Encoded.swap(encoded);
+    ++m_Size;
+
+    return true;
+}
+
+void CCategoryExamplesCollector::CCompactExamples::debugMemoryUsage(
+    const core::CMemoryUsage::TMemoryUsagePtr& mem) const {
+    mem->setName("CCompactExamples");
+    core::CMemoryDebug::dynamicSize("m_Encoded", m_Encoded, mem);
+}
+
+std::size_t CCategoryExamplesCollector::CCompactExamples::memoryUsage() const {
+    return core::CMemory::dynamicSize(m_Encoded);
+}
+
+std::size_t
+CCategoryExamplesCollector::CCompactExamples::decodeNext(std::size_t pos,
+                                                         std::string& example) const {
+    std::size_t shared{readLength(m_Encoded, pos)};
+    std::size_t suffix{readLength(m_Encoded, pos + LENGTH_BYTES)};
+    pos += 2 * LENGTH_BYTES;
+    example.resize(shared);
+    example.append(m_Encoded, pos, suffix);
+    return pos + suffix;
+}
+
+void CCategoryExamplesCollector::CCompactExamples::encode(const std::string& previous,
+                                                          const std::string& example,
+                                                          std::string& encoded) {
+    std::size_t shared{static_cast<std::size_t>(
+        std::mismatch(previous.begin(),
+                      previous.begin() + std::min(previous.size(), example.size()),
+                      example.begin())
+            .first -
+        previous.begin())};
+    appendLength(shared, encoded);
+    appendLength(example.size() - shared, encoded);
+    encoded.append(example, shared, std::string::npos);
+}
 }
 }
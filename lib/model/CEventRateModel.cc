@@ -348,7 +348,7 @@ void CEventRateModel::sample(core_t::TTime startTime,
         }
 
         this->sampleCorrelateModels();
-        m_Probabilities = TCategoryProbabilityCache(m_ProbabilityPrior);
+        m_Probabilities.update(m_ProbabilityPrior);
     }
 }
 
@@ -576,7 +576,7 @@ void CEventRateModel::clearPrunedResources(const TSizeVec& people, const TSizeVe
         categoriesToRemove.push_back(static_cast<double>(people[i]));
     }
     m_ProbabilityPrior.removeCategories(categoriesToRemove);
-    m_Probabilities = TCategoryProbabilityCache(m_ProbabilityPrior);
+    m_Probabilities.update(m_ProbabilityPrior);
 
     this->CIndividualModel::clearPrunedResources(people, attributes);
 }
@@ -505,7 +505,7 @@ void CEventRatePopulationModel::sample(core_t::TTime startTime,
             feature.s_Models->processSamples();
         }
 
-        m_AttributeProbabilities = TCategoryProbabilityCache(m_AttributeProbabilityPrior);
+        m_AttributeProbabilities.update(m_AttributeProbabilityPrior);
         m_Probabilities.clear();
     }
 }
@@ -549,7 +549,7 @@ void CEventRatePopulationModel::prune(std::size_t maximumAge) {
     }
     std::sort(categoriesToRemove.begin(), categoriesToRemove.end());
     m_AttributeProbabilityPrior.removeCategories(categoriesToRemove);
-    m_AttributeProbabilities = TCategoryProbabilityCache(m_AttributeProbabilityPrior);
+    m_AttributeProbabilities.update(m_AttributeProbabilityPrior);
 
     this->clearPrunedResources(peopleToRemove, attributesToRemove);
     this->removePeople(peopleToRemove);
@@ -26,6 +26,9 @@ namespace {
 
 using TMinAccumulator = maths::CBasicStatistics::COrderStatisticsStack<double, 1>;
 
+//! Marks a category probability which hasn't been computed.
+const double UNCOMPUTED_PROBABILITY{-1.0};
+
 //! \brief Visitor to add a probability to variant of possible
 //! aggregation styles.
 struct SAddProbability : public boost::static_visitor<void> {
@@ -261,11 +264,18 @@ bool CModelTools::CProbabilityAggregator::calculate(double& result) const {
 }
 
 CModelTools::CCategoryProbabilityCache::CCategoryProbabilityCache()
-    : m_Prior(nullptr), m_SmallestProbability(1.0) {
+    : m_Prior(nullptr), m_Stale(true), m_SmallestProbability(UNCOMPUTED_PROBABILITY) {
 }
 
 CModelTools::CCategoryProbabilityCache::CCategoryProbabilityCache(const maths::CMultinomialConjugate& prior)
-    : m_Prior(&prior), m_SmallestProbability(1.0) {
+    : m_Prior(&prior), m_Stale(true), m_SmallestProbability(UNCOMPUTED_PROBABILITY) {
+}
+
+void CModelTools::CCategoryProbabilityCache::update(const maths::CMultinomialConjugate& prior) {
+    // The calculator is brought up to date lazily since the probabilities
+    // may not be needed before the next update.
+    m_Prior = &prior;
+    m_Stale = true;
 }
 
 bool CModelTools::CCategoryProbabilityCache::lookup(std::size_t attribute, double& result) const {
@@ -274,31 +284,46 @@ bool CModelTools::CCategoryProbabilityCache::lookup(std::size_t attribute, doubl
         return false;
     }
 
-    if (m_Cache.empty()) {
-        TDoubleVec lb;
-        TDoubleVec ub;
-        m_Prior->probabilitiesOfLessLikelyCategories(maths_t::E_TwoSided, lb, ub);
-        LOG_TRACE(<< "P({c}) >= " << core::CContainerPrinter::print(lb));
-        LOG_TRACE(<< "P({c}) <= " << core::CContainerPrinter::print(ub));
-        m_Cache.swap(lb);
-        m_SmallestProbability = 1.0;
-        for (std::size_t i = 0; i < ub.size(); ++i) {
-            m_Cache[i] = (m_Cache[i] + ub[i]) / 2.0;
-            m_SmallestProbability = std::min(m_SmallestProbability, m_Cache[i]);
-        }
+    if (m_Stale) {
+        m_Calculator.update(*m_Prior);
+        m_Cache.assign(m_Calculator.numberCategories(), UNCOMPUTED_PROBABILITY);
+        m_SmallestProbability = UNCOMPUTED_PROBABILITY;
+        m_Stale = false;
     }
 
     std::size_t index;
-    result = (!m_Prior->index(static_cast<double>(attribute), index) ||
-              index >= m_Cache.size())
-                 ? m_SmallestProbability
-                 : m_Cache[index];
+    if (!m_Prior->index(static_cast<double>(attribute), index) || index >= m_Cache.size()) {
+        if (m_SmallestProbability == UNCOMPUTED_PROBABILITY) {
+            // This needs all the probabilities so compute and cache them.
+            TDoubleVec lb;
+            TDoubleVec ub;
+            m_Calculator.all(lb, ub);
+            LOG_TRACE(<< "P({c}) >= " << core::CContainerPrinter::print(lb));
+            LOG_TRACE(<< "P({c}) <= " << core::CContainerPrinter::print(ub));
+            m_Cache.swap(lb);
+            m_SmallestProbability = 1.0;
+            for (std::size_t i = 0; i < ub.size(); ++i) {
+                m_Cache[i] = (m_Cache[i] + ub[i]) / 2.0;
+                m_SmallestProbability = std::min(m_SmallestProbability, m_Cache[i]);
+            }
+        }
+        result = m_SmallestProbability;
+    } else {
+        if (m_Cache[index] == UNCOMPUTED_PROBABILITY) {
+            double lb;
+            double ub;
+            m_Calculator(index, lb, ub);
+            m_Cache[index] = (lb + ub) / 2.0;
+        }
+        result = m_Cache[index];
+    }
     return true;
 }
 
 void CModelTools::CCategoryProbabilityCache::debugMemoryUsage(
     const core::CMemoryUsage::TMemoryUsagePtr& mem) const {
     mem->setName("CTools::CLessLikelyProbability");
+    core::CMemoryDebug::dynamicSize("m_Calculator", m_Calculator, mem->addChild());
     core::CMemoryDebug::dynamicSize("m_Cache", m_Cache, mem->addChild());
     if (m_Prior) {
         m_Prior->debugMemoryUsage(mem->addChild());
@@ -306,7 +331,8 @@ void CModelTools::CCategoryProbabilityCache::debugMemoryUsage(
 }
 
 std::size_t CModelTools::CCategoryProbabilityCache::memoryUsage() const {
-    std::size_t mem{core::CMemory::dynamicSize(m_Cache)};
+    std::size_t mem{core::CMemory::dynamicSize(m_Calculator)};
+    mem += core::CMemory::dynamicSize(m_Cache);
     if (m_Prior) {
         mem += m_Prior->memoryUsage();
     }
@@ -134,8 +134,8 @@ void CResourceMonitor::forceRefreshAll() {
 }
 
 void CResourceMonitor::updateAllowAllocations() {
-    std::size_t total{this->totalMemory()};
-    core::CProgramCounters::counter(counter_t::E_TSADMemoryUsage) = total;
+    core::CProgramCounters::counter(counter_t::E_TSADMemoryUsage) = this->totalMemory();
+    std::size_t total{this->memoryForLimits()};
     LOG_TRACE(<< "Checking allocations: currently at " << total);
     if (m_AllowAllocations) {
         if (total > this->highLimit()) {
@@ -157,7 +157,7 @@ bool CResourceMonitor::pruneIfRequired(core_t::TTime endTime) {
     // prune models to bring it down again. If usage declines, we
     // relax the pruning window to let it go back up again.
 
-    std::size_t total{this->totalMemory()};
+    std::size_t total{this->memoryForLimits()};
     bool aboveThreshold = total > m_PruneThreshold;
 
     if (m_HasPruningStarted == false && !aboveThreshold) {
@@ -200,7 +200,7 @@ bool CResourceMonitor::pruneIfRequired(core_t::TTime endTime) {
             usageAfter += resource.second;
         }
         m_MonitoredResourceCurrentMemory = usageAfter;
-        total = this->totalMemory();
+        total = this->memoryForLimits();
         this->updateAllowAllocations();
     }
 
@@ -242,7 +242,7 @@ bool CResourceMonitor::areAllocationsAllowed() const {
 }
 
 std::size_t CResourceMonitor::allocationLimit() const {
-    return this->highLimit() - std::min(this->highLimit(), this->totalMemory());
+    return this->highLimit() - std::min(this->highLimit(), this->memoryForLimits());
 }
 
 void CResourceMonitor::memUsage(CMonitoredResource* resource) {
@@ -390,6 +390,11 @@ CResourceMonitor::createMemoryUsageReport(core_t::TTime bucketStartTime) {
     }
     res.s_AllocationFailures += m_AllocationFailures.size();
     res.s_OverallCategorizerStats.s_MemoryCategorizationFailures += m_CategorizerAllocationFailures;
+    if (core::CAllocationTracker::enabled()) {
+        res.s_AllocatedBytes = core::CAllocationTracker::liveBytesByTag();
+        LOG_TRACE(<< "estimated usage = " << res.s_Usage << ", allocated = "
+                  << core::CAllocationTracker::totalLiveBytes());
+    }
     return res;
 }
 
@@ -481,5 +486,17 @@ std::size_t CResourceMonitor::totalMemory() const {
            CStringStore::influencers().memoryUsage();
 }
 
+std::size_t CResourceMonitor::allocatedMemory() const {
+    return core::CAllocationTracker::liveBytes(core::CAllocationTracker::E_Gatherers) +
+           core::CAllocationTracker::liveBytes(core::CAllocationTracker::E_Models) +
+           core::CAllocationTracker::liveBytes(core::CAllocationTracker::E_Categorizer);
+}
+
+std::size_t CResourceMonitor::memoryForLimits() const {
+    // If the estimates are missing some memory we still want to respect the
+    // limits, but the estimates are still reported so they can be validated.
+    return std::max(this->totalMemory(), this->allocatedMemory());
+}
+
 } // model
 } // ml
@@ -7,6 +7,7 @@
 #include <model/CStringStore.h>
 
 #include <core/CContainerPrinter.h>
+#include <core/CHashing.h>
 #include <core/CLogger.h>
 #include <core/CScopedFastLock.h>
 #include <core/CStatePersistInserter.h>
@@ -18,10 +19,11 @@ namespace model {
 namespace {
 
 //! \brief Helper class to hash a std::string.
+//!
+//! \note This must match the hash cached by CStoredStringPtr.
 struct SStrHash {
     std::size_t operator()(const std::string& key) const {
-        boost::hash<std::string> hasher;
-        return hasher(key);
+        return core::CHashing::CMurmurHash2String{}(key);
     }
 } STR_HASH;
 
@@ -60,62 +62,23 @@ const core::CStoredStringPtr& CStringStore::getEmpty() const {
 }
 
 core::CStoredStringPtr CStringStore::get(const std::string& value) {
-    // This section is expected to be performed frequently.
-    //
-    // We ensure either:
-    //   1) Some threads may perform an insert and no thread will perform
-    //      a find until no threads can still perform an insert.
-    //   2) Some threads may perform a find and no thread will perform
-    //      an insert until no thread can still perform a find.
-    //
-    // We "leak" strings if there is contention between reading and writing,
-    // which is expected to be rare because inserts are expected to be rare.
+    // This is expected to be performed frequently and to almost always find
+    // an existing string, in which case it doesn't lock.
 
     if (value.empty()) {
         return m_EmptyString;
     }
 
-    core::CStoredStringPtr result;
-
-    m_Reading.fetch_add(1, std::memory_order_release);
-    if (m_Writing.load(std::memory_order_consume) == 0) {
-        auto i = m_Strings.find(value, STR_HASH, STR_EQUAL);
-        if (i != m_Strings.end()) {
-            result = *i;
-            m_Reading.fetch_sub(1, std::memory_order_release);
-        } else {
-            m_Writing.fetch_add(1, std::memory_order_acq_rel);
-            // NB: fetch_sub() returns the OLD value, and we know we added 1 in
-            // this thread, hence the test for 1 rather than 0
-            if (m_Reading.fetch_sub(1, std::memory_order_release) == 1) {
-                // This section is expected to occur infrequently so inserts
-                // are synchronized with a mutex.
-                core::CScopedFastLock lock(m_Mutex);
-                auto ret = m_Strings.insert(core::CStoredStringPtr::makeStoredString(value));
-                result = *ret.first;
-                if (ret.second) {
-                    m_StoredStringsMemUse += result.actualMemoryUsage();
-                }
-                m_Writing.fetch_sub(1, std::memory_order_release);
-            } else {
-                m_Writing.fetch_sub(1, std::memory_order_relaxed);
-                // This is leaked in the sense that it will never be shared and
-                // won't count towards our reported memory usage.  But it is not
-                // leaked in the traditional sense of the word, as its memory
-                // will be freed when the single user is finished with it.
-                result = core::CStoredStringPtr::makeStoredString(value);
-            }
-        }
-    } else {
-        m_Reading.fetch_sub(1, std::memory_order_relaxed);
-        // This is leaked in the sense that it will never be shared and won't
-        // count towards our reported memory usage.  But it is not leaked
-        // in the traditional sense of the word, as its memory will be freed
-        // when the single user is finished with it.
-        result = core::CStoredStringPtr::makeStoredString(value);
+    auto result = m_Strings.insert(value, STR_HASH, STR_EQUAL, [&value] {
+        auto stored = core::CStoredStringPtr::makeStoredString(value);
+        std::size_t memoryUsage{stored.actualMemoryUsage()};
+        return TStoredStringPtrSizeCMap::TKeyValuePr{std::move(stored), memoryUsage};
+    });
+    if (result.second) {
+        m_StoredStringsMemUse.fetch_add(result.first->second, std::memory_order_relaxed);
     }
 
-    return result;
+    return result.first->first;
 }
 
 void CStringStore::remove(const std::string& value) {
@@ -126,10 +89,10 @@ void CStringStore::remove(const std::string& value) {
 void CStringStore::pruneRemovedNotThreadSafe() {
     core::CScopedFastLock lock(m_Mutex);
     for (const auto& removed : m_Removed) {
-        auto i = m_Strings.find(removed, STR_HASH, STR_EQUAL);
-        if (i != m_Strings.end() && i->isUnique()) {
-            m_StoredStringsMemUse -= i->actualMemoryUsage();
-            m_Strings.erase(i);
+        const auto* entry = m_Strings.find(removed, STR_HASH, STR_EQUAL);
+        if (entry != nullptr && entry->first.isUnique()) {
+            m_StoredStringsMemUse.fetch_sub(entry->second, std::memory_order_relaxed);
+            m_Strings.eraseNotThreadSafe(removed, STR_HASH, STR_EQUAL);
         }
     }
     m_Removed.clear();
@@ -137,14 +100,13 @@ void CStringStore::pruneRemovedNotThreadSafe() {
 
 void CStringStore::pruneNotThreadSafe() {
     core::CScopedFastLock lock(m_Mutex);
-    for (auto i = m_Strings.begin(); i != m_Strings.end(); /**/) {
-        if (i->isUnique()) {
-            m_StoredStringsMemUse -= i->actualMemoryUsage();
-            i = m_Strings.erase(i);
-        } else {
-            ++i;
+    m_Strings.eraseIfNotThreadSafe([this](const TStoredStringPtrSizeCMap::TKeyValuePr& entry) {
+        if (entry.first.isUnique()) {
+            m_StoredStringsMemUse.fetch_sub(entry.second, std::memory_order_relaxed);
+            return true;
         }
-    }
+        return false;
+    });
 }
 
 void CStringStore::debugMemoryUsage(const core::CMemoryUsage::TMemoryUsagePtr& mem) const {
@@ -153,43 +115,42 @@ void CStringStore::debugMemoryUsage(const core::CMemoryUsage::TMemoryUsagePtr& m
                      : (this == &CStringStore::influencers() ? "influencers StringStore"
                                                              : "unknown StringStore"));
     mem->addItem("empty string ptr", m_EmptyString.actualMemoryUsage());
-    core::CScopedFastLock lock(m_Mutex);
     core::CMemoryDebug::dynamicSize("stored strings", m_Strings, mem);
+    core::CScopedFastLock lock(m_Mutex);
     core::CMemoryDebug::dynamicSize("removed strings", m_Removed, mem);
-    mem->addItem("stored string ptr memory", m_StoredStringsMemUse);
+    mem->addItem("stored string ptr memory",
+                 m_StoredStringsMemUse.load(std::memory_order_relaxed));
 }
 
 std::size_t CStringStore::memoryUsage() const {
     std::size_t mem = m_EmptyString.actualMemoryUsage();
-    core::CScopedFastLock lock(m_Mutex);
     // The assumption here is that the existence of
-    // core::CStoredStringPtr::dynamicSizeAlwaysZero() combined with dead code
-    // elimination will make calculating the size of m_Strings boil down to a
-    // couple of simple multiplications and additions
+    // core::CStoredStringPtr::dynamicSizeAlwaysZero() means calculating the
+    // size of m_Strings boils down to a couple of simple multiplications and
+    // additions
     mem += core::CMemory::dynamicSize(m_Strings);
+    core::CScopedFastLock lock(m_Mutex);
     // This one could be more expensive, but the assumption is that there won't
     // be many memory usage calculations while m_Removed is populated
     mem += core::CMemory::dynamicSize(m_Removed);
     // This adds back the size that was excluded from
     // core::CMemory::dynamicSize(m_Strings)
-    mem += m_StoredStringsMemUse;
+    mem += m_StoredStringsMemUse.load(std::memory_order_relaxed);
     return mem;
 }
 
 CStringStore::CStringStore()
-    : m_Reading(0), m_Writing(0),
-      m_EmptyString(core::CStoredStringPtr::makeStoredString(std::string())),
+    : m_EmptyString(core::CStoredStringPtr::makeStoredString(std::string())),
       m_StoredStringsMemUse(0) {
 }
 
 void CStringStore::clearEverythingTestOnly() {
     // For tests that assert on memory usage it's important that these
     // containers get returned to the state of a default constructed container
-    TStoredStringPtrUSet emptySet;
-    emptySet.swap(m_Strings);
+    m_Strings.clearNotThreadSafe();
     TStrVec emptyVec;
     emptyVec.swap(m_Removed);
-    m_StoredStringsMemUse = 0;
+    m_StoredStringsMemUse.store(0);
 }
 
 } // model
@@ -13,6 +13,7 @@
 #include <core/RestoreMacros.h>
 
 #include <functional>
+#include <limits>
 
 namespace ml {
 namespace model {
@@ -35,20 +36,47 @@ const std::string BASE_RAW_STRING_LENGTH{"k"};
 //! token ID/weight pairs.
 class CTokenIdLess {
 public:
-    bool operator()(CTokenListCategory::TSizeSizePr lhs, CTokenListCategory::TSizeSizePr rhs) {
+    bool operator()(const CTokenListCategory::TUInt32UInt16Pr& lhs,
+                    const CTokenListCategory::TUInt32UInt16Pr& rhs) {
         return lhs.first < rhs.first;
     }
 
-    bool operator()(std::size_t lhs, CTokenListCategory::TSizeSizePr rhs) {
+    bool operator()(std::size_t lhs, const CTokenListCategory::TUInt32UInt16Pr& rhs) {
         return lhs < rhs.first;
     }
 
-    bool operator()(CTokenListCategory::TSizeSizePr lhs, std::size_t rhs) {
+    bool operator()(const CTokenListCategory::TUInt32UInt16Pr& lhs, std::size_t rhs) {
         return lhs.first < rhs;
     }
 
     bool operator()(std::size_t lhs, std::size_t rhs) { return lhs < rhs; }
 };
+
+//! Get the compact representation of a token ID and weight, saturating
+//! the weight if it overflows.
+CTokenListCategory::TUInt32UInt16Pr toUInt32UInt16Pr(std::size_t tokenId, std::size_t weight) {
+    return {static_cast<std::uint32_t>(tokenId),
+            static_cast<std::uint16_t>(std::min(
+                weight, static_cast<std::size_t>(std::numeric_limits<std::uint16_t>::max())))};
+}
+
+//! Get the compact representation of a collection of token IDs and weights.
+template<typename PAIR_CONTAINER>
+CTokenListCategory::TUInt32UInt16PrVec toUInt32UInt16PrVec(const PAIR_CONTAINER& tokenIds) {
+    CTokenListCategory::TUInt32UInt16PrVec result;
+    result.reserve(tokenIds.size());
+    for (const auto& tokenId : tokenIds) {
+        result.push_back(toUInt32UInt16Pr(tokenId.first, tokenId.second));
+    }
+    return result;
+}
+
+//! Release the spare capacity of \p tokenIds if it is mostly unused.
+void shrinkIfSparse(CTokenListCategory::TUInt32UInt16PrVec& tokenIds) {
+    if (2 * tokenIds.size() <= tokenIds.capacity()) {
+        tokenIds.shrink_to_fit();
+    }
+}
 }
 
 CTokenListCategory::CTokenListCategory(bool isDryRun,
@@ -57,14 +85,14 @@ CTokenListCategory::CTokenListCategory(bool isDryRun,
                                        const TSizeSizePrVec& baseTokenIds,
                                        std::size_t baseWeight,
                                        const TSizeSizeMap& uniqueTokenIds)
-    : m_BaseString{std::move(baseString)}, m_BaseTokenIds{baseTokenIds},
+    : m_BaseString{std::move(baseString)}, m_BaseTokenIds{toUInt32UInt16PrVec(baseTokenIds)},
       m_BaseWeight{baseWeight}, m_BaseRawStringLen{rawStringLen},
       m_MaxStringLen{rawStringLen}, m_OrderedCommonTokenEndIndex{baseTokenIds.size()},
       // Note: m_CommonUniqueTokenIds is required to be in sorted order, and
       // this relies on uniqueTokenIds being in sorted order
-      m_CommonUniqueTokenIds{uniqueTokenIds.begin(), uniqueTokenIds.end()},
+      m_CommonUniqueTokenIds{toUInt32UInt16PrVec(uniqueTokenIds)},
       m_NumMatches{isDryRun ? 0u : 1u}, m_Changed{!isDryRun} {
-    for (auto uniqueTokenId : uniqueTokenIds) {
+    for (const auto& uniqueTokenId : m_CommonUniqueTokenIds) {
         m_CommonUniqueTokenWeight += uniqueTokenId.second;
     }
     m_OrigUniqueTokenWeight = m_CommonUniqueTokenWeight;
@@ -91,27 +119,27 @@ bool CTokenListCategory::acceptRestoreTraverser(core::CStateRestoreTraverser& tr
         if (name == BASE_STRING) {
             m_BaseString = traverser.value();
         } else if (name == BASE_TOKEN_ID) {
-            TSizeSizePr tokenAndWeight{0, 0};
-            if (core::CStringUtils::stringToType(traverser.value(),
-                                                 tokenAndWeight.first) == false) {
+            std::size_t tokenId{0};
+            if (core::CStringUtils::stringToType(traverser.value(), tokenId) == false) {
                 LOG_ERROR(<< "Invalid base token ID in " << traverser.value());
                 return false;
             }
 
-            m_BaseTokenIds.push_back(tokenAndWeight);
+            m_BaseTokenIds.push_back(toUInt32UInt16Pr(tokenId, 0));
         } else if (name == BASE_TOKEN_WEIGHT) {
             if (m_BaseTokenIds.empty()) {
                 LOG_ABORT(<< "Base token weight precedes base token ID in "
                           << traverser.value());
             }
 
-            TSizeSizePr& tokenAndWeight = m_BaseTokenIds.back();
-            if (core::CStringUtils::stringToType(traverser.value(),
-                                                 tokenAndWeight.second) == false) {
+            TUInt32UInt16Pr& tokenAndWeight = m_BaseTokenIds.back();
+            std::size_t weight{0};
+            if (core::CStringUtils::stringToType(traverser.value(), weight) == false) {
                 LOG_ERROR(<< "Invalid base token weight in " << traverser.value());
                 return false;
             }
 
+            tokenAndWeight = toUInt32UInt16Pr(tokenAndWeight.first, weight);
             m_BaseWeight += tokenAndWeight.second;
         } else if (name == MAX_STRING_LEN) {
             if (core::CStringUtils::stringToType(traverser.value(), m_MaxStringLen) == false) {
@@ -133,14 +161,13 @@ bool CTokenListCategory::acceptRestoreTraverser(core::CStateRestoreTraverser& tr
                 return false;
             }
         } else if (name == COMMON_UNIQUE_TOKEN_ID) {
-            TSizeSizePr tokenAndWeight{0, 0};
-            if (core::CStringUtils::stringToType(traverser.value(),
-                                                 tokenAndWeight.first) == false) {
+            std::size_t tokenId{0};
+            if (core::CStringUtils::stringToType(traverser.value(), tokenId) == false) {
                 LOG_ERROR(<< "Invalid common unique token ID in " << traverser.value());
                 return false;
             }
 
-            m_CommonUniqueTokenIds.push_back(tokenAndWeight);
+            m_CommonUniqueTokenIds.push_back(toUInt32UInt16Pr(tokenId, 0));
             expectWeight = true;
         } else if (name == COMMON_UNIQUE_TOKEN_WEIGHT) {
             if (!expectWeight) {
@@ -149,13 +176,14 @@ bool CTokenListCategory::acceptRestoreTraverser(core::CStateRestoreTraverser& tr
                 return false;
             }
 
-            TSizeSizePr& tokenAndWeight = m_CommonUniqueTokenIds.back();
-            if (core::CStringUtils::stringToType(traverser.value(),
-                                                 tokenAndWeight.second) == false) {
+            TUInt32UInt16Pr& tokenAndWeight = m_CommonUniqueTokenIds.back();
+            std::size_t weight{0};
+            if (core::CStringUtils::stringToType(traverser.value(), weight) == false) {
                 LOG_ERROR(<< "Invalid common unique token weight in "
                           << traverser.value());
                 return false;
             }
+            tokenAndWeight = toUInt32UInt16Pr(tokenAndWeight.first, weight);
             expectWeight = false;
 
             m_CommonUniqueTokenWeight += tokenAndWeight.second;
@@ -181,6 +209,10 @@ bool CTokenListCategory::acceptRestoreTraverser(core::CStateRestoreTraverser& tr
     // Ensure that m_CommonUniqueTokenIds is sorted in ascending order.
     std::sort(m_CommonUniqueTokenIds.begin(), m_CommonUniqueTokenIds.end(), CTokenIdLess{});
 
+    // Don't retain the spare capacity left by growing the token lists.
+    m_BaseTokenIds.shrink_to_fit();
+    m_CommonUniqueTokenIds.shrink_to_fit();
+
     // m_BaseRawStringLen will only have been persisted by 7.9 and above.
     // In this case the absolute maximum set at the beginning of the method
     // will still be set.  A reasonable compromise that will result in
@@ -256,6 +288,9 @@ bool CTokenListCategory::updateCommonUniqueTokenIds(const TSizeSizeMap& newUniqu
             ++newIter;
         }
     }
+    if (changed) {
+        shrinkIfSparse(m_CommonUniqueTokenIds);
+    }
     return changed;
 }
 
@@ -370,7 +405,7 @@ const std::string& CTokenListCategory::baseString() const {
     return m_BaseString;
 }
 
-const CTokenListCategory::TSizeSizePrVec& CTokenListCategory::baseTokenIds() const {
+const CTokenListCategory::TUInt32UInt16PrVec& CTokenListCategory::baseTokenIds() const {
     return m_BaseTokenIds;
 }
 
@@ -378,7 +413,7 @@ std::size_t CTokenListCategory::baseWeight() const {
     return m_BaseWeight;
 }
 
-const CTokenListCategory::TSizeSizePrVec& CTokenListCategory::commonUniqueTokenIds() const {
+const CTokenListCategory::TUInt32UInt16PrVec& CTokenListCategory::commonUniqueTokenIds() const {
     return m_CommonUniqueTokenIds;
 }
 
@@ -450,32 +485,6 @@ bool CTokenListCategory::matchesSearchForCategory(const CTokenListCategory& othe
                                           other.m_CommonUniqueTokenIds, other.m_BaseTokenIds);
 }
 
-bool CTokenListCategory::containsCommonInOrderTokensInOrder(const TSizeSizePrVec& tokenIds) const {
-
-    auto testIter = tokenIds.begin();
-    for (std::size_t index = m_OrderedCommonTokenBeginIndex;
-         index < m_OrderedCommonTokenEndIndex; ++index) {
-        std::size_t baseTokenId{m_BaseTokenIds[index].first};
-
-        // Ignore tokens that are not in the common unique tokens
-        if (this->isTokenCommon(baseTokenId) == false) {
-            continue;
-        }
-
-        // Skip tokens in the test tokens until we find one that matches the
-        // base token.  If we reach the end of the test tokens whilst doing
-        // this, it means the test tokens don't contain the common ordered base
-        // tokens in the correct order.
-        do {
-            if (testIter == tokenIds.end()) {
-                return false;
-            }
-        } while ((testIter++)->first != baseTokenId);
-    }
-
-    return true;
-}
-
 bool CTokenListCategory::isTokenCommon(std::size_t tokenId) const {
     return std::binary_search(m_CommonUniqueTokenIds.begin(),
                               m_CommonUniqueTokenIds.end(), tokenId, CTokenIdLess());
@@ -488,7 +497,7 @@ std::size_t CTokenListCategory::numMatches() const {
 void CTokenListCategory::acceptPersistInserter(core::CStatePersistInserter& inserter) const {
     inserter.insertValue(BASE_STRING, m_BaseString);
 
-    for (auto baseTokenId : m_BaseTokenIds) {
+    for (const auto& baseTokenId : m_BaseTokenIds) {
         inserter.insertValue(BASE_TOKEN_ID, baseTokenId.first);
         inserter.insertValue(BASE_TOKEN_WEIGHT, baseTokenId.second);
     }
@@ -497,7 +506,7 @@ void CTokenListCategory::acceptPersistInserter(core::CStatePersistInserter& inse
     inserter.insertValue(ORDERED_COMMON_TOKEN_BEGIN_INDEX, m_OrderedCommonTokenBeginIndex);
     inserter.insertValue(ORDERED_COMMON_TOKEN_END_INDEX, m_OrderedCommonTokenEndIndex);
 
-    for (auto commonUniqueTokenId : m_CommonUniqueTokenIds) {
+    for (const auto& commonUniqueTokenId : m_CommonUniqueTokenIds) {
         inserter.insertValue(COMMON_UNIQUE_TOKEN_ID, commonUniqueTokenId.first);
         inserter.insertValue(COMMON_UNIQUE_TOKEN_WEIGHT, commonUniqueTokenId.second);
     }
@@ -85,7 +85,7 @@ CTokenListDataCategorizerBase::computeCategory(bool isDryRun,
     double bestSoFarSimilarity{m_LowerThreshold};
     for (auto iter = m_CategoriesByCount.begin(); iter != m_CategoriesByCount.end(); ++iter) {
         const CTokenListCategory& compCategory{m_Categories[iter->second]};
-        const TSizeSizePrVec& baseTokenIds{compCategory.baseTokenIds()};
+        const TUInt32UInt16PrVec& baseTokenIds{compCategory.baseTokenIds()};
         std::size_t baseWeight{compCategory.baseWeight()};
 
         // Check whether the current record matches the search for the existing
@@ -213,8 +213,8 @@ bool CTokenListDataCategorizerBase::cacheReverseSearch(CLocalCategoryId category
     std::string part1;
     std::string part2;
 
-    const TSizeSizePrVec& baseTokenIds{category.baseTokenIds()};
-    const TSizeSizePrVec& commonUniqueTokenIds{category.commonUniqueTokenIds()};
+    const TUInt32UInt16PrVec& baseTokenIds{category.baseTokenIds()};
+    const TUInt32UInt16PrVec& commonUniqueTokenIds{category.commonUniqueTokenIds()};
     if (commonUniqueTokenIds.empty()) {
         // There's quite a high chance this call will return false
         if (m_ReverseSearchCreator->createNoUniqueTokenSearch(
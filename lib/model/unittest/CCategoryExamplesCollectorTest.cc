@@ -4,6 +4,8 @@
  * you may not use this file except in compliance with the Elastic License.
  */
 
+#include <core/CContainerPrinter.h>
+#include <core/CMemory.h>
 #include <core/CRapidXmlParser.h>
 #include <core/CRapidXmlStatePersistInserter.h>
 #include <core/CRapidXmlStateRestoreTraverser.h>
@@ -12,6 +14,11 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
 BOOST_TEST_DONT_PRINT_LOG_VALUE(ml::model::CCategoryExamplesCollector::TStrFSet::iterator)
 
 BOOST_AUTO_TEST_SUITE(CCategoryExamplesCollectorTest)
@@ -168,4 +175,61 @@ BOOST_AUTO_TEST_CASE(testTruncation) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(testSharedPrefixes) {
+
+    // Test examples with shared prefixes added in various orders are all
+    // recovered in sorted order, survive persistence and use less memory
+    // than storing them separately.
+
+    const std::string prefix{"2021-03-01 10:00:00 INFO [main] org.elasticsearch.node.Node: "};
+    std::vector<std::string> examples{prefix + "started",   prefix + "stopping",
+                                      prefix + "stopped",   prefix + "starting",
+                                      prefix + "start",     prefix,
+                                      "another message",    prefix + "closing",
+                                      prefix + "initialized"};
+
+    std::size_t separateMemory{0};
+    for (const auto& example : examples) {
+        separateMemory += example.size();
+    }
+
+    for (std::size_t trial = 0; trial < 10; ++trial) {
+        std::rotate(examples.begin(), examples.begin() + 1, examples.end());
+        if (trial % 2 == 1) {
+            std::reverse(examples.begin(), examples.end());
+        }
+
+        CCategoryExamplesCollector examplesCollector(examples.size());
+        for (const auto& example : examples) {
+            BOOST_TEST_REQUIRE(examplesCollector.add(CLocalCategoryId{1}, example));
+            BOOST_TEST_REQUIRE(examplesCollector.add(CLocalCategoryId{1}, example) == false);
+        }
+        BOOST_REQUIRE_EQUAL(examples.size(), examplesCollector.numberOfExamplesForCategory(
+                                                 CLocalCategoryId{1}));
+
+        std::set<std::string> expected(examples.begin(), examples.end());
+        BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expected),
+                            core::CContainerPrinter::print(
+                                examplesCollector.examples(CLocalCategoryId{1})));
+
+        BOOST_TEST_REQUIRE(core::CMemory::dynamicSize(examplesCollector) < separateMemory);
+
+        std::string origXml;
+        {
+            core::CRapidXmlStatePersistInserter inserter("root");
+            examplesCollector.acceptPersistInserter(inserter);
+            inserter.toXml(origXml);
+        }
+
+        core::CRapidXmlParser parser;
+        BOOST_TEST_REQUIRE(parser.parseStringIgnoreCdata(origXml));
+        core::CRapidXmlStateRestoreTraverser traverser(parser);
+        CCategoryExamplesCollector restoredExamplesCollector(examples.size(), traverser);
+
+        BOOST_REQUIRE_EQUAL(core::CContainerPrinter::print(expected),
+                            core::CContainerPrinter::print(restoredExamplesCollector.examples(
+                                CLocalCategoryId{1})));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
  * you may not use this file except in compliance with the Elastic License.
  */
 
+#include <core/CAllocationTracker.h>
 #include <core/CWordDictionary.h>
 #include <core/Constants.h>
 
@@ -17,7 +18,9 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <memory>
 #include <string>
+#include <vector>
 
 BOOST_AUTO_TEST_SUITE(CResourceMonitorTest)
 
@@ -543,6 +546,30 @@ BOOST_FIXTURE_TEST_CASE(testExtraMemory, CTestFixture) {
     BOOST_REQUIRE_EQUAL(allocationLimit, monitor.allocationLimit());
 }
 
+BOOST_FIXTURE_TEST_CASE(testAllocatedMemory, CTestFixture) {
+
+    // Test that if allocations are tracked the bytes allocated by the monitored
+    // subsystems count towards the memory limit.
+
+    CResourceMonitor monitor;
+    monitor.memoryLimit(1);
+    monitor.forceRefreshAll();
+    BOOST_TEST_REQUIRE(monitor.areAllocationsAllowed());
+
+    std::unique_ptr<std::vector<char>> buffer;
+    {
+        core::CAllocationTracker::CScopedTag tag{core::CAllocationTracker::E_Models};
+        buffer = std::make_unique<std::vector<char>>(2 * core::constants::BYTES_IN_MEGABYTES);
+    }
+    monitor.forceRefreshAll();
+    BOOST_REQUIRE_EQUAL(core::CAllocationTracker::enabled() == false,
+                        monitor.areAllocationsAllowed());
+
+    buffer.reset();
+    monitor.forceRefreshAll();
+    BOOST_TEST_REQUIRE(monitor.areAllocationsAllowed());
+}
+
 BOOST_FIXTURE_TEST_CASE(testPeakUsage, CTestFixture) {
     // Clear the counter so that other test cases do not interfere.
     core::CProgramCounters::counter(counter_t::E_TSADPeakMemoryUsage) = 0;
@@ -12,6 +12,7 @@
 
 #include <boost/optional.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/unordered_set.hpp>
 
 #include <memory>
 #include <tuple>
@@ -213,7 +214,8 @@ BOOST_FIXTURE_TEST_CASE(testStringStore, CTestFixture) {
             threads[i]->uniques(uniques);
         }
         LOG_DEBUG(<< "unique counts = " << uniques.size());
-        BOOST_TEST_REQUIRE(uniques.size() < 20000);
+        // Concurrent inserts of the same string should never duplicate it.
+        BOOST_REQUIRE_EQUAL(lotsOfStrings.size(), uniques.size());
 
         // Tidy up
         for (std::size_t i = 0; i < threads.size(); ++i) {
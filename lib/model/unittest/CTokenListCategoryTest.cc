@@ -5,12 +5,18 @@
  */
 
 #include <core/CContainerPrinter.h>
+#include <core/CLogger.h>
+#include <core/CRapidXmlParser.h>
+#include <core/CRapidXmlStatePersistInserter.h>
+#include <core/CRapidXmlStateRestoreTraverser.h>
 
 #include <model/CTokenListCategory.h>
 
 #include <boost/test/unit_test.hpp>
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <string>
 
 BOOST_AUTO_TEST_SUITE(CTokenListCategoryTest)
@@ -164,4 +170,66 @@ BOOST_AUTO_TEST_CASE(testCommonTokensDifferentOrder) {
         ml::core::CContainerPrinter::print(category.orderedCommonTokenBounds()));
 }
 
+BOOST_AUTO_TEST_CASE(testCompactTokensPersistence) {
+
+    // Test that weights which don't fit in the compact token representation
+    // saturate, that such tokens are then never common, and that the token
+    // lists survive a persist and restore round trip.
+
+    const std::size_t maxWeight{std::numeric_limits<std::uint16_t>::max()};
+
+    std::string baseString{"error error error disk full"};
+    ml::model::CTokenListCategory::TSizeSizePrVec baseTokenIds{
+        {0 /* error */, 2}, {1 /* disk */, 2}, {2 /* full */, 2}};
+    ml::model::CTokenListCategory::TSizeSizeMap baseUniqueTokenIds{
+        {0 /* error */, maxWeight + 10}, {1 /* disk */, 2}, {2 /* full */, 2}};
+
+    ml::model::CTokenListCategory category(false, baseString, baseString.length(),
+                                           baseTokenIds, 6, baseUniqueTokenIds);
+
+    BOOST_REQUIRE_EQUAL(ml::core::CContainerPrinter::print(baseTokenIds),
+                        ml::core::CContainerPrinter::print(category.baseTokenIds()));
+    BOOST_REQUIRE_EQUAL(3, category.commonUniqueTokenIds().size());
+    BOOST_REQUIRE_EQUAL(0, category.commonUniqueTokenIds()[0].first);
+    BOOST_REQUIRE_EQUAL(maxWeight, category.commonUniqueTokenIds()[0].second);
+    BOOST_REQUIRE_EQUAL(maxWeight + 4, category.commonUniqueTokenWeight());
+
+    BOOST_TEST_REQUIRE(category.addString(false, baseString, baseString.length(),
+                                          baseTokenIds, baseUniqueTokenIds));
+    BOOST_TEST_REQUIRE(category.isTokenCommon(0) == false);
+    BOOST_REQUIRE_EQUAL(4, category.commonUniqueTokenWeight());
+
+    std::string origXml;
+    {
+        ml::core::CRapidXmlStatePersistInserter inserter("root");
+        category.acceptPersistInserter(inserter);
+        inserter.toXml(origXml);
+    }
+    LOG_DEBUG(<< "XML:\n" << origXml);
+
+    ml::core::CRapidXmlParser parser;
+    BOOST_TEST_REQUIRE(parser.parseStringIgnoreCdata(origXml));
+    ml::core::CRapidXmlStateRestoreTraverser traverser(parser);
+    ml::model::CTokenListCategory restoredCategory{traverser};
+
+    BOOST_REQUIRE_EQUAL(
+        ml::core::CContainerPrinter::print(category.baseTokenIds()),
+        ml::core::CContainerPrinter::print(restoredCategory.baseTokenIds()));
+    BOOST_REQUIRE_EQUAL(
+        ml::core::CContainerPrinter::print(category.commonUniqueTokenIds()),
+        ml::core::CContainerPrinter::print(restoredCategory.commonUniqueTokenIds()));
+    BOOST_REQUIRE_EQUAL(category.baseWeight(), restoredCategory.baseWeight());
+    BOOST_REQUIRE_EQUAL(category.commonUniqueTokenWeight(),
+                        restoredCategory.commonUniqueTokenWeight());
+    BOOST_TEST_REQUIRE(restoredCategory.memoryUsage() <= category.memoryUsage());
+
+    std::string newXml;
+    {
+        ml::core::CRapidXmlStatePersistInserter inserter("root");
+        restoredCategory.acceptPersistInserter(inserter);
+        inserter.toXml(newXml);
+    }
+    BOOST_REQUIRE_EQUAL(origXml, newXml);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -66,6 +66,14 @@ CDataFrameAnalysisSpecificationFactory::diskUsageAllowed(bool disk) {
     return *this;
 }
 
+CDataFrameAnalysisSpecificationFactory&
+CDataFrameAnalysisSpecificationFactory::frameCache(const std::string& directory,
+                                                   const std::string& key) {
+    m_FrameCacheDirectory = directory;
+    m_FrameCacheKey = key;
+    return *this;
+}
+
 CDataFrameAnalysisSpecificationFactory&
 CDataFrameAnalysisSpecificationFactory::outlierMethod(std::string method) {
     m_Method = method;
@@ -211,6 +219,12 @@ CDataFrameAnalysisSpecificationFactory::classificationWeights(const TStrDoublePr
     return *this;
 }
 
+CDataFrameAnalysisSpecificationFactory&
+CDataFrameAnalysisSpecificationFactory::diagonalCurvature(bool diagonal) {
+    m_DiagonalCurvature = diagonal;
+    return *this;
+}
+
 CDataFrameAnalysisSpecificationFactory&
 CDataFrameAnalysisSpecificationFactory::regressionLossFunction(TLossFunctionType lossFunction) {
     m_RegressionLossFunction = lossFunction;
@@ -268,6 +282,7 @@ CDataFrameAnalysisSpecificationFactory::outlierSpec() const {
         "testJob", rows, columns, memoryLimit, 1, m_MissingString, {},
         m_DiskUsageAllowed, CTestTmpDir::tmpDir(), "ml",
         api::CDataFrameOutliersRunnerFactory::NAME, this->outlierParams())};
+    spec = this->addFrameCache(std::move(spec));
 
     LOG_TRACE(<< "spec =\n" << spec);
 
@@ -375,6 +390,10 @@ CDataFrameAnalysisSpecificationFactory::predictionParams(const std::string& anal
             }
             writer.EndArray();
         }
+        if (m_DiagonalCurvature) {
+            writer.Key(TClassificationRunner::DIAGONAL_CURVATURE);
+            writer.Bool(*m_DiagonalCurvature);
+        }
     }
     if (analysis == regression()) {
         if (m_RegressionLossFunction) {
@@ -418,6 +437,7 @@ CDataFrameAnalysisSpecificationFactory::predictionSpec(const std::string& analys
         "testJob", rows, columns, memoryLimit, 1, m_MissingString,
         m_CategoricalFieldNames, true, CTestTmpDir::tmpDir(), "ml", analysis,
         this->predictionParams(analysis, dependentVariable))};
+    spec = this->addFrameCache(std::move(spec));
 
     LOG_TRACE(<< "spec =\n" << spec);
 
@@ -430,5 +450,29 @@ CDataFrameAnalysisSpecificationFactory::predictionSpec(const std::string& analys
         return std::make_unique<api::CDataFrameAnalysisSpecification>(spec);
     }
 }
+
+std::string CDataFrameAnalysisSpecificationFactory::addFrameCache(std::string spec) const {
+
+    if (m_FrameCacheKey.empty()) {
+        return spec;
+    }
+
+    rapidjson::Document document;
+    document.Parse(spec);
+    auto& allocator = document.GetAllocator();
+    document.AddMember(
+        rapidjson::Value{api::CDataFrameAnalysisSpecification::FRAME_CACHE_DIRECTORY, allocator},
+        rapidjson::Value{m_FrameCacheDirectory, allocator}, allocator);
+    document.AddMember(
+        rapidjson::Value{api::CDataFrameAnalysisSpecification::FRAME_CACHE_KEY, allocator},
+        rapidjson::Value{m_FrameCacheKey, allocator}, allocator);
+
+    rapidjson::StringBuffer result;
+    TRapidJsonLineWriter writer;
+    writer.Reset(result);
+    document.Accept(writer);
+
+    return result.GetString();
+}
 }
 }
@@ -63,5 +63,10 @@ LOCAL_DRIVE=C
 include $(CPP_SRC_HOME)/mk/windows.mk
 endif
 
+# Optionally replace the global allocation functions to track live heap bytes
+ifdef ML_ALLOCATION_TRACKING
+CPPFLAGS+=-DML_ALLOCATION_TRACKING
+endif
+
 OBJS_DIR=.objs
 